@@ -565,7 +565,8 @@
 //!     "start_time":           "2018-04-23T18:25:43.511Z",
 //!     "timeout":              3.0,
 //!     "advertising_interval": 1.0,
-//!     "ghost_mode":           false
+//!     "ghost_mode":           false,
+//!     "unix_socket_name":     "yogi-123e4567-e89b-12d3-a456-426655440000"
 //!   }
 //! \endcode
 #define YOGI_BEV_BRANCH_QUERIED (1 << 1)
@@ -592,10 +593,28 @@
 //! \endcode
 #define YOGI_BEV_CONNECTION_LOST (1 << 3)
 
+//! A branch has been penalized for falling behind on broadcast messages
+//!
+//! The penalty depends on the _tx_slow_consumer_policy_ branch property. With
+//! the _disconnect_ policy, the event gets generated right before the
+//! connection gets closed.
+//!
+//! Associated event information:
+//!
+//! \code
+//!   {
+//!     "uuid":    "123e4567-e89b-12d3-a456-426655440000",
+//!     "policy":  "drop",
+//!     "backlog": 65536
+//!   }
+//! \endcode
+#define YOGI_BEV_SLOW_CONSUMER (1 << 4)
+
 //! All branch events
 #define YOGI_BEV_ALL                                      \
   (YOGI_BEV_BRANCH_DISCOVERED | YOGI_BEV_BRANCH_QUERIED | \
-   YOGI_BEV_CONNECT_FINISHED | YOGI_BEV_CONNECTION_LOST)
+   YOGI_BEV_CONNECT_FINISHED | YOGI_BEV_CONNECTION_LOST | \
+   YOGI_BEV_SLOW_CONSUMER)
 
 //! @}
 //!
@@ -1271,6 +1290,9 @@ YOGI_API int YOGI_ConfigurationWriteToFile(void* config, const char* filename,
 /*!
  * Creates a context for the execution of asynchronous operations.
  *
+ * The context gets run by a single thread; see
+ * YOGI_ContextCreateWithThreads() for running it on multiple threads.
+ *
  * \param[out] context Pointer to the context handle
  *
  * \returns [=0] #YOGI_OK if successful
@@ -1278,6 +1300,25 @@ YOGI_API int YOGI_ConfigurationWriteToFile(void* config, const char* filename,
  */
 YOGI_API int YOGI_ContextCreate(void** context);
 
+/*!
+ * Creates a context for the execution of asynchronous operations that gets
+ * run by multiple threads.
+ *
+ * The \p num_threads parameter determines how many threads execute the
+ * context's handlers when running it via YOGI_ContextRunInBackground() or
+ * YOGI_ContextRun(). In the latter case, the calling thread is one of them.
+ * Operations belonging to the same branch connection are serialized, so
+ * handlers for different connections can run in parallel. Handlers passed to
+ * YOGI_ContextPost() may run concurrently if \p num_threads is larger than 1.
+ *
+ * \param[out] context     Pointer to the context handle
+ * \param[in]  num_threads Number of threads running the context (at least 1)
+ *
+ * \returns [=0] #YOGI_OK if successful
+ * \returns [<0] An error code in case of a failure (see \ref EC)
+ */
+YOGI_API int YOGI_ContextCreateWithThreads(void** context, int num_threads);
+
 /*!
  * Runs the context's event processing loop to execute ready handlers.
  *
@@ -1358,6 +1399,32 @@ YOGI_API int YOGI_ContextRun(void* context, int* count, long long duration);
  */
 YOGI_API int YOGI_ContextRunOne(void* context, int* count, long long duration);
 
+/*!
+ * Runs the context's event processing loop for the specified duration without
+ * ever blocking.
+ *
+ * This function behaves like YOGI_ContextRun() but instead of sleeping while
+ * waiting for events, it continuously polls for ready handlers. This keeps the
+ * calling thread (and any other threads of the context) busy at 100% CPU load
+ * but avoids the latency of being woken up by the operating system.
+ *
+ * Once a context has been run in busy-poll mode, TCP connections established
+ * by branches using the context additionally set the SO_BUSY_POLL socket
+ * option where supported.
+ *
+ * This function must be called from outside any handler functions that are
+ * being executed through the context.
+ *
+ * \param[in]  context  The context to use
+ * \param[out] count    Number of executed handlers (may be set to NULL)
+ * \param[in]  duration Duration in nanoseconds (-1 for infinity)
+ *
+ * \returns [=0] #YOGI_OK if successful
+ * \returns [<0] An error code in case of a failure (see \ref EC)
+ */
+YOGI_API int YOGI_ContextRunBusyPoll(void* context, int* count,
+                                    long long duration);
+
 /*!
  * Starts an internal thread for running the context's event processing loop.
  *
@@ -1376,6 +1443,27 @@ YOGI_API int YOGI_ContextRunOne(void* context, int* count, long long duration);
  */
 YOGI_API int YOGI_ContextRunInBackground(void* context);
 
+/*!
+ * Starts internal threads for running the context's event processing loop in
+ * busy-poll mode.
+ *
+ * This function works like YOGI_ContextRunInBackground() except that the
+ * threads never block (see YOGI_ContextRunBusyPoll()). Optionally, the threads
+ * can be pinned to CPUs: the first thread gets pinned to \p cpu, the second
+ * one to \p cpu + 1 and so on.
+ *
+ * This function must be called from outside any handler functions that are
+ * being executed through the context.
+ *
+ * \param[in] context The context to use
+ * \param[in] cpu     Index of the CPU to pin the first thread to (-1 to not
+ *                    pin the threads)
+ *
+ * \returns [=0] #YOGI_OK if successful
+ * \returns [<0] An error code in case of a failure (see \ref EC)
+ */
+YOGI_API int YOGI_ContextRunInBackgroundBusyPoll(void* context, int cpu);
+
 /*!
  * Stops the context's event processing loop.
  *
@@ -1452,6 +1540,198 @@ YOGI_API int YOGI_ContextWaitForStopped(void* context, long long duration);
 YOGI_API int YOGI_ContextPost(void* context, void (*fn)(void* userarg),
                               void* userarg);
 
+/*!
+ * Adds multiple functions to the context's event processing queue as a single
+ * handler and returns immediately.
+ *
+ * The \p n functions get wrapped into one handler which calls them in the
+ * given order from the same thread; fns[i] will be called with userargs[i] as
+ * its only parameter. This differs from calling YOGI_ContextPost() for each
+ * function:
+ *  - The batch counts as a single handler, i.e. YOGI_ContextRunOne() executes
+ *    all of its functions and the statistics from YOGI_ContextGetStats() count
+ *    it as one handler.
+ *  - The functions never run concurrently, not even if multiple threads are
+ *    running the context's event processing loop.
+ *
+ * If \p n is 0, then nothing gets added to the queue.
+ *
+ * \param[in] context  The context to use
+ * \param[in] fns      Array of \p n functions to call from within the context
+ * \param[in] userargs Array of \p n user-specified arguments to be passed to
+ *                     the functions (may be set to NULL to pass NULL to all)
+ * \param[in] n        Number of functions
+ *
+ * \returns [=0] #YOGI_OK if successful
+ * \returns [<0] An error code in case of a failure (see \ref EC)
+ */
+YOGI_API int YOGI_ContextPostBatch(void* context, void (*fns[])(void* userarg),
+                                   void* userargs[], int n);
+
+/*!
+ * Enables or disables recording statistics about the context's event
+ * processing loop.
+ *
+ * When enabled, the context measures the execution time of handlers, the time
+ * that posted handlers spend waiting in the queue as well as the number of
+ * queued handlers. The data can be retrieved via YOGI_ContextGetStats().
+ * Enabling the statistics resets them.
+ *
+ * Handlers taking longer than \p slow_threshold to execute get reported via a
+ * warning log entry.
+ *
+ * \param[in] context        The context to use
+ * \param[in] enable         #YOGI_TRUE to enable and #YOGI_FALSE to disable
+ *                           the statistics
+ * \param[in] slow_threshold Execution time in nanoseconds above which
+ *                           handlers are considered slow (-1 to never report
+ *                           slow handlers)
+ *
+ * \returns [=0] #YOGI_OK if successful
+ * \returns [<0] An error code in case of a failure (see \ref EC)
+ */
+YOGI_API int YOGI_ContextConfigureStats(void* context, int enable,
+                                       long long slow_threshold);
+
+/*!
+ * Retrieves the statistics about the context's event processing loop.
+ *
+ * The statistics will be returned in the following JSON format. All times are
+ * in seconds. Histograms contain one count per upper bound plus an additional
+ * count for all values above the last upper bound.
+ *
+ * \code
+ *   {
+ *     "enabled":                true,
+ *     "period":                 12.5,
+ *     "threads":                2,
+ *     "handlers":               10453,
+ *     "queued_handlers":        3,
+ *     "max_queued_handlers":    17,
+ *     "busy_time":              0.84,
+ *     "utilization":            0.0336,
+ *     "slow_handler_threshold": 0.01,
+ *     "slow_handlers":          1,
+ *     "execution_times":        {"upper_bounds": [1e-06, 2e-06, ...],
+ *                                "counts":       [9123, 1001, ...]},
+ *     "queue_delays":           {"upper_bounds": [1e-06, 2e-06, ...],
+ *                                "counts":       [412, 87, ...]}
+ *   }
+ * \endcode
+ *
+ * The utilization is the time spent executing handlers relative to the time
+ * the context's threads were available during the period. Handlers that were
+ * already running when the statistics got reset count towards the new period,
+ * so the utilization may slightly exceed 1.
+ *
+ * All handlers executed by the context get recorded, including completion
+ * handlers of I/O operations, timers, signals and accepted connections.
+ * Handlers which get executed inline from within another handler (e.g. when
+ * dispatched through a strand) are part of the enclosing handler's execution
+ * time and do not count as separate handlers.
+ *
+ * If the statistics do not fit into \p json, then the function returns
+ * #YOGI_ERR_BUFFER_TOO_SMALL. In this case, \p json will *not* contain valid
+ * JSON data.
+ *
+ * \param[in]  context  The context to use
+ * \param[out] json     Pointer to a char array for storing the statistics (can
+ *                      be set to NULL)
+ * \param[in]  jsonsize Maximum number of bytes to write to \p json
+ * \param[in]  reset    #YOGI_TRUE to reset the statistics after reading them
+ *                      and #YOGI_FALSE otherwise
+ *
+ * \returns [=0] #YOGI_OK if successful
+ * \returns [<0] An error code in case of a failure (see \ref EC)
+ */
+YOGI_API int YOGI_ContextGetStats(void* context, char* json, int jsonsize,
+                                  int reset);
+
+/*!
+ * Creates a group of contexts that share the connections of their branches.
+ *
+ * A context group consists of \p num_contexts single-threaded contexts
+ * (shards). Branches can be created on any of them via
+ * YOGI_ContextGroupGetContext() and YOGI_BranchCreate(). The connections of
+ * such a branch are distributed over all contexts of the group: outgoing
+ * connections by the UUID of the remote branch and incoming connections in a
+ * round-robin fashion. Each connection is then handled by its context, i.e.
+ * the connection's I/O, timers and received messages are processed on that
+ * context's thread. This spreads the work for the connections over the
+ * threads of the group. However, all connections of a branch still share
+ * some state protected by locks, e.g. the branch's list of connections, its
+ * receive queues, the log used for sending broadcasts and the memory pool for
+ * handlers, so connections on different contexts can still contend.
+ *
+ * Handlers for operations on such a branch, e.g. the ones passed to
+ * YOGI_BranchAwaitEventAsync() or YOGI_BranchReceiveBroadcastAsync(), get
+ * called from the thread of whichever context of the group handles the
+ * connection that caused them to be called, i.e. not necessarily from the
+ * thread of the context that the branch has been created on.
+ *
+ * The contexts of the group are regular context objects. They can only be
+ * destroyed after the group has been destroyed.
+ *
+ * \param[out] group        Pointer to the context group handle
+ * \param[in]  num_contexts Number of contexts to create; 0 creates one context
+ *                          per CPU core
+ *
+ * \returns [=0] #YOGI_OK if successful
+ * \returns [<0] An error code in case of a failure (see \ref EC)
+ */
+YOGI_API int YOGI_ContextGroupCreate(void** group, int num_contexts);
+
+/*!
+ * Retrieves a context of a context group.
+ *
+ * \param[in]  group   The context group
+ * \param[in]  index   Index of the context (starting at 0)
+ * \param[out] context Pointer to the context handle
+ *
+ * \returns [=0] #YOGI_OK if successful
+ * \returns [<0] An error code in case of a failure (see \ref EC)
+ */
+YOGI_API int YOGI_ContextGroupGetContext(void* group, int index,
+                                         void** context);
+
+/*!
+ * Runs the event processing loops of all contexts in a group, each in its own
+ * background thread.
+ *
+ * If \p pin is set to #YOGI_TRUE, the thread of the context with index i gets
+ * pinned to CPU core i (modulo the number of cores). On platforms that do not
+ * support this, a warning is logged and the threads run unpinned.
+ *
+ * \param[in] group The context group
+ * \param[in] pin   Pin the threads to CPU cores (#YOGI_TRUE or #YOGI_FALSE)
+ *
+ * \returns [=0] #YOGI_OK if successful
+ * \returns [<0] An error code in case of a failure (see \ref EC)
+ */
+YOGI_API int YOGI_ContextGroupRunInBackground(void* group, int pin);
+
+/*!
+ * Stops the event processing loops of all contexts in a group.
+ *
+ * \param[in] group The context group
+ *
+ * \returns [=0] #YOGI_OK if successful
+ * \returns [<0] An error code in case of a failure (see \ref EC)
+ */
+YOGI_API int YOGI_ContextGroupStop(void* group);
+
+/*!
+ * Blocks until no context in a group is running its event processing loop any
+ * more.
+ *
+ * \param[in] group    The context group
+ * \param[in] duration Maximum time to wait in nanoseconds (-1 for infinity)
+ *
+ * \returns [=0] #YOGI_OK if successful
+ * \returns [<0] An error code in case of a failure (see \ref EC)
+ */
+YOGI_API int YOGI_ContextGroupWaitForStopped(void* group, long long duration);
+
 /*!
  * Raises a signal.
  *
@@ -1622,7 +1902,16 @@ YOGI_API int YOGI_TimerCancel(void* timer);
  *     "timeout":                3.0,
  *     "ghost_mode":             false,
  *     "tx_queue_size":          1000000,
- *     "rx_queue_size":          100000
+ *     "rx_queue_size":          100000,
+ *     "tx_coalescing_delay":    0.0,
+ *     "tx_coalescing_bytes":    -1,
+ *     "tx_zerocopy_threshold":  -1,
+ *     "tx_fanout_partitions":   1,
+ *     "rx_broadcast_queue_depth": 0,
+ *     "tx_slow_consumer_policy": "block",
+ *     "tx_slow_consumer_threshold": 500000,
+ *     "tx_slow_consumer_timeout": 1.0,
+ *     "tx_overflow_budget":     -1
  *   }
  * \endcode
  *
@@ -1648,6 +1937,57 @@ YOGI_API int YOGI_TimerCancel(void* timer);
  *  - __ghost_mode__: Set to true to activate ghost mode.
  *  - __tx_queue_size__: Size of the send queues for remote branches.
  *  - __rx_queue_size__: Size of the receive queues for remote branches.
+ *  - __tx_coalescing_delay__: Maximum time that outgoing messages get held
+ *    back in order to send them together with subsequent ones. Set to 0 to
+ *    send every message immediately (default).
+ *  - __tx_coalescing_bytes__: Number of queued bytes at which held back
+ *    messages get sent immediately. Set to -1 (default) to only limit the
+ *    delay. Held back messages are always sent as soon as the send queue is
+ *    full.
+ *  - __tx_zerocopy_threshold__: Minimum size of a single write to a TCP
+ *    connection for which the kernel sends directly from the send queue
+ *    instead of copying the data (Linux only). This pays off for large
+ *    messages but frees up space in the send queue only once the peer has
+ *    acknowledged the data. Set to -1 (default) to always copy.
+ *  - __tx_fanout_partitions__: Number of partitions that the connections
+ *    running on the same context get split into when they are woken up to
+ *    send a broadcast. Each partition is handled by a single handler, so
+ *    with large numbers of connections, several partitions allow a multi-
+ *    threaded context to send the broadcast on all of them in parallel. Set
+ *    to 0 to use one partition per thread of the context. Default is 1.
+ *  - __rx_broadcast_queue_depth__: Maximum number of received broadcast
+ *    messages that get queued while no receive operation is active. Once the
+ *    queue is full, further broadcasts get discarded until it has been
+ *    drained. Set to 0 (default) to discard all broadcasts that arrive while
+ *    no receive operation is active. Queued messages get stored in reusable
+ *    buffers of #YOGI_CONST_MAX_MESSAGE_PAYLOAD_SIZE bytes, one per queue
+ *    entry, which get allocated the first time they are needed.
+ *  - __tx_slow_consumer_policy__: What to do with a connection whose backlog
+ *    of unsent broadcast messages exceeds _tx_slow_consumer_threshold_ bytes.
+ *    With _block_ (default), the connection's send queue simply fills up
+ *    while other connections keep receiving broadcasts; once it is full,
+ *    sending a broadcast without retrying fails with #YOGI_ERR_TX_QUEUE_FULL
+ *    as before. With _drop_, the connection skips all broadcasts it fell
+ *    behind on and with _conflate_, it skips all but the latest one. With
+ *    _disconnect_, the connection gets closed if its backlog still exceeds
+ *    the threshold after _tx_slow_consumer_timeout_ seconds. A message that
+ *    is being written to the connection always gets completed, but the
+ *    broadcasts behind it get skipped right away, even if the connection is
+ *    stalled. A #YOGI_BEV_SLOW_CONSUMER event gets generated whenever a
+ *    connection gets penalized.
+ *  - __tx_slow_consumer_threshold__: Backlog in bytes above which a connection
+ *    is considered to be slow. Defaults to half of _tx_queue_size_.
+ *  - __tx_slow_consumer_timeout__: Time in seconds that a connection may stay
+ *    slow before it gets closed by the _disconnect_ policy. Default is 1.0.
+ *  - __tx_overflow_budget__: Broadcasts are stored once for all connections
+ *    in a queue of _tx_queue_size_ bytes. A connection that falls further
+ *    behind than that gets a queue of the same size for itself and from then
+ *    on receives its own copy of every broadcast until it has caught up.
+ *    This property limits the total size of these queues; it is rounded down
+ *    to a multiple of _tx_queue_size_. A connection that falls behind while
+ *    the budget is used up gets closed and the connection-lost event reports
+ *    #YOGI_ERR_TX_QUEUE_FULL. Set to -1 (default) for no limit, in which case
+ *    the worst case is one queue per connection.
  *
  * Advertising and establishing connections can be limited to certain network
  * interfaces via the _interface_ property. The default is to use all
@@ -1661,6 +2001,15 @@ YOGI_API int YOGI_TimerCancel(void* timer);
  * for obtaining information about active branches without actually becoming
  * part of the Yogi network.
  *
+ * On Linux, branches running on the same host connect to each other via a Unix
+ * domain socket in the abstract namespace instead of TCP. The socket name is
+ * derived from the branch's UUID and listed as _unix_socket_name_ in the
+ * branch information; TCP is used if connecting to it fails. Once connected,
+ * the data itself gets exchanged via ring buffers in shared memory, falling
+ * back to the socket if the shared memory cannot be set up. Branches within
+ * the same process bypass the operating system entirely and pass data to each
+ * other directly.
+ *
  * \note
  *   Even if the communication between branches is not encrypted, the
  *   authentication process via passwords is always done in a secure manner.
@@ -1717,7 +2066,8 @@ YOGI_API int YOGI_BranchCreate(void** branch, void* context, const char* props,
  *     "tcp_server_port":        53332,
  *     "start_time":             "2018-04-23T18:25:43.511Z",
  *     "timeout":                3.0,
- *     "ghost_mode":             false
+ *     "ghost_mode":             false,
+ *     "unix_socket_name":       "yogi-6ba7b810-9dad-11d1-80b4-00c04fd430c8"
  *   }
  * \endcode
  *
@@ -1768,7 +2118,8 @@ YOGI_API int YOGI_BranchGetInfo(void* branch, void* uuid, char* json,
  *     "start_time":           "2018-04-23T18:25:43.511Z",
  *     "timeout":              3.0,
  *     "advertising_interval": 1.0,
- *     "ghost_mode":           false
+ *     "ghost_mode":           false,
+ *     "unix_socket_name":     "yogi-123e4567-e89b-12d3-a456-426655440000"
  *   }
  * \endcode
  *
@@ -1877,6 +2228,13 @@ YOGI_API int YOGI_BranchCancelAwaitEvent(void* branch);
  * until the message has been put into the send queues of all connected
  * branches.
  *
+ * The branch's _tx_slow_consumer_policy_ property does not change this: with
+ * _block_ (default) and _disconnect_, a single branch with a full send queue
+ * causes #YOGI_ERR_TX_QUEUE_FULL, even though all other branches receive the
+ * message. Only with _drop_ and _conflate_, branches that are currently being
+ * penalized for being slow skip the message without causing the error; they
+ * get reported via #YOGI_BEV_SLOW_CONSUMER events instead.
+ *
  * \attention
  *   Calling this function from within a handler function executed through the
  *   branch's _context_  with \p block set to #YOGI_TRUE will cause a dead-lock
@@ -1921,7 +2279,8 @@ YOGI_API int YOGI_BranchSendBroadcast(void* branch, int enc, const void* data,
  * branch was skipped, the handler \p fn will be called with the
  * #YOGI_ERR_TX_QUEUE_FULL error. If the parameter is set to #YOGI_TRUE instead,
  * \p fn will be called once the message has been put into the send queues of
- * all connected branches.
+ * all connected branches. See YOGI_BranchSendBroadcast() for how this relates
+ * to the branch's _tx_slow_consumer_policy_ property.
  *
  * The function returns an ID which uniquely identifies this send operation
  * until \p fn has been called. It can be used in a subsequent
@@ -1999,10 +2358,11 @@ YOGI_API int YOGI_BranchCancelSendBroadcast(void* branch, int oid);
  * error.
  *
  * \attention
- *   Broadcast messages do not get queued, i.e. if a branch is not actively
+ *   Unless the _rx_broadcast_queue_depth_ branch property has been set,
+ *   broadcast messages do not get queued, i.e. if a branch is not actively
  *   receiving broadcast messages then they will be discarded. To ensure that
  *   no messages get missed, call YOGI_BranchReceiveBroadcastAsync() again from
- *   within the handler \p fn.
+ *   within the handler \p fn or use YOGI_BranchReceiveBroadcastsAsync().
  *
  * \param[in]  branch   The branch handle
  * \param[out] uuid     Pointer to a 16 byte array for storing the UUID of the
@@ -2020,6 +2380,107 @@ YOGI_API int YOGI_BranchReceiveBroadcastAsync(
     void* branch, void* uuid, int enc, void* data, int datasize,
     void (*fn)(int res, int size, void* userarg), void* userarg);
 
+/*!
+ * Receives a broadcast message without copying its payload.
+ *
+ * Instead of copying the received payload into a user-supplied buffer, the
+ * handler \p fn gets a pointer directly into the receive queue of the
+ * connection that the message arrived on. The payload is always MsgPack
+ * encoded (see #YOGI_ENC_MSGPACK).
+ *
+ * The data pointed to by \p data in \p fn stays valid until the lease has
+ * been released via YOGI_BranchReleaseBroadcastLease(). Each lease must be
+ * released exactly once and no further messages will be received from the
+ * sending branch until that happens; hence leases should be released as soon
+ * as possible, ideally from within \p fn.
+ *
+ * The handler function \p fn will be called with the following arguments:
+ *  -# __res__: #YOGI_OK or error code in case of a failure (see \ref EC)
+ *  -# __uuid__: Pointer to the 16 byte UUID of the sending branch (NULL if
+ *     \p res is an error)
+ *  -# __data__: Pointer to the received MsgPack payload
+ *  -# __size__: Number of bytes pointed to by \p data
+ *  -# __lease__: Handle of the lease (NULL if \p res is an error)
+ *  -# __userarg__: Value of the user-specified \p userarg parameter
+ *
+ * This function shares its receive operation with
+ * YOGI_BranchReceiveBroadcastAsync(), i.e. calling either of them while a
+ * receive operation is still active will cancel the previous operation with
+ * the #YOGI_ERR_CANCELED error. The operation can be canceled via
+ * YOGI_BranchCancelReceiveBroadcast().
+ *
+ * \param[in] branch  The branch handle
+ * \param[in] fn      Handler to call for the received broadcast message
+ * \param[in] userarg User-specified argument to be passed to \p fn
+ *
+ * \returns [=0] #YOGI_OK if successful
+ * \returns [<0] An error code in case of a failure (see \ref EC)
+ */
+YOGI_API int YOGI_BranchReceiveBroadcastLeaseAsync(
+    void* branch,
+    void (*fn)(int res, const void* uuid, const void* data, int size,
+               void* lease, void* userarg),
+    void* userarg);
+
+/*!
+ * Receives multiple broadcast messages at once.
+ *
+ * This function works like YOGI_BranchReceiveBroadcastAsync(), however, all
+ * broadcast messages queued by the branch (see the _rx_broadcast_queue_depth_
+ * branch property) get written to \p data in one go, as long as they fit. If
+ * no messages are queued, the operation completes as soon as the next one has
+ * been received.
+ *
+ * Each message written to \p data is stored as follows:
+ *  -# 16 bytes: UUID of the sending branch
+ *  -# 4 bytes: Size of the payload as an unsigned 32 bit integer in host byte
+ *     order
+ *  -# The payload in the encoding given by \p enc
+ *
+ * The parameters passed to \p fn are:
+ *  -# __res__: #YOGI_OK or error code in case of a failure (see \ref EC)
+ *  -# __count__: Number of messages written to \p data
+ *  -# __size__: Number of bytes written to \p data
+ *  -# __userarg__: Value of the user-specified \p userarg parameter
+ *
+ * Messages that do not fit into \p data any more remain queued for the next
+ * receive operation. If not even the first message fits, then \p fn will be
+ * called with the #YOGI_ERR_BUFFER_TOO_SMALL error and the message will be
+ * discarded.
+ *
+ * This function shares its receive operation with
+ * YOGI_BranchReceiveBroadcastAsync(), i.e. calling either of them while a
+ * receive operation is still active will cancel the previous operation with
+ * the #YOGI_ERR_CANCELED error. The operation can be canceled via
+ * YOGI_BranchCancelReceiveBroadcast().
+ *
+ * \param[in]  branch   The branch handle
+ * \param[in]  enc      Encoding type to use for the payloads (see \ref ENC)
+ * \param[out] data     Pointer to a buffer to store the received messages in
+ * \param[in]  datasize Maximum number of bytes to write to \p data
+ * \param[in]  fn       Handler to call once messages have been received
+ * \param[in]  userarg  User-specified argument to be passed to \p fn
+ *
+ * \returns [=0] #YOGI_OK if successful
+ * \returns [<0] An error code in case of a failure (see \ref EC)
+ */
+YOGI_API int YOGI_BranchReceiveBroadcastsAsync(
+    void* branch, int enc, void* data, int datasize,
+    void (*fn)(int res, int count, int size, void* userarg), void* userarg);
+
+/*!
+ * Releases a lease obtained via YOGI_BranchReceiveBroadcastLeaseAsync().
+ *
+ * After this function returns, the data associated with the lease must not
+ * be accessed anymore.
+ *
+ * \param[in] lease The lease handle
+ *
+ * \returns [=0] #YOGI_OK if successful
+ * \returns [<0] An error code in case of a failure (see \ref EC)
+ */
+YOGI_API int YOGI_BranchReleaseBroadcastLease(void* lease);
+
 /*!
  * Cancels receiving a broadcast message.
  *
@@ -37,6 +37,7 @@ enum BranchEvents {
   kBranchQueriedEvent = YOGI_BEV_BRANCH_QUERIED,
   kConnectFinishedEvent = YOGI_BEV_CONNECT_FINISHED,
   kConnectionLostEvent = YOGI_BEV_CONNECTION_LOST,
+  kSlowConsumerEvent = YOGI_BEV_SLOW_CONSUMER,
   kAllEvents = YOGI_BEV_ALL,
 };
 
@@ -58,6 +58,11 @@ const std::string& ExposedObject::TypeName() const {
       return s;
     }
 
+    case ObjectType::kContextGroup: {
+      static const std::string s = "ContextGroup";
+      return s;
+    }
+
     default: {
       YOGI_NEVER_REACHED;
       static const std::string s;
@@ -36,6 +36,7 @@ enum class ObjectType {
   kBranch,
   kConfiguration,
   kSignalSet,
+  kContextGroup,
 };
 
 typedef void* ObjectHandle;
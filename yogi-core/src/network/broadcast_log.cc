@@ -0,0 +1,933 @@
+/*
+ * This file is part of the Yogi distribution https://github.com/yohummus/yogi.
+ * Copyright (c) 2018 Johannes Bergmann.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "broadcast_log.h"
+#include "../utils/algorithm.h"
+#include "msg_transport.h"
+
+#include <algorithm>
+
+namespace network {
+namespace {
+
+std::array<boost::asio::const_buffer, 3> MakeFrame(
+    const OutgoingMessage::ConstBufferSequence& msg_bufs,
+    std::array<utils::Byte, 5>* size_field_buf) {
+  auto n = internal::SerializeMsgSizeField(
+      boost::asio::buffer_size(msg_bufs), size_field_buf);
+  return {{boost::asio::buffer(size_field_buf->data(), n), msg_bufs[0],
+           msg_bufs[1]}};
+}
+
+// The (up to) two regions of the log's memory holding n bytes starting at
+// the given position
+std::array<boost::asio::mutable_buffer, 2> MakeRegions(
+    utils::ByteVector* buffer, std::uint64_t pos, std::size_t n) {
+  auto capacity = buffer->size();
+  auto idx = static_cast<std::size_t>(pos % capacity);
+  auto first = std::min(n, capacity - idx);
+  return {{boost::asio::buffer(buffer->data() + idx, first),
+           boost::asio::buffer(buffer->data(), n - first)}};
+}
+
+// Removes the first n bytes of the (up to) two readable regions of a ring
+// buffer
+utils::LockFreeRingBuffer::ConstBuffers DropFront(
+    utils::LockFreeRingBuffer::ConstBuffers bufs, std::size_t n) {
+  auto first = std::min(n, bufs[0].size());
+  bufs[0] += first;
+  bufs[1] += n - first;
+  if (bufs[0].size() == 0) {
+    std::swap(bufs[0], bufs[1]);
+  }
+
+  return bufs;
+}
+
+// Keeps only the first n bytes of the (up to) two readable regions of a ring
+// buffer
+utils::LockFreeRingBuffer::ConstBuffers TakeFront(
+    utils::LockFreeRingBuffer::ConstBuffers bufs, std::size_t n) {
+  auto first = std::min(n, bufs[0].size());
+  bufs[0] = boost::asio::buffer(bufs[0], first);
+  bufs[1] = boost::asio::buffer(bufs[1], n - first);
+  return bufs;
+}
+
+template <typename ConstBufferSequence>
+void WriteToRingBuffer(utils::LockFreeRingBuffer* rb,
+                       const ConstBufferSequence& bufs) {
+  auto n = boost::asio::buffer_size(bufs);
+  boost::asio::buffer_copy(rb->Reserve(n), bufs);
+  rb->CommitWriteArrays(n);
+}
+
+}  // anonymous namespace
+
+BroadcastLog::Cursor::Cursor(BroadcastLogPtr log, objects::ContextPtr context,
+                             NotifyFn notify_fn, LagFn lag_fn,
+                             NotifyFn overrun_fn)
+    : log_(log),
+      notify_fn_(notify_fn),
+      lag_fn_(lag_fn),
+      overrun_fn_(overrun_fn),
+      context_(context),
+      partition_(nullptr),
+      pos_(0),
+      read_end_(0),
+      lagging_(false),
+      overrun_(false),
+      detached_(false),
+      overflow_offset_(0),
+      overflow_read_(0),
+      overflow_keep_(0),
+      overflow_skip_(0) {}
+
+BroadcastLog::Cursor::~Cursor() { log_->RemoveCursor(this); }
+
+BroadcastLog::ConstBufferSequence BroadcastLog::Cursor::ReadArrays(
+    std::size_t offset) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (detached_) {
+    // Data pinned in the log's memory gets written first and always ends at
+    // a message boundary
+    auto pinned = Pinned();
+    if (offset < pinned) {
+      auto bufs = MakeRegions(buffer_.get(), pos_ + offset, pinned - offset);
+      return {{bufs[0], bufs[1]}};
+    }
+
+    if (overrun_) return {};
+
+    // Skipped data must not be read before it has been discarded
+    auto bufs = overflow_->ReadArrays();
+    if (overflow_skip_ > 0) {
+      bufs = TakeFront(bufs, overflow_keep_);
+    }
+
+    bufs = DropFront(bufs, offset - pinned);
+    overflow_read_ = std::max(overflow_read_,
+                              offset - pinned + boost::asio::buffer_size(bufs));
+    return bufs;
+  }
+
+  auto end = log_->head_.load(std::memory_order_acquire);
+  auto pos = pos_ + offset;
+  auto n = end > pos ? static_cast<std::size_t>(end - pos) : 0;
+  read_end_ = std::max(read_end_, pos + n);
+
+  auto bufs = MakeRegions(buffer_.get(), pos, n);
+  return {{bufs[0], bufs[1]}};
+}
+
+std::size_t BroadcastLog::Cursor::AvailableForRead() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (detached_) {
+    auto n = overflow_skip_ > 0 ? overflow_keep_ : OverflowSize();
+    return Pinned() + n;
+  }
+
+  auto head = log_->head_.load(std::memory_order_acquire);
+  return static_cast<std::size_t>(head - pos_);
+}
+
+void BroadcastLog::Cursor::Advance(std::size_t n, bool still_reading) {
+  HandlerVector finished_handlers;
+  bool update_log;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (detached_) {
+      auto k = std::min(n, Pinned());
+      pos_ += k;
+      CommitOverflow(n - k, still_reading);
+
+      BroadcastLog::MoveQueuedToOverflow(this, &finished_handlers);
+    } else {
+      YOGI_ASSERT(pos_ + n <= log_->head_.load(std::memory_order_relaxed));
+      pos_ += n;
+      if (!still_reading || read_end_ < pos_) {
+        read_end_ = pos_;
+      }
+    }
+
+    if (Pinned() == 0) {
+      old_buffers_.clear();
+      if (detached_) {
+        buffer_.reset();
+      }
+    }
+
+    // Everything else only needs the cursor's own lock
+    update_log = lagging_ ? detached_ || Pinned() == 0
+                          : detached_ && CaughtUp();
+  }
+
+  if (update_log) {
+    log_->OnCursorAdvanced(this, &finished_handlers);
+  }
+
+  BroadcastLog::PostHandlers(context_, std::move(finished_handlers));
+}
+
+std::size_t BroadcastLog::Cursor::Backlog() const {
+  if (detached_) {
+    return Pinned() + OverflowSize() - overflow_skip_;
+  }
+
+  auto head = log_->head_.load(std::memory_order_relaxed);
+  return static_cast<std::size_t>(head - pos_);
+}
+
+std::size_t BroadcastLog::Cursor::OverflowSize() const {
+  return overflow_ ? overflow_->AvailableForRead() : 0;
+}
+
+bool BroadcastLog::Cursor::CaughtUp() const {
+  // Overrun cursors never return to the log
+  return !overrun_ && Pinned() == 0 && OverflowSize() == 0 && queued_.empty();
+}
+
+bool BroadcastLog::Cursor::HasRoomFor(std::size_t size) const {
+  // Skipped data occupies the overflow queue until it gets discarded
+  return Backlog() + overflow_skip_ + size <= log_->capacity_;
+}
+
+template <typename Buffers>
+void BroadcastLog::Cursor::WriteToOverflow(const Buffers& bufs) {
+  auto n = boost::asio::buffer_size(bufs);
+  WriteToRingBuffer(overflow_.get(), bufs);
+  if (log_->SkipsData()) {
+    overflow_frames_.push_back(n);
+  }
+}
+
+void BroadcastLog::Cursor::CommitOverflow(std::size_t n, bool still_reading) {
+  if (n > 0) {
+    overflow_->CommitReadArrays(n);
+  }
+
+  if (!overflow_frames_.empty()) {
+    overflow_offset_ += n;
+    while (!overflow_frames_.empty() &&
+           overflow_offset_ >= overflow_frames_.front()) {
+      overflow_offset_ -= overflow_frames_.front();
+      overflow_frames_.pop_front();
+    }
+  }
+
+  overflow_read_ =
+      still_reading && overflow_read_ > n ? overflow_read_ - n : 0;
+
+  if (overflow_skip_ > 0) {
+    YOGI_ASSERT(n <= overflow_keep_);
+    overflow_keep_ -= n;
+    if (overflow_keep_ == 0) {
+      DiscardSkipped();
+    }
+  }
+}
+
+void BroadcastLog::Cursor::SkipOverflow(bool keep_latest) {
+  // Frames that have been written partially or that are being written must
+  // be completed. Frames behind those have either been skipped already or
+  // can be skipped now.
+  std::size_t idx = 0;
+  std::size_t end = 0;
+  if (overflow_skip_ > 0) {
+    auto skipped_end = overflow_offset_ + overflow_keep_ + overflow_skip_;
+    while (end < skipped_end) {
+      end += overflow_frames_[idx++];
+    }
+  } else {
+    auto in_use = overflow_offset_ + overflow_read_;
+    while (idx < overflow_frames_.size() && end < in_use) {
+      end += overflow_frames_[idx++];
+    }
+
+    overflow_keep_ = end - overflow_offset_;
+  }
+
+  auto last = overflow_frames_.size();
+  if (keep_latest && idx < last) {
+    --last;
+  }
+
+  for (; idx < last; ++idx) {
+    overflow_skip_ += overflow_frames_[idx];
+  }
+
+  if (overflow_keep_ == 0) {
+    DiscardSkipped();
+  }
+}
+
+void BroadcastLog::Cursor::DiscardSkipped() {
+  if (overflow_skip_ == 0) return;
+
+  // The data in front of the skipped frames has been written completely
+  YOGI_ASSERT(overflow_offset_ == 0);
+  overflow_->CommitReadArrays(overflow_skip_);
+  while (overflow_skip_ > 0) {
+    overflow_skip_ -= overflow_frames_.front();
+    overflow_frames_.pop_front();
+  }
+}
+
+BroadcastLog::BroadcastLog(std::size_t capacity,
+                           std::size_t partitions_per_context,
+                           SlowConsumerPolicy slow_policy,
+                           std::size_t slow_threshold,
+                           std::size_t overflow_budget)
+    : capacity_(capacity),
+      partitions_per_context_(partitions_per_context),
+      slow_policy_(slow_policy),
+      slow_threshold_(slow_threshold),
+      max_overflows_(overflow_budget / capacity),
+      buffer_(std::make_shared<utils::ByteVector>(capacity)),
+      head_(0),
+      tail_(0),
+      num_detached_(0),
+      num_overflows_(0) {
+  YOGI_ASSERT(capacity > 0);
+}
+
+BroadcastLog::CursorPtr BroadcastLog::MakeCursor(objects::ContextPtr context,
+                                                 NotifyFn notify_fn,
+                                                 LagFn lag_fn,
+                                                 NotifyFn overrun_fn) {
+  auto cursor = CursorPtr(new Cursor(shared_from_this(), context, notify_fn,
+                                     lag_fn, overrun_fn));
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto head = head_.load(std::memory_order_relaxed);
+  cursor->buffer_ = buffer_;
+  cursor->pos_ = head;
+  cursor->read_end_ = head;
+  cursor->partition_ = AssignPartition(context);
+  cursor->partition_->cursors.push_back(cursor.get());
+  cursors_.push_back(cursor.get());
+
+  return cursor;
+}
+
+std::vector<std::size_t> BroadcastLog::GetPartitionSizes(
+    const objects::ContextPtr& context) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  std::vector<std::size_t> sizes;
+  for (auto& partition : partitions_) {
+    auto& ctx = partition->context;
+    if (ctx.owner_before(context) || context.owner_before(ctx)) continue;
+    if (partition->cursors.empty()) continue;
+
+    sizes.push_back(partition->cursors.size());
+  }
+
+  return sizes;
+}
+
+bool BroadcastLog::TryAppend(const OutgoingMessage& msg) {
+  std::array<utils::Byte, 5> size_field_buf;
+  auto frame = MakeFrame(msg.GetSerializedBuffers(), &size_field_buf);
+
+  HandlerVector finished_handlers;
+  bool all_appended;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    all_appended = AppendFrame(frame, 0, nullptr, &finished_handlers);
+    NotifyCursors();
+  }
+
+  for (auto& handler : finished_handlers) {
+    handler(api::kSuccess);
+  }
+
+  return all_appended;
+}
+
+bool BroadcastLog::AppendOrQueue(const OutgoingMessage& msg, OperationTag tag,
+                                 AppendHandler handler) {
+  YOGI_ASSERT(tag != 0);
+
+  std::array<utils::Byte, 5> size_field_buf;
+  auto frame = MakeFrame(msg.GetSerializedBuffers(), &size_field_buf);
+
+  HandlerVector finished_handlers;
+  bool all_appended;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    all_appended = AppendFrame(frame, tag, &handler, &finished_handlers);
+    NotifyCursors();
+  }
+
+  for (auto& finished_handler : finished_handlers) {
+    finished_handler(api::kSuccess);
+  }
+
+  return all_appended;
+}
+
+bool BroadcastLog::CancelQueued(OperationTag tag) {
+  QueuedAppendPtr queued;
+  HandlerVector finished_handlers;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto cursor : cursors_) {
+      std::lock_guard<std::mutex> cursor_lock(cursor->mutex_);
+      auto it = utils::find_if(cursor->queued_,
+                               [&](auto& entry) { return entry->tag == tag; });
+      if (it == cursor->queued_.end()) continue;
+
+      queued = *it;
+      cursor->queued_.erase(it);
+
+      // The canceled message may have been blocking the ones behind it
+      MoveQueuedToOverflow(cursor, &finished_handlers);
+    }
+
+    if (!finished_handlers.empty()) {
+      NotifyCursors();
+    }
+  }
+
+  bool canceled = queued && !queued->finished.exchange(true);
+  if (canceled) {
+    queued->handler(api::Error(YOGI_ERR_CANCELED));
+  }
+
+  for (auto& finished_handler : finished_handlers) {
+    finished_handler(api::kSuccess);
+  }
+
+  return canceled;
+}
+
+bool BroadcastLog::SkipsData() const {
+  return slow_policy_ == SlowConsumerPolicy::kDrop ||
+         slow_policy_ == SlowConsumerPolicy::kConflate;
+}
+
+std::size_t BroadcastLog::FreeSpace() const {
+  auto head = head_.load(std::memory_order_relaxed);
+  return capacity_ - static_cast<std::size_t>(head - tail_);
+}
+
+void BroadcastLog::UpdateTail() {
+  auto tail = head_.load(std::memory_order_relaxed);
+  for (auto cursor : cursors_) {
+    std::lock_guard<std::mutex> lock(cursor->mutex_);
+    if (!cursor->detached_ ||
+        (cursor->buffer_ == buffer_ && cursor->Pinned() > 0)) {
+      tail = std::min(tail, cursor->pos_);
+    }
+  }
+
+  tail_ = tail;
+}
+
+bool BroadcastLog::IsFrameStart(std::uint64_t pos) const {
+  return pos == head_.load(std::memory_order_relaxed) ||
+         std::binary_search(frame_starts_.begin(), frame_starts_.end(), pos);
+}
+
+bool BroadcastLog::AppendFrame(const FrameBuffers& frame, OperationTag tag,
+                               const AppendHandler* handler,
+                               HandlerVector* finished_handlers) {
+  auto size = boost::asio::buffer_size(frame);
+  YOGI_ASSERT(size <= capacity_);
+
+  // Nobody would ever read the message
+  if (cursors_.empty()) return true;
+
+  MakeSpace(size);
+
+  auto head = head_.load(std::memory_order_relaxed);
+  if (SkipsData()) {
+    // Keeps the frame that the tail is in the middle of
+    while (frame_starts_.size() > 1 && frame_starts_[1] <= tail_) {
+      frame_starts_.pop_front();
+    }
+
+    frame_starts_.push_back(head);
+  }
+
+  boost::asio::buffer_copy(MakeRegions(buffer_.get(), head, size), frame);
+  head_.store(head + size, std::memory_order_release);
+
+  bool all_appended = true;
+  if (num_detached_ > 0) {
+    all_appended =
+        AppendToDetachedCursors(frame, tag, handler, finished_handlers);
+  }
+
+  CheckForSlowCursors(finished_handlers);
+
+  return all_appended;
+}
+
+bool BroadcastLog::AppendToDetachedCursors(const FrameBuffers& frame,
+                                           OperationTag tag,
+                                           const AppendHandler* handler,
+                                           HandlerVector* finished_handlers) {
+  auto size = boost::asio::buffer_size(frame);
+  bool all_appended = true;
+  QueuedAppendPtr queued;
+
+  for (auto cursor : cursors_) {
+    std::lock_guard<std::mutex> lock(cursor->mutex_);
+    if (!cursor->detached_ || cursor->overrun_) continue;
+
+    // Lagging cursors skip the message or, with kConflate, everything but it
+    if (cursor->lagging_ && SkipsData()) {
+      if (slow_policy_ == SlowConsumerPolicy::kConflate) {
+        SkipBacklog(cursor, false, finished_handlers);
+        if (cursor->HasRoomFor(size)) {
+          cursor->WriteToOverflow(frame);
+        }
+      }
+
+      continue;
+    }
+
+    // Messages must not overtake queued ones
+    if (cursor->queued_.empty() && cursor->HasRoomFor(size)) {
+      cursor->WriteToOverflow(frame);
+      continue;
+    }
+
+    all_appended = false;
+    if (!handler) continue;
+
+    if (!queued) {
+      queued = std::make_shared<QueuedAppend>();
+      queued->tag = tag;
+      queued->frame.resize(size);
+      boost::asio::buffer_copy(
+          boost::asio::buffer(queued->frame.data(), size), frame);
+      queued->handler = *handler;
+      queued->remaining = 1;  // Held until all cursors have been visited
+      queued->finished = false;
+    }
+
+    ++queued->remaining;
+    cursor->queued_.push_back(queued);
+  }
+
+  // The cursors may have caught up already
+  if (queued && queued->remaining.fetch_sub(1) == 1) {
+    return !queued->finished.exchange(true);
+  }
+
+  return all_appended;
+}
+
+void BroadcastLog::MakeSpace(std::size_t size) {
+  if (size <= FreeSpace()) return;
+
+  UpdateTail();
+  if (size <= FreeSpace()) return;
+
+  // Cursors that would lose data continue with a queue of their own
+  auto min_pos = head_.load(std::memory_order_relaxed) + size - capacity_;
+  for (auto cursor : cursors_) {
+    std::lock_guard<std::mutex> lock(cursor->mutex_);
+    if (!cursor->detached_ && cursor->pos_ < min_pos) {
+      Detach(cursor);
+    }
+  }
+
+  UpdateTail();
+  if (size <= FreeSpace()) return;
+
+  // Detached cursors are still writing data from the log's memory
+  ReplaceBuffer();
+}
+
+bool BroadcastLog::Detach(Cursor* cursor) {
+  if (!cursor->overflow_ && !AcquireOverflow(cursor)) {
+    Overrun(cursor);
+    return false;
+  }
+
+  auto head = head_.load(std::memory_order_relaxed);
+
+  YOGI_ASSERT(cursor->overflow_->AvailableForRead() == 0);
+  auto n = static_cast<std::size_t>(head - cursor->read_end_);
+  WriteToRingBuffer(cursor->overflow_.get(),
+                    MakeRegions(buffer_.get(), cursor->read_end_, n));
+
+  // The cursor may be in the middle of a frame if its last write stopped
+  // there
+  if (SkipsData() && n > 0) {
+    auto it = std::upper_bound(frame_starts_.begin(), frame_starts_.end(),
+                               cursor->read_end_);
+    YOGI_ASSERT(it != frame_starts_.begin());
+    auto start = *std::prev(it);
+    cursor->overflow_offset_ = static_cast<std::size_t>(cursor->read_end_ -
+                                                        start);
+    for (; it != frame_starts_.end(); ++it) {
+      cursor->overflow_frames_.push_back(static_cast<std::size_t>(*it - start));
+      start = *it;
+    }
+
+    cursor->overflow_frames_.push_back(static_cast<std::size_t>(head - start));
+  }
+
+  if (cursor->Pinned() == 0) {
+    cursor->buffer_.reset();
+  }
+
+  cursor->detached_ = true;
+  ++num_detached_;
+  return true;
+}
+
+bool BroadcastLog::AcquireOverflow(Cursor* cursor) {
+  if (!spare_overflows_.empty()) {
+    cursor->overflow_ = std::move(spare_overflows_.back());
+    spare_overflows_.pop_back();
+    return true;
+  }
+
+  if (num_overflows_ >= max_overflows_) return false;
+
+  cursor->overflow_.reset(new utils::LockFreeRingBuffer(capacity_));
+  ++num_overflows_;
+  return true;
+}
+
+void BroadcastLog::Overrun(Cursor* cursor) {
+  // The data that the cursor is writing stays pinned, everything behind it
+  // is lost for the cursor
+  cursor->read_end_ = std::max(cursor->read_end_, cursor->pos_);
+  if (cursor->Pinned() == 0) {
+    cursor->buffer_.reset();
+  }
+
+  cursor->lagging_ = false;
+  cursor->overrun_ = true;
+  cursor->detached_ = true;
+  ++num_detached_;
+
+  auto context = cursor->context_.lock();
+  if (context && cursor->overrun_fn_) {
+    context->Post(cursor->overrun_fn_);
+  }
+}
+
+void BroadcastLog::ReplaceBuffer() {
+  auto head = head_.load(std::memory_order_relaxed);
+  auto tail = head;
+  for (auto cursor : cursors_) {
+    std::lock_guard<std::mutex> lock(cursor->mutex_);
+    if (!cursor->detached_) {
+      tail = std::min(tail, cursor->pos_);
+    }
+  }
+
+  auto n = static_cast<std::size_t>(head - tail);
+  auto buffer = std::make_shared<utils::ByteVector>(capacity_);
+  boost::asio::buffer_copy(MakeRegions(buffer.get(), tail, n),
+                           MakeRegions(buffer_.get(), tail, n));
+
+  for (auto cursor : cursors_) {
+    std::lock_guard<std::mutex> lock(cursor->mutex_);
+    if (cursor->detached_) continue;
+
+    if (cursor->Pinned() > 0) {
+      cursor->old_buffers_.push_back(cursor->buffer_);
+    }
+
+    cursor->buffer_ = buffer;
+  }
+
+  buffer_ = buffer;
+  tail_ = tail;
+}
+
+void BroadcastLog::CheckForSlowCursors(HandlerVector* finished_handlers) {
+  if (slow_policy_ == SlowConsumerPolicy::kBlock) return;
+
+  auto head = head_.load(std::memory_order_relaxed);
+  if (num_detached_ == 0 && head - tail_ <= slow_threshold_) return;
+
+  // Visiting all cursors anyway, so update the tail as well
+  auto tail = head;
+  for (auto cursor : cursors_) {
+    std::lock_guard<std::mutex> lock(cursor->mutex_);
+    if (!cursor->detached_ ||
+        (cursor->buffer_ == buffer_ && cursor->Pinned() > 0)) {
+      tail = std::min(tail, cursor->pos_);
+    }
+
+    if (cursor->overrun_) continue;
+
+    auto backlog = cursor->Backlog();
+    if (cursor->lagging_ || backlog <= slow_threshold_) continue;
+
+    cursor->lagging_ = true;
+
+    auto context = cursor->partition_->context.lock();
+    if (context && cursor->lag_fn_) {
+      auto lag_fn = cursor->lag_fn_;
+      context->Post([lag_fn, backlog] { lag_fn(backlog); });
+    }
+
+    UpdateLagging(cursor, finished_handlers);
+  }
+
+  tail_ = tail;
+}
+
+void BroadcastLog::UpdateLagging(Cursor* cursor,
+                                 HandlerVector* finished_handlers) {
+  switch (slow_policy_) {
+    case SlowConsumerPolicy::kBlock:
+      break;
+
+    case SlowConsumerPolicy::kDrop:
+    case SlowConsumerPolicy::kConflate:
+      // Cursors that are not writing anything can simply move ahead
+      if (!cursor->detached_ && cursor->Pinned() == 0 &&
+          IsFrameStart(cursor->pos_)) {
+        auto new_pos = head_.load(std::memory_order_relaxed);
+        if (slow_policy_ == SlowConsumerPolicy::kConflate &&
+            !frame_starts_.empty()) {
+          new_pos = std::max(cursor->pos_, frame_starts_.back());
+        }
+
+        cursor->pos_ = new_pos;
+        cursor->read_end_ = new_pos;
+        cursor->lagging_ = false;
+        break;
+      }
+
+      // Otherwise, the data behind the write in progress gets skipped in the
+      // cursor's own queue
+      if (!cursor->detached_ && !Detach(cursor)) break;
+
+      SkipBacklog(cursor, slow_policy_ == SlowConsumerPolicy::kConflate,
+                  finished_handlers);
+
+      // New messages get skipped as well until the write has finished
+      cursor->lagging_ = cursor->Pinned() > 0 || cursor->overflow_skip_ > 0;
+      break;
+
+    case SlowConsumerPolicy::kDisconnect:
+      cursor->lagging_ = cursor->Backlog() > slow_threshold_;
+      break;
+  }
+}
+
+void BroadcastLog::SkipBacklog(Cursor* cursor, bool keep_latest,
+                               HandlerVector* finished_handlers) {
+  // Queued messages are newer than everything in the overflow queue
+  auto queued = std::move(cursor->queued_);
+  cursor->queued_.clear();
+  cursor->SkipOverflow(keep_latest && queued.empty());
+
+  if (keep_latest && !queued.empty()) {
+    auto& frame = queued.back()->frame;
+    if (cursor->HasRoomFor(frame.size())) {
+      cursor->WriteToOverflow(boost::asio::buffer(frame.data(), frame.size()));
+    }
+  }
+
+  for (auto& entry : queued) {
+    FinishQueued(entry, finished_handlers);
+  }
+}
+
+void BroadcastLog::OnCursorAdvanced(Cursor* cursor,
+                                    HandlerVector* finished_handlers) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::lock_guard<std::mutex> cursor_lock(cursor->mutex_);
+
+  if (cursor->detached_ && cursor->CaughtUp()) {
+    Reattach(cursor);
+  } else if (cursor->lagging_) {
+    UpdateLagging(cursor, finished_handlers);
+  }
+}
+
+void BroadcastLog::Reattach(Cursor* cursor) {
+  YOGI_ASSERT(cursor->overflow_frames_.empty());
+
+  auto head = head_.load(std::memory_order_relaxed);
+  cursor->buffer_ = buffer_;
+  cursor->pos_ = head;
+  cursor->read_end_ = head;
+  cursor->lagging_ = false;
+  cursor->detached_ = false;
+  cursor->overflow_offset_ = 0;
+  cursor->overflow_read_ = 0;
+  --num_detached_;
+
+  // The queue is empty and can be used by the next cursor that gets detached
+  spare_overflows_.push_back(std::move(cursor->overflow_));
+}
+
+void BroadcastLog::MoveQueuedToOverflow(Cursor* cursor,
+                                        HandlerVector* finished_handlers) {
+  while (!cursor->queued_.empty()) {
+    auto& queued = cursor->queued_.front();
+    auto& frame = queued->frame;
+    if (!cursor->HasRoomFor(frame.size())) break;
+
+    cursor->WriteToOverflow(boost::asio::buffer(frame.data(), frame.size()));
+    FinishQueued(queued, finished_handlers);
+    cursor->queued_.pop_front();
+  }
+}
+
+bool BroadcastLog::FinishQueued(const QueuedAppendPtr& queued,
+                                HandlerVector* finished_handlers) {
+  if (queued->remaining.fetch_sub(1) != 1) return false;
+  if (queued->finished.exchange(true)) return false;
+
+  finished_handlers->push_back(std::move(queued->handler));
+  return true;
+}
+
+BroadcastLog::Partition* BroadcastLog::AssignPartition(
+    const objects::ContextPtr& context) {
+  auto max_partitions = partitions_per_context_;
+  if (max_partitions == 0) {
+    max_partitions = context->GetNumThreads();
+  }
+
+  // Partitions of contexts that have been destroyed cannot be used any more
+  utils::remove_erase_if(partitions_, [](auto& partition) {
+    return partition->cursors.empty() && partition->context.expired();
+  });
+
+  Partition* smallest = nullptr;
+  std::size_t num_partitions = 0;
+  for (auto& partition : partitions_) {
+    auto& ctx = partition->context;
+    if (ctx.owner_before(context) || context.owner_before(ctx)) continue;
+
+    ++num_partitions;
+    if (!smallest || partition->cursors.size() < smallest->cursors.size()) {
+      smallest = partition.get();
+    }
+  }
+
+  if (smallest && (smallest->cursors.empty() ||
+                   num_partitions >= max_partitions)) {
+    return smallest;
+  }
+
+  partitions_.push_back(std::make_shared<Partition>());
+  auto& partition = partitions_.back();
+  partition->context = context;
+  partition->scheduled = false;
+
+  return partition.get();
+}
+
+void BroadcastLog::NotifyCursors() {
+  std::weak_ptr<BroadcastLog> weak_self = shared_from_this();
+  for (auto& partition : partitions_) {
+    if (partition->cursors.empty() || partition->scheduled) continue;
+
+    auto context = partition->context.lock();
+    if (!context) continue;
+
+    partition->scheduled = true;
+    context->Post([weak_self, partition] {
+      if (auto self = weak_self.lock()) {
+        self->NotifyPartition(partition.get());
+      }
+    });
+  }
+}
+
+void BroadcastLog::NotifyPartition(Partition* partition) {
+  // The notify functions acquire other locks, so they must not be called
+  // with the log's mutex held
+  std::vector<NotifyFn> notify_fns;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    partition->scheduled = false;
+    notify_fns.reserve(partition->cursors.size());
+    for (auto cursor : partition->cursors) {
+      notify_fns.push_back(cursor->notify_fn_);
+    }
+  }
+
+  for (auto& notify_fn : notify_fns) {
+    notify_fn();
+  }
+}
+
+void BroadcastLog::RemoveCursor(Cursor* cursor) {
+  HandlerVector finished_handlers;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    utils::remove_erase(cursor->partition_->cursors, cursor);
+    utils::remove_erase(cursors_, cursor);
+
+    std::lock_guard<std::mutex> cursor_lock(cursor->mutex_);
+    if (cursor->detached_) {
+      --num_detached_;
+    }
+
+    if (cursor->overflow_) {
+      --num_overflows_;
+    }
+
+    // The cursor does not hold back queued messages any more
+    for (auto& queued : cursor->queued_) {
+      FinishQueued(queued, &finished_handlers);
+    }
+  }
+
+  PostHandlers(cursor->context_, std::move(finished_handlers));
+}
+
+void BroadcastLog::PostHandlers(const std::weak_ptr<objects::Context>& context,
+                                HandlerVector handlers) {
+  if (handlers.empty()) return;
+
+  auto ctx = context.lock();
+  if (!ctx) {
+    for (auto& handler : handlers) {
+      handler(api::kSuccess);
+    }
+
+    return;
+  }
+
+  ctx->Post([handlers = std::move(handlers)] {
+    for (auto& handler : handlers) {
+      handler(api::kSuccess);
+    }
+  });
+}
+
+}  // namespace network
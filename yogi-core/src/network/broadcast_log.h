@@ -0,0 +1,279 @@
+/*
+ * This file is part of the Yogi distribution https://github.com/yohummus/yogi.
+ * Copyright (c) 2018 Johannes Bergmann.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "../config.h"
+#include "../api/errors.h"
+#include "../objects/context.h"
+#include "../utils/types.h"
+#include "../utils/small_function.h"
+#include "../utils/ringbuffer.h"
+#include "messages.h"
+
+#include <boost/asio/buffer.hpp>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace network {
+
+class BroadcastLog;
+typedef std::shared_ptr<BroadcastLog> BroadcastLogPtr;
+
+// How to treat connections that fall behind on broadcasts
+enum class SlowConsumerPolicy {
+  kBlock,       // Broadcasts to the connection wait for space in its queue
+  kDrop,        // The connection skips everything it fell behind on
+  kConflate,    // The connection skips everything but the latest message
+  kDisconnect,  // Like kBlock; the connection gets closed by its owner
+};
+
+// Append-only log of serialized broadcast messages shared by all connections
+// of a branch. Every message gets copied into the log exactly once and each
+// connection only keeps a read cursor, writing to its transport straight from
+// the log's memory.
+//
+// Each cursor may fall behind by up to the log's capacity, just like with a
+// send queue of its own. A cursor that would hold back an append gets
+// detached from the log: the data it has not started writing yet gets moved
+// into a private queue of the same capacity and subsequent messages get
+// copied there as well. Messages that do not fit into that queue get skipped
+// for the cursor (or queued until they fit). Data that the cursor is still
+// writing stays where it is; if the log needs to overwrite it, the log moves
+// on to new memory instead. Detached cursors return to the log once they have
+// caught up.
+//
+// Without an overflow budget, every connection of the branch may end up with
+// a private queue, i.e. the worst case is the same memory and the same number
+// of copies per message as with separate send queues. The overflow budget
+// limits the number of private queues that exist at any time, counting queues
+// that have been kept for reuse. A cursor that would need a private queue
+// beyond the budget gets overrun instead: it completes the write in progress
+// but gets no data after that, and its owner is expected to close the
+// connection.
+//
+// Handlers of queued appends that complete while a cursor is being advanced
+// or destroyed get posted to the cursor's context since the cursor's owner
+// typically holds locks of its own at that point.
+//
+// Connections get woken up in partitions: each partition is handled by a
+// single handler on the context running its connections. This spreads the
+// fan-out of large broadcasts over the threads of the context (and over the
+// shards of a context group) instead of doing it serially on the thread that
+// appends the message.
+//
+// Cursors lagging behind by more than the slow consumer threshold get
+// penalized according to the slow consumer policy. Skipping data only happens
+// at message boundaries. A message that a cursor is in the middle of writing
+// always gets completed; in order to skip the messages behind it without
+// waiting for the write, the cursor gets detached.
+class BroadcastLog : public std::enable_shared_from_this<BroadcastLog> {
+  struct Partition;
+  struct QueuedAppend;
+
+  typedef std::shared_ptr<utils::ByteVector> BufferPtr;
+  typedef std::shared_ptr<QueuedAppend> QueuedAppendPtr;
+  typedef std::unique_ptr<utils::LockFreeRingBuffer> OverflowPtr;
+
+ public:
+  typedef int OperationTag;
+  typedef utils::SmallFunction<void(const api::Result&)> AppendHandler;
+  typedef utils::SmallFunction<void()> NotifyFn;
+  typedef utils::SmallFunction<void(std::size_t backlog)> LagFn;
+  typedef std::array<boost::asio::const_buffer, 2> ConstBufferSequence;
+
+  class Cursor {
+    friend class BroadcastLog;
+
+   public:
+    Cursor(const Cursor&) = delete;
+    Cursor& operator=(const Cursor&) = delete;
+    ~Cursor();
+
+    // Data that has not been read yet, without the first offset bytes (which
+    // must have been returned by an earlier call); the memory stays valid
+    // until the cursor gets advanced past it
+    ConstBufferSequence ReadArrays(std::size_t offset = 0);
+    std::size_t AvailableForRead() const;
+
+    // Set still_reading if data behind the new position that has been
+    // returned by ReadArrays() is still in use
+    void Advance(std::size_t n, bool still_reading = false);
+
+   private:
+    Cursor(BroadcastLogPtr log, objects::ContextPtr context,
+           NotifyFn notify_fn, LagFn lag_fn, NotifyFn overrun_fn);
+
+    // Data at the cursor's position that is still in the log's memory
+    std::size_t Pinned() const {
+      return static_cast<std::size_t>(read_end_ - pos_);
+    }
+
+    std::size_t Backlog() const;
+    std::size_t OverflowSize() const;
+    bool CaughtUp() const;
+    bool HasRoomFor(std::size_t size) const;
+
+    template <typename Buffers>
+    void WriteToOverflow(const Buffers& bufs);
+    void CommitOverflow(std::size_t n, bool still_reading);
+    void SkipOverflow(bool keep_latest);
+    void DiscardSkipped();
+
+    const BroadcastLogPtr log_;
+    const NotifyFn notify_fn_;
+    const LagFn lag_fn_;
+    const NotifyFn overrun_fn_;
+    const std::weak_ptr<objects::Context> context_;
+    Partition* partition_;  // Guarded by the log's mutex
+
+    // The log locks its own mutex before this one; the cursor's owner only
+    // ever needs this one on the hot path
+    mutable std::mutex mutex_;
+    BufferPtr buffer_;                    // Log memory being read from
+    std::vector<BufferPtr> old_buffers_;  // Replaced but still being read
+    std::uint64_t pos_;
+    std::uint64_t read_end_;  // End of the data returned by ReadArrays()
+    bool lagging_;            // Backlog exceeded the slow consumer threshold
+    bool overrun_;  // Did not get a private queue; only finishes its write
+    bool detached_;  // Reads [pos_, read_end_) from buffer_, then overflow_
+    OverflowPtr overflow_;
+    std::deque<std::size_t> overflow_frames_;  // Only tracked for skipping
+    std::size_t overflow_offset_;  // Already written part of the first frame
+    std::size_t overflow_read_;    // Returned by ReadArrays() and still in use
+    std::size_t overflow_keep_;    // Gets written before discarding...
+    std::size_t overflow_skip_;    // ...these bytes that have been skipped
+    std::deque<QueuedAppendPtr> queued_;  // Did not fit into overflow_ yet
+  };
+
+  typedef std::unique_ptr<Cursor> CursorPtr;
+
+  // Setting partitions_per_context to 0 uses one partition per thread of the
+  // context that the respective connections run on. The overflow budget is
+  // the total size of all private queues of detached cursors; each of them
+  // has the same size as the log.
+  BroadcastLog(std::size_t capacity, std::size_t partitions_per_context = 1,
+               SlowConsumerPolicy slow_policy = SlowConsumerPolicy::kBlock,
+               std::size_t slow_threshold = 0,
+               std::size_t overflow_budget =
+                   std::numeric_limits<std::size_t>::max());
+
+  std::size_t Capacity() const { return capacity_; }
+
+  // Number of cursors in each partition of the given context
+  std::vector<std::size_t> GetPartitionSizes(
+      const objects::ContextPtr& context) const;
+
+  // Creates a cursor positioned at the end of the log. The notify function
+  // gets called from a handler on the given context whenever data has been
+  // appended. The lag function gets called in the same way whenever the
+  // cursor's backlog exceeds the slow consumer threshold and the overrun
+  // function once the cursor got overrun.
+  CursorPtr MakeCursor(objects::ContextPtr context, NotifyFn notify_fn,
+                       LagFn lag_fn = {}, NotifyFn overrun_fn = {});
+
+  // Appends the message and returns false if it had to be skipped for at
+  // least one cursor because that cursor's queue is full. Lagging cursors
+  // that skip messages because of the drop or conflate policy do not count.
+  bool TryAppend(const OutgoingMessage& msg);
+
+  // Appends the message and returns true if all cursors got it. Otherwise,
+  // the message gets queued for the cursors whose queue is full; the handler
+  // gets called once all of them got it or if the operation has been
+  // canceled.
+  bool AppendOrQueue(const OutgoingMessage& msg, OperationTag tag,
+                     AppendHandler handler);
+  bool CancelQueued(OperationTag tag);
+
+ private:
+  typedef std::array<boost::asio::const_buffer, 3> FrameBuffers;
+
+  struct QueuedAppend {
+    OperationTag tag;
+    utils::SmallByteVector frame;
+    AppendHandler handler;
+    std::atomic<std::size_t> remaining;  // Cursors that still need the frame
+    std::atomic<bool> finished;          // Handler has been taken
+  };
+
+  struct Partition {
+    std::weak_ptr<objects::Context> context;
+    std::vector<Cursor*> cursors;
+    bool scheduled;  // A handler notifying the cursors has been posted
+  };
+
+  typedef std::vector<AppendHandler> HandlerVector;
+  typedef std::shared_ptr<Partition> PartitionPtr;
+
+  bool SkipsData() const;
+  std::size_t FreeSpace() const;
+  void UpdateTail();
+  bool IsFrameStart(std::uint64_t pos) const;
+  bool AppendFrame(const FrameBuffers& frame, OperationTag tag,
+                   const AppendHandler* handler,
+                   HandlerVector* finished_handlers);
+  bool AppendToDetachedCursors(const FrameBuffers& frame, OperationTag tag,
+                               const AppendHandler* handler,
+                               HandlerVector* finished_handlers);
+  void MakeSpace(std::size_t size);
+  bool Detach(Cursor* cursor);
+  bool AcquireOverflow(Cursor* cursor);
+  void Overrun(Cursor* cursor);
+  void ReplaceBuffer();
+  void CheckForSlowCursors(HandlerVector* finished_handlers);
+  void UpdateLagging(Cursor* cursor, HandlerVector* finished_handlers);
+  void SkipBacklog(Cursor* cursor, bool keep_latest,
+                   HandlerVector* finished_handlers);
+  void OnCursorAdvanced(Cursor* cursor, HandlerVector* finished_handlers);
+  void Reattach(Cursor* cursor);
+  Partition* AssignPartition(const objects::ContextPtr& context);
+  void NotifyCursors();
+  void NotifyPartition(Partition* partition);
+  void RemoveCursor(Cursor* cursor);
+
+  static void PostHandlers(const std::weak_ptr<objects::Context>& context,
+                           HandlerVector handlers);
+  static void MoveQueuedToOverflow(Cursor* cursor,
+                                   HandlerVector* finished_handlers);
+  static bool FinishQueued(const QueuedAppendPtr& queued,
+                           HandlerVector* finished_handlers);
+
+  const std::size_t capacity_;
+  const std::size_t partitions_per_context_;
+  const SlowConsumerPolicy slow_policy_;
+  const std::size_t slow_threshold_;
+  const std::size_t max_overflows_;
+  mutable std::mutex mutex_;
+  BufferPtr buffer_;
+  std::atomic<std::uint64_t> head_;  // Where the next message gets appended
+  std::uint64_t tail_;  // Start of the data that may still get read
+  std::deque<std::uint64_t> frame_starts_;  // Only tracked for skipping
+  std::vector<Cursor*> cursors_;
+  std::size_t num_detached_;
+  std::size_t num_overflows_;  // Private queues allocated, including spares
+  std::vector<OverflowPtr> spare_overflows_;
+  std::vector<PartitionPtr> partitions_;
+};
+
+}  // namespace network
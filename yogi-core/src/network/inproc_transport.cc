@@ -0,0 +1,271 @@
+/*
+ * This file is part of the Yogi distribution https://github.com/yohummus/yogi.
+ * Copyright (c) 2018 Johannes Bergmann.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "inproc_transport.h"
+
+#include <unordered_map>
+
+namespace network {
+namespace {
+
+const std::size_t kRingBufferSize = 64 * 1024;
+
+struct PendingOperation {
+  objects::ContextPtr context;
+  Transport::ConstBufferSequence tx_data;
+  Transport::MutableBufferSequence rx_data;
+  Transport::TransferSomeHandler handler;
+};
+
+struct Direction {
+  Direction() : rb(kRingBufferSize) {}
+
+  utils::LockFreeRingBuffer rb;
+  PendingOperation pending_write;
+  PendingOperation pending_read;
+};
+
+struct Registry {
+  std::mutex mutex;
+  std::unordered_map<std::string, InProcTransport::Listener*> listeners;
+};
+
+Registry& GetRegistry() {
+  static Registry registry;
+  return registry;
+}
+
+void Complete(const objects::ContextPtr& context,
+              Transport::TransferSomeHandler handler, const api::Result& res,
+              std::size_t bytes_transferred) {
+  context->Post([=] { handler(res, bytes_transferred); });
+}
+
+void Complete(PendingOperation* op, const api::Result& res,
+              std::size_t bytes_transferred) {
+  Complete(op->context, op->handler, res, bytes_transferred);
+  *op = {};
+}
+
+std::size_t WriteToRingBuffer(utils::LockFreeRingBuffer* rb,
+                              const Transport::ConstBufferSequence& data) {
+  std::size_t n = 0;
+  for (auto& buffer : data) {
+    n += rb->Write(static_cast<const utils::Byte*>(buffer.data()),
+                   buffer.size());
+  }
+
+  return n;
+}
+
+std::size_t ReadFromRingBuffer(utils::LockFreeRingBuffer* rb,
+                               const Transport::MutableBufferSequence& data) {
+  std::size_t n = 0;
+  for (auto& buffer : data) {
+    n += rb->Read(static_cast<utils::Byte*>(buffer.data()), buffer.size());
+  }
+
+  return n;
+}
+
+void ServePendingRead(Direction* dir, bool writer_closed) {
+  auto& op = dir->pending_read;
+  if (!op.handler) return;
+
+  auto n = ReadFromRingBuffer(&dir->rb, op.rx_data);
+  if (n > 0) {
+    Complete(&op, api::kSuccess, n);
+  } else if (writer_closed) {
+    Complete(&op, api::Error(YOGI_ERR_RW_SOCKET_FAILED), 0);
+  }
+}
+
+void ServePendingWrite(Direction* dir, bool reader_closed) {
+  auto& op = dir->pending_write;
+  if (!op.handler) return;
+
+  if (reader_closed) {
+    Complete(&op, api::Error(YOGI_ERR_RW_SOCKET_FAILED), 0);
+    return;
+  }
+
+  auto n = WriteToRingBuffer(&dir->rb, op.tx_data);
+  if (n > 0) {
+    Complete(&op, api::kSuccess, n);
+  }
+}
+
+}  // anonymous namespace
+
+// Side i writes to directions[i] and reads from the other one
+struct InProcTransport::Channel {
+  std::mutex mutex;
+  Direction directions[2];
+  bool closed[2] = {false, false};
+};
+
+InProcTransport::ListenerPtr InProcTransport::Listen(
+    objects::ContextPtr context, const std::string& name,
+    std::chrono::nanoseconds timeout, std::size_t transceive_byte_limit,
+    AcceptHandler handler) {
+  auto& registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  if (registry.listeners.count(name)) {
+    throw api::Error(YOGI_ERR_BIND_SOCKET_FAILED);
+  }
+
+  auto listener = ListenerPtr(new Listener(context, name, timeout,
+                                           transceive_byte_limit, handler));
+  registry.listeners[name] = listener.get();
+  return listener;
+}
+
+bool InProcTransport::IsListening(const std::string& name) {
+  auto& registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  return registry.listeners.count(name) != 0;
+}
+
+void InProcTransport::ConnectAsync(objects::ContextPtr context,
+                                   const std::string& name,
+                                   std::chrono::nanoseconds timeout,
+                                   std::size_t transceive_byte_limit,
+                                   ConnectHandler handler) {
+  auto& registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+
+  auto it = registry.listeners.find(name);
+  if (it == registry.listeners.end()) {
+    context->Post(
+        [=] { handler(api::Error(YOGI_ERR_CONNECT_SOCKET_FAILED), {}); });
+    return;
+  }
+
+  auto& listener = *it->second;
+  auto channel = std::make_shared<Channel>();
+
+  auto client = InProcTransportPtr(
+      new InProcTransport(context, channel, 0, timeout, transceive_byte_limit,
+                          false, "inproc:" + name));
+  auto server = InProcTransportPtr(new InProcTransport(
+      listener.context_, channel, 1, listener.timeout_,
+      listener.transceive_byte_limit_, true, "inproc:" + name + " (client)"));
+
+  auto accept_handler = listener.handler_;
+  listener.context_->Post([=] { accept_handler(api::kSuccess, server); });
+  context->Post([=] { handler(api::kSuccess, client); });
+}
+
+InProcTransport::~InProcTransport() { Shutdown(); }
+
+void InProcTransport::WriteSomeAsync(const ConstBufferSequence& data,
+                                     TransferSomeHandler handler) {
+  std::lock_guard<std::mutex> lock(channel_->mutex);
+  auto& dir = channel_->directions[side_];
+
+  if (channel_->closed[side_]) {
+    Complete(GetContext(), handler, api::Error(YOGI_ERR_CANCELED), 0);
+    return;
+  }
+
+  if (channel_->closed[1 - side_]) {
+    Complete(GetContext(), handler, api::Error(YOGI_ERR_RW_SOCKET_FAILED), 0);
+    return;
+  }
+
+  auto n = WriteToRingBuffer(&dir.rb, data);
+  if (n > 0) {
+    Complete(GetContext(), handler, api::kSuccess, n);
+    ServePendingRead(&dir, false);
+  } else {
+    dir.pending_write = {GetContext(), data, {}, handler};
+  }
+}
+
+void InProcTransport::ReadSomeAsync(const MutableBufferSequence& data,
+                                    TransferSomeHandler handler) {
+  std::lock_guard<std::mutex> lock(channel_->mutex);
+  auto& dir = channel_->directions[1 - side_];
+
+  if (channel_->closed[side_]) {
+    Complete(GetContext(), handler, api::Error(YOGI_ERR_CANCELED), 0);
+    return;
+  }
+
+  // Data written by the peer before it closed the connection can still be read
+  auto n = ReadFromRingBuffer(&dir.rb, data);
+  if (n > 0) {
+    Complete(GetContext(), handler, api::kSuccess, n);
+    ServePendingWrite(&dir, false);
+  } else if (channel_->closed[1 - side_]) {
+    Complete(GetContext(), handler, api::Error(YOGI_ERR_RW_SOCKET_FAILED), 0);
+  } else {
+    dir.pending_read = {GetContext(), {}, data, handler};
+  }
+}
+
+void InProcTransport::Shutdown() {
+  std::lock_guard<std::mutex> lock(channel_->mutex);
+  if (channel_->closed[side_]) return;
+
+  channel_->closed[side_] = true;
+
+  auto& tx_dir = channel_->directions[side_];
+  auto& rx_dir = channel_->directions[1 - side_];
+
+  if (tx_dir.pending_write.handler) {
+    Complete(&tx_dir.pending_write, api::Error(YOGI_ERR_CANCELED), 0);
+  }
+
+  if (rx_dir.pending_read.handler) {
+    Complete(&rx_dir.pending_read, api::Error(YOGI_ERR_CANCELED), 0);
+  }
+
+  ServePendingRead(&tx_dir, true);
+  ServePendingWrite(&rx_dir, true);
+}
+
+InProcTransport::InProcTransport(objects::ContextPtr context,
+                                 ChannelPtr channel, std::size_t side,
+                                 std::chrono::nanoseconds timeout,
+                                 std::size_t transceive_byte_limit,
+                                 bool created_via_accept,
+                                 std::string peer_description)
+    : Transport(context, timeout, created_via_accept, peer_description,
+                transceive_byte_limit),
+      channel_(channel),
+      side_(side) {}
+
+InProcTransport::Listener::~Listener() {
+  auto& registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  registry.listeners.erase(name_);
+}
+
+InProcTransport::Listener::Listener(objects::ContextPtr context,
+                                    const std::string& name,
+                                    std::chrono::nanoseconds timeout,
+                                    std::size_t transceive_byte_limit,
+                                    AcceptHandler handler)
+    : context_(context),
+      name_(name),
+      timeout_(timeout),
+      transceive_byte_limit_(transceive_byte_limit),
+      handler_(handler) {}
+
+}  // namespace network
@@ -0,0 +1,101 @@
+/*
+ * This file is part of the Yogi distribution https://github.com/yohummus/yogi.
+ * Copyright (c) 2018 Johannes Bergmann.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "../config.h"
+#include "../utils/ringbuffer.h"
+#include "transport.h"
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace network {
+
+class InProcTransport;
+typedef std::shared_ptr<InProcTransport> InProcTransportPtr;
+typedef std::weak_ptr<InProcTransport> InProcTransportWeakPtr;
+
+// Transport between objects within the same process. Data gets passed through
+// a pair of ring buffers shared by both ends of the connection, i.e. without
+// any system calls. Names are registered in a process-wide table via Listen().
+class InProcTransport : public Transport {
+ public:
+  class Listener;
+  typedef std::unique_ptr<Listener> ListenerPtr;
+  typedef std::function<void(const api::Result&, TransportPtr)> AcceptHandler;
+  typedef std::function<void(const api::Result&, TransportPtr)> ConnectHandler;
+
+  // Incoming connections get passed to the handler until the returned
+  // listener is destroyed
+  static ListenerPtr Listen(objects::ContextPtr context,
+                            const std::string& name,
+                            std::chrono::nanoseconds timeout,
+                            std::size_t transceive_byte_limit,
+                            AcceptHandler handler);
+
+  static bool IsListening(const std::string& name);
+
+  static void ConnectAsync(objects::ContextPtr context, const std::string& name,
+                           std::chrono::nanoseconds timeout,
+                           std::size_t transceive_byte_limit,
+                           ConnectHandler handler);
+
+  virtual ~InProcTransport();
+
+ protected:
+  virtual void WriteSomeAsync(const ConstBufferSequence& data,
+                              TransferSomeHandler handler) override;
+  virtual void ReadSomeAsync(const MutableBufferSequence& data,
+                             TransferSomeHandler handler) override;
+  virtual void Shutdown() override;
+
+ private:
+  struct Channel;
+  typedef std::shared_ptr<Channel> ChannelPtr;
+
+  InProcTransport(objects::ContextPtr context, ChannelPtr channel,
+                  std::size_t side, std::chrono::nanoseconds timeout,
+                  std::size_t transceive_byte_limit, bool created_via_accept,
+                  std::string peer_description);
+
+  const ChannelPtr channel_;
+  const std::size_t side_;  // Index of the direction we write to
+};
+
+class InProcTransport::Listener {
+ public:
+  ~Listener();
+
+ private:
+  friend class InProcTransport;
+
+  Listener(objects::ContextPtr context, const std::string& name,
+           std::chrono::nanoseconds timeout, std::size_t transceive_byte_limit,
+           AcceptHandler handler);
+
+  const objects::ContextPtr context_;
+  const std::string name_;
+  const std::chrono::nanoseconds timeout_;
+  const std::size_t transceive_byte_limit_;
+  const AcceptHandler handler_;
+};
+
+}  // namespace network
@@ -67,14 +67,15 @@ utils::ByteVector CheckAndConvertPayloadFromJsonToMsgPack(const char* data,
 }  // anonymous namespace
 }  // namespace internal
 
-void IncomingMessage::Deserialize(const utils::ByteVector& serialized_msg,
+void IncomingMessage::Deserialize(boost::asio::const_buffer serialized_msg,
                                   const MessageHandler& fn) {
-  if (serialized_msg.empty()) {
+  if (serialized_msg.size() == 0) {
     fn(messages::HeartbeatIncoming());
     return;
   }
 
-  switch (serialized_msg[0]) {
+  auto type = *static_cast<const utils::Byte*>(serialized_msg.data());
+  switch (type) {
     case MessageType::kAcknowledge:
       fn(messages::AcknowledgeIncoming());
       break;
@@ -85,12 +86,24 @@ void IncomingMessage::Deserialize(const utils::ByteVector& serialized_msg,
 
     default:
       throw api::DescriptiveError(YOGI_ERR_DESERIALIZE_MSG_FAILED)
-          << "Unknown message type " << serialized_msg[0];
+          << "Unknown message type " << type;
   }
 }
 
+void IncomingMessage::Deserialize(const utils::ByteVector& serialized_msg,
+                                  const MessageHandler& fn) {
+  Deserialize(boost::asio::buffer(serialized_msg), fn);
+}
+
 void Payload::SerializeTo(utils::SmallByteVector* buffer) const {
-  if (data_.size() == 0) return;
+  auto data = SerializeOrBorrow(buffer);
+  auto raw = static_cast<const utils::Byte*>(data.data());
+  buffer->insert(buffer->end(), raw, raw + data.size());
+}
+
+boost::asio::const_buffer Payload::SerializeOrBorrow(
+    utils::SmallByteVector* buffer) const {
+  if (data_.size() == 0) return {};
 
   auto raw = static_cast<const char*>(data_.data());
 
@@ -99,18 +112,17 @@ void Payload::SerializeTo(utils::SmallByteVector* buffer) const {
       auto data =
           internal::CheckAndConvertPayloadFromJsonToMsgPack(raw, data_.size());
       buffer->insert(buffer->end(), data.begin(), data.end());
-      break;
+      return {};
     }
 
     case api::Encoding::kMsgPack: {
       internal::CheckPayloadIsValidMsgPack(raw, data_.size());
-      buffer->insert(buffer->end(), raw, raw + data_.size());
-
-      break;
+      return data_;
     }
 
     default:
       YOGI_NEVER_REACHED;
+      return {};
   }
 }
 
@@ -161,9 +173,31 @@ api::Result Payload::SerializeToUserBuffer(boost::asio::mutable_buffer buffer,
   return api::kSuccess;
 }
 
-std::size_t OutgoingMessage::GetSize() const { return Serialize().size(); }
+std::size_t OutgoingMessage::GetSize() const {
+  return boost::asio::buffer_size(GetSerializedBuffers());
+}
+
+OutgoingMessage::ConstBufferSequence OutgoingMessage::GetSerializedBuffers()
+    const {
+  if (shared_serialized_msg_) {
+    return {{boost::asio::buffer(shared_serialized_msg_->data(),
+                                 shared_serialized_msg_->size()),
+             boost::asio::const_buffer{}}};
+  } else {
+    return {{boost::asio::buffer(serialized_msg_.data(),
+                                 serialized_msg_.size()),
+             borrowed_payload_}};
+  }
+}
 
 const utils::SmallByteVector& OutgoingMessage::Serialize() const {
+  if (!shared_serialized_msg_ && borrowed_payload_.size() > 0) {
+    auto raw = static_cast<const utils::Byte*>(borrowed_payload_.data());
+    auto msg = utils::MakeSharedSmallByteVector(serialized_msg_);
+    msg->insert(msg->end(), raw, raw + borrowed_payload_.size());
+    shared_serialized_msg_ = msg;
+  }
+
   if (shared_serialized_msg_) {
     return *shared_serialized_msg_;
   } else {
@@ -173,8 +207,12 @@ const utils::SmallByteVector& OutgoingMessage::Serialize() const {
 
 utils::SharedSmallByteVector OutgoingMessage::SerializeShared() {
   if (!shared_serialized_msg_) {
-    shared_serialized_msg_ =
-        utils::MakeSharedSmallByteVector(std::move(serialized_msg_));
+    if (borrowed_payload_.size() > 0) {
+      Serialize();
+    } else {
+      shared_serialized_msg_ =
+          utils::MakeSharedSmallByteVector(std::move(serialized_msg_));
+    }
   }
 
   return shared_serialized_msg_;
@@ -183,10 +221,16 @@ utils::SharedSmallByteVector OutgoingMessage::SerializeShared() {
 OutgoingMessage::OutgoingMessage(utils::SmallByteVector serialized_msg)
     : serialized_msg_(serialized_msg) {}
 
+OutgoingMessage::OutgoingMessage(utils::SmallByteVector serialized_msg_header,
+                                 const Payload& payload)
+    : serialized_msg_(serialized_msg_header) {
+  borrowed_payload_ = payload.SerializeOrBorrow(&serialized_msg_);
+}
+
 namespace messages {
 
-BroadcastIncoming::BroadcastIncoming(const utils::ByteVector& serialized_msg)
-    : payload_(boost::asio::buffer(serialized_msg) + 1,
+BroadcastIncoming::BroadcastIncoming(boost::asio::const_buffer serialized_msg)
+    : payload_(serialized_msg + 1,
                api::Encoding::kMsgPack) {}
 
 std::string BroadcastIncoming::ToString() const {
@@ -197,7 +241,7 @@ std::string BroadcastIncoming::ToString() const {
 }
 
 BroadcastOutgoing::BroadcastOutgoing(const Payload& payload)
-    : OutgoingMessage(MakeMsgBytes(payload)) {}
+    : OutgoingMessage(MakeMsgBytes(), payload) {}
 
 std::string BroadcastOutgoing::ToString() const {
   std::stringstream ss;
@@ -62,6 +62,8 @@ class IncomingMessage : virtual public Message {
  public:
   typedef std::function<void(const IncomingMessage&)> MessageHandler;
 
+  static void Deserialize(boost::asio::const_buffer serialized_msg,
+                          const MessageHandler& fn);
   static void Deserialize(const utils::ByteVector& serialized_msg,
                           const MessageHandler& fn);
 
@@ -75,10 +77,15 @@ class Payload {
       : data_(data), enc_(enc) {}
 
   void SerializeTo(utils::SmallByteVector* buffer) const;
+  boost::asio::const_buffer SerializeOrBorrow(
+      utils::SmallByteVector* buffer) const;
   api::Result SerializeToUserBuffer(boost::asio::mutable_buffer buffer,
                                     api::Encoding enc,
                                     std::size_t* bytes_written) const;
 
+  boost::asio::const_buffer GetData() const { return data_; }
+  api::Encoding GetEncoding() const { return enc_; }
+
  private:
   boost::asio::const_buffer data_;
   api::Encoding enc_;
@@ -124,16 +131,26 @@ class MessageT : virtual public Message {
 
 class OutgoingMessage : virtual public Message {
  public:
+  typedef std::array<boost::asio::const_buffer, 2> ConstBufferSequence;
+
   std::size_t GetSize() const;
+  ConstBufferSequence GetSerializedBuffers() const;
   const utils::SmallByteVector& Serialize() const;
   utils::SharedSmallByteVector SerializeShared();
 
  protected:
   OutgoingMessage(utils::SmallByteVector serialized_msg);
 
+  // The payload is only referenced (not copied) if it does not need to be
+  // converted; in that case the message must not outlive the user's data
+  // unless SerializeShared() has been called.
+  OutgoingMessage(utils::SmallByteVector serialized_msg_header,
+                  const Payload& payload);
+
  private:
   utils::SmallByteVector serialized_msg_;
-  utils::SharedSmallByteVector shared_serialized_msg_;
+  boost::asio::const_buffer borrowed_payload_;
+  mutable utils::SharedSmallByteVector shared_serialized_msg_;
 };
 
 namespace messages {
@@ -165,7 +182,7 @@ class Broadcast : public MessageT<MessageType::kBroadcast> {};
 
 class BroadcastIncoming : public IncomingMessage, public Broadcast {
  public:
-  BroadcastIncoming(const utils::ByteVector& serialized_msg);
+  BroadcastIncoming(boost::asio::const_buffer serialized_msg);
 
   virtual std::string ToString() const override final;
 
@@ -16,7 +16,6 @@
  */
 
 #include "msg_transport.h"
-#include "../utils/algorithm.h"
 
 namespace network {
 namespace internal {
@@ -63,6 +62,33 @@ bool DeserializeMsgSizeField(const std::array<utils::Byte, 5>& buffer,
 
 }  // namespace internal
 
+namespace {
+
+utils::SharedSmallByteVector MakeSharedCopy(
+    const OutgoingMessage::ConstBufferSequence& bufs) {
+  auto bytes =
+      utils::MakeSharedSmallByteVector(boost::asio::buffer_size(bufs));
+  boost::asio::buffer_copy(boost::asio::buffer(bytes->data(), bytes->size()),
+                           bufs);
+  return bytes;
+}
+
+// Removes the first n bytes of the (up to) two readable regions of a ring
+// buffer
+utils::LockFreeRingBuffer::ConstBuffers DropFront(
+    utils::LockFreeRingBuffer::ConstBuffers bufs, std::size_t n) {
+  auto first = std::min(n, bufs[0].size());
+  bufs[0] += first;
+  bufs[1] += n - first;
+  if (bufs[0].size() == 0) {
+    std::swap(bufs[0], bufs[1]);
+  }
+
+  return bufs;
+}
+
+}  // anonymous namespace
+
 MessageTransport::MessageTransport(TransportPtr transport,
                                    std::size_t tx_queue_size,
                                    std::size_t rx_queue_size)
@@ -71,27 +97,84 @@ MessageTransport::MessageTransport(TransportPtr transport,
       tx_rb_(tx_queue_size),
       rx_rb_(rx_queue_size),
       last_tx_error_(api::kSuccess),
+      tx_failed_(false),
+      tx_credit_(tx_rb_.Capacity()),
+      pending_sends_count_(0),
+      drain_submissions_scheduled_(false),
+      sending_from_bc_log_(false),
+      tx_at_frame_boundary_(true),
       send_to_transport_running_(false),
+      defer_tx_release_(false),
+      tx_rb_unreleased_(0),
+      bc_unreleased_(0),
+      released_ahead_(0),
+      last_send_time_(
+          std::chrono::steady_clock::now().time_since_epoch().count()),
+      coalescing_delay_(std::chrono::nanoseconds::zero()),
+      coalescing_bytes_(0),
+      coalescing_timer_running_(false),
+      leased_size_(0),
       receive_from_transport_running_(false),
       last_rx_error_(api::kSuccess) {
   ResetReceivedSizeField();
 }
 
-void MessageTransport::Start() { ReceiveSomeBytesFromTransport(); }
+void MessageTransport::EnableCoalescing(std::chrono::nanoseconds max_delay,
+                                        std::size_t max_bytes) {
+  coalescing_delay_ = max_delay;
+  coalescing_bytes_ = max_bytes;
+}
 
-bool MessageTransport::TrySend(const OutgoingMessage& msg) {
+void MessageTransport::ReleaseSentBytes(std::size_t n) {
   std::lock_guard<std::mutex> lock(tx_mutex_);
-  if (last_tx_error_.IsError()) {
-    throw last_tx_error_.ToError();
+  CommitReleasedBytes(n);
+
+  if (AvailableForSend() > 0) {
+    SendSomeBytesToTransport();
   }
 
-  if (pending_sends_.empty()) {
-    return TrySendImpl(msg.Serialize());
-  } else {
-    return false;
+  DrainSubmissions();
+  RetrySendingPendingSends();
+}
+
+void MessageTransport::Start() { ReceiveSomeBytesFromTransport(); }
+
+void MessageTransport::AttachBroadcastLog(const BroadcastLogPtr& log,
+                                          BroadcastLog::LagFn lag_fn,
+                                          BroadcastLog::NotifyFn overrun_fn) {
+  auto weak_self = MakeWeakPtr();
+  auto cursor = log->MakeCursor(context_,
+                                [weak_self] {
+                                  if (auto self = weak_self.lock()) {
+                                    self->OnBroadcastLogAppended();
+                                  }
+                                },
+                                lag_fn, overrun_fn);
+
+  std::lock_guard<std::mutex> lock(tx_mutex_);
+  if (!tx_failed_) {
+    bc_cursor_ = std::move(cursor);
   }
 }
 
+std::size_t MessageTransport::GetBroadcastBacklog() const {
+  std::lock_guard<std::mutex> lock(tx_mutex_);
+  return bc_cursor_ ? bc_cursor_->AvailableForRead() : 0;
+}
+
+bool MessageTransport::TrySend(const OutgoingMessage& msg) {
+  ThrowOnTxError();
+
+  // Messages must not overtake pending sends
+  if (pending_sends_count_.load(std::memory_order_acquire) > 0) return false;
+
+  auto msg_bufs = msg.GetSerializedBuffers();
+  if (!TryReserveTxSpace(boost::asio::buffer_size(msg_bufs))) return false;
+
+  SendReserved(msg_bufs);
+  return true;
+}
+
 void MessageTransport::SendAsync(OutgoingMessage* msg, OperationTag tag,
                                  SendHandler handler) {
   YOGI_ASSERT(tag != 0);
@@ -106,27 +189,30 @@ bool MessageTransport::CancelSend(OperationTag tag) {
   YOGI_ASSERT(tag != 0);
 
   std::lock_guard<std::mutex> lock(tx_mutex_);
-  auto it =
-      utils::find_if(pending_sends_, [&](auto& ps) { return ps.tag == tag; });
+  DrainSubmissions();
+
+  auto it = pending_sends_by_tag_.find(tag);
+  if (it == pending_sends_by_tag_.end()) return false;
 
-  if (it == pending_sends_.end()) return false;
+  auto handler = std::move(it->second->handler);
+  RecyclePendingSend(it->second);
 
-  auto handler = std::move(it->handler);
-  pending_sends_.erase(it);
+  transport_->Post([=] { handler(api::Error(YOGI_ERR_CANCELED)); });
 
-  transport_->GetContext()->Post(
-      [=] { handler(api::Error(YOGI_ERR_CANCELED)); });
+  // The canceled operation may have been blocking the ones behind it
+  RetrySendingPendingSends();
 
   return true;
 }
 
 void MessageTransport::ReceiveAsync(boost::asio::mutable_buffer msg,
                                     ReceiveHandler handler) {
-  YOGI_ASSERT(!pending_receive_handler_);
+  YOGI_ASSERT(!pending_receive_handler_ && !pending_lease_handler_);
   YOGI_ASSERT(!size_field_valid_);
+  YOGI_ASSERT(leased_size_ == 0);
 
   if (last_rx_error_.IsError()) {
-    transport_->GetContext()->Post([=] { handler(last_rx_error_, 0); });
+    transport_->Post([=] { handler(last_rx_error_, 0); });
     return;
   }
 
@@ -137,74 +223,279 @@ void MessageTransport::ReceiveAsync(boost::asio::mutable_buffer msg,
   ReceiveSomeBytesFromTransport();
 }
 
+void MessageTransport::ReceiveLeaseAsync(LeaseReceiveHandler handler) {
+  YOGI_ASSERT(!pending_receive_handler_ && !pending_lease_handler_);
+  YOGI_ASSERT(leased_size_ == 0);
+
+  if (last_rx_error_.IsError()) {
+    transport_->Post([=] { handler(last_rx_error_, {}); });
+    return;
+  }
+
+  pending_lease_handler_ = handler;
+  TryDeliveringPendingReceive();
+
+  ReceiveSomeBytesFromTransport();
+}
+
+void MessageTransport::ReleaseLeasedReceive() {
+  rx_rb_.Discard(leased_size_);
+  leased_size_ = 0;
+
+  if (last_rx_error_.IsSuccess()) {
+    ReceiveSomeBytesFromTransport();
+  }
+}
+
+bool MessageTransport::TryReceiveLease(boost::asio::const_buffer* msg) {
+  YOGI_ASSERT(!pending_receive_handler_ && !pending_lease_handler_);
+  YOGI_ASSERT(leased_size_ == 0);
+
+  if (last_rx_error_.IsError()) return false;
+
+  std::size_t size;
+  if (!TryGetReceivedSizeField(&size) || rx_rb_.AvailableForRead() < size) {
+    return false;
+  }
+
+  ResetReceivedSizeField();
+  *msg = LeaseReceivedMessage(size);
+
+  return true;
+}
+
 void MessageTransport::CancelReceive() {
+  if (pending_lease_handler_) {
+    LeaseReceiveHandler handler;
+    std::swap(handler, pending_lease_handler_);
+
+    transport_->Post([=] { handler(api::Error(YOGI_ERR_CANCELED), {}); });
+  }
+
   if (!pending_receive_handler_) return;
 
   ReceiveHandler handler;
   std::swap(handler, pending_receive_handler_);
 
-  transport_->GetContext()->Post(
-      [=] { handler(api::Error(YOGI_ERR_CANCELED), 0); });
+  transport_->Post([=] { handler(api::Error(YOGI_ERR_CANCELED), 0); });
 }
 
-bool MessageTransport::TrySendImpl(const utils::SmallByteVector& msg_bytes) {
-  if (!CanSend(msg_bytes.size())) return false;
-
-  SizeFieldBuffer size_field_buf;
-  auto n = internal::SerializeMsgSizeField(msg_bytes.size(), &size_field_buf);
-  auto bytes_written = tx_rb_.Write(size_field_buf.data(), n);
-  YOGI_UNUSED(bytes_written);
-  YOGI_ASSERT(bytes_written == n);
+void MessageTransport::ThrowOnTxError() {
+  if (tx_failed_.load(std::memory_order_acquire)) {
+    std::lock_guard<std::mutex> lock(tx_mutex_);
+    throw last_tx_error_.ToError();
+  }
+}
 
-  bytes_written = tx_rb_.Write(
-      static_cast<const utils::Byte*>(msg_bytes.data()), msg_bytes.size());
-  YOGI_ASSERT(bytes_written == msg_bytes.size());
+bool MessageTransport::TryReserveTxSpace(std::size_t msg_size) {
+  auto n = msg_size + internal::CalculateMsgSizeFieldLength(msg_size);
+  YOGI_ASSERT(n <= tx_rb_.Capacity());
 
-  SendSomeBytesToTransport();
+  auto credit = tx_credit_.load(std::memory_order_relaxed);
+  do {
+    if (credit < n) return false;
+  } while (!tx_credit_.compare_exchange_weak(credit, credit - n,
+                                             std::memory_order_acquire,
+                                             std::memory_order_relaxed));
 
   return true;
 }
 
-bool MessageTransport::CanSend(std::size_t msg_size) const {
-  YOGI_ASSERT(msg_size + internal::CalculateMsgSizeFieldLength(msg_size) <=
-              tx_rb_.Capacity());
+void MessageTransport::SendReserved(
+    const OutgoingMessage::ConstBufferSequence& msg_bufs) {
+  std::unique_lock<std::mutex> lock(tx_mutex_, std::try_to_lock);
+  if (lock) {
+    DrainSubmissions();
+    WriteToTxQueue(msg_bufs);
+  } else {
+    Submit({true, 0, MakeSharedCopy(msg_bufs), {}});
+  }
+}
+
+void MessageTransport::WriteToTxQueue(
+    const OutgoingMessage::ConstBufferSequence& msg_bufs) {
+  auto msg_size = boost::asio::buffer_size(msg_bufs);
+
+  // Serialize the size field and the message directly into the reserved
+  // space in the ring buffer so no intermediate frame has to be assembled
+  SizeFieldBuffer size_field_buf;
+  auto n = internal::SerializeMsgSizeField(msg_size, &size_field_buf);
+  std::array<boost::asio::const_buffer, 3> frame = {
+      {boost::asio::buffer(size_field_buf.data(), n), msg_bufs[0],
+       msg_bufs[1]}};
+
+  auto bytes_written =
+      boost::asio::buffer_copy(tx_rb_.Reserve(n + msg_size), frame);
+  YOGI_ASSERT(bytes_written == n + msg_size);
+  tx_rb_.CommitWriteArrays(bytes_written);
 
-  auto n = tx_rb_.AvailableForWrite();
-  if (n >= msg_size + 5) return true;  // optimisation since this is very likely
-  return n >= msg_size + internal::CalculateMsgSizeFieldLength(msg_size);
+  FlushOrStartCoalescing();
 }
 
 void MessageTransport::SendAsyncImpl(OutgoingMessage* msg, OperationTag tag,
                                      SendHandler handler) {
-  std::lock_guard<std::mutex> lock(tx_mutex_);
-
-  if (tag != 0) {
-    CheckOperationTagIsNotUsed(tag);
+  if (tx_failed_.load(std::memory_order_acquire)) {
+    std::lock_guard<std::mutex> lock(tx_mutex_);
+    auto err = last_tx_error_;
+    transport_->Post([=] { handler(err); });
+    return;
   }
 
-  if (last_tx_error_.IsError()) {
-    transport_->GetContext()->Post([=] { handler(last_tx_error_); });
+  auto msg_bufs = msg->GetSerializedBuffers();
+  if (pending_sends_count_.load(std::memory_order_acquire) == 0 &&
+      TryReserveTxSpace(boost::asio::buffer_size(msg_bufs))) {
+    SendReserved(msg_bufs);
+    transport_->Post([=] { handler(api::kSuccess); });
     return;
   }
 
-  if (pending_sends_.empty() && TrySendImpl(msg->Serialize())) {
-    transport_->GetContext()->Post([=] { handler(api::kSuccess); });
+  pending_sends_count_.fetch_add(1, std::memory_order_acq_rel);
+
+  std::unique_lock<std::mutex> lock(tx_mutex_, std::try_to_lock);
+  if (lock) {
+    DrainSubmissions();
+    if (tag != 0) {
+      CheckOperationTagIsNotUsed(tag);
+    }
+
+    EnqueuePendingSend(tag, msg->SerializeShared(), handler);
+    RetrySendingPendingSends();
   } else {
-    PendingSend ps = {tag, msg->SerializeShared(), handler};
-    pending_sends_.push_back(ps);
+    Submit({false, tag, msg->SerializeShared(), handler});
+  }
+}
 
-    YOGI_ASSERT(send_to_transport_running_);
+void MessageTransport::Submit(Submission sub) {
+  submissions_.Push(std::move(sub));
+
+  // Make sure the submission gets picked up even if no other operation
+  // acquires tx_mutex_ anytime soon
+  if (!drain_submissions_scheduled_.exchange(true)) {
+    auto weak_self = MakeWeakPtr();
+    transport_->Post([=] {
+      auto self = weak_self.lock();
+      if (!self) return;
+
+      self->drain_submissions_scheduled_ = false;
+
+      std::lock_guard<std::mutex> lock(self->tx_mutex_);
+      self->DrainSubmissions();
+      self->RetrySendingPendingSends();
+    });
   }
 }
 
-void MessageTransport::SendSomeBytesToTransport() {
-  YOGI_ASSERT(!tx_rb_.Empty());
+void MessageTransport::DrainSubmissions() {
+  submissions_.ConsumeAll([&](Submission&& sub) {
+    auto& msg_bytes = *sub.msg_bytes;
+    if (sub.space_reserved) {
+      if (!last_tx_error_.IsError()) {
+        auto buf = boost::asio::buffer(msg_bytes.data(), msg_bytes.size());
+        WriteToTxQueue({{buf, boost::asio::const_buffer{}}});
+      }
+    } else if (last_tx_error_.IsError()) {
+      pending_sends_count_.fetch_sub(1, std::memory_order_acq_rel);
+      auto err = last_tx_error_;
+      auto handler = std::move(sub.handler);
+      transport_->Post([=] { handler(err); });
+    } else {
+      if (sub.tag != 0) {
+        CheckOperationTagIsNotUsed(sub.tag);
+      }
+
+      EnqueuePendingSend(sub.tag, sub.msg_bytes, sub.handler);
+    }
+  });
+}
+
+std::size_t MessageTransport::SendableFromTxQueue() const {
+  return tx_rb_.AvailableForRead() - tx_rb_unreleased_;
+}
 
+std::size_t MessageTransport::SendableFromBroadcastLog() const {
+  if (!bc_cursor_) return 0;
+
+  // A lagging cursor may only see part of what has been written already
+  auto n = bc_cursor_->AvailableForRead();
+  return n > bc_unreleased_ ? n - bc_unreleased_ : 0;
+}
+
+std::size_t MessageTransport::AvailableForSend() const {
+  return SendableFromTxQueue() + SendableFromBroadcastLog();
+}
+
+void MessageTransport::OnBroadcastLogAppended() {
+  std::lock_guard<std::mutex> lock(tx_mutex_);
+  if (SendableFromBroadcastLog() > 0) {
+    FlushOrStartCoalescing();
+  }
+}
+
+void MessageTransport::FlushOrStartCoalescing() {
+  // While a write is running, everything queued in the meantime gets sent
+  // in one go once it finishes anyway. Pending sends mean that the TX queue
+  // ran full, so holding its contents back any longer only stalls them.
+  if (coalescing_delay_ == coalescing_delay_.zero() ||
+      send_to_transport_running_ ||
+      pending_sends_count_.load(std::memory_order_acquire) > 0 ||
+      AvailableForSend() >= coalescing_bytes_) {
+    SendSomeBytesToTransport();
+    return;
+  }
+
+  if (coalescing_timer_running_) return;
+  coalescing_timer_running_ = true;
+
+  // The timer is never cancelled; if the queue got flushed in the meantime,
+  // the handler simply finds nothing (or only newer messages) to send
+  auto weak_self = MakeWeakPtr();
+  context_->GetTimerWheel().ScheduleAfter(coalescing_delay_, [weak_self] {
+    auto self = weak_self.lock();
+    if (!self) return;
+
+    self->transport_->Post([weak_self] {
+      if (auto self = weak_self.lock()) {
+        self->OnCoalescingTimerExpired();
+      }
+    });
+  });
+}
+
+void MessageTransport::OnCoalescingTimerExpired() {
+  std::lock_guard<std::mutex> lock(tx_mutex_);
+  coalescing_timer_running_ = false;
+
+  if (AvailableForSend() > 0) {
+    SendSomeBytesToTransport();
+  }
+}
+
+void MessageTransport::SendSomeBytesToTransport() {
   if (send_to_transport_running_) return;
+
+  // Both sources only contain complete messages, so we can switch between
+  // them whenever the previous write did not stop in the middle of one. The
+  // sources take turns in order to not starve each other.
+  if (!bc_cursor_) {
+    sending_from_bc_log_ = false;
+  } else if (tx_at_frame_boundary_) {
+    if (sending_from_bc_log_) {
+      sending_from_bc_log_ = SendableFromTxQueue() == 0;
+    } else {
+      sending_from_bc_log_ = SendableFromBroadcastLog() > 0;
+    }
+  }
+
+  auto bufs = sending_from_bc_log_
+                  ? bc_cursor_->ReadArrays(bc_unreleased_)
+                  : DropFront(tx_rb_.ReadArrays(), tx_rb_unreleased_);
+  auto size = boost::asio::buffer_size(bufs);
+  if (size == 0) return;
+
   send_to_transport_running_ = true;
 
   auto weak_self = MakeWeakPtr();
-  transport_->SendSomeAsync(tx_rb_.FirstReadArray(), [=](auto& res, auto n) {
+  transport_->SendSomeAsync(bufs, [=](auto& res, auto n) {
     auto self = weak_self.lock();
     if (!self) return;
 
@@ -213,27 +504,125 @@ void MessageTransport::SendSomeBytesToTransport() {
       return;
     }
 
+    self->last_send_time_ =
+        std::chrono::steady_clock::now().time_since_epoch().count();
+
     std::lock_guard<std::mutex> lock(tx_mutex_);
-    self->tx_rb_.CommitFirstReadArray(n);
+    if (self->defer_tx_release_) {
+      self->AddUnreleasedWrite(self->sending_from_bc_log_, n);
+    } else if (self->sending_from_bc_log_) {
+      self->bc_cursor_->Advance(n);
+    } else {
+      self->tx_rb_.CommitReadArrays(n);
+      self->tx_credit_.fetch_add(n, std::memory_order_release);
+    }
+
+    self->tx_at_frame_boundary_ = n == size;
     send_to_transport_running_ = false;
 
-    if (!self->tx_rb_.Empty()) {
+    if (self->AvailableForSend() > 0) {
       self->SendSomeBytesToTransport();
     }
 
+    self->DrainSubmissions();
     self->RetrySendingPendingSends();
   });
 }
 
+void MessageTransport::AddUnreleasedWrite(bool from_bc_log, std::size_t n) {
+  if (from_bc_log) {
+    bc_unreleased_ += n;
+  } else {
+    tx_rb_unreleased_ += n;
+  }
+
+  if (!unreleased_writes_.empty() &&
+      unreleased_writes_.back().from_bc_log == from_bc_log) {
+    unreleased_writes_.back().size += n;
+  } else {
+    unreleased_writes_.push_back({from_bc_log, n});
+  }
+
+  if (released_ahead_ > 0) {
+    auto released = released_ahead_;
+    released_ahead_ = 0;
+    CommitReleasedBytes(released);
+  }
+}
+
+void MessageTransport::CommitReleasedBytes(std::size_t n) {
+  while (n > 0 && !unreleased_writes_.empty()) {
+    auto& writes = unreleased_writes_.front();
+    auto k = std::min(n, writes.size);
+
+    if (writes.from_bc_log) {
+      bc_unreleased_ -= k;
+      if (bc_cursor_) {
+        // The running write may still be reading from the cursor as well
+        bool still_reading = bc_unreleased_ > 0 ||
+                             (send_to_transport_running_ &&
+                              sending_from_bc_log_);
+        bc_cursor_->Advance(k, still_reading);
+      }
+    } else {
+      tx_rb_unreleased_ -= k;
+      tx_rb_.CommitReadArrays(k);
+      tx_credit_.fetch_add(k, std::memory_order_release);
+    }
+
+    writes.size -= k;
+    if (writes.size == 0) {
+      unreleased_writes_.pop_front();
+    }
+
+    n -= k;
+  }
+
+  // The notification overtook the completion of the write
+  released_ahead_ += n;
+}
+
+void MessageTransport::EnqueuePendingSend(OperationTag tag,
+                                          utils::SharedSmallByteVector msg,
+                                          SendHandler handler) {
+  if (pending_sends_pool_.empty()) {
+    pending_sends_.push_back({});
+  } else {
+    pending_sends_.splice(pending_sends_.end(), pending_sends_pool_,
+                          pending_sends_pool_.begin());
+  }
+
+  auto it = std::prev(pending_sends_.end());
+  *it = {tag, msg, handler};
+
+  if (tag != 0) {
+    pending_sends_by_tag_[tag] = it;
+  }
+}
+
+void MessageTransport::RecyclePendingSend(PendingSendList::iterator it) {
+  if (it->tag != 0) {
+    pending_sends_by_tag_.erase(it->tag);
+  }
+
+  pending_sends_count_.fetch_sub(1, std::memory_order_acq_rel);
+  *it = {};
+  pending_sends_pool_.splice(pending_sends_pool_.end(), pending_sends_, it);
+}
+
 void MessageTransport::RetrySendingPendingSends() {
-  auto it = pending_sends_.begin();
-  while (it != pending_sends_.end() && TrySendImpl(*it->msg_bytes)) {
+  while (!pending_sends_.empty()) {
+    auto it = pending_sends_.begin();
+    auto& msg_bytes = *it->msg_bytes;
+    if (!TryReserveTxSpace(msg_bytes.size())) break;
+
+    WriteToTxQueue({{boost::asio::buffer(msg_bytes.data(), msg_bytes.size()),
+                     boost::asio::const_buffer{}}});
+
     auto handler = std::move(it->handler);
-    transport_->GetContext()->Post([=] { handler(api::kSuccess); });
-    ++it;
+    transport_->Post([=] { handler(api::kSuccess); });
+    RecyclePendingSend(it);
   }
-
-  pending_sends_.erase(pending_sends_.begin(), it);
 }
 
 bool MessageTransport::TryGetReceivedSizeField(std::size_t* msg_size) {
@@ -277,35 +666,39 @@ void MessageTransport::ReceiveSomeBytesFromTransport() {
   receive_from_transport_running_ = true;
 
   auto weak_self = MakeWeakPtr();
-  transport_->ReceiveSomeAsync(rx_rb_.FirstWriteArray(),
-                               [=](auto& res, auto n) {
-                                 auto self = weak_self.lock();
-                                 if (!self) return;
+  transport_->ReceiveSomeAsync(rx_rb_.WriteArrays(), [=](auto& res, auto n) {
+    auto self = weak_self.lock();
+    if (!self) return;
 
-                                 if (res.IsError()) {
-                                   self->HandleReceiveError(res.ToError());
-                                   return;
-                                 }
+    if (res.IsError()) {
+      self->HandleReceiveError(res.ToError());
+      return;
+    }
 
-                                 self->rx_rb_.CommitFirstWriteArray(n);
-                                 receive_from_transport_running_ = false;
+    self->rx_rb_.CommitWriteArrays(n);
+    receive_from_transport_running_ = false;
 
-                                 self->TryDeliveringPendingReceive();
+    self->TryDeliveringPendingReceive();
 
-                                 if (!self->rx_rb_.Full()) {
-                                   self->ReceiveSomeBytesFromTransport();
-                                 }
-                               });
+    if (!self->rx_rb_.Full()) {
+      self->ReceiveSomeBytesFromTransport();
+    }
+  });
 }
 
 void MessageTransport::TryDeliveringPendingReceive() {
-  if (!pending_receive_handler_) return;
+  if (!pending_receive_handler_ && !pending_lease_handler_) return;
 
   std::size_t size;
   if (!TryGetReceivedSizeField(&size) || rx_rb_.AvailableForRead() < size) {
     return;
   }
 
+  if (pending_lease_handler_) {
+    DeliverLeasedReceive(size);
+    return;
+  }
+
   ReceiveHandler handler;
   std::swap(handler, pending_receive_handler_);
   ResetReceivedSizeField();
@@ -315,11 +708,34 @@ void MessageTransport::TryDeliveringPendingReceive() {
 
   if (n < size) {
     rx_rb_.Discard(size - n);
-    transport_->GetContext()->Post(
+    transport_->Post(
         [=] { handler(api::Error(YOGI_ERR_BUFFER_TOO_SMALL), size); });
   } else {
-    transport_->GetContext()->Post([=] { handler(api::kSuccess, size); });
+    transport_->Post([=] { handler(api::kSuccess, size); });
+  }
+}
+
+void MessageTransport::DeliverLeasedReceive(std::size_t msg_size) {
+  LeaseReceiveHandler handler;
+  std::swap(handler, pending_lease_handler_);
+  ResetReceivedSizeField();
+
+  auto msg = LeaseReceivedMessage(msg_size);
+  transport_->Post([=] { handler(api::kSuccess, msg); });
+}
+
+boost::asio::const_buffer MessageTransport::LeaseReceivedMessage(
+    std::size_t msg_size) {
+  auto first_array = rx_rb_.FirstReadArray();
+  if (boost::asio::buffer_size(first_array) >= msg_size) {
+    leased_size_ = msg_size;
+    return boost::asio::buffer(*first_array.begin(), msg_size);
   }
+
+  // The message wraps around the end of the RX queue
+  lease_wrap_buffer_.resize(msg_size);
+  rx_rb_.Read(lease_wrap_buffer_.data(), msg_size);
+  return boost::asio::buffer(lease_wrap_buffer_);
 }
 
 void MessageTransport::HandleSendError(const api::Error& err) {
@@ -329,12 +745,21 @@ void MessageTransport::HandleSendError(const api::Error& err) {
 
   std::lock_guard<std::mutex> lock(tx_mutex_);
   last_tx_error_ = err;
+  tx_failed_ = true;
+
+  // Broadcasts queued for this connection do not need to wait any longer
+  bc_cursor_.reset();
+
+  DrainSubmissions();
 
   for (auto& ps : pending_sends_) {
     ps.handler(err);
   }
 
+  pending_sends_count_.fetch_sub(pending_sends_.size(),
+                                 std::memory_order_acq_rel);
   pending_sends_.clear();
+  pending_sends_by_tag_.clear();
 }
 
 void MessageTransport::HandleReceiveError(const api::Error& err) {
@@ -342,19 +767,34 @@ void MessageTransport::HandleReceiveError(const api::Error& err) {
 
   Close();
 
+  {
+    // A running write still references the broadcast log; it fails soon
+    // since the transport has been closed and the cursor gets released then
+    std::lock_guard<std::mutex> lock(tx_mutex_);
+    if (!send_to_transport_running_) {
+      bc_cursor_.reset();
+    }
+  }
+
   last_rx_error_ = err;
+  if (pending_lease_handler_) {
+    LeaseReceiveHandler handler;
+    std::swap(handler, pending_lease_handler_);
+
+    transport_->Post([=] { handler(api::Error(err), {}); });
+  }
+
   if (pending_receive_handler_) {
     ReceiveHandler handler;
     std::swap(handler, pending_receive_handler_);
 
-    transport_->GetContext()->Post([=] { handler(api::Error(err), 0); });
+    transport_->Post([=] { handler(api::Error(err), 0); });
   }
 }
 
 void MessageTransport::CheckOperationTagIsNotUsed(OperationTag tag) {
   YOGI_ASSERT(tag != 0);
-  YOGI_ASSERT(!utils::contains_if(pending_sends_,
-                                  [&](auto& ps) { return ps.tag == tag; }));
+  YOGI_ASSERT(pending_sends_by_tag_.count(tag) == 0);
 }
 
 const objects::LoggerPtr MessageTransport::logger_ =
@@ -19,15 +19,22 @@
 
 #include "../config.h"
 #include "../utils/ringbuffer.h"
+#include "../utils/mpsc_queue.h"
 #include "../objects/logger.h"
 #include "transport.h"
 #include "messages.h"
+#include "broadcast_log.h"
 
 #include <boost/asio/buffer.hpp>
+#include <chrono>
 #include <functional>
 #include <memory>
 #include <array>
 #include <vector>
+#include <list>
+#include <deque>
+#include <unordered_map>
+#include <atomic>
 
 namespace network {
 namespace internal {
@@ -46,27 +53,71 @@ typedef std::weak_ptr<MessageTransport> MessageTransportWeakPtr;
 class MessageTransport : public std::enable_shared_from_this<MessageTransport> {
  public:
   typedef int OperationTag;
-  typedef std::function<void(const api::Result&)> SendHandler;
-  typedef std::function<void(const api::Result&, std::size_t msg_size)>
+  typedef utils::SmallFunction<void(const api::Result&)> SendHandler;
+  typedef utils::SmallFunction<void(const api::Result&, std::size_t msg_size)>
       ReceiveHandler;
   typedef ReceiveHandler SizeFieldReceiveHandler;
+  typedef utils::SmallFunction<void(const api::Result&,
+                                    boost::asio::const_buffer msg)>
+      LeaseReceiveHandler;
 
   MessageTransport(TransportPtr transport, std::size_t tx_queue_size,
                    std::size_t rx_queue_size);
 
   objects::ContextPtr GetContext() const { return context_; }
 
+  // Instead of handing every message to the transport right away, collect
+  // them for up to max_delay or until max_bytes are queued so they can be
+  // written in one go; a max_bytes larger than the TX queue disables the byte
+  // trigger, but a send waiting for space always flushes the queue
+  void EnableCoalescing(std::chrono::nanoseconds max_delay,
+                        std::size_t max_bytes);
+
+  // Written bytes stay in the TX queue (or the broadcast log) until they get
+  // released via ReleaseSentBytes() in the order they have been written. This
+  // is for transports that still reference the data after a write completed
+  // (see TcpTransport::EnableZeroCopy()). Must be called before Start().
+  void DeferReleaseOfSentBytes() { defer_tx_release_ = true; }
+  void ReleaseSentBytes(std::size_t n);
+
   void Start();
 
+  // Broadcasts appended to the log get written to the transport straight
+  // from the log, interleaved with the messages sent via this object. The
+  // overrun function gets called if the connection fell behind while the
+  // log's overflow budget was used up; it should close the connection.
+  void AttachBroadcastLog(const BroadcastLogPtr& log,
+                          BroadcastLog::LagFn lag_fn = {},
+                          BroadcastLog::NotifyFn overrun_fn = {});
+
+  // Number of bytes in the broadcast log that have not been sent yet
+  std::size_t GetBroadcastBacklog() const;
+
   bool TrySend(const OutgoingMessage& msg);
   void SendAsync(OutgoingMessage* msg, OperationTag tag, SendHandler handler);
   void SendAsync(OutgoingMessage* msg, SendHandler handler);
   bool CancelSend(OperationTag tag);
   void ReceiveAsync(boost::asio::mutable_buffer msg, ReceiveHandler handler);
 
+  // The received message is passed to the handler without copying it out of
+  // the RX queue; it stays valid until ReleaseLeasedReceive() gets called and
+  // no other receive operation can be started before that.
+  void ReceiveLeaseAsync(LeaseReceiveHandler handler);
+  void ReleaseLeasedReceive();
+
+  // Synchronous version of ReceiveLeaseAsync() for draining all messages that
+  // have already been received completely; returns false if there are none.
+  bool TryReceiveLease(boost::asio::const_buffer* msg);
+
   void CancelReceive();
   void Close() { transport_->Close(); }
 
+  // Time when data has last been written to the transport successfully
+  std::chrono::steady_clock::time_point GetLastSendTime() const {
+    return std::chrono::steady_clock::time_point(
+        std::chrono::steady_clock::duration(last_send_time_.load()));
+  }
+
  private:
   typedef std::array<utils::Byte, 5> SizeFieldBuffer;
 
@@ -76,17 +127,52 @@ class MessageTransport : public std::enable_shared_from_this<MessageTransport> {
     SendHandler handler;
   };
 
+  // Send operations from producers that could not acquire tx_mutex_ without
+  // blocking; these get handed over to whoever holds the mutex next
+  struct Submission {
+    bool space_reserved;  // true => written to tx_rb_, false => pending send
+    OperationTag tag;
+    utils::SharedSmallByteVector msg_bytes;
+    SendHandler handler;
+  };
+
+  // Consecutive writes to the transport from the same source whose data has
+  // not been released yet
+  struct UnreleasedWrites {
+    bool from_bc_log;
+    std::size_t size;
+  };
+
+  typedef std::list<PendingSend> PendingSendList;
+
   MessageTransportWeakPtr MakeWeakPtr() { return shared_from_this(); }
-  bool TrySendImpl(const utils::SmallByteVector& msg_bytes);
-  bool CanSend(std::size_t msg_size) const;
+  void ThrowOnTxError();
+  bool TryReserveTxSpace(std::size_t msg_size);
+  void SendReserved(const OutgoingMessage::ConstBufferSequence& msg_bufs);
+  void WriteToTxQueue(const OutgoingMessage::ConstBufferSequence& msg_bufs);
   void SendAsyncImpl(OutgoingMessage* msg, OperationTag tag,
                      SendHandler handler);
+  void Submit(Submission sub);
+  void DrainSubmissions();
+  std::size_t SendableFromTxQueue() const;
+  std::size_t SendableFromBroadcastLog() const;
+  std::size_t AvailableForSend() const;
+  void OnBroadcastLogAppended();
+  void FlushOrStartCoalescing();
+  void OnCoalescingTimerExpired();
   void SendSomeBytesToTransport();
+  void AddUnreleasedWrite(bool from_bc_log, std::size_t n);
+  void CommitReleasedBytes(std::size_t n);
+  void EnqueuePendingSend(OperationTag tag, utils::SharedSmallByteVector msg,
+                          SendHandler handler);
+  void RecyclePendingSend(PendingSendList::iterator it);
   void RetrySendingPendingSends();
   bool TryGetReceivedSizeField(std::size_t* msg_size);
   void ResetReceivedSizeField();
   void ReceiveSomeBytesFromTransport();
   void TryDeliveringPendingReceive();
+  void DeliverLeasedReceive(std::size_t msg_size);
+  boost::asio::const_buffer LeaseReceivedMessage(std::size_t msg_size);
   void HandleSendError(const api::Error& err);
   void HandleReceiveError(const api::Error& err);
   void CheckOperationTagIsNotUsed(OperationTag tag);
@@ -97,16 +183,39 @@ class MessageTransport : public std::enable_shared_from_this<MessageTransport> {
   const TransportPtr transport_;
   utils::LockFreeRingBuffer tx_rb_;
   utils::LockFreeRingBuffer rx_rb_;
-  std::mutex tx_mutex_;
+  mutable std::mutex tx_mutex_;
   api::Result last_tx_error_;
+  std::atomic<bool> tx_failed_;
+  std::atomic<std::size_t> tx_credit_;  // Free tx_rb_ space not yet reserved
+  std::atomic<std::size_t> pending_sends_count_;  // Incl. submissions
+  utils::LockFreeMpscQueue<Submission> submissions_;
+  std::atomic<bool> drain_submissions_scheduled_;
+  BroadcastLog::CursorPtr bc_cursor_;
+  bool sending_from_bc_log_;  // Source of the last write to the transport
+  bool tx_at_frame_boundary_;  // Last write did not end within a message
   bool send_to_transport_running_;
-  std::vector<PendingSend> pending_sends_;
+  bool defer_tx_release_;
+  std::deque<UnreleasedWrites> unreleased_writes_;
+  std::size_t tx_rb_unreleased_;  // Written from tx_rb_ but not released
+  std::size_t bc_unreleased_;     // Written from bc_cursor_ but not released
+  std::size_t released_ahead_;    // Released before the write completed
+  std::atomic<std::chrono::steady_clock::rep> last_send_time_;
+  std::chrono::nanoseconds coalescing_delay_;
+  std::size_t coalescing_bytes_;
+  bool coalescing_timer_running_;
+  PendingSendList pending_sends_;
+  PendingSendList pending_sends_pool_;  // Recycled nodes for pending_sends_
+  std::unordered_map<OperationTag, PendingSendList::iterator>
+      pending_sends_by_tag_;
   SizeFieldBuffer size_field_buffer_;
   std::size_t size_field_buffer_size_;
   std::size_t size_field_;
   bool size_field_valid_;
   boost::asio::mutable_buffer pending_receive_buffer_;
   ReceiveHandler pending_receive_handler_;
+  LeaseReceiveHandler pending_lease_handler_;
+  std::size_t leased_size_;
+  utils::ByteVector lease_wrap_buffer_;
   bool receive_from_transport_running_;
   api::Result last_rx_error_;
 };
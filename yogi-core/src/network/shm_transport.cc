@@ -0,0 +1,426 @@
+/*
+ * This file is part of the Yogi distribution https://github.com/yohummus/yogi.
+ * Copyright (c) 2018 Johannes Bergmann.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "shm_transport.h"
+
+#ifdef YOGI_HAS_SHM_TRANSPORT
+
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstring>
+
+namespace network {
+
+struct ShmTransport::RingControl {
+  alignas(64) std::atomic<std::uint64_t> write_idx;
+  std::atomic<std::uint32_t> reader_waiting;
+  alignas(64) std::atomic<std::uint64_t> read_idx;
+  std::atomic<std::uint32_t> writer_waiting;
+};
+
+// The offering side writes to rings[0] and the attaching side to rings[1];
+// the data areas for both rings follow the header.
+struct ShmTransport::SegmentHeader {
+  std::uint64_t magic;
+  std::uint64_t ring_size;
+  alignas(64) RingControl rings[2];
+};
+
+namespace {
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+              "Atomics in shared memory must be lock-free");
+
+const std::uint64_t kSegmentMagic = 0x4d48532d49474f59;  // "YOGI-SHM"
+const std::size_t kRingSize = 1 << 18;
+
+// Order of the file descriptors sent with the handshake
+enum FdIndex {
+  kMemFd,
+  kDataEfd0,
+  kSpaceEfd0,
+  kDataEfd1,
+  kSpaceEfd1,
+  kNumFds,
+};
+
+void CloseFds(const std::vector<int>& fds) {
+  for (auto fd : fds) {
+    if (fd != -1) ::close(fd);
+  }
+}
+
+void* MapSegment(int memfd, std::size_t size) {
+  auto segment =
+      ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+  if (segment == MAP_FAILED) {
+    throw api::Error(YOGI_ERR_OPEN_FILE_FAILED);
+  }
+
+  return segment;
+}
+
+void SignalEventFd(boost::asio::posix::stream_descriptor& efd) {
+  std::uint64_t value = 1;
+  auto n = ::write(efd.native_handle(), &value, sizeof(value));
+  YOGI_UNUSED(n);
+}
+
+void DrainEventFd(boost::asio::posix::stream_descriptor& efd) {
+  std::uint64_t value;
+  auto n = ::read(efd.native_handle(), &value, sizeof(value));
+  YOGI_UNUSED(n);
+}
+
+}  // anonymous namespace
+
+ShmTransportPtr ShmTransport::Offer(objects::ContextPtr context,
+                                    Socket* socket,
+                                    std::chrono::nanoseconds timeout,
+                                    std::size_t transceive_byte_limit,
+                                    std::string peer_description) {
+  auto segment_size = GetSegmentSize(kRingSize);
+
+  std::vector<int> fds(kNumFds, -1);
+  void* segment = MAP_FAILED;
+  try {
+    fds[kMemFd] = ::memfd_create("yogi-shm", MFD_CLOEXEC);
+    for (std::size_t i = kDataEfd0; i < kNumFds; ++i) {
+      fds[i] = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    }
+
+    for (auto fd : fds) {
+      if (fd == -1) throw api::Error(YOGI_ERR_OPEN_FILE_FAILED);
+    }
+
+    if (::ftruncate(fds[kMemFd], static_cast<off_t>(segment_size)) == -1) {
+      throw api::Error(YOGI_ERR_OPEN_FILE_FAILED);
+    }
+
+    segment = MapSegment(fds[kMemFd], segment_size);
+    auto header = new (segment) SegmentHeader();
+    header->magic = kSegmentMagic;
+    header->ring_size = kRingSize;
+
+    if (!internal::SendHandshake(socket->native_handle(),
+                                 UnixTransport::kShmHandshake, fds)) {
+      throw api::Error(YOGI_ERR_CONNECT_SOCKET_FAILED);
+    }
+  } catch (const api::Error&) {
+    if (segment != MAP_FAILED) ::munmap(segment, segment_size);
+    CloseFds(fds);
+    throw;
+  }
+
+  ::close(fds[kMemFd]);
+  fds.erase(fds.begin());
+
+  auto transport = ShmTransportPtr(
+      new ShmTransport(context, std::move(*socket), timeout,
+                       transceive_byte_limit, false, peer_description,
+                       segment, fds));
+  transport->StartPeerWatch();
+  return transport;
+}
+
+ShmTransportPtr ShmTransport::Attach(objects::ContextPtr context,
+                                     Socket* socket,
+                                     const std::vector<int>& fds,
+                                     std::chrono::nanoseconds timeout,
+                                     std::size_t transceive_byte_limit,
+                                     std::string peer_description) {
+  auto segment_size = GetSegmentSize(kRingSize);
+
+  void* segment = MAP_FAILED;
+  try {
+    if (fds.size() != kNumFds) {
+      throw api::Error(YOGI_ERR_DESERIALIZE_MSG_FAILED);
+    }
+
+    struct stat st;
+    if (::fstat(fds[kMemFd], &st) == -1 ||
+        static_cast<std::size_t>(st.st_size) != segment_size) {
+      throw api::Error(YOGI_ERR_INCOMPATIBLE_VERSION);
+    }
+
+    segment = MapSegment(fds[kMemFd], segment_size);
+    auto header = static_cast<SegmentHeader*>(segment);
+    if (header->magic != kSegmentMagic) {
+      throw api::Error(YOGI_ERR_INVALID_MAGIC_PREFIX);
+    }
+
+    if (header->ring_size != kRingSize) {
+      throw api::Error(YOGI_ERR_INCOMPATIBLE_VERSION);
+    }
+  } catch (const api::Error&) {
+    if (segment != MAP_FAILED) ::munmap(segment, segment_size);
+    CloseFds(fds);
+    throw;
+  }
+
+  ::close(fds[kMemFd]);
+
+  auto transport = ShmTransportPtr(new ShmTransport(
+      context, std::move(*socket), timeout, transceive_byte_limit, true,
+      peer_description, segment, {fds.begin() + 1, fds.end()}));
+  transport->StartPeerWatch();
+  return transport;
+}
+
+ShmTransport::~ShmTransport() {
+  ::munmap(segment_, GetSegmentSize(ring_size_));
+}
+
+void ShmTransport::WriteSomeAsync(const ConstBufferSequence& data,
+                                  TransferSomeHandler handler) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  TryWrite(data, handler);
+}
+
+void ShmTransport::ReadSomeAsync(const MutableBufferSequence& data,
+                                 TransferSomeHandler handler) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  TryRead(data, handler);
+}
+
+void ShmTransport::Shutdown() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (closed_) return;
+
+  closed_ = true;
+  UnixTransport::CloseSocket(&socket_);
+
+  boost::system::error_code ec;
+  tx_space_efd_.cancel(ec);
+  rx_data_efd_.cancel(ec);
+}
+
+ShmTransport::ShmTransport(objects::ContextPtr context, Socket&& socket,
+                           std::chrono::nanoseconds timeout,
+                           std::size_t transceive_byte_limit,
+                           bool created_via_accept,
+                           std::string peer_description, void* segment,
+                           const std::vector<int>& event_fds)
+    : Transport(context, timeout, created_via_accept, peer_description,
+                transceive_byte_limit),
+      socket_(std::move(socket)),
+      segment_(segment),
+      ring_size_(kRingSize),
+      tx_data_efd_(context->IoContext()),
+      tx_space_efd_(context->IoContext()),
+      rx_data_efd_(context->IoContext()),
+      rx_space_efd_(context->IoContext()),
+      peer_gone_(false),
+      closed_(false) {
+  auto header = static_cast<SegmentHeader*>(segment_);
+  auto data = static_cast<utils::Byte*>(segment_) + sizeof(SegmentHeader);
+
+  // Indices into event_fds which lacks the memfd
+  std::size_t tx = created_via_accept ? 1 : 0;
+  std::size_t rx = 1 - tx;
+
+  tx_ctrl_ = &header->rings[tx];
+  rx_ctrl_ = &header->rings[rx];
+  tx_data_ = data + tx * ring_size_;
+  rx_data_ = data + rx * ring_size_;
+  tx_data_efd_.assign(event_fds[tx * 2]);
+  tx_space_efd_.assign(event_fds[tx * 2 + 1]);
+  rx_data_efd_.assign(event_fds[rx * 2]);
+  rx_space_efd_.assign(event_fds[rx * 2 + 1]);
+}
+
+std::size_t ShmTransport::GetSegmentSize(std::size_t ring_size) {
+  return sizeof(SegmentHeader) + 2 * ring_size;
+}
+
+ShmTransportWeakPtr ShmTransport::MakeWeakPtr() {
+  return std::static_pointer_cast<ShmTransport>(shared_from_this());
+}
+
+void ShmTransport::StartPeerWatch() {
+  // The peer never writes to the socket after the handshake, so this only
+  // completes once the connection gets closed
+  auto weak_self = MakeWeakPtr();
+  socket_.async_read_some(boost::asio::buffer(&peer_watch_byte_, 1),
+                          WrapHandler([=](auto&, auto) {
+                            auto self = weak_self.lock();
+                            if (!self) return;
+
+                            std::lock_guard<std::mutex> lock(self->mutex_);
+                            self->peer_gone_ = true;
+
+                            boost::system::error_code ec;
+                            self->tx_space_efd_.cancel(ec);
+                            self->rx_data_efd_.cancel(ec);
+                          }));
+}
+
+void ShmTransport::TryWrite(const ConstBufferSequence& data,
+                            TransferSomeHandler handler) {
+  if (closed_) {
+    Complete(handler, api::Error(YOGI_ERR_CANCELED), 0);
+    return;
+  }
+
+  if (peer_gone_) {
+    Complete(handler, api::Error(YOGI_ERR_RW_SOCKET_FAILED), 0);
+    return;
+  }
+
+  auto n = WriteToRing(data);
+  if (n == 0) {
+    // Announce that we are waiting before checking again so the reader
+    // cannot free up space without noticing
+    tx_ctrl_->writer_waiting.store(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    n = WriteToRing(data);
+  }
+
+  if (n > 0) {
+    Complete(handler, api::kSuccess, n);
+    return;
+  }
+
+  auto weak_self = MakeWeakPtr();
+  tx_space_efd_.async_wait(EventFd::wait_read, WrapHandler([=](auto&) {
+    auto self = weak_self.lock();
+    if (!self) {
+      handler(api::Error(YOGI_ERR_CANCELED), 0);
+      return;
+    }
+
+    std::lock_guard<std::mutex> lock(self->mutex_);
+    DrainEventFd(self->tx_space_efd_);
+    self->TryWrite(data, handler);
+  }));
+}
+
+void ShmTransport::TryRead(const MutableBufferSequence& data,
+                           TransferSomeHandler handler) {
+  if (closed_) {
+    Complete(handler, api::Error(YOGI_ERR_CANCELED), 0);
+    return;
+  }
+
+  // Data written by the peer before it went away can still be read
+  auto n = ReadFromRing(data);
+  if (n == 0 && !peer_gone_) {
+    rx_ctrl_->reader_waiting.store(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    n = ReadFromRing(data);
+  }
+
+  if (n > 0) {
+    Complete(handler, api::kSuccess, n);
+    return;
+  }
+
+  if (peer_gone_) {
+    Complete(handler, api::Error(YOGI_ERR_RW_SOCKET_FAILED), 0);
+    return;
+  }
+
+  auto weak_self = MakeWeakPtr();
+  rx_data_efd_.async_wait(EventFd::wait_read, WrapHandler([=](auto&) {
+    auto self = weak_self.lock();
+    if (!self) {
+      handler(api::Error(YOGI_ERR_CANCELED), 0);
+      return;
+    }
+
+    std::lock_guard<std::mutex> lock(self->mutex_);
+    DrainEventFd(self->rx_data_efd_);
+    self->TryRead(data, handler);
+  }));
+}
+
+std::size_t ShmTransport::WriteToRing(const ConstBufferSequence& data) {
+  auto write_idx = tx_ctrl_->write_idx.load(std::memory_order_relaxed);
+  auto read_idx = tx_ctrl_->read_idx.load(std::memory_order_acquire);
+  auto space = ring_size_ - static_cast<std::size_t>(write_idx - read_idx);
+
+  std::size_t n = 0;
+  for (auto& buffer : data) {
+    auto src = static_cast<const utils::Byte*>(buffer.data());
+    auto size = std::min(buffer.size(), space - n);
+    while (size > 0) {
+      auto pos = (write_idx + n) & (ring_size_ - 1);
+      auto chunk = std::min(size, ring_size_ - pos);
+      std::memcpy(tx_data_ + pos, src, chunk);
+      src += chunk;
+      size -= chunk;
+      n += chunk;
+    }
+  }
+
+  if (n == 0) return 0;
+
+  tx_ctrl_->write_idx.store(write_idx + n, std::memory_order_release);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (tx_ctrl_->reader_waiting.load(std::memory_order_relaxed) &&
+      tx_ctrl_->reader_waiting.exchange(0)) {
+    SignalEventFd(tx_data_efd_);
+  }
+
+  return n;
+}
+
+std::size_t ShmTransport::ReadFromRing(const MutableBufferSequence& data) {
+  auto read_idx = rx_ctrl_->read_idx.load(std::memory_order_relaxed);
+  auto write_idx = rx_ctrl_->write_idx.load(std::memory_order_acquire);
+  auto available = static_cast<std::size_t>(write_idx - read_idx);
+
+  std::size_t n = 0;
+  for (auto& buffer : data) {
+    auto dst = static_cast<utils::Byte*>(buffer.data());
+    auto size = std::min(buffer.size(), available - n);
+    while (size > 0) {
+      auto pos = (read_idx + n) & (ring_size_ - 1);
+      auto chunk = std::min(size, ring_size_ - pos);
+      std::memcpy(dst, rx_data_ + pos, chunk);
+      dst += chunk;
+      size -= chunk;
+      n += chunk;
+    }
+  }
+
+  if (n == 0) return 0;
+
+  rx_ctrl_->read_idx.store(read_idx + n, std::memory_order_release);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (rx_ctrl_->writer_waiting.load(std::memory_order_relaxed) &&
+      rx_ctrl_->writer_waiting.exchange(0)) {
+    SignalEventFd(rx_space_efd_);
+  }
+
+  return n;
+}
+
+void ShmTransport::Complete(TransferSomeHandler handler,
+                            const api::Result& res,
+                            std::size_t bytes_transferred) {
+  // Never call the handler from within WriteSomeAsync() or ReadSomeAsync()
+  GetContext()->Post([=] { handler(res, bytes_transferred); });
+}
+
+}  // namespace network
+
+#endif  // YOGI_HAS_SHM_TRANSPORT
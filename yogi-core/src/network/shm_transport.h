@@ -0,0 +1,114 @@
+/*
+ * This file is part of the Yogi distribution https://github.com/yohummus/yogi.
+ * Copyright (c) 2018 Johannes Bergmann.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "../config.h"
+#include "unix_transport.h"
+
+#ifdef YOGI_HAS_UNIX_TRANSPORT
+#define YOGI_HAS_SHM_TRANSPORT
+#endif
+
+#ifdef YOGI_HAS_SHM_TRANSPORT
+
+#include <boost/asio/posix/stream_descriptor.hpp>
+#include <mutex>
+#include <vector>
+
+namespace network {
+
+class ShmTransport;
+typedef std::shared_ptr<ShmTransport> ShmTransportPtr;
+typedef std::weak_ptr<ShmTransport> ShmTransportWeakPtr;
+
+// Transport between processes on the same host via two single-producer
+// single-consumer ring buffers in a shared memory segment. The segment and
+// the eventfds for waking up the peer are passed over the Unix domain socket
+// connection during the handshake (see UnixTransport); the peer only gets
+// woken up if it is actually waiting for data or space. The socket is kept
+// open afterwards in order to detect when the peer goes away.
+class ShmTransport : public Transport {
+ public:
+  typedef UnixTransport::Socket Socket;
+
+  // Creates the segment and sends it to the peer; the socket is only moved
+  // into the transport on success
+  static ShmTransportPtr Offer(objects::ContextPtr context, Socket* socket,
+                               std::chrono::nanoseconds timeout,
+                               std::size_t transceive_byte_limit,
+                               std::string peer_description);
+
+  // Takes ownership of the file descriptors received during the handshake
+  static ShmTransportPtr Attach(objects::ContextPtr context, Socket* socket,
+                                const std::vector<int>& fds,
+                                std::chrono::nanoseconds timeout,
+                                std::size_t transceive_byte_limit,
+                                std::string peer_description);
+
+  virtual ~ShmTransport();
+
+ protected:
+  virtual void WriteSomeAsync(const ConstBufferSequence& data,
+                              TransferSomeHandler handler) override;
+  virtual void ReadSomeAsync(const MutableBufferSequence& data,
+                             TransferSomeHandler handler) override;
+  virtual void Shutdown() override;
+
+ private:
+  struct RingControl;
+  struct SegmentHeader;
+  typedef boost::asio::posix::stream_descriptor EventFd;
+
+  ShmTransport(objects::ContextPtr context, Socket&& socket,
+               std::chrono::nanoseconds timeout,
+               std::size_t transceive_byte_limit, bool created_via_accept,
+               std::string peer_description, void* segment,
+               const std::vector<int>& event_fds);
+
+  static std::size_t GetSegmentSize(std::size_t ring_size);
+
+  ShmTransportWeakPtr MakeWeakPtr();
+  void StartPeerWatch();
+  void TryWrite(const ConstBufferSequence& data, TransferSomeHandler handler);
+  void TryRead(const MutableBufferSequence& data, TransferSomeHandler handler);
+  std::size_t WriteToRing(const ConstBufferSequence& data);
+  std::size_t ReadFromRing(const MutableBufferSequence& data);
+  void Complete(TransferSomeHandler handler, const api::Result& res,
+                std::size_t bytes_transferred);
+
+  Socket socket_;
+  std::mutex mutex_;
+  void* const segment_;
+  const std::size_t ring_size_;
+  RingControl* tx_ctrl_;
+  RingControl* rx_ctrl_;
+  utils::Byte* tx_data_;
+  utils::Byte* rx_data_;
+  EventFd tx_data_efd_;   // Signaled by us when the peer waits for data
+  EventFd tx_space_efd_;  // Signaled by the peer when we wait for space
+  EventFd rx_data_efd_;   // Signaled by the peer when we wait for data
+  EventFd rx_space_efd_;  // Signaled by us when the peer waits for space
+  char peer_watch_byte_;
+  bool peer_gone_;
+  bool closed_;
+};
+
+}  // namespace network
+
+#endif  // YOGI_HAS_SHM_TRANSPORT
@@ -18,6 +18,14 @@
 #include "tcp_transport.h"
 #include "ip.h"
 
+#ifdef YOGI_HAS_TCP_ZEROCOPY
+#include <linux/errqueue.h>
+#include <netinet/in.h>
+#endif
+
+#include <cerrno>
+#include <cstring>
+
 namespace network {
 
 TcpTransport::AcceptGuardPtr TcpTransport::AcceptAsync(
@@ -30,7 +38,7 @@ TcpTransport::AcceptGuardPtr TcpTransport::AcceptAsync(
 
   auto socket =
       std::make_shared<boost::asio::ip::tcp::socket>(context->IoContext());
-  acceptor->async_accept(*socket, [=](auto& ec) {
+  acceptor->async_accept(*socket, context->WrapHandler([=](auto& ec) {
     auto guard = weak_guard.lock();
     if (guard) guard->Disable();
 
@@ -47,7 +55,7 @@ TcpTransport::AcceptGuardPtr TcpTransport::AcceptAsync(
     } else {
       handler(api::Error(YOGI_ERR_ACCEPT_SOCKET_FAILED), {}, guard);
     }
-  });
+  }));
 
   return guard;
 }
@@ -71,7 +79,7 @@ TcpTransport::ConnectGuardPtr TcpTransport::ConnectAsync(
   auto weak_guard = ConnectGuardWeakPtr(guard);
   auto weak_context = context->MakeWeakPtr();
 
-  condat->socket.async_connect(ep, [=](auto& ec) {
+  condat->socket.async_connect(ep, context->WrapHandler([=](auto& ec) {
     auto guard = weak_guard.lock();
     if (guard) guard->Disable();
 
@@ -93,47 +101,101 @@ TcpTransport::ConnectGuardPtr TcpTransport::ConnectAsync(
     } else {
       handler(api::Error(YOGI_ERR_CONNECT_SOCKET_FAILED), {}, guard);
     }
-  });
+  }));
 
   condat->timer.expires_from_now(timeout);
-  condat->timer.async_wait([=](auto& ec) {
+  condat->timer.async_wait(context->WrapHandler([=](auto& ec) {
     if (ec) return;
 
     if (condat->running) {
       condat->timed_out = true;
       CloseSocket(&condat->socket);
     }
-  });
+  }));
 
   return guard;
 }
 
-void TcpTransport::WriteSomeAsync(boost::asio::const_buffer data,
+bool TcpTransport::EnableZeroCopy(std::size_t threshold,
+                                  ReleaseFn release_fn) {
+#ifdef YOGI_HAS_TCP_ZEROCOPY
+  std::lock_guard<std::mutex> lock(socket_mutex_);
+  int on = 1;
+  if (::setsockopt(socket_.native_handle(), SOL_SOCKET, SO_ZEROCOPY, &on,
+                   sizeof(on)) != 0) {
+    YOGI_LOG_WARNING(logger_, "Could not enable zero-copy sends on socket: "
+                                  << std::strerror(errno));
+    return false;
+  }
+
+  zerocopy_threshold_ = threshold;
+  zerocopy_release_fn_ = release_fn;
+  return true;
+#else
+  YOGI_UNUSED(threshold);
+  YOGI_UNUSED(release_fn);
+  return false;
+#endif
+}
+
+bool TcpTransport::EnableBusyPoll(std::chrono::microseconds budget) {
+#ifdef SO_BUSY_POLL
+  std::lock_guard<std::mutex> lock(socket_mutex_);
+  int usecs = static_cast<int>(budget.count());
+  if (::setsockopt(socket_.native_handle(), SOL_SOCKET, SO_BUSY_POLL, &usecs,
+                   sizeof(usecs)) != 0) {
+    YOGI_LOG_WARNING(logger_, "Could not set SO_BUSY_POLL option on socket: "
+                                  << std::strerror(errno));
+    return false;
+  }
+
+  return true;
+#else
+  YOGI_UNUSED(budget);
+  return false;
+#endif
+}
+
+void TcpTransport::WriteSomeAsync(const ConstBufferSequence& data,
                                   TransferSomeHandler handler) {
   std::lock_guard<std::mutex> lock(socket_mutex_);
-  socket_.async_write_some(data, [=](auto& ec, auto bytes_written) {
-    if (!ec) {
-      handler(api::kSuccess, bytes_written);
-    } else if (ec == boost::asio::error::operation_aborted) {
-      handler(api::Error(YOGI_ERR_CANCELED), bytes_written);
-    } else {
-      handler(api::Error(YOGI_ERR_RW_SOCKET_FAILED), bytes_written);
-    }
-  });
+#ifdef YOGI_HAS_TCP_ZEROCOPY
+  if (zerocopy_release_fn_) {
+    WriteSomeZeroCopyAsync(data, handler);
+    return;
+  }
+#endif
+
+  WriteSomeCopyAsync(data, handler);
 }
 
-void TcpTransport::ReadSomeAsync(boost::asio::mutable_buffer data,
+void TcpTransport::WriteSomeCopyAsync(const ConstBufferSequence& data,
+                                      TransferSomeHandler handler) {
+  socket_.async_write_some(
+      data, WrapHandler([=](auto& ec, auto bytes_written) {
+        if (!ec) {
+          handler(api::kSuccess, bytes_written);
+        } else if (ec == boost::asio::error::operation_aborted) {
+          handler(api::Error(YOGI_ERR_CANCELED), bytes_written);
+        } else {
+          handler(api::Error(YOGI_ERR_RW_SOCKET_FAILED), bytes_written);
+        }
+      }));
+}
+
+void TcpTransport::ReadSomeAsync(const MutableBufferSequence& data,
                                  TransferSomeHandler handler) {
   std::lock_guard<std::mutex> lock(socket_mutex_);
-  socket_.async_read_some(data, [=](auto& ec, auto bytes_read) {
-    if (!ec) {
-      handler(api::kSuccess, bytes_read);
-    } else if (ec == boost::asio::error::operation_aborted) {
-      handler(api::Error(YOGI_ERR_CANCELED), bytes_read);
-    } else {
-      handler(api::Error(YOGI_ERR_RW_SOCKET_FAILED), bytes_read);
-    }
-  });
+  socket_.async_read_some(
+      data, WrapHandler([=](auto& ec, auto bytes_read) {
+        if (!ec) {
+          handler(api::kSuccess, bytes_read);
+        } else if (ec == boost::asio::error::operation_aborted) {
+          handler(api::Error(YOGI_ERR_CANCELED), bytes_read);
+        } else {
+          handler(api::Error(YOGI_ERR_RW_SOCKET_FAILED), bytes_read);
+        }
+      }));
 }
 
 void TcpTransport::Shutdown() {
@@ -173,6 +235,203 @@ void TcpTransport::SetNoDelayOption() {
   }
 }
 
+#ifdef YOGI_HAS_TCP_ZEROCOPY
+TcpTransportWeakPtr TcpTransport::MakeWeakPtr() {
+  return std::static_pointer_cast<TcpTransport>(shared_from_this());
+}
+
+void TcpTransport::WriteSomeZeroCopyAsync(const ConstBufferSequence& data,
+                                          TransferSomeHandler handler) {
+  if (zerocopy_failed_) {
+    GetContext()->Post(
+        [=] { handler(api::Error(YOGI_ERR_RW_SOCKET_FAILED), 0); });
+    return;
+  }
+
+  if (boost::asio::buffer_size(data) < zerocopy_threshold_) {
+    WriteSomeTrackedCopyAsync(data, handler);
+    return;
+  }
+
+  iovec iov[2];
+  for (std::size_t i = 0; i < data.size(); ++i) {
+    iov[i].iov_base = const_cast<void*>(data[i].data());
+    iov[i].iov_len = data[i].size();
+  }
+
+  msghdr msg = {};
+  msg.msg_iov = iov;
+  msg.msg_iovlen = data.size();
+
+  auto n = ::sendmsg(socket_.native_handle(), &msg,
+                     MSG_ZEROCOPY | MSG_NOSIGNAL | MSG_DONTWAIT);
+  if (n > 0) {
+    auto bytes_written = static_cast<std::size_t>(n);
+    auto seq = zerocopy_next_seq_++;
+    GetContext()->Post([=] { handler(api::kSuccess, bytes_written); });
+
+    AddUnreleasedWrite(seq + 1, bytes_written);
+    CheckZeroCopyCompletions();
+  } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+    auto weak_self = MakeWeakPtr();
+    socket_.async_wait(socket_.wait_write, WrapHandler([=](auto& ec) {
+      auto self = weak_self.lock();
+      if (!self || ec == boost::asio::error::operation_aborted) {
+        handler(api::Error(YOGI_ERR_CANCELED), 0);
+      } else if (ec) {
+        handler(api::Error(YOGI_ERR_RW_SOCKET_FAILED), 0);
+      } else {
+        std::lock_guard<std::mutex> lock(self->socket_mutex_);
+        self->WriteSomeZeroCopyAsync(data, handler);
+      }
+    }));
+  } else if (errno == ENOBUFS) {
+    // Too many zero-copy sends in flight (limited by optmem_max)
+    WriteSomeTrackedCopyAsync(data, handler);
+  } else {
+    GetContext()->Post(
+        [=] { handler(api::Error(YOGI_ERR_RW_SOCKET_FAILED), 0); });
+  }
+}
+
+void TcpTransport::WriteSomeTrackedCopyAsync(const ConstBufferSequence& data,
+                                             TransferSomeHandler handler) {
+  // The data gets copied by the kernel, but it must not be released before
+  // the data of earlier zero-copy sends
+  auto weak_self = MakeWeakPtr();
+  WriteSomeCopyAsync(data, [=](auto& res, auto bytes_written) {
+    auto self = weak_self.lock();
+    if (self && !res.IsError()) {
+      std::lock_guard<std::mutex> lock(self->socket_mutex_);
+      self->AddUnreleasedWrite(self->zerocopy_next_seq_, bytes_written);
+      self->ReleaseFinishedWrites();
+    }
+
+    handler(res, bytes_written);
+  });
+}
+
+void TcpTransport::AddUnreleasedWrite(std::uint32_t end_seq,
+                                      std::size_t size) {
+  if (!zerocopy_unreleased_.empty() &&
+      zerocopy_unreleased_.back().end_seq == end_seq) {
+    zerocopy_unreleased_.back().size += size;
+  } else {
+    zerocopy_unreleased_.push_back({end_seq, size});
+  }
+}
+
+void TcpTransport::CheckZeroCopyCompletions() {
+  // Completion notifications wake up the wait only when they arrive (the
+  // reactor is edge-triggered), so it must be running before the error queue
+  // gets read in order to not miss any notifications in between
+  if (!zerocopy_unreleased_.empty()) {
+    StartZeroCopyCompletionWait();
+  }
+
+  if (ReapZeroCopyCompletions()) {
+    ReleaseFinishedWrites();
+  }
+}
+
+void TcpTransport::StartZeroCopyCompletionWait() {
+  if (zerocopy_wait_running_) return;
+  zerocopy_wait_running_ = true;
+
+  auto weak_self = MakeWeakPtr();
+  socket_.async_wait(socket_.wait_error, WrapHandler([=](auto& ec) {
+    auto self = weak_self.lock();
+    if (!self) return;
+
+    std::lock_guard<std::mutex> lock(self->socket_mutex_);
+    self->zerocopy_wait_running_ = false;
+
+    // Errors only occur once the socket is closed; reads and writes fail as
+    // well in that case
+    if (!ec) {
+      self->CheckZeroCopyCompletions();
+    }
+  }));
+}
+
+bool TcpTransport::ReapZeroCopyCompletions() {
+  while (true) {
+    char control[128];
+    msghdr msg = {};
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    if (::recvmsg(socket_.native_handle(), &msg,
+                  MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+      break;
+    }
+
+    for (auto cmsg = CMSG_FIRSTHDR(&msg); cmsg;
+         cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      if (!(cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) &&
+          !(cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)) {
+        continue;
+      }
+
+      sock_extended_err serr;
+      std::memcpy(&serr, CMSG_DATA(cmsg), sizeof(serr));
+      if (serr.ee_errno != 0) {
+        FailZeroCopy(static_cast<int>(serr.ee_errno));
+        return false;
+      }
+
+      if (serr.ee_origin != SO_EE_ORIGIN_ZEROCOPY) continue;
+
+      // Sends ee_info to ee_data (inclusive) have completed
+      auto next_seq = serr.ee_data + 1;
+      if (static_cast<std::int32_t>(next_seq - zerocopy_done_seq_) > 0) {
+        zerocopy_done_seq_ = next_seq;
+      }
+
+      // E.g. on loopback connections, the kernel copies the data anyway
+      if ((serr.ee_code & SO_EE_CODE_ZEROCOPY_COPIED) &&
+          zerocopy_threshold_ != std::numeric_limits<std::size_t>::max()) {
+        YOGI_LOG_DEBUG(logger_, "Kernel copied data of zero-copy send to "
+                                    << GetPeerDescription()
+                                    << "; using regular sends from now on");
+        zerocopy_threshold_ = std::numeric_limits<std::size_t>::max();
+      }
+    }
+  }
+
+  return true;
+}
+
+void TcpTransport::ReleaseFinishedWrites() {
+  std::size_t n = 0;
+  while (!zerocopy_unreleased_.empty()) {
+    auto& write = zerocopy_unreleased_.front();
+    if (static_cast<std::int32_t>(zerocopy_done_seq_ - write.end_seq) < 0) {
+      break;
+    }
+
+    n += write.size;
+    zerocopy_unreleased_.pop_front();
+  }
+
+  if (n > 0) {
+    auto release_fn = zerocopy_release_fn_;
+    Post([=] { release_fn(n); });
+  }
+}
+
+void TcpTransport::FailZeroCopy(int err) {
+  YOGI_LOG_ERROR(logger_, "Zero-copy send to " << GetPeerDescription()
+                                               << " failed: "
+                                               << std::strerror(err));
+
+  // Closing the socket makes the running and all future operations fail
+  zerocopy_failed_ = true;
+  zerocopy_unreleased_.clear();
+  CloseSocket(&socket_);
+}
+#endif  // YOGI_HAS_TCP_ZEROCOPY
+
 const objects::LoggerPtr TcpTransport::logger_ =
     objects::Logger::CreateStaticInternalLogger("Transport.Tcp");
 
@@ -23,6 +23,16 @@
 #include <boost/asio.hpp>
 
 #include <mutex>
+#include <deque>
+#include <cstdint>
+#include <limits>
+
+#ifdef __linux__
+#include <sys/socket.h>
+#if defined(MSG_ZEROCOPY) && defined(SO_ZEROCOPY)
+#define YOGI_HAS_TCP_ZEROCOPY
+#endif
+#endif
 
 namespace network {
 
@@ -32,22 +42,6 @@ typedef std::weak_ptr<TcpTransport> TcpTransportWeakPtr;
 
 class TcpTransport : public Transport {
  public:
-  template <typename T>
-  class AsioGuard {
-    friend class TcpTransport;
-
-   public:
-    AsioGuard(T* obj) : obj_(obj) {}
-    ~AsioGuard() {
-      if (obj_) obj_->cancel();
-    }
-
-   private:
-    void Disable() { obj_ = nullptr; }
-
-    T* obj_;
-  };
-
   typedef AsioGuard<boost::asio::ip::tcp::acceptor> AcceptGuard;
   typedef std::shared_ptr<AcceptGuard> AcceptGuardPtr;
   typedef std::weak_ptr<AcceptGuard> AcceptGuardWeakPtr;
@@ -60,6 +54,7 @@ class TcpTransport : public Transport {
   typedef std::function<void(const api::Result&, TcpTransportPtr,
                              ConnectGuardPtr)>
       ConnectHandler;
+  typedef std::function<void(std::size_t bytes)> ReleaseFn;
 
   static AcceptGuardPtr AcceptAsync(objects::ContextPtr context,
                                     boost::asio::ip::tcp::acceptor* acceptor,
@@ -77,10 +72,23 @@ class TcpTransport : public Transport {
     return socket_.remote_endpoint();
   }
 
+  // Writes of at least threshold bytes get sent with MSG_ZEROCOPY. They
+  // complete as soon as the kernel has taken the data, but the kernel keeps
+  // referencing it until the peer acknowledged it. Therefore, from now on,
+  // release_fn gets called (through the strand) with the number of bytes of
+  // all completed writes, in write order, that may be modified again. Returns
+  // false if zero-copy sends are not supported.
+  bool EnableZeroCopy(std::size_t threshold, ReleaseFn release_fn);
+
+  // Sets SO_BUSY_POLL so that the kernel busy-polls the device queue for up
+  // to the given time instead of waiting for an interrupt. Returns false if
+  // not supported or permitted.
+  bool EnableBusyPoll(std::chrono::microseconds budget);
+
  protected:
-  virtual void WriteSomeAsync(boost::asio::const_buffer data,
+  virtual void WriteSomeAsync(const ConstBufferSequence& data,
                               TransferSomeHandler handler) override;
-  virtual void ReadSomeAsync(boost::asio::mutable_buffer data,
+  virtual void ReadSomeAsync(const MutableBufferSequence& data,
                              TransferSomeHandler handler) override;
   virtual void Shutdown() override;
 
@@ -94,10 +102,41 @@ class TcpTransport : public Transport {
                std::chrono::nanoseconds timeout,
                std::size_t transceive_byte_limit, bool created_via_accept);
   void SetNoDelayOption();
+  void WriteSomeCopyAsync(const ConstBufferSequence& data,
+                          TransferSomeHandler handler);
+
+#ifdef YOGI_HAS_TCP_ZEROCOPY
+  // Completed writes whose data may still be referenced by the kernel
+  struct UnreleasedWrite {
+    std::uint32_t end_seq;  // Released once all sends before it completed
+    std::size_t size;
+  };
+
+  TcpTransportWeakPtr MakeWeakPtr();
+  void WriteSomeZeroCopyAsync(const ConstBufferSequence& data,
+                              TransferSomeHandler handler);
+  void WriteSomeTrackedCopyAsync(const ConstBufferSequence& data,
+                                 TransferSomeHandler handler);
+  void AddUnreleasedWrite(std::uint32_t end_seq, std::size_t size);
+  void CheckZeroCopyCompletions();
+  void StartZeroCopyCompletionWait();
+  bool ReapZeroCopyCompletions();
+  void ReleaseFinishedWrites();
+  void FailZeroCopy(int err);
+#endif
 
   static const objects::LoggerPtr logger_;
   boost::asio::ip::tcp::socket socket_;
   std::mutex socket_mutex_;
+#ifdef YOGI_HAS_TCP_ZEROCOPY
+  std::size_t zerocopy_threshold_ = std::numeric_limits<std::size_t>::max();
+  std::uint32_t zerocopy_next_seq_ = 0;  // Sequence number of the next send
+  std::uint32_t zerocopy_done_seq_ = 0;  // All sends before it completed
+  ReleaseFn zerocopy_release_fn_;
+  std::deque<UnreleasedWrite> zerocopy_unreleased_;
+  bool zerocopy_wait_running_ = false;
+  bool zerocopy_failed_ = false;
+#endif
 };
 
 }  // namespace network
@@ -27,26 +27,43 @@ Transport::Transport(objects::ContextPtr context,
                      std::string peer_description,
                      std::size_t transceive_byte_limit)
     : context_(context),
+      strand_(context->IoContext()),
       timeout_(timeout),
       created_from_incoming_conn_req_(created_from_incoming_conn_req),
       peer_description_(peer_description),
       transceive_byte_limit_(transceive_byte_limit),
-      tx_timer_(context->IoContext()),
-      rx_timer_(context->IoContext()),
+      tx_timeout_id_(0),
+      rx_timeout_id_(0),
       timed_out_(false) {}
 
-Transport::~Transport() {}
+Transport::~Transport() {
+  CancelTimeout(&tx_timeout_id_);
+  CancelTimeout(&rx_timeout_id_);
+}
+
+template <typename BufferSequence>
+void Transport::LimitToTransceiveByteLimit(BufferSequence* data) const {
+  auto limit = transceive_byte_limit_;
+  for (auto& buffer : *data) {
+    buffer = boost::asio::buffer(buffer, limit);
+    limit -= buffer.size();
+  }
+}
 
 void Transport::SendSomeAsync(boost::asio::const_buffer data,
                               TransferSomeHandler handler) {
-  YOGI_ASSERT(data.size() > 0);
+  SendSomeAsync(ConstBufferSequence{{data, boost::asio::const_buffer{}}},
+                handler);
+}
 
-  if (data.size() > transceive_byte_limit_) {
-    data = boost::asio::buffer(data.data(), transceive_byte_limit_);
-  }
+void Transport::SendSomeAsync(ConstBufferSequence data,
+                              TransferSomeHandler handler) {
+  YOGI_ASSERT(boost::asio::buffer_size(data) > 0);
+
+  LimitToTransceiveByteLimit(&data);
 
   auto weak_self = MakeWeakPtr();
-  StartTimeout(&tx_timer_, weak_self);
+  StartTimeout(&tx_timeout_id_, weak_self);
 
   WriteSomeAsync(data, [=](auto& res, auto bytes_written) {
     auto self = weak_self.lock();
@@ -55,18 +72,30 @@ void Transport::SendSomeAsync(boost::asio::const_buffer data,
       return;
     }
 
-    self->tx_timer_.cancel();
-
-    if (self->timed_out_) {
-      handler(api::Error(YOGI_ERR_TIMEOUT), bytes_written);
-    } else {
-      if (res.IsError()) {
-        self->Close();
+    boost::asio::dispatch(self->strand_, self->WrapHandler([=] {
+      if (auto self = weak_self.lock()) {
+        self->OnSendSomeFinished(res, bytes_written, handler);
+      } else {
+        handler(api::Error(YOGI_ERR_CANCELED), bytes_written);
       }
+    }));
+  });
+}
+
+void Transport::OnSendSomeFinished(const api::Result& res,
+                                   std::size_t bytes_written,
+                                   TransferSomeHandler handler) {
+  CancelTimeout(&tx_timeout_id_);
 
-      handler(res, bytes_written);
+  if (timed_out_) {
+    handler(api::Error(YOGI_ERR_TIMEOUT), bytes_written);
+  } else {
+    if (res.IsError()) {
+      Close();
     }
-  });
+
+    handler(res, bytes_written);
+  }
 }
 
 void Transport::SendAllAsync(boost::asio::const_buffer data,
@@ -88,14 +117,18 @@ void Transport::SendAllAsync(utils::SharedSmallByteVector data,
 
 void Transport::ReceiveSomeAsync(boost::asio::mutable_buffer data,
                                  TransferSomeHandler handler) {
-  YOGI_ASSERT(data.size() > 0);
+  ReceiveSomeAsync(MutableBufferSequence{{data, boost::asio::mutable_buffer{}}},
+                   handler);
+}
 
-  if (data.size() > transceive_byte_limit_) {
-    data = boost::asio::buffer(data.data(), transceive_byte_limit_);
-  }
+void Transport::ReceiveSomeAsync(MutableBufferSequence data,
+                                 TransferSomeHandler handler) {
+  YOGI_ASSERT(boost::asio::buffer_size(data) > 0);
+
+  LimitToTransceiveByteLimit(&data);
 
   auto weak_self = MakeWeakPtr();
-  StartTimeout(&rx_timer_, weak_self);
+  StartTimeout(&rx_timeout_id_, weak_self);
 
   ReadSomeAsync(data, [=](auto& res, auto bytes_read) {
     auto self = weak_self.lock();
@@ -104,18 +137,30 @@ void Transport::ReceiveSomeAsync(boost::asio::mutable_buffer data,
       return;
     }
 
-    self->rx_timer_.cancel();
-
-    if (self->timed_out_) {
-      handler(api::Error(YOGI_ERR_TIMEOUT), bytes_read);
-    } else {
-      if (res.IsError()) {
-        self->Close();
+    boost::asio::dispatch(self->strand_, self->WrapHandler([=] {
+      if (auto self = weak_self.lock()) {
+        self->OnReceiveSomeFinished(res, bytes_read, handler);
+      } else {
+        handler(api::Error(YOGI_ERR_CANCELED), bytes_read);
       }
+    }));
+  });
+}
+
+void Transport::OnReceiveSomeFinished(const api::Result& res,
+                                      std::size_t bytes_read,
+                                      TransferSomeHandler handler) {
+  CancelTimeout(&rx_timeout_id_);
 
-      handler(res, bytes_read);
+  if (timed_out_) {
+    handler(api::Error(YOGI_ERR_TIMEOUT), bytes_read);
+  } else {
+    if (res.IsError()) {
+      Close();
     }
-  });
+
+    handler(res, bytes_read);
+  }
 }
 
 void Transport::ReceiveAllAsync(boost::asio::mutable_buffer data,
@@ -166,17 +211,25 @@ void Transport::ReceiveAllAsyncImpl(boost::asio::mutable_buffer data,
   }
 }
 
-void Transport::StartTimeout(boost::asio::steady_timer* timer,
+void Transport::StartTimeout(objects::detail::TimerWheel::TimerId* timeout_id,
                              TransportWeakPtr weak_self) {
-  timer->expires_from_now(timeout_);
-  timer->async_wait([weak_self](auto& ec) {
-    auto self = weak_self.lock();
-    if (!self) return;
+  if (timeout_ == timeout_.max()) return;
 
-    if (!ec) {
-      self->OnTimeout();
-    }
-  });
+  *timeout_id =
+      context_->GetTimerWheel().ScheduleAfter(timeout_, [weak_self] {
+        auto self = weak_self.lock();
+        if (!self) return;
+
+        self->OnTimeout();
+      });
+}
+
+void Transport::CancelTimeout(
+    objects::detail::TimerWheel::TimerId* timeout_id) {
+  if (*timeout_id == 0) return;
+
+  context_->GetTimerWheel().Cancel(*timeout_id);
+  *timeout_id = 0;
 }
 
 void Transport::OnTimeout() {
@@ -20,6 +20,7 @@
 #include "../config.h"
 #include "../objects/context.h"
 #include "../utils/types.h"
+#include "../utils/small_function.h"
 
 #include <boost/asio.hpp>
 #include <memory>
@@ -27,19 +28,42 @@
 #include <sstream>
 #include <chrono>
 #include <string>
+#include <array>
+#include <atomic>
 
 namespace network {
 
+// Cancels the pending accept or connect operation on an acceptor or socket
+// unless the operation has already finished
+template <typename T>
+class AsioGuard {
+  friend class TcpTransport;
+  friend class UnixTransport;
+
+ public:
+  AsioGuard(T* obj) : obj_(obj) {}
+  ~AsioGuard() {
+    if (obj_) obj_->cancel();
+  }
+
+ private:
+  void Disable() { obj_ = nullptr; }
+
+  T* obj_;
+};
+
 class Transport;
 typedef std::shared_ptr<Transport> TransportPtr;
 typedef std::weak_ptr<Transport> TransportWeakPtr;
 
 class Transport : public std::enable_shared_from_this<Transport> {
  public:
-  typedef std::function<void(const api::Result&,
-                             const std::size_t bytes_transferred)>
+  typedef utils::SmallFunction<void(const api::Result&,
+                                    const std::size_t bytes_transferred)>
       TransferSomeHandler;
-  typedef std::function<void(const api::Result&)> TransferAllHandler;
+  typedef utils::SmallFunction<void(const api::Result&)> TransferAllHandler;
+  typedef std::array<boost::asio::const_buffer, 2> ConstBufferSequence;
+  typedef std::array<boost::asio::mutable_buffer, 2> MutableBufferSequence;
 
   Transport(objects::ContextPtr context, std::chrono::nanoseconds timeout,
             bool created_from_incoming_conn_req, std::string peer_description,
@@ -47,6 +71,16 @@ class Transport : public std::enable_shared_from_this<Transport> {
   virtual ~Transport();
 
   objects::ContextPtr GetContext() const { return context_; }
+
+  // Completion handlers of all operations on the transport are executed
+  // through this strand, so they never run concurrently
+  boost::asio::io_context::strand& GetStrand() { return strand_; }
+
+  template <typename Fn>
+  void Post(Fn&& fn) {
+    boost::asio::post(strand_,
+                      context_->WrapHandler(std::forward<Fn>(fn), true));
+  }
   const std::string& GetPeerDescription() const { return peer_description_; }
 
   bool CreatedFromIncomingConnectionRequest() const {
@@ -55,12 +89,15 @@ class Transport : public std::enable_shared_from_this<Transport> {
 
   void SendSomeAsync(boost::asio::const_buffer data,
                      TransferSomeHandler handler);
+  void SendSomeAsync(ConstBufferSequence data, TransferSomeHandler handler);
   void SendAllAsync(boost::asio::const_buffer data, TransferAllHandler handler);
   void SendAllAsync(utils::SharedByteVector data, TransferAllHandler handler);
   void SendAllAsync(utils::SharedSmallByteVector data,
                     TransferAllHandler handler);
   void ReceiveSomeAsync(boost::asio::mutable_buffer data,
                         TransferSomeHandler handler);
+  void ReceiveSomeAsync(MutableBufferSequence data,
+                        TransferSomeHandler handler);
   void ReceiveAllAsync(boost::asio::mutable_buffer data,
                        TransferAllHandler handler);
   void ReceiveAllAsync(utils::SharedByteVector data,
@@ -68,31 +105,44 @@ class Transport : public std::enable_shared_from_this<Transport> {
   void Close();
 
  protected:
-  virtual void WriteSomeAsync(boost::asio::const_buffer data,
+  template <typename Handler>
+  auto WrapHandler(Handler&& handler) {
+    return context_->WrapHandler(std::forward<Handler>(handler));
+  }
+
+  virtual void WriteSomeAsync(const ConstBufferSequence& data,
                               TransferSomeHandler handler) = 0;
-  virtual void ReadSomeAsync(boost::asio::mutable_buffer data,
+  virtual void ReadSomeAsync(const MutableBufferSequence& data,
                              TransferSomeHandler handler) = 0;
   virtual void Shutdown() = 0;
 
  private:
   TransportWeakPtr MakeWeakPtr() { return shared_from_this(); }
+  void OnSendSomeFinished(const api::Result& res, std::size_t bytes_written,
+                          TransferSomeHandler handler);
+  void OnReceiveSomeFinished(const api::Result& res, std::size_t bytes_read,
+                             TransferSomeHandler handler);
   void SendAllAsyncImpl(boost::asio::const_buffer data, const api::Result& res,
                         std::size_t bytes_written, TransferAllHandler handler);
   void ReceiveAllAsyncImpl(boost::asio::mutable_buffer data,
                            const api::Result& res, std::size_t bytes_read,
                            TransferAllHandler handler);
-  void StartTimeout(boost::asio::steady_timer* timer,
+  template <typename BufferSequence>
+  void LimitToTransceiveByteLimit(BufferSequence* data) const;
+  void StartTimeout(objects::detail::TimerWheel::TimerId* timeout_id,
                     TransportWeakPtr weak_self);
+  void CancelTimeout(objects::detail::TimerWheel::TimerId* timeout_id);
   void OnTimeout();
 
   const objects::ContextPtr context_;
+  boost::asio::io_context::strand strand_;
   const std::chrono::nanoseconds timeout_;
   const bool created_from_incoming_conn_req_;
   const std::string peer_description_;
   const std::size_t transceive_byte_limit_;
-  boost::asio::steady_timer tx_timer_;
-  boost::asio::steady_timer rx_timer_;
-  bool timed_out_;
+  objects::detail::TimerWheel::TimerId tx_timeout_id_;
+  objects::detail::TimerWheel::TimerId rx_timeout_id_;
+  std::atomic<bool> timed_out_;
   YOGI_DEBUG_ONLY(bool close_called_ = false;)
 };
 
@@ -0,0 +1,333 @@
+/*
+ * This file is part of the Yogi distribution https://github.com/yohummus/yogi.
+ * Copyright (c) 2018 Johannes Bergmann.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "unix_transport.h"
+
+#ifdef YOGI_HAS_UNIX_TRANSPORT
+
+#include "shm_transport.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cstring>
+
+namespace network {
+namespace internal {
+
+bool SendHandshake(int socket, char handshake, const std::vector<int>& fds) {
+  iovec iov = {&handshake, 1};
+
+  msghdr msg = {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+
+  std::vector<char> control;
+  if (!fds.empty()) {
+    auto fds_size = fds.size() * sizeof(int);
+    control.resize(CMSG_SPACE(fds_size));
+    msg.msg_control = control.data();
+    msg.msg_controllen = control.size();
+
+    auto cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(fds_size);
+    std::memcpy(CMSG_DATA(cmsg), fds.data(), fds_size);
+  }
+
+  return ::sendmsg(socket, &msg, MSG_NOSIGNAL) == 1;
+}
+
+bool ReceiveHandshake(int socket, char* handshake, std::vector<int>* fds) {
+  const std::size_t kMaxFds = 8;
+
+  iovec iov = {handshake, 1};
+  std::vector<char> control(CMSG_SPACE(kMaxFds * sizeof(int)));
+
+  msghdr msg = {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.data();
+  msg.msg_controllen = control.size();
+
+  auto n = ::recvmsg(socket, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+
+  for (auto cmsg = CMSG_FIRSTHDR(&msg); n >= 0 && cmsg;
+       cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+      auto num_fds = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+      auto first = fds->size();
+      fds->resize(first + num_fds);
+      std::memcpy(fds->data() + first, CMSG_DATA(cmsg), num_fds * sizeof(int));
+    }
+  }
+
+  if (n != 1 || (msg.msg_flags & MSG_CTRUNC)) {
+    for (auto fd : *fds) ::close(fd);
+    fds->clear();
+    return false;
+  }
+
+  return true;
+}
+
+}  // namespace internal
+
+namespace {
+
+std::string MakeAbstractName(const UnixTransport::Endpoint& ep) {
+  auto path = ep.path();
+  if (!path.empty() && path[0] == '\0') {
+    path[0] = '@';
+  }
+
+  return path;
+}
+
+}  // anonymous namespace
+
+UnixTransport::Endpoint UnixTransport::MakeAbstractEndpoint(
+    const std::string& name) {
+  return Endpoint(std::string(1, '\0') + name);
+}
+
+UnixTransport::AcceptGuardPtr UnixTransport::AcceptAsync(
+    objects::ContextPtr context, Acceptor* acceptor,
+    std::chrono::nanoseconds timeout, std::size_t transceive_byte_limit,
+    AcceptHandler handler, AcceptedFn accepted_fn) {
+  auto guard = std::make_shared<AcceptGuard>(acceptor);
+  auto weak_guard = AcceptGuardWeakPtr(guard);
+  auto weak_context = context->MakeWeakPtr();
+  auto peer_description =
+      MakeAbstractName(acceptor->local_endpoint()) + " (client)";
+
+  auto socket = std::make_shared<Socket>(context->IoContext());
+  acceptor->async_accept(*socket, context->WrapHandler([=](auto& ec) {
+    auto guard = weak_guard.lock();
+    if (guard) guard->Disable();
+
+    auto context = weak_context.lock();
+    if (!context) return;
+
+    if (!ec) {
+      if (accepted_fn) accepted_fn();
+      ReceiveHandshakeAsync(context, socket, timeout, transceive_byte_limit,
+                            peer_description,
+                            [=](auto& res, auto transport) {
+                              handler(res, transport, guard);
+                            });
+    } else if (ec == boost::asio::error::operation_aborted) {
+      handler(api::Error(YOGI_ERR_CANCELED), {}, guard);
+    } else {
+      handler(api::Error(YOGI_ERR_ACCEPT_SOCKET_FAILED), {}, guard);
+    }
+  }));
+
+  return guard;
+}
+
+UnixTransport::ConnectGuardPtr UnixTransport::ConnectAsync(
+    objects::ContextPtr context, const std::string& name,
+    std::chrono::nanoseconds timeout, std::size_t transceive_byte_limit,
+    bool offer_shm, ConnectHandler handler) {
+  // Connecting to a local socket either succeeds or fails right away, so
+  // there is no need for a connect timeout like in TcpTransport
+  auto socket = std::make_shared<Socket>(context->IoContext());
+
+  auto guard = std::make_shared<ConnectGuard>(socket.get());
+  auto weak_guard = ConnectGuardWeakPtr(guard);
+  auto weak_context = context->MakeWeakPtr();
+  auto ep = MakeAbstractEndpoint(name);
+
+  socket->async_connect(ep, context->WrapHandler([=](auto& ec) {
+    auto guard = weak_guard.lock();
+    if (guard) guard->Disable();
+
+    auto context = weak_context.lock();
+    if (!context) return;
+
+    if (!ec) {
+      auto transport =
+          SendHandshake(context, socket.get(), timeout, transceive_byte_limit,
+                        offer_shm, '@' + name);
+      if (transport) {
+        handler(api::kSuccess, transport, guard);
+      } else {
+        handler(api::Error(YOGI_ERR_CONNECT_SOCKET_FAILED), {}, guard);
+      }
+    } else if (ec == boost::asio::error::operation_aborted) {
+      handler(api::Error(YOGI_ERR_CANCELED), {}, guard);
+    } else {
+      handler(api::Error(YOGI_ERR_CONNECT_SOCKET_FAILED), {}, guard);
+    }
+  }));
+
+  return guard;
+}
+
+void UnixTransport::CloseSocket(Socket* s) {
+  boost::system::error_code ec;
+  s->cancel(ec);
+  s->shutdown(s->shutdown_both, ec);
+  s->close(ec);
+}
+
+void UnixTransport::WriteSomeAsync(const ConstBufferSequence& data,
+                                   TransferSomeHandler handler) {
+  std::lock_guard<std::mutex> lock(socket_mutex_);
+  socket_.async_write_some(
+      data, WrapHandler([=](auto& ec, auto bytes_written) {
+        if (!ec) {
+          handler(api::kSuccess, bytes_written);
+        } else if (ec == boost::asio::error::operation_aborted) {
+          handler(api::Error(YOGI_ERR_CANCELED), bytes_written);
+        } else {
+          handler(api::Error(YOGI_ERR_RW_SOCKET_FAILED), bytes_written);
+        }
+      }));
+}
+
+void UnixTransport::ReadSomeAsync(const MutableBufferSequence& data,
+                                  TransferSomeHandler handler) {
+  std::lock_guard<std::mutex> lock(socket_mutex_);
+  socket_.async_read_some(
+      data, WrapHandler([=](auto& ec, auto bytes_read) {
+        if (!ec) {
+          handler(api::kSuccess, bytes_read);
+        } else if (ec == boost::asio::error::operation_aborted) {
+          handler(api::Error(YOGI_ERR_CANCELED), bytes_read);
+        } else {
+          handler(api::Error(YOGI_ERR_RW_SOCKET_FAILED), bytes_read);
+        }
+      }));
+}
+
+void UnixTransport::Shutdown() {
+  std::lock_guard<std::mutex> lock(socket_mutex_);
+  CloseSocket(&socket_);
+}
+
+void UnixTransport::ReceiveHandshakeAsync(objects::ContextPtr context,
+                                          std::shared_ptr<Socket> socket,
+                                          std::chrono::nanoseconds timeout,
+                                          std::size_t transceive_byte_limit,
+                                          std::string peer_description,
+                                          HandshakeHandler handler) {
+  struct HandshakeData {
+    objects::detail::TimerWheel::TimerId timer_id = 0;
+    bool timed_out = false;
+  };
+
+  auto hsdat = std::make_shared<HandshakeData>();
+  if (timeout != timeout.max()) {
+    hsdat->timer_id =
+        context->GetTimerWheel().ScheduleAfter(timeout, [=] {
+          hsdat->timed_out = true;
+          CloseSocket(socket.get());
+        });
+  }
+
+  auto weak_context = context->MakeWeakPtr();
+  socket->async_wait(Socket::wait_read, context->WrapHandler([=](auto& ec) {
+    auto context = weak_context.lock();
+    if (!context) return;
+
+    context->GetTimerWheel().Cancel(hsdat->timer_id);
+
+    if (hsdat->timed_out) {
+      handler(api::Error(YOGI_ERR_TIMEOUT), {});
+      return;
+    } else if (ec == boost::asio::error::operation_aborted) {
+      handler(api::Error(YOGI_ERR_CANCELED), {});
+      return;
+    }
+
+    char handshake = 0;
+    std::vector<int> fds;
+    if (ec ||
+        !internal::ReceiveHandshake(socket->native_handle(), &handshake,
+                                    &fds)) {
+      handler(api::Error(YOGI_ERR_RW_SOCKET_FAILED), {});
+      return;
+    }
+
+    try {
+      TransportPtr transport;
+      if (handshake == kPlainHandshake && fds.empty()) {
+        transport = UnixTransportPtr(
+            new UnixTransport(context, std::move(*socket), timeout,
+                              transceive_byte_limit, true, peer_description));
+      } else if (handshake == kShmHandshake) {
+        transport = ShmTransport::Attach(context, socket.get(), fds, timeout,
+                                         transceive_byte_limit,
+                                         peer_description);
+      } else {
+        for (auto fd : fds) ::close(fd);
+        throw api::Error(YOGI_ERR_DESERIALIZE_MSG_FAILED);
+      }
+
+      handler(api::kSuccess, transport);
+    } catch (const api::Error& err) {
+      YOGI_LOG_ERROR(logger_, "Invalid handshake from " << peer_description
+                                                        << ": " << err);
+      handler(err, {});
+    }
+  }));
+}
+
+TransportPtr UnixTransport::SendHandshake(objects::ContextPtr context,
+                                          Socket* socket,
+                                          std::chrono::nanoseconds timeout,
+                                          std::size_t transceive_byte_limit,
+                                          bool offer_shm,
+                                          std::string peer_description) {
+  if (offer_shm) {
+    try {
+      return ShmTransport::Offer(context, socket, timeout,
+                                 transceive_byte_limit, peer_description);
+    } catch (const api::Error& err) {
+      YOGI_LOG_WARNING(logger_, "Could not set up shared memory transport to "
+                                    << peer_description << ": " << err
+                                    << ". Using the socket instead.");
+    }
+  }
+
+  if (!internal::SendHandshake(socket->native_handle(), kPlainHandshake, {})) {
+    return {};
+  }
+
+  return UnixTransportPtr(new UnixTransport(context, std::move(*socket),
+                                            timeout, transceive_byte_limit,
+                                            false, peer_description));
+}
+
+UnixTransport::UnixTransport(objects::ContextPtr context, Socket&& socket,
+                             std::chrono::nanoseconds timeout,
+                             std::size_t transceive_byte_limit,
+                             bool created_via_accept,
+                             std::string peer_description)
+    : Transport(context, timeout, created_via_accept, peer_description,
+                transceive_byte_limit),
+      socket_(std::move(socket)) {}
+
+const objects::LoggerPtr UnixTransport::logger_ =
+    objects::Logger::CreateStaticInternalLogger("Transport.Unix");
+
+}  // namespace network
+
+#endif  // YOGI_HAS_UNIX_TRANSPORT
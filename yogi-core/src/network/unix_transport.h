@@ -0,0 +1,135 @@
+/*
+ * This file is part of the Yogi distribution https://github.com/yohummus/yogi.
+ * Copyright (c) 2018 Johannes Bergmann.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "../config.h"
+#include "../objects/logger.h"
+#include "transport.h"
+
+#include <boost/asio.hpp>
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Abstract socket names are a Linux extension
+#if defined(__linux__) && defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+#define YOGI_HAS_UNIX_TRANSPORT
+#endif
+
+#ifdef YOGI_HAS_UNIX_TRANSPORT
+
+namespace network {
+namespace internal {
+
+// Sends/receives the single byte handshake at the start of a Unix domain
+// socket connection, optionally together with file descriptors
+bool SendHandshake(int socket, char handshake, const std::vector<int>& fds);
+bool ReceiveHandshake(int socket, char* handshake, std::vector<int>* fds);
+
+}  // namespace internal
+
+class UnixTransport;
+typedef std::shared_ptr<UnixTransport> UnixTransportPtr;
+typedef std::weak_ptr<UnixTransport> UnixTransportWeakPtr;
+
+// Transport over Unix domain stream sockets bound to a name in the abstract
+// namespace, i.e. without a file in the file system. The connecting side
+// starts with a handshake byte that determines whether the socket itself gets
+// used for transferring data or a shared memory segment (see ShmTransport).
+class UnixTransport : public Transport {
+ public:
+  enum Handshake : char {
+    kPlainHandshake = 'U',
+    kShmHandshake = 'S',
+  };
+
+  typedef boost::asio::local::stream_protocol::acceptor Acceptor;
+  typedef boost::asio::local::stream_protocol::socket Socket;
+  typedef boost::asio::local::stream_protocol::endpoint Endpoint;
+  typedef AsioGuard<Acceptor> AcceptGuard;
+  typedef std::shared_ptr<AcceptGuard> AcceptGuardPtr;
+  typedef std::weak_ptr<AcceptGuard> AcceptGuardWeakPtr;
+  typedef AsioGuard<Socket> ConnectGuard;
+  typedef std::shared_ptr<ConnectGuard> ConnectGuardPtr;
+  typedef std::weak_ptr<ConnectGuard> ConnectGuardWeakPtr;
+  typedef std::function<void(const api::Result&, TransportPtr, AcceptGuardPtr)>
+      AcceptHandler;
+  typedef std::function<void()> AcceptedFn;
+  typedef std::function<void(const api::Result&, TransportPtr,
+                             ConnectGuardPtr)>
+      ConnectHandler;
+
+  static Endpoint MakeAbstractEndpoint(const std::string& name);
+
+  // The optional accepted_fn gets called as soon as a socket has been
+  // accepted, i.e. before the handshake, so the next accept can be started
+  // without waiting for a possibly slow peer
+  static AcceptGuardPtr AcceptAsync(objects::ContextPtr context,
+                                    Acceptor* acceptor,
+                                    std::chrono::nanoseconds timeout,
+                                    std::size_t transceive_byte_limit,
+                                    AcceptHandler handler,
+                                    AcceptedFn accepted_fn = {});
+
+  static ConnectGuardPtr ConnectAsync(objects::ContextPtr context,
+                                      const std::string& name,
+                                      std::chrono::nanoseconds timeout,
+                                      std::size_t transceive_byte_limit,
+                                      bool offer_shm, ConnectHandler handler);
+
+  static void CloseSocket(Socket* s);
+
+ protected:
+  virtual void WriteSomeAsync(const ConstBufferSequence& data,
+                              TransferSomeHandler handler) override;
+  virtual void ReadSomeAsync(const MutableBufferSequence& data,
+                             TransferSomeHandler handler) override;
+  virtual void Shutdown() override;
+
+ private:
+  typedef std::function<void(const api::Result&, TransportPtr)>
+      HandshakeHandler;
+
+  static void ReceiveHandshakeAsync(objects::ContextPtr context,
+                                    std::shared_ptr<Socket> socket,
+                                    std::chrono::nanoseconds timeout,
+                                    std::size_t transceive_byte_limit,
+                                    std::string peer_description,
+                                    HandshakeHandler handler);
+  static TransportPtr SendHandshake(objects::ContextPtr context,
+                                    Socket* socket,
+                                    std::chrono::nanoseconds timeout,
+                                    std::size_t transceive_byte_limit,
+                                    bool offer_shm,
+                                    std::string peer_description);
+
+  UnixTransport(objects::ContextPtr context, Socket&& socket,
+                std::chrono::nanoseconds timeout,
+                std::size_t transceive_byte_limit, bool created_via_accept,
+                std::string peer_description);
+
+  static const objects::LoggerPtr logger_;
+  Socket socket_;
+  std::mutex socket_mutex_;
+};
+
+}  // namespace network
+
+#endif  // YOGI_HAS_UNIX_TRANSPORT
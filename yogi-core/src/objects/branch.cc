@@ -30,7 +30,16 @@ Branch::Branch(ContextPtr context, std::string name, std::string description,
                std::chrono::nanoseconds adv_interval,
                std::chrono::nanoseconds timeout, bool ghost_mode,
                std::size_t tx_queue_size, std::size_t rx_queue_size,
-               std::size_t transceive_byte_limit)
+               std::size_t transceive_byte_limit,
+               std::chrono::nanoseconds tx_coalescing_delay,
+               std::size_t tx_coalescing_bytes,
+               std::size_t tx_zerocopy_threshold,
+               std::size_t tx_fanout_partitions,
+               std::size_t rx_broadcast_queue_depth,
+               network::SlowConsumerPolicy tx_slow_consumer_policy,
+               std::size_t tx_slow_consumer_threshold,
+               std::chrono::nanoseconds tx_slow_consumer_timeout,
+               std::size_t tx_overflow_budget)
     : context_(context),
       connection_manager_(std::make_shared<detail::ConnectionManager>(
           context, password, adv_if_strings, adv_ep,
@@ -41,11 +50,17 @@ Branch::Branch(ContextPtr context, std::string name, std::string description,
           connection_manager_->GetAdvertisingInterfaces(),
           connection_manager_->GetAdvertisingEndpoint(),
           connection_manager_->GetTcpServerEndpoint(), timeout, adv_interval,
-          ghost_mode, tx_queue_size, rx_queue_size, transceive_byte_limit)),
+          ghost_mode, tx_queue_size, rx_queue_size, transceive_byte_limit,
+          tx_coalescing_delay, tx_coalescing_bytes, tx_zerocopy_threshold,
+          tx_fanout_partitions, rx_broadcast_queue_depth,
+          tx_slow_consumer_policy, tx_slow_consumer_threshold,
+          tx_slow_consumer_timeout, tx_overflow_budget)),
       broadcast_manager_(std::make_shared<detail::BroadcastManager>(
-          context, *connection_manager_)) {
+          context, *connection_manager_, rx_broadcast_queue_depth)) {
   if (name.empty() || net_name.empty() || path.empty() || path.front() != '/' ||
-      adv_interval < 1ms || timeout < 1ms) {
+      adv_interval < 1ms || timeout < 1ms ||
+      tx_coalescing_delay == tx_coalescing_delay.max() ||
+      tx_slow_consumer_timeout == tx_slow_consumer_timeout.max()) {
     throw api::Error(YOGI_ERR_INVALID_PARAM);
   }
 }
@@ -88,6 +103,16 @@ void Branch::ReceiveBroadcast(api::Encoding enc,
   broadcast_manager_->ReceiveBroadcast(enc, data, handler);
 }
 
+void Branch::ReceiveBroadcastLease(ReceiveBroadcastLeaseHandler handler) {
+  broadcast_manager_->ReceiveBroadcastLease(handler);
+}
+
+void Branch::ReceiveBroadcasts(api::Encoding enc,
+                               boost::asio::mutable_buffer data,
+                               ReceiveBroadcastsHandler handler) {
+  broadcast_manager_->ReceiveBroadcasts(enc, data, handler);
+}
+
 bool Branch::CancelReceiveBroadcast() {
   return broadcast_manager_->CancelReceiveBroadcast();
 }
@@ -30,6 +30,11 @@ class Branch : public api::ExposedObjectT<Branch, api::ObjectType::kBranch> {
   using SendBroadcastHandler = detail::BroadcastManager::SendBroadcastHandler;
   using ReceiveBroadcastHandler =
       detail::BroadcastManager::ReceiveBroadcastHandler;
+  using ReceiveBroadcastLeaseHandler =
+      detail::BroadcastManager::ReceiveBroadcastLeaseHandler;
+  using ReceiveBroadcastsHandler =
+      detail::BroadcastManager::ReceiveBroadcastsHandler;
+  using ReceiveLease = detail::BranchConnection::ReceiveLease;
   using BranchInfoStringsList =
       detail::ConnectionManager::BranchInfoStringsList;
   using SendBroadcastOperationId =
@@ -42,7 +47,15 @@ class Branch : public api::ExposedObjectT<Branch, api::ObjectType::kBranch> {
          std::chrono::nanoseconds adv_interval,
          std::chrono::nanoseconds timeout, bool ghost_mode,
          std::size_t tx_queue_size, std::size_t rx_queue_size,
-         std::size_t transceive_byte_limit);
+         std::size_t transceive_byte_limit,
+         std::chrono::nanoseconds tx_coalescing_delay,
+         std::size_t tx_coalescing_bytes, std::size_t tx_zerocopy_threshold,
+         std::size_t tx_fanout_partitions,
+         std::size_t rx_broadcast_queue_depth,
+         network::SlowConsumerPolicy tx_slow_consumer_policy,
+         std::size_t tx_slow_consumer_threshold,
+         std::chrono::nanoseconds tx_slow_consumer_timeout,
+         std::size_t tx_overflow_budget);
 
   void Start();
 
@@ -58,6 +71,9 @@ class Branch : public api::ExposedObjectT<Branch, api::ObjectType::kBranch> {
   bool CancelSendBroadcast(SendBroadcastOperationId oid);
   void ReceiveBroadcast(api::Encoding enc, boost::asio::mutable_buffer data,
                         ReceiveBroadcastHandler handler);
+  void ReceiveBroadcastLease(ReceiveBroadcastLeaseHandler handler);
+  void ReceiveBroadcasts(api::Encoding enc, boost::asio::mutable_buffer data,
+                         ReceiveBroadcastsHandler handler);
   bool CancelReceiveBroadcast();
 
  private:
@@ -17,13 +17,34 @@
 
 #include "context.h"
 #include "../api/errors.h"
+#include "../utils/system.h"
 
-#include <boost/asio/post.hpp>
+#include <algorithm>
 #include <signal.h>
 
 namespace objects {
-
-Context::Context() : ioc_(1), work_(ioc_), signals_(ioc_), running_(false) {}
+namespace {
+
+// 1ms resolution with ~1s per revolution; transport timeouts and heartbeats
+// are far coarser than that
+const std::chrono::milliseconds kTimerWheelResolution(1);
+const std::size_t kTimerWheelSlots = 1024;
+
+}  // anonymous namespace
+
+Context::Context(std::size_t num_threads)
+    : num_threads_(num_threads),
+      loop_stats_(num_threads),
+      ioc_(static_cast<int>(num_threads)),
+      work_(ioc_),
+      timer_wheel_(ioc_, &loop_stats_, kTimerWheelResolution,
+                   kTimerWheelSlots),
+      signals_(ioc_),
+      running_(false),
+      running_threads_(0),
+      busy_poll_enabled_(false) {
+  YOGI_ASSERT(num_threads_ >= 1);
+}
 
 Context::~Context() {
   Stop();
@@ -39,7 +60,7 @@ int Context::PollOne() {
 }
 
 int Context::Run(std::chrono::nanoseconds dur) {
-  return RunImpl([&] {
+  return RunOnAllThreads([&] {
     if (dur == dur.max()) {
       return ioc_.run();
     } else {
@@ -58,21 +79,58 @@ int Context::RunOne(std::chrono::nanoseconds dur) {
   });
 }
 
-void Context::RunInBackground() {
+int Context::RunBusyPoll(std::chrono::nanoseconds dur) {
+  busy_poll_enabled_ = true;
+  return RunOnAllThreads([&] { return BusyPoll(dur); });
+}
+
+void Context::RunInBackground(int first_cpu, bool busy_poll) {
+  if (busy_poll) {
+    busy_poll_enabled_ = true;
+  }
+
   SetRunningFlagAndReset();
-  thread_ = std::thread([&] {
-    try {
-      ioc_.run();
-    } catch (const std::exception& e) {
-      YOGI_LOG_FATAL(logger_, "Exception caught in context background thread: "
-                                  << e.what());
-    } catch (...) {
-      YOGI_LOG_FATAL(logger_,
-                     "Unknown Exception caught in context background thread");
-    }
+  JoinThreads();
 
-    ClearRunningFlag();
-  });
+  std::lock_guard<std::mutex> lock(mutex_);
+  running_threads_ = num_threads_;
+  for (std::size_t i = 0; i < num_threads_; ++i) {
+    threads_.emplace_back([this, i, first_cpu, busy_poll] {
+      if (first_cpu >= 0) {
+        auto num_cpus = std::max(std::thread::hardware_concurrency(), 1u);
+        auto cpu = (static_cast<std::size_t>(first_cpu) + i) % num_cpus;
+        if (!utils::PinCurrentThreadToCpu(cpu)) {
+          YOGI_LOG_WARNING(logger_, "Could not pin context thread to CPU "
+                                        << cpu);
+        }
+      }
+
+      try {
+        if (busy_poll) {
+          BusyPoll(std::chrono::nanoseconds::max());
+        } else {
+          ioc_.run();
+        }
+      } catch (const std::exception& e) {
+        YOGI_LOG_FATAL(logger_,
+                       "Exception caught in context background thread: "
+                           << e.what());
+      } catch (...) {
+        YOGI_LOG_FATAL(logger_,
+                       "Unknown Exception caught in context background thread");
+      }
+
+      bool last_thread;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        last_thread = --running_threads_ == 0;
+      }
+
+      if (last_thread) {
+        ClearRunningFlag();
+      }
+    });
+  }
 }
 
 void Context::Stop() {
@@ -101,14 +159,27 @@ bool Context::WaitForStopped(std::chrono::nanoseconds timeout) {
     timed_out = !cv_.wait_for(lock, timeout, [&] { return !running_; });
   }
 
-  if (!timed_out && thread_.joinable()) {
-    thread_.join();
+  if (!timed_out) {
+    lock.unlock();
+    JoinThreads();
   }
 
   return !timed_out;
 }
 
-void Context::Post(std::function<void()> fn) { boost::asio::post(ioc_, fn); }
+void Context::ConfigureLoopStats(
+    bool enable, std::chrono::nanoseconds slow_handler_threshold) {
+  loop_stats_.Configure(enable, slow_handler_threshold);
+}
+
+std::string Context::MakeLoopStatsString(bool reset) {
+  auto json = loop_stats_.ToJson();
+  if (reset) {
+    loop_stats_.Reset();
+  }
+
+  return json.dump();
+}
 
 void Context::AwaitSignal(api::Signals sigs, SignalHandler signal_handler) {
   std::lock_guard<std::mutex> lock(mutex_);
@@ -141,7 +212,7 @@ void Context::AwaitSignal(api::Signals sigs, SignalHandler signal_handler) {
     throw api::Error(YOGI_ERR_UNKNOWN);
   }
 
-  signals_.async_wait([=](auto& ec, int sig_num) {
+  signals_.async_wait(WrapHandler([=](auto& ec, int sig_num) {
     auto res = api::kSuccess;
     auto sig = sigs;
 
@@ -167,11 +238,25 @@ void Context::AwaitSignal(api::Signals sigs, SignalHandler signal_handler) {
     }
 
     signal_handler(res, sig);
-  });
+  }));
 }
 
 void Context::CancelAwaitSignal() { signals_.cancel(); }
 
+void Context::SetShards(std::vector<std::weak_ptr<Context>> shards) {
+  shards_ = shards;
+}
+
+std::shared_ptr<Context> Context::GetShard(std::size_t key) {
+  if (!shards_.empty()) {
+    if (auto shard = shards_[key % shards_.size()].lock()) {
+      return shard;
+    }
+  }
+
+  return std::static_pointer_cast<Context>(shared_from_this());
+}
+
 void Context::SetRunningFlagAndReset() {
   std::lock_guard<std::mutex> lock(mutex_);
   if (running_) {
@@ -190,6 +275,36 @@ void Context::ClearRunningFlag() {
   cv_.notify_all();
 }
 
+void Context::JoinThreads() {
+  std::vector<std::thread> threads;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    threads.swap(threads_);
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+std::size_t Context::BusyPoll(std::chrono::nanoseconds dur) {
+  // Never sleeps in the reactor; trades a fully used core for wake-up latency
+  auto deadline = std::chrono::steady_clock::time_point::max();
+  if (dur != dur.max()) {
+    deadline = std::chrono::steady_clock::now() +
+               std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                   dur);
+  }
+
+  std::size_t cnt = 0;
+  while (!ioc_.stopped()) {
+    cnt += ioc_.poll();
+    if (std::chrono::steady_clock::now() >= deadline) break;
+  }
+
+  return cnt;
+}
+
 template <typename Fn>
 int Context::RunImpl(Fn fn) {
   SetRunningFlagAndReset();
@@ -198,6 +313,30 @@ int Context::RunImpl(Fn fn) {
   return cnt;
 }
 
+template <typename Fn>
+int Context::RunOnAllThreads(Fn fn) {
+  if (num_threads_ == 1) {
+    return RunImpl(fn);
+  }
+
+  return RunImpl([&] {
+    // The calling thread is one of the context's threads
+    std::vector<std::thread> helpers;
+    std::vector<std::size_t> counts(num_threads_ - 1);
+    for (std::size_t i = 0; i < counts.size(); ++i) {
+      helpers.emplace_back([&, i] { counts[i] = fn(); });
+    }
+
+    auto cnt = fn();
+    for (std::size_t i = 0; i < helpers.size(); ++i) {
+      helpers[i].join();
+      cnt += counts[i];
+    }
+
+    return cnt;
+  });
+}
+
 const LoggerPtr Context::logger_ =
     Logger::CreateStaticInternalLogger("Context");
 
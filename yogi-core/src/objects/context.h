@@ -21,14 +21,21 @@
 #include "../api/object.h"
 #include "../api/enums.h"
 #include "logger.h"
+#include "detail/timer_wheel.h"
+#include "detail/loop_stats.h"
+#include "../utils/handler_memory.h"
 
 #include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
 #include <boost/asio/signal_set.hpp>
 #include <chrono>
 #include <functional>
 #include <mutex>
 #include <condition_variable>
 #include <thread>
+#include <atomic>
+#include <vector>
+#include <utility>
 
 namespace objects {
 
@@ -36,39 +43,100 @@ class Context : public api::ExposedObjectT<Context, api::ObjectType::kContext> {
  public:
   typedef std::function<void(const api::Result&, api::Signals)> SignalHandler;
 
-  Context();
+  explicit Context(std::size_t num_threads = 1);
   virtual ~Context();
 
   boost::asio::io_context& IoContext() { return ioc_; }
+  std::size_t GetNumThreads() const { return num_threads_; }
+  detail::TimerWheel& GetTimerWheel() { return timer_wheel_; }
+
+  // Set once the context has been run in busy-poll mode; connections
+  // established afterwards ask the kernel to busy-poll their sockets too
+  bool BusyPollEnabled() const { return busy_poll_enabled_; }
+
+  utils::HandlerMemoryPool& GetHandlerMemoryPool() {
+    return handler_memory_pool_;
+  }
 
   int Poll();
   int PollOne();
   int Run(std::chrono::nanoseconds dur);
   int RunOne(std::chrono::nanoseconds dur);
-  void RunInBackground();
+  int RunBusyPoll(std::chrono::nanoseconds dur);
+  void RunInBackground(int first_cpu = -1, bool busy_poll = false);
   void Stop();
   bool WaitForRunning(std::chrono::nanoseconds timeout);
   bool WaitForStopped(std::chrono::nanoseconds timeout);
-  void Post(std::function<void()> fn);
+
+  // Makes asio allocate the handler's operation from the context's memory
+  // pool and records the handler in the loop statistics if enabled
+  template <typename Handler>
+  utils::RecyclingHandler<
+      detail::InstrumentedHandler<typename std::decay<Handler>::type>>
+  WrapHandler(Handler&& handler, bool queued = false) {
+    return utils::MakeRecyclingHandler(
+        &handler_memory_pool_,
+        detail::InstrumentedHandler<typename std::decay<Handler>::type>(
+            &loop_stats_, std::forward<Handler>(handler), queued));
+  }
+
+  template <typename Fn>
+  void Post(Fn&& fn) {
+    boost::asio::post(ioc_, WrapHandler(std::forward<Fn>(fn), true));
+  }
+
+  // Enqueues all calls as a single operation; they run in order on one thread
+  template <typename Fn, typename Arg>
+  void PostBatch(std::vector<std::pair<Fn, Arg>> calls) {
+    if (calls.empty()) return;
+    Post([calls = std::move(calls)] {
+      for (auto& call : calls) {
+        call.first(call.second);
+      }
+    });
+  }
+
+  void ConfigureLoopStats(bool enable,
+                          std::chrono::nanoseconds slow_handler_threshold);
+  std::string MakeLoopStatsString(bool reset);
+
   void AwaitSignal(api::Signals signals, SignalHandler signal_handler);
   void CancelAwaitSignal();
 
+  // Contexts created by a ContextGroup distribute new connections over all
+  // contexts (shards) of the group; otherwise this context is returned
+  void SetShards(std::vector<std::weak_ptr<Context>> shards);
+  std::shared_ptr<Context> GetShard(std::size_t key);
+
  private:
   void SetRunningFlagAndReset();
   void ClearRunningFlag();
 
+  void JoinThreads();
+  std::size_t BusyPoll(std::chrono::nanoseconds dur);
+
   template <typename Fn>
   int RunImpl(Fn fn);
 
+  template <typename Fn>
+  int RunOnAllThreads(Fn fn);
+
   static const LoggerPtr logger_;
 
+  const std::size_t num_threads_;
+  utils::HandlerMemoryPool handler_memory_pool_;  // Must outlive ioc_
+  detail::LoopStats loop_stats_;                  // Must outlive ioc_
   boost::asio::io_context ioc_;
   boost::asio::io_context::work work_;
+  detail::TimerWheel timer_wheel_;
   boost::asio::signal_set signals_;
   bool running_;
   std::mutex mutex_;
   std::condition_variable cv_;
-  std::thread thread_;
+  std::vector<std::thread> threads_;
+  std::size_t running_threads_;
+  std::vector<std::weak_ptr<Context>> shards_;
+  std::atomic<bool> busy_poll_enabled_;
 };
 
 typedef std::shared_ptr<Context> ContextPtr;
@@ -0,0 +1,85 @@
+/*
+ * This file is part of the Yogi distribution https://github.com/yohummus/yogi.
+ * Copyright (c) 2018 Johannes Bergmann.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "context_group.h"
+#include "../api/errors.h"
+
+#include <algorithm>
+
+namespace objects {
+namespace {
+
+std::vector<ContextPtr> MakeContexts(std::size_t num_contexts) {
+  std::vector<ContextPtr> contexts;
+  for (std::size_t i = 0; i < num_contexts; ++i) {
+    contexts.push_back(Context::Create());
+  }
+
+  std::vector<std::weak_ptr<Context>> shards(contexts.begin(), contexts.end());
+  for (auto& context : contexts) {
+    context->SetShards(shards);
+  }
+
+  return contexts;
+}
+
+}  // anonymous namespace
+
+ContextGroup::ContextGroup(std::size_t num_contexts)
+    : contexts_(MakeContexts(num_contexts)) {}
+
+void ContextGroup::RunInBackground(bool pin_threads) {
+  // Make sure that either all or none of the contexts are running
+  for (auto& context : contexts_) {
+    if (!context->WaitForStopped(std::chrono::nanoseconds::zero())) {
+      throw api::Error(YOGI_ERR_BUSY);
+    }
+  }
+
+  for (std::size_t i = 0; i < contexts_.size(); ++i) {
+    contexts_[i]->RunInBackground(pin_threads ? static_cast<int>(i) : -1);
+  }
+}
+
+void ContextGroup::Stop() {
+  for (auto& context : contexts_) {
+    context->Stop();
+  }
+}
+
+bool ContextGroup::WaitForStopped(std::chrono::nanoseconds timeout) {
+  if (timeout == timeout.max()) {
+    for (auto& context : contexts_) {
+      context->WaitForStopped(timeout);
+    }
+
+    return true;
+  }
+
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  for (auto& context : contexts_) {
+    auto remaining = std::max<std::chrono::nanoseconds>(
+        deadline - std::chrono::steady_clock::now(),
+        std::chrono::nanoseconds::zero());
+    if (!context->WaitForStopped(remaining)) return false;
+  }
+
+  return true;
+}
+
+}  // namespace objects
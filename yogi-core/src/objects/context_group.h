@@ -0,0 +1,49 @@
+/*
+ * This file is part of the Yogi distribution https://github.com/yohummus/yogi.
+ * Copyright (c) 2018 Johannes Bergmann.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "../config.h"
+#include "context.h"
+
+#include <chrono>
+#include <vector>
+
+namespace objects {
+
+// Set of single-threaded contexts (shards) that share the connections of
+// branches created on any of them, so each connection is handled entirely by
+// one shard and its thread
+class ContextGroup
+    : public api::ExposedObjectT<ContextGroup, api::ObjectType::kContextGroup> {
+ public:
+  explicit ContextGroup(std::size_t num_contexts);
+
+  const std::vector<ContextPtr>& GetContexts() const { return contexts_; }
+
+  void RunInBackground(bool pin_threads);
+  void Stop();
+  bool WaitForStopped(std::chrono::nanoseconds timeout);
+
+ private:
+  const std::vector<ContextPtr> contexts_;
+};
+
+typedef std::shared_ptr<ContextGroup> ContextGroupPtr;
+
+}  // namespace objects
@@ -97,14 +97,14 @@ bool AdvertisingReceiver::JoinMulticastGroups() {
 void AdvertisingReceiver::StartReceiveAdvertisement() {
   auto buffer = buffer_;
   auto weak_self = std::weak_ptr<AdvertisingReceiver>{shared_from_this()};
-  socket_.async_receive_from(boost::asio::buffer(*buffer_), sender_ep_,
-                             [weak_self, buffer](auto ec, auto bytes_received) {
-                               auto self = weak_self.lock();
-                               if (!self) return;
-
-                               self->OnReceivedAdvertisementFinished(
-                                   ec, bytes_received);
-                             });
+  socket_.async_receive_from(
+      boost::asio::buffer(*buffer_), sender_ep_,
+      context_->WrapHandler([weak_self, buffer](auto ec, auto bytes_received) {
+        auto self = weak_self.lock();
+        if (!self) return;
+
+        self->OnReceivedAdvertisementFinished(ec, bytes_received);
+      }));
 }
 
 void AdvertisingReceiver::OnReceivedAdvertisementFinished(
@@ -98,7 +98,7 @@ void AdvertisingSender::SendAdvertisements() {
   for (const auto& socket : sockets_) {
     socket->socket.async_send_to(
         boost::asio::buffer(*msg), adv_ep_,
-        [weak_self, msg, socket](auto ec, auto) {
+        context_->WrapHandler([weak_self, msg, socket](auto ec, auto) {
           auto self = weak_self.lock();
           if (!self) return;
 
@@ -117,7 +117,7 @@ void AdvertisingSender::SendAdvertisements() {
           if (self->active_send_ops_ == 0) {
             self->StartTimer();
           }
-        });
+        }));
     ++active_send_ops_;
   }
 }
@@ -126,7 +126,7 @@ void AdvertisingSender::StartTimer() {
   timer_.expires_after(info_->GetAdvertisingInterval());
 
   auto weak_self = std::weak_ptr<AdvertisingSender>(shared_from_this());
-  timer_.async_wait([weak_self](auto ec) {
+  timer_.async_wait(context_->WrapHandler([weak_self](auto ec) {
     auto self = weak_self.lock();
     if (!self) return;
 
@@ -139,7 +139,7 @@ void AdvertisingSender::StartTimer() {
                          << ec.message()
                          << ". No more advertising messages will be sent.");
     }
-  });
+  }));
 }
 
 const LoggerPtr AdvertisingSender::logger_ =
@@ -19,9 +19,16 @@
 #include "../../../api/constants.h"
 #include "../../../utils/crypto.h"
 #include "../../../network/serialize.h"
+#include "../../../network/tcp_transport.h"
 
 namespace objects {
 namespace detail {
+namespace {
+
+// Recommended starting point for SO_BUSY_POLL in the kernel documentation
+const std::chrono::microseconds kSocketBusyPollBudget(50);
+
+}  // anonymous namespace
 
 BranchConnection::BranchConnection(network::TransportPtr transport,
                                    const boost::asio::ip::address& peer_address,
@@ -32,7 +39,11 @@ BranchConnection::BranchConnection(network::TransportPtr transport,
       peer_address_(peer_address),
       connected_since_(utils::Timestamp::Now()),
       session_running_(false),
-      heartbeat_timer_(context_->IoContext()),
+      rx_lease_dispatching_(false),
+      rx_lease_released_(false),
+      heartbeat_timer_id_(0),
+      slow_consumer_check_pending_(false),
+      slow_consumer_disconnected_(false),
       next_result_(api::kSuccess) {}
 
 std::string BranchConnection::MakeInfoString() const {
@@ -79,8 +90,10 @@ void BranchConnection::Authenticate(utils::SharedByteVector password_hash,
   });
 }
 
-void BranchConnection::RunSession(MessageReceiveHandler rcv_handler,
-                                  CompletionHandler session_handler) {
+void BranchConnection::RunSession(network::BroadcastLogPtr broadcast_log,
+                                  MessageReceiveHandler rcv_handler,
+                                  CompletionHandler session_handler,
+                                  SlowConsumerHandler slow_consumer_handler) {
   YOGI_ASSERT(remote_info_);
   YOGI_ASSERT(!SessionRunning());
 
@@ -88,13 +101,54 @@ void BranchConnection::RunSession(MessageReceiveHandler rcv_handler,
 
   msg_transport_ = std::make_shared<network::MessageTransport>(
       transport_, local_info_->GetTxQueueSize(), local_info_->GetRxQueueSize());
+  msg_transport_->EnableCoalescing(local_info_->GetTxCoalescingDelay(),
+                                   local_info_->GetTxCoalescingBytes());
+
+  auto tcp = std::dynamic_pointer_cast<network::TcpTransport>(transport_);
+  auto zerocopy_threshold = local_info_->GetTxZeroCopyThreshold();
+  if (tcp && zerocopy_threshold != std::numeric_limits<std::size_t>::max()) {
+    network::MessageTransportWeakPtr weak_msg_transport = msg_transport_;
+    if (tcp->EnableZeroCopy(zerocopy_threshold, [weak_msg_transport](auto n) {
+          if (auto msg_transport = weak_msg_transport.lock()) {
+            msg_transport->ReleaseSentBytes(n);
+          }
+        })) {
+      msg_transport_->DeferReleaseOfSentBytes();
+    }
+  }
+
   msg_transport_->Start();
 
-  RestartHeartbeatTimer();
-  StartReceive(utils::MakeSharedByteVector());
-  session_running_ = true;
+  slow_consumer_handler_ = slow_consumer_handler;
+  auto weak_self = MakeWeakPtr();
+  msg_transport_->AttachBroadcastLog(
+      broadcast_log,
+      [weak_self](auto backlog) {
+        if (auto self = weak_self.lock()) {
+          self->OnBroadcastsLagging(backlog);
+        }
+      },
+      [weak_self] {
+        auto self = weak_self.lock();
+        if (!self) return;
+
+        self->transport_->Post([weak_self] {
+          if (auto self = weak_self.lock()) {
+            self->OnBroadcastsOverrun();
+          }
+        });
+      });
+
+  if (tcp && context_->BusyPollEnabled()) {
+    tcp->EnableBusyPoll(kSocketBusyPollBudget);
+  }
+
   session_handler_ = session_handler;
   rcv_handler_ = rcv_handler;
+  session_running_ = true;
+  StartHeartbeatTimer(std::chrono::steady_clock::now() +
+                      GetHeartbeatInterval());
+  StartReceive();
 }
 
 void BranchConnection::OnInfoSent(CompletionHandler handler) {
@@ -290,47 +344,116 @@ void BranchConnection::OnSolutionAckReceived(const api::Result& res,
   }
 }
 
-void BranchConnection::RestartHeartbeatTimer() {
+std::chrono::nanoseconds BranchConnection::GetHeartbeatInterval() const {
   YOGI_ASSERT((remote_info_->GetTimeout() / 2).count() > 0);
-  heartbeat_timer_.expires_from_now(remote_info_->GetTimeout() / 2);
+  return remote_info_->GetTimeout() / 2;
+}
 
+void BranchConnection::StartHeartbeatTimer(
+    TimerWheel::Clock::time_point deadline) {
+  // The timer wheel calls the handler from an arbitrary thread; running it
+  // through the strand serializes it with OnSessionError()
   auto weak_self = MakeWeakPtr();
-  heartbeat_timer_.async_wait([weak_self](auto& ec) {
-    if (ec == boost::asio::error::operation_aborted) return;
-
-    auto self = weak_self.lock();
-    if (!self) return;
+  heartbeat_timer_id_ =
+      context_->GetTimerWheel().Schedule(deadline, [weak_self] {
+        auto self = weak_self.lock();
+        if (!self) return;
 
-    self->OnHeartbeatTimerExpired();
-  });
+        self->transport_->Post([weak_self] {
+          if (auto self = weak_self.lock()) {
+            self->OnHeartbeatTimerExpired();
+          }
+        });
+      });
 }
 
 void BranchConnection::OnHeartbeatTimerExpired() {
-  TrySend(heartbeat_msg_);
-  RestartHeartbeatTimer();
+  if (!session_running_) return;
+
+  // Any data written to the transport proves that we are alive, so only send
+  // a heartbeat if the connection has been idle for a whole interval
+  auto now = std::chrono::steady_clock::now();
+  auto deadline = msg_transport_->GetLastSendTime() + GetHeartbeatInterval();
+  if (now >= deadline) {
+    TrySend(heartbeat_msg_);
+    deadline = now + GetHeartbeatInterval();
+  }
+
+  StartHeartbeatTimer(deadline);
+}
+
+void BranchConnection::OnBroadcastsLagging(std::size_t backlog) {
+  if (local_info_->GetTxSlowConsumerPolicy() !=
+      network::SlowConsumerPolicy::kDisconnect) {
+    slow_consumer_handler_(backlog);
+    return;
+  }
+
+  // Give the peer some time to catch up before closing the connection
+  if (slow_consumer_check_pending_.exchange(true)) return;
+
+  // Same as for the heartbeat: the strand serializes the handler with
+  // OnSessionError()
+  auto weak_self = MakeWeakPtr();
+  context_->GetTimerWheel().ScheduleAfter(
+      local_info_->GetTxSlowConsumerTimeout(), [weak_self] {
+        auto self = weak_self.lock();
+        if (!self) return;
+
+        self->transport_->Post([weak_self] {
+          if (auto self = weak_self.lock()) {
+            self->OnSlowConsumerTimerExpired();
+          }
+        });
+      });
+}
+
+void BranchConnection::OnSlowConsumerTimerExpired() {
+  slow_consumer_check_pending_ = false;
+  if (!session_running_) return;
+
+  // The backlog is 0 if the session has been terminated in the meantime
+  auto backlog = msg_transport_->GetBroadcastBacklog();
+  if (backlog <= local_info_->GetTxSlowConsumerThreshold()) return;
+
+  slow_consumer_handler_(backlog);
+
+  // Fails the pending receive operation which terminates the session
+  slow_consumer_disconnected_ = true;
+  msg_transport_->Close();
+}
+
+void BranchConnection::OnBroadcastsOverrun() {
+  if (!session_running_) return;
+
+  // The broadcasts that the peer fell behind on are lost
+  slow_consumer_disconnected_ = true;
+  msg_transport_->Close();
 }
 
-void BranchConnection::StartReceive(utils::SharedByteVector buffer) {
-  auto weak_self = std::weak_ptr<BranchConnection>(shared_from_this());
-  buffer->resize(api::kMinRxQueueSize);  // This will fit an entire message
-  msg_transport_->ReceiveAsync(boost::asio::buffer(*buffer),
-                               [=](auto& res, auto msg_size) {
-                                 auto self = weak_self.lock();
-                                 if (!self) return;
-
-                                 if (res.IsError()) {
-                                   self->OnSessionError(res.ToError());
-                                 } else {
-                                   buffer->resize(msg_size);
-                                   self->OnMessageReceived(buffer);
-                                   self->StartReceive(buffer);
-                                 }
-                               });
+void BranchConnection::StartReceive() {
+  auto weak_self = MakeWeakPtr();
+  msg_transport_->ReceiveLeaseAsync([=](auto& res, auto msg) {
+    auto self = weak_self.lock();
+    if (!self) return;
+
+    if (res.IsError()) {
+      self->OnSessionError(res.ToError());
+    } else {
+      self->OnMessageReceived(msg);
+    }
+  });
 }
 
 void BranchConnection::OnSessionError(const api::Error& err) {
-  heartbeat_timer_.cancel();
-  session_handler_(err);
+  session_running_ = false;
+  context_->GetTimerWheel().Cancel(heartbeat_timer_id_);
+
+  if (slow_consumer_disconnected_) {
+    session_handler_(api::Error(YOGI_ERR_TX_QUEUE_FULL));
+  } else {
+    session_handler_(err);
+  }
 }
 
 void BranchConnection::CheckAckAndSetNextResult(
@@ -346,7 +469,7 @@ void BranchConnection::CheckAckAndSetNextResult(
 bool BranchConnection::CheckNextResult(CompletionHandler handler) {
   if (next_result_.IsError()) {
     auto res = next_result_;
-    context_->Post([=] { handler(res); });
+    transport_->Post([=] { handler(res); });
 
     return false;
   }
@@ -354,8 +477,69 @@ bool BranchConnection::CheckNextResult(CompletionHandler handler) {
   return true;
 }
 
-void BranchConnection::OnMessageReceived(const utils::SharedByteVector& msg) {
-  network::IncomingMessage::Deserialize(*msg, rcv_handler_);
+void BranchConnection::OnMessageReceived(boost::asio::const_buffer msg) {
+  // Handle all messages that have already been received completely in one go
+  // instead of going through the context for each one of them
+  while (DispatchReceivedMessage(msg)) {
+    msg_transport_->ReleaseLeasedReceive();
+    if (!msg_transport_->TryReceiveLease(&msg)) {
+      StartReceive();
+      return;
+    }
+  }
+}
+
+bool BranchConnection::DispatchReceivedMessage(boost::asio::const_buffer msg) {
+  {
+    std::lock_guard<std::mutex> lock(rx_lease_mutex_);
+    rx_lease_dispatching_ = true;
+    rx_lease_released_ = false;
+  }
+
+  // The lease keeps the message transport, and thus the memory of the
+  // message, alive even if the connection gets destroyed in the meantime
+  auto weak_self = MakeWeakPtr();
+  auto msg_transport = msg_transport_;
+  rx_lease_ = ReceiveLease(msg.data(), [weak_self, msg_transport](auto) {
+    if (auto self = weak_self.lock()) {
+      self->OnReceiveLeaseReleased();
+    }
+  });
+
+  network::IncomingMessage::Deserialize(msg, rcv_handler_);
+  rx_lease_.reset();
+
+  std::lock_guard<std::mutex> lock(rx_lease_mutex_);
+  rx_lease_dispatching_ = false;
+  return rx_lease_released_;
+}
+
+void BranchConnection::OnReceiveLeaseReleased() {
+  {
+    std::lock_guard<std::mutex> lock(rx_lease_mutex_);
+    if (rx_lease_dispatching_) {
+      rx_lease_released_ = true;
+      return;
+    }
+  }
+
+  auto weak_self = MakeWeakPtr();
+  transport_->Post([=] {
+    if (auto self = weak_self.lock()) {
+      self->ResumeReceive();
+    }
+  });
+}
+
+void BranchConnection::ResumeReceive() {
+  msg_transport_->ReleaseLeasedReceive();
+
+  boost::asio::const_buffer msg;
+  if (msg_transport_->TryReceiveLease(&msg)) {
+    OnMessageReceived(msg);
+  } else {
+    StartReceive();
+  }
 }
 
 const LoggerPtr BranchConnection::logger_ =
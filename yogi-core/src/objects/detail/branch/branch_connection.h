@@ -27,6 +27,7 @@
 #include <functional>
 #include <memory>
 #include <atomic>
+#include <mutex>
 #include <fstream>
 
 namespace objects {
@@ -38,10 +39,15 @@ typedef std::weak_ptr<BranchConnection> BranchConnectionWeakPtr;
 
 class BranchConnection : public std::enable_shared_from_this<BranchConnection> {
  public:
-  typedef std::function<void(const api::Result&)> CompletionHandler;
+  typedef utils::SmallFunction<void(const api::Result&)> CompletionHandler;
   using MessageReceiveHandler =  network::IncomingMessage::MessageHandler;
   using OperationTag = network::MessageTransport::OperationTag;
   using SendHandler = network::MessageTransport::SendHandler;
+  typedef utils::SmallFunction<void(std::size_t backlog)> SlowConsumerHandler;
+
+  // Keeps the message that is currently being received in the RX queue;
+  // receiving further messages is paused until all copies are destroyed.
+  typedef std::shared_ptr<const void> ReceiveLease;
 
   BranchConnection(network::TransportPtr transport,
                    const boost::asio::ip::address& peer_address,
@@ -62,8 +68,12 @@ class BranchConnection : public std::enable_shared_from_this<BranchConnection> {
   void ExchangeBranchInfo(CompletionHandler handler);
   void Authenticate(utils::SharedByteVector password_hash,
                     CompletionHandler handler);
-  void RunSession(MessageReceiveHandler rcv_handler,
-                  CompletionHandler session_handler);
+  // The slow consumer handler gets called whenever the peer gets penalized
+  // for falling behind on broadcasts
+  void RunSession(network::BroadcastLogPtr broadcast_log,
+                  MessageReceiveHandler rcv_handler,
+                  CompletionHandler session_handler,
+                  SlowConsumerHandler slow_consumer_handler);
 
   bool TrySend(const network::OutgoingMessage& msg) {
     return msg_transport_->TrySend(msg);
@@ -80,6 +90,9 @@ class BranchConnection : public std::enable_shared_from_this<BranchConnection> {
 
   bool CancelSend(OperationTag tag) { return msg_transport_->CancelSend(tag); }
 
+  // Only valid while a received message is being handled
+  const ReceiveLease& GetReceiveLease() const { return rx_lease_; }
+
  private:
   BranchConnectionWeakPtr MakeWeakPtr() { return {shared_from_this()}; }
   void OnInfoSent(CompletionHandler handler);
@@ -110,14 +123,21 @@ class BranchConnection : public std::enable_shared_from_this<BranchConnection> {
   void OnSolutionAckReceived(const api::Result& res, bool solutions_match,
                              utils::SharedByteVector ack_msg,
                              CompletionHandler handler);
-  void RestartHeartbeatTimer();
+  std::chrono::nanoseconds GetHeartbeatInterval() const;
+  void StartHeartbeatTimer(TimerWheel::Clock::time_point deadline);
   void OnHeartbeatTimerExpired();
-  void StartReceive(utils::SharedByteVector buffer);
+  void OnBroadcastsLagging(std::size_t backlog);
+  void OnSlowConsumerTimerExpired();
+  void OnBroadcastsOverrun();
+  void StartReceive();
   void OnSessionError(const api::Error& err);
   void CheckAckAndSetNextResult(const api::Result& res,
                                 const utils::ByteVector& ack_msg);
   bool CheckNextResult(CompletionHandler handler);
-  void OnMessageReceived(const utils::SharedByteVector& msg);
+  void OnMessageReceived(boost::asio::const_buffer msg);
+  bool DispatchReceivedMessage(boost::asio::const_buffer msg);
+  void OnReceiveLeaseReleased();
+  void ResumeReceive();
 
   static const LoggerPtr logger_;
 
@@ -133,7 +153,14 @@ class BranchConnection : public std::enable_shared_from_this<BranchConnection> {
   std::atomic<bool> session_running_;
   CompletionHandler session_handler_;
   MessageReceiveHandler rcv_handler_;
-  boost::asio::steady_timer heartbeat_timer_;
+  SlowConsumerHandler slow_consumer_handler_;
+  ReceiveLease rx_lease_;
+  std::mutex rx_lease_mutex_;
+  bool rx_lease_dispatching_;
+  bool rx_lease_released_;
+  TimerWheel::TimerId heartbeat_timer_id_;  // Used on the strand once running
+  std::atomic<bool> slow_consumer_check_pending_;
+  std::atomic<bool> slow_consumer_disconnected_;
   api::Result next_result_;
 };
 
@@ -19,6 +19,7 @@
 #include "../../../api/constants.h"
 #include "../../../network/ip.h"
 #include "../../../network/serialize.h"
+#include "../../../network/unix_transport.h"
 #include "../../../utils/system.h"
 
 #include <boost/uuid/uuid_io.hpp>
@@ -63,9 +64,14 @@ void BranchInfo::PopulateJson() {
       {"timeout", timeout},
       {"advertising_interval", adv_interval},
       {"ghost_mode", ghost_mode_},
+      {"unix_socket_name", unix_socket_name_},
   };
 }
 
+std::string BranchInfo::MakeUnixSocketName(const boost::uuids::uuid& uuid) {
+  return "yogi-" + boost::uuids::to_string(uuid);
+}
+
 LocalBranchInfo::LocalBranchInfo(
     std::string name, std::string description, std::string net_name,
     std::string path, const std::vector<utils::NetworkInterfaceInfo>& adv_ifs,
@@ -74,7 +80,14 @@ LocalBranchInfo::LocalBranchInfo(
     const std::chrono::nanoseconds& timeout,
     const std::chrono::nanoseconds& adv_interval, bool ghost_mode,
     std::size_t tx_queue_size, std::size_t rx_queue_size,
-    std::size_t transceive_byte_limit) {
+    std::size_t transceive_byte_limit,
+    const std::chrono::nanoseconds& tx_coalescing_delay,
+    std::size_t tx_coalescing_bytes, std::size_t tx_zerocopy_threshold,
+    std::size_t tx_fanout_partitions, std::size_t rx_broadcast_queue_depth,
+    network::SlowConsumerPolicy tx_slow_consumer_policy,
+    std::size_t tx_slow_consumer_threshold,
+    const std::chrono::nanoseconds& tx_slow_consumer_timeout,
+    std::size_t tx_overflow_budget) {
   uuid_ = boost::uuids::random_generator()();
   name_ = name;
   description_ = description;
@@ -92,6 +105,18 @@ LocalBranchInfo::LocalBranchInfo(
   tx_queue_size_ = tx_queue_size;
   rx_queue_size_ = rx_queue_size;
   transceive_byte_limit_ = transceive_byte_limit;
+  tx_coalescing_delay_ = tx_coalescing_delay;
+  tx_coalescing_bytes_ = tx_coalescing_bytes;
+  tx_zerocopy_threshold_ = tx_zerocopy_threshold;
+  tx_fanout_partitions_ = tx_fanout_partitions;
+  rx_broadcast_queue_depth_ = rx_broadcast_queue_depth;
+  tx_slow_consumer_policy_ = tx_slow_consumer_policy;
+  tx_slow_consumer_threshold_ = tx_slow_consumer_threshold;
+  tx_slow_consumer_timeout_ = tx_slow_consumer_timeout;
+  tx_overflow_budget_ = tx_overflow_budget;
+#ifdef YOGI_HAS_UNIX_TRANSPORT
+  unix_socket_name_ = MakeUnixSocketName(uuid_);
+#endif
 
   PopulateMessages();
   PopulateJson();
@@ -122,6 +147,9 @@ void LocalBranchInfo::PopulateMessages() {
   network::Serialize(&buffer, adv_interval_);
   network::Serialize(&buffer, ghost_mode_);
 
+  // Optional trailer; peers that do not know about it ignore it
+  network::Serialize(&buffer, unix_socket_name_);
+
   network::Serialize(&*info_msg_, buffer.size());
   YOGI_ASSERT(info_msg_->size() == kInfoMessageHeaderSize);
   info_msg_->insert(info_msg_->end(), buffer.begin(), buffer.end());
@@ -173,6 +201,11 @@ RemoteBranchInfo::RemoteBranchInfo(const utils::ByteVector& info_msg,
   DeserializeField(&adv_interval_, info_msg, &it);
   DeserializeField(&ghost_mode_, info_msg, &it);
 
+  // Peers without Unix domain socket support do not send the trailer
+  if (it != info_msg.cend()) {
+    DeserializeField(&unix_socket_name_, info_msg, &it);
+  }
+
   PopulateJson();
 }
 
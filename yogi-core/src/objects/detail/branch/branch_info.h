@@ -22,6 +22,7 @@
 #include "../../../utils/timestamp.h"
 #include "../../../utils/types.h"
 #include "../../../utils/system.h"
+#include "../../../network/broadcast_log.h"
 
 #include <nlohmann/json.hpp>
 #include <boost/uuid/uuid.hpp>
@@ -65,6 +66,11 @@ class BranchInfo {
 
   bool GetGhostMode() const { return ghost_mode_; }
 
+  // Name of the abstract Unix domain socket for connections from the same
+  // host; empty if not supported by the platform
+  const std::string& GetUnixSocketName() const { return unix_socket_name_; }
+  static std::string MakeUnixSocketName(const boost::uuids::uuid& uuid);
+
   const nlohmann::json& ToJson() const { return json_; }
 
  protected:
@@ -82,6 +88,7 @@ class BranchInfo {
   std::chrono::nanoseconds timeout_;
   std::chrono::nanoseconds adv_interval_;
   bool ghost_mode_;
+  std::string unix_socket_name_;
   nlohmann::json json_;
 };
 
@@ -100,7 +107,16 @@ class LocalBranchInfo : public BranchInfo {
                   const std::chrono::nanoseconds& timeout,
                   const std::chrono::nanoseconds& adv_interval, bool ghost_mode,
                   std::size_t tx_queue_size, std::size_t rx_queue_size,
-                  std::size_t transceive_byte_limit);
+                  std::size_t transceive_byte_limit,
+                  const std::chrono::nanoseconds& tx_coalescing_delay,
+                  std::size_t tx_coalescing_bytes,
+                  std::size_t tx_zerocopy_threshold,
+                  std::size_t tx_fanout_partitions,
+                  std::size_t rx_broadcast_queue_depth,
+                  network::SlowConsumerPolicy tx_slow_consumer_policy,
+                  std::size_t tx_slow_consumer_threshold,
+                  const std::chrono::nanoseconds& tx_slow_consumer_timeout,
+                  std::size_t tx_overflow_budget);
 
   const std::vector<utils::NetworkInterfaceInfo>& GetAdvertisingInterfaces()
       const {
@@ -115,6 +131,36 @@ class LocalBranchInfo : public BranchInfo {
   std::size_t GetRxQueueSize() const { return rx_queue_size_; }
   std::size_t GetTransceiveByteLimit() const { return transceive_byte_limit_; }
 
+  const std::chrono::nanoseconds& GetTxCoalescingDelay() const {
+    return tx_coalescing_delay_;
+  }
+
+  std::size_t GetTxCoalescingBytes() const { return tx_coalescing_bytes_; }
+
+  std::size_t GetTxZeroCopyThreshold() const {
+    return tx_zerocopy_threshold_;
+  }
+
+  std::size_t GetTxFanoutPartitions() const { return tx_fanout_partitions_; }
+
+  std::size_t GetRxBroadcastQueueDepth() const {
+    return rx_broadcast_queue_depth_;
+  }
+
+  network::SlowConsumerPolicy GetTxSlowConsumerPolicy() const {
+    return tx_slow_consumer_policy_;
+  }
+
+  std::size_t GetTxSlowConsumerThreshold() const {
+    return tx_slow_consumer_threshold_;
+  }
+
+  const std::chrono::nanoseconds& GetTxSlowConsumerTimeout() const {
+    return tx_slow_consumer_timeout_;
+  }
+
+  std::size_t GetTxOverflowBudget() const { return tx_overflow_budget_; }
+
   utils::SharedByteVector MakeAdvertisingMessage() const {
     YOGI_ASSERT(adv_msg_);
     return adv_msg_;
@@ -134,6 +180,15 @@ class LocalBranchInfo : public BranchInfo {
   std::size_t tx_queue_size_;
   std::size_t rx_queue_size_;
   std::size_t transceive_byte_limit_;
+  std::chrono::nanoseconds tx_coalescing_delay_;
+  std::size_t tx_coalescing_bytes_;
+  std::size_t tx_zerocopy_threshold_;
+  std::size_t tx_fanout_partitions_;
+  std::size_t rx_broadcast_queue_depth_;
+  network::SlowConsumerPolicy tx_slow_consumer_policy_;
+  std::size_t tx_slow_consumer_threshold_;
+  std::chrono::nanoseconds tx_slow_consumer_timeout_;
+  std::size_t tx_overflow_budget_;
   utils::SharedByteVector adv_msg_;
   utils::SharedByteVector info_msg_;
 };
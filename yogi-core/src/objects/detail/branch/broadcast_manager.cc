@@ -16,14 +16,25 @@
  */
 
 #include "broadcast_manager.h"
-#include "../../../utils/algorithm.h"
+
+#include <boost/uuid/uuid_io.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 
 namespace objects {
 namespace detail {
 
+constexpr std::size_t BroadcastManager::kBatchRecordHeaderSize;
+
 BroadcastManager::BroadcastManager(ContextPtr context,
-                                   ConnectionManager& conn_manager)
-    : context_(context), conn_manager_(conn_manager) {}
+                                   ConnectionManager& conn_manager,
+                                   std::size_t rx_queue_depth)
+    : context_(context),
+      conn_manager_(conn_manager),
+      rx_queue_depth_(rx_queue_depth),
+      rx_queue_overflowed_(false),
+      rx_next_slot_(0) {}
 
 BroadcastManager::~BroadcastManager() {}
 
@@ -47,47 +58,30 @@ BroadcastManager::SendBroadcastOperationId BroadcastManager::SendBroadcastAsync(
   network::messages::BroadcastOutgoing msg(payload);
 
   auto oid = conn_manager_.MakeOperationId();
+  auto& log = conn_manager_.GetBroadcastLog();
 
+  // The message gets serialized into the log shared by all sessions once
+  // instead of into each session's TX queue
   if (retry) {
-    std::shared_ptr<int> pending_handlers;
-
-    std::lock_guard<std::mutex> lock(tx_oids_mutex_);
-    conn_manager_.ForeachRunningSession([&](auto& conn) {
-      this->SendNowOrLater(&pending_handlers, &msg, conn, handler, oid);
-    });
-
-    StoreOidForLaterOrCallHandlerNow(pending_handlers, handler, oid);
-  } else {
-    bool all_sent = true;
-    conn_manager_.ForeachRunningSession([&](auto& conn) {
-      if (!conn->TrySend(msg)) {
-        all_sent = false;
-      }
+    auto context = context_;
+    bool appended = log->AppendOrQueue(msg, oid, [=](auto& res) {
+      context->Post([=] { handler(res, oid); });
     });
 
-    if (all_sent) {
+    if (appended) {
       context_->Post([=] { handler(api::kSuccess, oid); });
-    } else {
-      context_->Post([=] { handler(api::Error(YOGI_ERR_TX_QUEUE_FULL), oid); });
     }
+  } else if (log->TryAppend(msg)) {
+    context_->Post([=] { handler(api::kSuccess, oid); });
+  } else {
+    context_->Post([=] { handler(api::Error(YOGI_ERR_TX_QUEUE_FULL), oid); });
   }
 
   return oid;
 }
 
 bool BroadcastManager::CancelSendBroadcast(SendBroadcastOperationId oid) {
-  {
-    std::lock_guard<std::mutex> lock(tx_oids_mutex_);
-    auto it = utils::find(tx_active_oids_, oid);
-    if (it == tx_active_oids_.end()) return false;
-    tx_active_oids_.erase(it);
-  }
-
-  bool canceled = false;
-  conn_manager_.ForeachRunningSession(
-      [&](auto& conn) { canceled |= conn->CancelSend(oid); });
-
-  return canceled;
+  return conn_manager_.GetBroadcastLog()->CancelQueued(oid);
 }
 
 void BroadcastManager::ReceiveBroadcast(api::Encoding enc,
@@ -96,10 +90,17 @@ void BroadcastManager::ReceiveBroadcast(api::Encoding enc,
   YOGI_ASSERT(handler);
 
   std::lock_guard<std::recursive_mutex> lock(rx_mutex_);
+  CancelPendingReceive();
 
-  if (rx_handler_) {
-    auto old_handler = rx_handler_;
-    context_->Post([=] { old_handler(api::Error(YOGI_ERR_CANCELED), {}, 0); });
+  if (!rx_queue_.empty()) {
+    auto entry = rx_queue_.front();
+    rx_queue_.pop_front();
+
+    std::size_t n = 0;
+    auto payload = network::Payload(entry.payload, api::Encoding::kMsgPack);
+    auto res = payload.SerializeToUserBuffer(data, enc, &n);
+    context_->Post([=] { handler(res, entry.src_uuid, n); });
+    return;
   }
 
   rx_enc_ = enc;
@@ -107,13 +108,52 @@ void BroadcastManager::ReceiveBroadcast(api::Encoding enc,
   rx_handler_ = handler;
 }
 
+void BroadcastManager::ReceiveBroadcastLease(
+    ReceiveBroadcastLeaseHandler handler) {
+  YOGI_ASSERT(handler);
+
+  std::lock_guard<std::recursive_mutex> lock(rx_mutex_);
+  CancelPendingReceive();
+
+  if (!rx_queue_.empty()) {
+    // The queue entry's memory itself serves as the lease
+    auto entry = rx_queue_.front();
+    rx_queue_.pop_front();
+    context_->Post([=] {
+      handler(api::kSuccess, entry.src_uuid, entry.payload, entry.memory);
+    });
+    return;
+  }
+
+  rx_lease_handler_ = handler;
+}
+
+void BroadcastManager::ReceiveBroadcasts(api::Encoding enc,
+                                         boost::asio::mutable_buffer data,
+                                         ReceiveBroadcastsHandler handler) {
+  YOGI_ASSERT(handler);
+
+  std::lock_guard<std::recursive_mutex> lock(rx_mutex_);
+  CancelPendingReceive();
+
+  if (!rx_queue_.empty()) {
+    std::size_t count = 0;
+    std::size_t size = 0;
+    auto res = WriteQueuedBroadcasts(enc, data, &count, &size);
+    context_->Post([=] { handler(res, count, size); });
+    return;
+  }
+
+  rx_enc_ = enc;
+  rx_data_ = data;
+  rx_batch_handler_ = handler;
+}
+
 bool BroadcastManager::CancelReceiveBroadcast() {
   std::lock_guard<std::recursive_mutex> lock(rx_mutex_);
 
-  if (rx_handler_) {
-    auto handler = rx_handler_;
-    rx_handler_ = {};
-    context_->Post([=] { handler(api::Error(YOGI_ERR_CANCELED), {}, 0); });
+  if (rx_handler_ || rx_lease_handler_ || rx_batch_handler_) {
+    CancelPendingReceive();
     return true;
   }
 
@@ -124,86 +164,161 @@ void BroadcastManager::OnBroadcastReceived(
     const network::messages::BroadcastIncoming& msg,
     const detail::BranchConnectionPtr& conn) {
   std::lock_guard<std::recursive_mutex> lock(rx_mutex_);
+  auto& src_uuid = conn->GetRemoteBranchInfo()->GetUuid();
 
   if (rx_handler_) {
     auto handler = rx_handler_;
     rx_handler_ = {};
     std::size_t n = 0;
     auto res = msg.GetPayload().SerializeToUserBuffer(rx_data_, rx_enc_, &n);
-    handler(res, conn->GetRemoteBranchInfo()->GetUuid(), n);
+    handler(res, src_uuid, n);
+  } else if (rx_lease_handler_) {
+    auto handler = rx_lease_handler_;
+    rx_lease_handler_ = {};
+    handler(api::kSuccess, src_uuid, msg.GetPayload().GetData(),
+            conn->GetReceiveLease());
+  } else if (rx_batch_handler_) {
+    auto handler = rx_batch_handler_;
+    rx_batch_handler_ = {};
+    std::size_t n = 0;
+    auto res =
+        WriteBatchRecord(msg.GetPayload(), src_uuid, rx_enc_, rx_data_, &n);
+    handler(res, res.IsSuccess() ? 1u : 0u, n);
+  } else if (rx_queue_depth_ > 0) {
+    QueueBroadcast(msg.GetPayload(), src_uuid);
   }
 }
 
-void BroadcastManager::SendNowOrLater(SharedCounter* pending_handlers,
-                                      network::OutgoingMessage* msg,
-                                      BranchConnectionPtr conn,
-                                      SendBroadcastHandler handler,
-                                      SendBroadcastOperationId oid) {
-  try {
-    if (!conn->TrySend(*msg)) {
-      CreateAndIncrementCounter(pending_handlers);
-
-      try {
-        auto& pending_handlers_ref = *pending_handlers;
-        auto weak_self = std::weak_ptr<BroadcastManager>{shared_from_this()};
-        conn->SendAsync(msg, oid, [=](auto&) {
-          bool success = false;
-
-          {
-            std::lock_guard<std::mutex> lock(tx_oids_mutex_);
-
-            YOGI_ASSERT(pending_handlers_ref);
-            bool is_last_handler = --*pending_handlers_ref == 0;
-            if (!is_last_handler) return;
-
-            if (auto self = weak_self.lock()) {
-              success = self->RemoveActiveOid(oid);
-            }
-          }
-
-          if (success) {
-            handler(api::kSuccess, oid);
-          } else {
-            handler(api::Error(YOGI_ERR_CANCELED), oid);
-          }
-        });
-      } catch (...) {
-        --**pending_handlers;
-        throw;
-      }
+void BroadcastManager::QueueBroadcast(const network::Payload& payload,
+                                      const boost::uuids::uuid& src_uuid) {
+  if (rx_queue_.size() >= rx_queue_depth_) {
+    if (!rx_queue_overflowed_) {
+      YOGI_LOG_WARNING(logger_, "Receive queue is full; discarding broadcasts "
+                                "until it has been drained");
+      rx_queue_overflowed_ = true;
     }
-  } catch (const api::Error& err) {
-    YOGI_LOG_ERROR(logger_,
-                   "Could not send broadcast to " << conn << ": " << err);
+
+    YOGI_LOG_TRACE(logger_, "Discarded broadcast from " << src_uuid);
+    return;
+  }
+
+  rx_queue_overflowed_ = false;
+
+  // Received payloads are always MsgPack-encoded
+  auto data = payload.GetData();
+  auto bytes = static_cast<const utils::Byte*>(data.data());
+
+  RxSlotPtr slot;
+  if (data.size() <= sizeof(RxSlot::data)) {
+    slot = AcquireRxSlot();
   }
-}
 
-void BroadcastManager::StoreOidForLaterOrCallHandlerNow(
-    SharedCounter pending_handlers, SendBroadcastHandler handler,
-    SendBroadcastOperationId oid) {
-  if (pending_handlers) {
-    tx_active_oids_.push_back(oid);
+  if (slot) {
+    std::copy_n(bytes, data.size(), slot->data.begin());
+    rx_queue_.push_back(
+        {src_uuid, slot, boost::asio::buffer(slot->data.data(), data.size())});
   } else {
-    context_->Post([=] { handler(api::kSuccess, oid); });
+    auto vec = std::make_shared<const utils::ByteVector>(bytes,
+                                                         bytes + data.size());
+    rx_queue_.push_back({src_uuid, vec, boost::asio::buffer(*vec)});
   }
+
+  YOGI_LOG_TRACE(logger_, "Queued broadcast from " << src_uuid << " ("
+                                                   << rx_queue_.size()
+                                                   << " queued)");
 }
 
-void BroadcastManager::CreateAndIncrementCounter(SharedCounter* counter) {
-  if (*counter) {
-    ++**counter;
-  } else {
-    *counter = std::make_shared<int>(1);
+BroadcastManager::RxSlotPtr BroadcastManager::AcquireRxSlot() {
+  // Slots only referenced by the pool are neither queued nor leased; they
+  // are mostly freed up in the order they got acquired
+  for (std::size_t i = 0; i < rx_slots_.size(); ++i) {
+    auto idx = (rx_next_slot_ + i) % rx_slots_.size();
+    if (rx_slots_[idx].use_count() == 1) {
+      rx_next_slot_ = idx + 1;
+      return rx_slots_[idx];
+    }
   }
+
+  // All slots are in use, e.g. by leases that have not been released yet
+  if (rx_slots_.size() >= rx_queue_depth_) return {};
+
+  rx_slots_.push_back(std::make_shared<RxSlot>());
+  rx_next_slot_ = 0;
+  return rx_slots_.back();
 }
 
-bool BroadcastManager::RemoveActiveOid(SendBroadcastOperationId oid) {
-  auto it = utils::find(tx_active_oids_, oid);
-  if (it != tx_active_oids_.end()) {
-    tx_active_oids_.erase(it);
-    return true;
+api::Result BroadcastManager::WriteQueuedBroadcasts(
+    api::Encoding enc, boost::asio::mutable_buffer data, std::size_t* count,
+    std::size_t* size) {
+  api::Result res = api::kSuccess;
+  while (!rx_queue_.empty()) {
+    auto& entry = rx_queue_.front();
+    auto payload = network::Payload(entry.payload, api::Encoding::kMsgPack);
+
+    std::size_t n = 0;
+    auto rec_res =
+        WriteBatchRecord(payload, entry.src_uuid, enc, data + *size, &n);
+    if (rec_res.IsError()) {
+      // A message that does not even fit into the empty buffer gets
+      // discarded; otherwise it is left for the next receive operation
+      if (*count == 0) {
+        res = rec_res;
+        rx_queue_.pop_front();
+      }
+
+      break;
+    }
+
+    *size += n;
+    ++*count;
+    rx_queue_.pop_front();
   }
 
-  return false;
+  return res;
+}
+
+void BroadcastManager::CancelPendingReceive() {
+  if (rx_handler_) {
+    auto handler = rx_handler_;
+    rx_handler_ = {};
+    context_->Post([=] { handler(api::Error(YOGI_ERR_CANCELED), {}, 0); });
+  }
+
+  if (rx_lease_handler_) {
+    auto handler = rx_lease_handler_;
+    rx_lease_handler_ = {};
+    context_->Post(
+        [=] { handler(api::Error(YOGI_ERR_CANCELED), {}, {}, {}); });
+  }
+
+  if (rx_batch_handler_) {
+    auto handler = rx_batch_handler_;
+    rx_batch_handler_ = {};
+    context_->Post([=] { handler(api::Error(YOGI_ERR_CANCELED), 0, 0); });
+  }
+}
+
+api::Result BroadcastManager::WriteBatchRecord(
+    const network::Payload& payload, const boost::uuids::uuid& src_uuid,
+    api::Encoding enc, boost::asio::mutable_buffer data,
+    std::size_t* bytes_written) {
+  *bytes_written = 0;
+  if (data.size() <= kBatchRecordHeaderSize) {
+    return api::Error(YOGI_ERR_BUFFER_TOO_SMALL);
+  }
+
+  std::size_t n = 0;
+  auto res = payload.SerializeToUserBuffer(data + kBatchRecordHeaderSize, enc,
+                                           &n);
+  if (res.IsError()) return res;
+
+  auto header = static_cast<char*>(data.data());
+  auto size_field = static_cast<std::uint32_t>(n);
+  std::memcpy(header, src_uuid.data, 16);
+  std::memcpy(header + 16, &size_field, sizeof(size_field));
+
+  *bytes_written = kBatchRecordHeaderSize + n;
+  return api::kSuccess;
 }
 
 const LoggerPtr BroadcastManager::logger_ =
@@ -18,12 +18,15 @@
 #pragma once
 
 #include "../../../config.h"
+#include "../../../api/constants.h"
 #include "../../../network/messages.h"
 #include "../../context.h"
 #include "../../logger.h"
 #include "connection_manager.h"
 
 #include <boost/asio/buffer.hpp>
+#include <array>
+#include <deque>
 #include <vector>
 #include <mutex>
 
@@ -34,15 +37,27 @@ class BroadcastManager final
     : public std::enable_shared_from_this<BroadcastManager> {
  public:
   typedef network::MessageTransport::OperationTag SendBroadcastOperationId;
-  typedef std::function<void(const api::Result& res,
-                             SendBroadcastOperationId oid)>
+  typedef utils::SmallFunction<void(const api::Result& res,
+                                    SendBroadcastOperationId oid)>
       SendBroadcastHandler;
-  typedef std::function<void(const api::Result& res,
-                             const boost::uuids::uuid& src_uuid,
-                             std::size_t size)>
+  typedef utils::SmallFunction<void(const api::Result& res,
+                                    const boost::uuids::uuid& src_uuid,
+                                    std::size_t size)>
       ReceiveBroadcastHandler;
-
-  BroadcastManager(ContextPtr context, ConnectionManager& conn_manager);
+  typedef utils::SmallFunction<void(const api::Result& res,
+                                    const boost::uuids::uuid& src_uuid,
+                                    boost::asio::const_buffer data,
+                                    BranchConnection::ReceiveLease lease)>
+      ReceiveBroadcastLeaseHandler;
+  typedef utils::SmallFunction<void(const api::Result& res, std::size_t count,
+                                    std::size_t size)>
+      ReceiveBroadcastsHandler;
+
+  // Size of the header preceding each message written by ReceiveBroadcasts()
+  static constexpr std::size_t kBatchRecordHeaderSize = 16 + 4;
+
+  BroadcastManager(ContextPtr context, ConnectionManager& conn_manager,
+                   std::size_t rx_queue_depth);
   virtual ~BroadcastManager();
 
   api::Result SendBroadcast(const network::Payload& payload, bool retry);
@@ -56,38 +71,64 @@ class BroadcastManager final
   void ReceiveBroadcast(api::Encoding enc, boost::asio::mutable_buffer data,
                         ReceiveBroadcastHandler handler);
 
+  void ReceiveBroadcastLease(ReceiveBroadcastLeaseHandler handler);
+
+  // Writes as many received messages as fit into data, each one preceded by
+  // the sending branch's UUID and the payload size (32 bit, host byte order)
+  void ReceiveBroadcasts(api::Encoding enc, boost::asio::mutable_buffer data,
+                         ReceiveBroadcastsHandler handler);
+
   bool CancelReceiveBroadcast();
 
   void OnBroadcastReceived(const network::messages::BroadcastIncoming& msg,
                            const detail::BranchConnectionPtr& conn);
 
  private:
-  typedef std::shared_ptr<int> SharedCounter;
-
-  void SendNowOrLater(SharedCounter* pending_handlers,
-                      network::OutgoingMessage* msg, BranchConnectionPtr conn,
-                      SendBroadcastHandler handler,
-                      SendBroadcastOperationId oid);
-
-  void StoreOidForLaterOrCallHandlerNow(SharedCounter pending_handlers,
-                                        SendBroadcastHandler handler,
-                                        SendBroadcastOperationId oid);
-
-  void CreateAndIncrementCounter(SharedCounter* counter);
-  bool RemoveActiveOid(SendBroadcastOperationId oid);
+  // Queued payloads get copied into fixed-size slots which get reused once
+  // the message has been received and its lease (if any) released
+  struct RxSlot {
+    std::array<utils::Byte, api::kMaxMessagePayloadSize> data;
+  };
+
+  typedef std::shared_ptr<RxSlot> RxSlotPtr;
+
+  struct QueuedBroadcast {
+    boost::uuids::uuid src_uuid;
+    std::shared_ptr<const void> memory;  // Slot or one-off allocation
+    boost::asio::const_buffer payload;   // MsgPack-encoded
+  };
+
+  void QueueBroadcast(const network::Payload& payload,
+                      const boost::uuids::uuid& src_uuid);
+  RxSlotPtr AcquireRxSlot();
+  api::Result WriteQueuedBroadcasts(api::Encoding enc,
+                                    boost::asio::mutable_buffer data,
+                                    std::size_t* count, std::size_t* size);
+  void CancelPendingReceive();
+
+  static api::Result WriteBatchRecord(const network::Payload& payload,
+                                      const boost::uuids::uuid& src_uuid,
+                                      api::Encoding enc,
+                                      boost::asio::mutable_buffer data,
+                                      std::size_t* bytes_written);
 
   static const LoggerPtr logger_;
 
   const ContextPtr context_;
   ConnectionManager& conn_manager_;
-  std::mutex tx_oids_mutex_;
-  std::vector<SendBroadcastOperationId> tx_active_oids_;
+  const std::size_t rx_queue_depth_;
   std::mutex tx_sync_mutex_;
   std::condition_variable tx_sync_cv_;
   std::recursive_mutex rx_mutex_;
   api::Encoding rx_enc_;
   boost::asio::mutable_buffer rx_data_;
   ReceiveBroadcastHandler rx_handler_;
+  ReceiveBroadcastLeaseHandler rx_lease_handler_;
+  ReceiveBroadcastsHandler rx_batch_handler_;
+  std::deque<QueuedBroadcast> rx_queue_;
+  bool rx_queue_overflowed_;
+  std::vector<RxSlotPtr> rx_slots_;  // At most rx_queue_depth_ slots
+  std::size_t rx_next_slot_;
 };
 
 typedef std::shared_ptr<BroadcastManager> BroadcastManagerPtr;
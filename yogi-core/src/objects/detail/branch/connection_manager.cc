@@ -16,6 +16,7 @@
  */
 
 #include "connection_manager.h"
+#include "../../../utils/algorithm.h"
 #include "../../../utils/crypto.h"
 #include "../../../network/ip.h"
 
@@ -23,6 +24,27 @@
 
 namespace objects {
 namespace detail {
+namespace {
+
+const char* SlowConsumerPolicyToString(network::SlowConsumerPolicy policy) {
+  switch (policy) {
+    case network::SlowConsumerPolicy::kBlock:
+      return "block";
+
+    case network::SlowConsumerPolicy::kDrop:
+      return "drop";
+
+    case network::SlowConsumerPolicy::kConflate:
+      return "conflate";
+
+    case network::SlowConsumerPolicy::kDisconnect:
+      return "disconnect";
+  }
+
+  return "";
+}
+
+}  // anonymous namespace
 
 ConnectionManager::ConnectionManager(
     ContextPtr context, const std::string& password,
@@ -33,6 +55,7 @@ ConnectionManager::ConnectionManager(
     : context_(context),
       adv_ifs_(utils::GetFilteredNetworkInterfaces(adv_if_strings,
                                                    adv_ep.protocol())),
+      all_ifs_(utils::GetNetworkInterfaces()),
       password_hash_(utils::MakeSharedByteVector(
           utils::MakeSha256({password.cbegin(), password.cend()}))),
       connection_changed_handler_(connection_changed_handler),
@@ -44,7 +67,12 @@ ConnectionManager::ConnectionManager(
             this->OnAdvertisementReceived(uuid, ep);
           })),
       acceptor_(context->IoContext()),
+#ifdef YOGI_HAS_UNIX_TRANSPORT
+      unix_acceptor_(context->IoContext()),
+#endif
+      running_sessions_(std::make_shared<const ConnectionsList>()),
       last_op_tag_(0),
+      next_shard_(0),
       observed_events_(api::kNoEvent) {
   if (adv_ep.port() == 0) {
     throw api::Error(YOGI_ERR_INVALID_PARAM);
@@ -58,7 +86,13 @@ ConnectionManager::~ConnectionManager() { CancelAwaitEvent(); }
 
 void ConnectionManager::Start(LocalBranchInfoPtr info) {
   info_ = info;
+  broadcast_log_ = std::make_shared<network::BroadcastLog>(
+      info->GetTxQueueSize(), info->GetTxFanoutPartitions(),
+      info->GetTxSlowConsumerPolicy(), info->GetTxSlowConsumerThreshold(),
+      info->GetTxOverflowBudget());
   StartAccept();
+  SetupUnixAcceptor();
+  SetupInProcListener();
   adv_sender_->Start(info);
   adv_receiver_->Start(info);
 
@@ -72,14 +106,10 @@ ConnectionManager::BranchInfoStringsList
 ConnectionManager::MakeConnectedBranchesInfoStrings() const {
   BranchInfoStringsList branches;
 
-  std::lock_guard<std::mutex> lock(connections_mutex_);
-  for (auto& entry : connections_) {
-    YOGI_ASSERT(entry.second);
-    if (entry.second->SessionRunning()) {
-      branches.push_back(
-          std::make_pair(entry.first, entry.second->MakeInfoString()));
-    }
-  }
+  ForeachRunningSession([&](auto& conn) {
+    branches.push_back(std::make_pair(conn->GetRemoteBranchInfo()->GetUuid(),
+                                      conn->MakeInfoString()));
+  });
 
   return branches;
 }
@@ -117,6 +147,15 @@ ConnectionManager::OperationTag ConnectionManager::MakeOperationId() {
   return tag;
 }
 
+ContextPtr ConnectionManager::GetNextShard() {
+  // The remote UUID of incoming connections is unknown at this point
+  return context_->GetShard(next_shard_++);
+}
+
+ContextPtr ConnectionManager::GetShardFor(const boost::uuids::uuid& uuid) {
+  return context_->GetShard(boost::hash<boost::uuids::uuid>()(uuid));
+}
+
 void ConnectionManager::SetupAcceptor(const boost::asio::ip::tcp& protocol) {
   boost::system::error_code ec;
   acceptor_.open(protocol, ec);
@@ -135,7 +174,7 @@ void ConnectionManager::SetupAcceptor(const boost::asio::ip::tcp& protocol) {
 void ConnectionManager::StartAccept() {
   auto weak_self = MakeWeakPtr();
   accept_guard_ = network::TcpTransport::AcceptAsync(
-      context_, &acceptor_, info_->GetTimeout(),
+      GetNextShard(), &acceptor_, info_->GetTimeout(),
       info_->GetTransceiveByteLimit(), [=](auto& res, auto transport, auto) {
         auto self = weak_self.lock();
         if (!self) return;
@@ -162,54 +201,269 @@ void ConnectionManager::OnAcceptFinished(const api::Result& res,
   StartAccept();
 }
 
+void ConnectionManager::SetupUnixAcceptor() {
+#ifdef YOGI_HAS_UNIX_TRANSPORT
+  auto ep = network::UnixTransport::MakeAbstractEndpoint(
+      info_->GetUnixSocketName());
+
+  boost::system::error_code ec;
+  unix_acceptor_.open(ep.protocol(), ec);
+  if (!ec) unix_acceptor_.bind(ep, ec);
+  if (!ec) unix_acceptor_.listen(unix_acceptor_.max_listen_connections, ec);
+  if (ec) {
+    YOGI_LOG_WARNING(logger_, info_ << " Could not set up Unix domain socket @"
+                                    << info_->GetUnixSocketName() << ": "
+                                    << ec.message()
+                                    << ". Only TCP connections will be used.");
+    unix_acceptor_.close(ec);
+    return;
+  }
+
+  StartUnixAccept();
+#endif
+}
+
+void ConnectionManager::StartUnixAccept() {
+#ifdef YOGI_HAS_UNIX_TRANSPORT
+  auto weak_self = MakeWeakPtr();
+  unix_accept_guard_ = network::UnixTransport::AcceptAsync(
+      GetNextShard(), &unix_acceptor_, info_->GetTimeout(),
+      info_->GetTransceiveByteLimit(),
+      [=](auto& res, auto transport, auto) {
+        auto self = weak_self.lock();
+        if (!self) return;
+
+        self->OnUnixAcceptFinished(res, transport);
+      },
+      [=] {
+        // Accept the next connection while this one does its handshake
+        if (auto self = weak_self.lock()) {
+          self->StartUnixAccept();
+        }
+      });
+#endif
+}
+
+void ConnectionManager::OnUnixAcceptFinished(const api::Result& res,
+                                             network::TransportPtr transport) {
+  // Errors other than these are caused by a misbehaving peer during the
+  // handshake and do not affect the acceptor
+  if (res == api::Error(YOGI_ERR_ACCEPT_SOCKET_FAILED) ||
+      res == api::Error(YOGI_ERR_CANCELED)) {
+    YOGI_LOG_ERROR(logger_, info_ << " Accepting incoming Unix domain socket "
+                                     "connection failed: "
+                                  << res
+                                  << ". No more connections will be accepted "
+                                     "via Unix domain sockets.");
+    return;
+  }
+
+  if (res.IsError()) {
+    YOGI_LOG_WARNING(logger_, info_ << " Handshake on incoming Unix domain "
+                                       "socket connection failed: "
+                                    << res);
+    return;
+  }
+
+  YOGI_LOG_DEBUG(logger_,
+                 info_ << " Accepted incoming Unix domain socket connection");
+
+  StartExchangeBranchInfo(transport, MakeLoopbackAddress(), {});
+}
+
+void ConnectionManager::SetupInProcListener() {
+  auto weak_self = MakeWeakPtr();
+  inproc_listener_ = network::InProcTransport::Listen(
+      context_, boost::uuids::to_string(info_->GetUuid()),
+      info_->GetTimeout(), info_->GetTransceiveByteLimit(),
+      [=](auto& res, auto transport) {
+        auto self = weak_self.lock();
+        if (!self) return;
+
+        self->OnInProcAcceptFinished(res, transport);
+      });
+}
+
+void ConnectionManager::OnInProcAcceptFinished(
+    const api::Result& res, network::TransportPtr transport) {
+  YOGI_ASSERT(res.IsSuccess());
+  YOGI_UNUSED(res);
+
+  YOGI_LOG_DEBUG(logger_,
+                 info_ << " Accepted incoming in-process connection");
+
+  StartExchangeBranchInfo(transport, MakeLoopbackAddress(), {});
+}
+
+bool ConnectionManager::IsLocalAddress(
+    const boost::asio::ip::address& addr) const {
+  if (addr.is_loopback()) return true;
+
+  // Advertisements from this host may arrive on a different interface than
+  // they were sent from, so all interfaces are checked. IPv6 addresses get
+  // compared without their scope IDs since these differ between the sender
+  // address and the address of our interface.
+  for (auto& info : all_ifs_) {
+    for (auto& if_addr : info.addresses) {
+      if (if_addr.is_v6() && addr.is_v6()) {
+        if (if_addr.to_v6().to_bytes() == addr.to_v6().to_bytes()) return true;
+      } else if (if_addr == addr) {
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+boost::asio::ip::address ConnectionManager::MakeLoopbackAddress() const {
+  // Used as peer address for connections to branches on this host since their
+  // TCP servers are reachable via loopback
+  using namespace boost::asio::ip;
+  return info_->GetTcpServerEndpoint().protocol() == tcp::v4()
+             ? address(address_v4::loopback())
+             : address(address_v6::loopback());
+}
+
 void ConnectionManager::OnAdvertisementReceived(
     const boost::uuids::uuid& adv_uuid,
     const boost::asio::ip::tcp::endpoint& ep) {
-  std::lock_guard<std::mutex> lock(connections_mutex_);
+  std::lock_guard<std::recursive_mutex> lock(connections_mutex_);
   if (connections_.count(adv_uuid)) return;
   if (blacklisted_uuids_.count(adv_uuid)) return;
   if (pending_connects_.count(adv_uuid)) return;
 
+  // Branches in the same process register their UUID with the in-process
+  // transport, so finding it there means that the PID and host match ours.
+  // Other branches on the same host are preferably connected via Unix domain
+  // sockets; the socket name is derived from the advertised UUID.
+  if (network::InProcTransport::IsListening(
+          boost::uuids::to_string(adv_uuid))) {
+    StartInProcConnect(adv_uuid, ep);
+#ifdef YOGI_HAS_UNIX_TRANSPORT
+  } else if (unix_acceptor_.is_open() && IsLocalAddress(ep.address())) {
+    StartUnixConnect(adv_uuid, ep);
+#endif
+  } else {
+    StartTcpConnect(adv_uuid, ep);
+  }
+
+  pending_connects_.insert(adv_uuid);
+
+  EmitBranchEvent(api::kBranchDiscoveredEvent, api::kSuccess, adv_uuid, [&] {
+    return nlohmann::json{
+        {"uuid", boost::uuids::to_string(adv_uuid)},
+        {"tcp_server_address", network::MakeIpAddressString(ep)},
+        {"tcp_server_port", ep.port()}};
+  });
+}
+
+void ConnectionManager::StartTcpConnect(
+    const boost::uuids::uuid& adv_uuid,
+    const boost::asio::ip::tcp::endpoint& ep) {
   YOGI_LOG_DEBUG(logger_, info_ << " Attempting to connect to [" << adv_uuid
                                 << "] on " << network::MakeIpAddressString(ep)
                                 << ":" << ep.port());
 
   auto weak_self = MakeWeakPtr();
   auto guard = network::TcpTransport::ConnectAsync(
-      context_, ep, info_->GetTimeout(), info_->GetTransceiveByteLimit(),
+      GetShardFor(adv_uuid), ep, info_->GetTimeout(),
+      info_->GetTransceiveByteLimit(),
       [=](auto& res, auto transport, auto guard) {
         auto self = weak_self.lock();
         if (!self) return;
 
+        std::lock_guard<std::recursive_mutex> lock(self->connections_mutex_);
         self->connect_guards_.erase(guard);
-        self->OnConnectFinished(res, adv_uuid, transport);
+        self->OnConnectFinished(res, adv_uuid, transport, ep.address());
       });
 
-  pending_connects_.insert(adv_uuid);
+  std::lock_guard<std::recursive_mutex> lock(connections_mutex_);
   connect_guards_.insert(guard);
+}
 
-  EmitBranchEvent(api::kBranchDiscoveredEvent, api::kSuccess, adv_uuid, [&] {
-    return nlohmann::json{
-        {"uuid", boost::uuids::to_string(adv_uuid)},
-        {"tcp_server_address", network::MakeIpAddressString(ep)},
-        {"tcp_server_port", ep.port()}};
-  });
+void ConnectionManager::StartInProcConnect(
+    const boost::uuids::uuid& adv_uuid,
+    const boost::asio::ip::tcp::endpoint& ep) {
+  YOGI_LOG_DEBUG(logger_, info_ << " Attempting to connect to [" << adv_uuid
+                                << "] in-process");
+
+  auto weak_self = MakeWeakPtr();
+  network::InProcTransport::ConnectAsync(
+      GetShardFor(adv_uuid), boost::uuids::to_string(adv_uuid),
+      info_->GetTimeout(), info_->GetTransceiveByteLimit(),
+      [=](auto& res, auto transport) {
+        auto self = weak_self.lock();
+        if (!self) return;
+
+        // The other branch might have been destroyed in the meantime
+        if (res.IsError()) {
+          self->StartTcpConnect(adv_uuid, ep);
+          return;
+        }
+
+        self->OnConnectFinished(res, adv_uuid, transport,
+                                self->MakeLoopbackAddress());
+      });
 }
 
-void ConnectionManager::OnConnectFinished(const api::Result& res,
-                                          const boost::uuids::uuid& adv_uuid,
-                                          network::TcpTransportPtr transport) {
+void ConnectionManager::StartUnixConnect(
+    const boost::uuids::uuid& adv_uuid,
+    const boost::asio::ip::tcp::endpoint& ep) {
+#ifdef YOGI_HAS_UNIX_TRANSPORT
+  auto name = BranchInfo::MakeUnixSocketName(adv_uuid);
+  YOGI_LOG_DEBUG(logger_, info_ << " Attempting to connect to [" << adv_uuid
+                                << "] on @" << name);
+
+  auto weak_self = MakeWeakPtr();
+  auto guard = network::UnixTransport::ConnectAsync(
+      GetShardFor(adv_uuid), name, info_->GetTimeout(),
+      info_->GetTransceiveByteLimit(), true,
+      [=](auto& res, auto transport, auto guard) {
+        auto self = weak_self.lock();
+        if (!self) return;
+
+        std::lock_guard<std::recursive_mutex> lock(self->connections_mutex_);
+        self->connect_guards_.erase(guard);
+
+        // The peer might not support Unix domain sockets or live in a
+        // different network namespace, so fall back to TCP
+        if (res.IsError() && res != api::Error(YOGI_ERR_CANCELED)) {
+          YOGI_LOG_DEBUG(logger_, self->info_ << " Connecting to [" << adv_uuid
+                                              << "] on @" << name
+                                              << " failed: " << res
+                                              << ". Falling back to TCP.");
+          self->StartTcpConnect(adv_uuid, ep);
+          return;
+        }
+
+        self->OnConnectFinished(res, adv_uuid, transport, ep.address());
+      });
+
+  std::lock_guard<std::recursive_mutex> lock(connections_mutex_);
+  connect_guards_.insert(guard);
+#else
+  YOGI_UNUSED(adv_uuid);
+  YOGI_UNUSED(ep);
+  YOGI_NEVER_REACHED;
+#endif
+}
+
+void ConnectionManager::OnConnectFinished(
+    const api::Result& res, const boost::uuids::uuid& adv_uuid,
+    network::TransportPtr transport,
+    const boost::asio::ip::address& peer_address) {
+  std::lock_guard<std::recursive_mutex> lock(connections_mutex_);
   if (res.IsError()) {
     EmitBranchEvent(api::kBranchQueriedEvent, res, adv_uuid);
     pending_connects_.erase(adv_uuid);
     return;
   }
 
-  YOGI_LOG_DEBUG(logger_, info_ << " TCP connection to " << *transport
+  YOGI_LOG_DEBUG(logger_, info_ << " Connection to " << *transport
                                 << " established successfully");
 
-  StartExchangeBranchInfo(transport, transport->GetPeerEndpoint().address(),
-                          adv_uuid);
+  StartExchangeBranchInfo(transport, peer_address, adv_uuid);
 }
 
 void ConnectionManager::StartExchangeBranchInfo(
@@ -220,6 +474,7 @@ void ConnectionManager::StartExchangeBranchInfo(
   auto weak_conn = BranchConnectionWeakPtr(conn);
   conn->ExchangeBranchInfo([this, weak_conn, adv_uuid](auto& res) {
     YOGI_ASSERT(weak_conn.lock());
+    std::lock_guard<std::recursive_mutex> lock(this->connections_mutex_);
     this->OnExchangeBranchInfoFinished(res, weak_conn.lock(), adv_uuid);
     this->StopKeepingConnectionAlive(weak_conn);
     this->pending_connects_.erase(adv_uuid);
@@ -252,7 +507,7 @@ void ConnectionManager::OnExchangeBranchInfoFinished(
                                         : "client")
                                 << ")");
 
-  std::lock_guard<std::mutex> lock(connections_mutex_);
+  std::lock_guard<std::recursive_mutex> lock(connections_mutex_);
   auto con_res = connections_.insert(std::make_pair(remote_uuid, conn));
   bool conn_already_exists = !con_res.second;
 
@@ -399,12 +654,12 @@ void ConnectionManager::OnAuthenticateFinished(const api::Result& res,
                                                BranchConnectionPtr conn) {
   auto& uuid = conn->GetRemoteBranchInfo()->GetUuid();
 
+  std::lock_guard<std::recursive_mutex> lock(connections_mutex_);
   if (res.IsError()) {
     if (res == api::Error(YOGI_ERR_PASSWORD_MISMATCH)) {
       blacklisted_uuids_.insert(uuid);
     }
 
-    std::lock_guard<std::mutex> lock(connections_mutex_);
     connections_.erase(uuid);
 
     EmitBranchEvent(api::kConnectFinishedEvent, res, uuid);
@@ -418,6 +673,7 @@ void ConnectionManager::OnAuthenticateFinished(const api::Result& res,
 void ConnectionManager::StartSession(BranchConnectionPtr conn) {
   auto weak_conn = BranchConnectionWeakPtr(conn);
   conn->RunSession(
+      broadcast_log_,
       [this, weak_conn](auto& msg) {
         YOGI_ASSERT(weak_conn.lock());
         this->message_handler_(msg, weak_conn.lock());
@@ -425,8 +681,16 @@ void ConnectionManager::StartSession(BranchConnectionPtr conn) {
       [this, weak_conn](auto& res) {
         YOGI_ASSERT(weak_conn.lock());
         this->OnSessionTerminated(res.ToError(), weak_conn.lock());
+      },
+      [this, weak_conn](auto backlog) {
+        YOGI_ASSERT(weak_conn.lock());
+        this->OnSlowConsumer(weak_conn.lock(), backlog);
       });
 
+  auto sessions = *GetRunningSessions();
+  sessions.push_back(conn);
+  PublishRunningSessions(std::move(sessions));
+
   EmitBranchEvent(api::kConnectFinishedEvent, api::kSuccess,
                   conn->GetRemoteBranchInfo()->GetUuid());
 
@@ -445,17 +709,40 @@ void ConnectionManager::OnSessionTerminated(const api::Error& err,
   EmitBranchEvent(api::kConnectionLostEvent, err,
                   conn->GetRemoteBranchInfo()->GetUuid());
 
-  std::lock_guard<std::mutex> lock(connections_mutex_);
+  std::lock_guard<std::recursive_mutex> lock(connections_mutex_);
   connections_.erase(conn->GetRemoteBranchInfo()->GetUuid());
 
+  auto sessions = *GetRunningSessions();
+  utils::remove_erase(sessions, conn);
+  PublishRunningSessions(std::move(sessions));
+
   connection_changed_handler_(err, conn);
 }
 
+void ConnectionManager::OnSlowConsumer(BranchConnectionPtr conn,
+                                       std::size_t backlog) {
+  auto& uuid = conn->GetRemoteBranchInfo()->GetUuid();
+  auto policy = SlowConsumerPolicyToString(info_->GetTxSlowConsumerPolicy());
+  EmitBranchEvent(api::kSlowConsumerEvent, api::kSuccess, uuid, [&] {
+    return nlohmann::json{{"uuid", boost::uuids::to_string(uuid)},
+                          {"policy", policy},
+                          {"backlog", backlog}};
+  });
+}
+
+void ConnectionManager::PublishRunningSessions(ConnectionsList sessions) {
+  // Writers are serialized by connections_mutex_; readers never block
+  std::atomic_store(&running_sessions_, std::make_shared<const ConnectionsList>(
+                                           std::move(sessions)));
+}
+
 BranchConnectionPtr ConnectionManager::MakeConnectionAndKeepItAlive(
     const boost::asio::ip::address& peer_address,
     network::TransportPtr transport) {
   auto conn =
       std::make_shared<BranchConnection>(transport, peer_address, info_);
+
+  std::lock_guard<std::recursive_mutex> lock(connections_mutex_);
   connections_kept_alive_.insert(conn);
   return conn;
 }
@@ -464,6 +751,8 @@ BranchConnectionPtr ConnectionManager::StopKeepingConnectionAlive(
     const BranchConnectionWeakPtr& weak_conn) {
   auto conn = weak_conn.lock();
   YOGI_ASSERT(conn);
+
+  std::lock_guard<std::recursive_mutex> lock(connections_mutex_);
   connections_kept_alive_.erase(conn);
   return conn;
 }
@@ -525,6 +814,12 @@ void ConnectionManager::LogBranchEvent(api::BranchEvents event,
           logger_, info_ << " Event: YOGI_BEV_CONNECTION_LOST; ev_res=\""
                          << ev_res << "; json=\"" << make_json_fn() << "\"");
       break;
+
+    case api::kSlowConsumerEvent:
+      YOGI_LOG_WARNING(
+          logger_, info_ << " Event: YOGI_BEV_SLOW_CONSUMER; ev_res=\""
+                         << ev_res << "; json=\"" << make_json_fn() << "\"");
+      break;
   }
 }
 
@@ -19,7 +19,9 @@
 
 #include "../../../config.h"
 #include "../../../api/enums.h"
+#include "../../../network/inproc_transport.h"
 #include "../../../network/tcp_transport.h"
+#include "../../../network/unix_transport.h"
 #include "../../../utils/system.h"
 #include "advertising_receiver.h"
 #include "advertising_sender.h"
@@ -55,6 +57,8 @@ class ConnectionManager
       MessageReceiveHandler;
   typedef std::vector<std::pair<boost::uuids::uuid, std::string>>
       BranchInfoStringsList;
+  typedef std::vector<BranchConnectionPtr> ConnectionsList;
+  typedef std::shared_ptr<const ConnectionsList> ConnectionsSnapshot;
   using OperationTag = network::MessageTransport::OperationTag;
 
   ConnectionManager(ContextPtr context, const std::string& password,
@@ -84,11 +88,24 @@ class ConnectionManager
   bool AwaitEventAsync(api::BranchEvents events, BranchEventHandler handler);
   bool CancelAwaitEvent();
 
+  // Immutable list of the connections with a running session. A new list
+  // gets published whenever a session starts or terminates, so iterating
+  // over it does not require any lock.
+  //
+  // A snapshot keeps its connections alive, even after their sessions have
+  // terminated and a newer snapshot has been published. Code iterating over
+  // a snapshot must therefore check SessionRunning() on each connection
+  // before using its session; it turns false in OnSessionError(), before
+  // the connection gets removed from the list.
+  ConnectionsSnapshot GetRunningSessions() const {
+    return std::atomic_load(&running_sessions_);
+  }
+
+  // Skips connections whose session terminated after the snapshot was taken
   template <typename Fn>
-  void ForeachRunningSession(Fn fn) {
-    std::lock_guard<std::mutex> lock(connections_mutex_);
-    for (auto& entry : connections_) {
-      auto& conn = entry.second;
+  void ForeachRunningSession(Fn fn) const {
+    auto sessions = GetRunningSessions();
+    for (auto& conn : *sessions) {
       if (conn->SessionRunning()) {
         fn(conn);
       }
@@ -97,6 +114,11 @@ class ConnectionManager
 
   OperationTag MakeOperationId();
 
+  // Shared by all sessions; only valid after Start() has been called
+  const network::BroadcastLogPtr& GetBroadcastLog() const {
+    return broadcast_log_;
+  }
+
  private:
   typedef std::unordered_set<boost::uuids::uuid,
                              boost::hash<boost::uuids::uuid>>
@@ -107,19 +129,37 @@ class ConnectionManager
       ConnectionsMap;
 
   typedef ConnectionsMap::value_type ConnectionsMapEntry;
-  typedef std::set<network::TcpTransport::ConnectGuardPtr> ConnectGuardsSet;
+  typedef std::set<std::shared_ptr<void>> ConnectGuardsSet;
   typedef std::set<BranchConnectionPtr> ConnectionsSet;
 
   ConnectionManagerWeakPtr MakeWeakPtr() { return {shared_from_this()}; }
+  ContextPtr GetNextShard();
+  ContextPtr GetShardFor(const boost::uuids::uuid& uuid);
   void SetupAcceptor(const boost::asio::ip::tcp& protocol);
   void StartAccept();
   void OnAcceptFinished(const api::Result& res,
                         network::TcpTransportPtr transport);
+  void SetupUnixAcceptor();
+  void StartUnixAccept();
+  void OnUnixAcceptFinished(const api::Result& res,
+                            network::TransportPtr transport);
+  void SetupInProcListener();
+  void OnInProcAcceptFinished(const api::Result& res,
+                              network::TransportPtr transport);
+  bool IsLocalAddress(const boost::asio::ip::address& addr) const;
+  boost::asio::ip::address MakeLoopbackAddress() const;
   void OnAdvertisementReceived(const boost::uuids::uuid& adv_uuid,
                                const boost::asio::ip::tcp::endpoint& ep);
+  void StartTcpConnect(const boost::uuids::uuid& adv_uuid,
+                       const boost::asio::ip::tcp::endpoint& ep);
+  void StartInProcConnect(const boost::uuids::uuid& adv_uuid,
+                          const boost::asio::ip::tcp::endpoint& ep);
+  void StartUnixConnect(const boost::uuids::uuid& adv_uuid,
+                        const boost::asio::ip::tcp::endpoint& ep);
   void OnConnectFinished(const api::Result& res,
                          const boost::uuids::uuid& adv_uuid,
-                         network::TcpTransportPtr transport);
+                         network::TransportPtr transport,
+                         const boost::asio::ip::address& peer_address);
   void StartExchangeBranchInfo(network::TransportPtr transport,
                                const boost::asio::ip::address& peer_address,
                                const boost::uuids::uuid& adv_uuid);
@@ -141,6 +181,8 @@ class ConnectionManager
   void OnAuthenticateFinished(const api::Result& res, BranchConnectionPtr conn);
   void StartSession(BranchConnectionPtr conn);
   void OnSessionTerminated(const api::Error& err, BranchConnectionPtr conn);
+  void OnSlowConsumer(BranchConnectionPtr conn, std::size_t backlog);
+  void PublishRunningSessions(ConnectionsList sessions);
   BranchConnectionPtr MakeConnectionAndKeepItAlive(
       const boost::asio::ip::address& peer_address,
       network::TransportPtr transport);
@@ -161,6 +203,7 @@ class ConnectionManager
 
   const ContextPtr context_;
   const std::vector<utils::NetworkInterfaceInfo> adv_ifs_;
+  const std::vector<utils::NetworkInterfaceInfo> all_ifs_;
   const utils::SharedByteVector password_hash_;
   const ConnectionChangedHandler connection_changed_handler_;
   const MessageReceiveHandler message_handler_;
@@ -168,16 +211,28 @@ class ConnectionManager
   const detail::AdvertisingReceiverPtr adv_receiver_;
   boost::asio::ip::tcp::acceptor acceptor_;
   network::TcpTransport::AcceptGuardPtr accept_guard_;
+#ifdef YOGI_HAS_UNIX_TRANSPORT
+  network::UnixTransport::Acceptor unix_acceptor_;
+  network::UnixTransport::AcceptGuardPtr unix_accept_guard_;
+#endif
+  network::InProcTransport::ListenerPtr inproc_listener_;
   ConnectGuardsSet connect_guards_;
   ConnectionsSet connections_kept_alive_;
   LocalBranchInfoPtr info_;
+  network::BroadcastLogPtr broadcast_log_;
+
+  ConnectionsSnapshot running_sessions_;  // Accessed atomically only
 
   UuidSet blacklisted_uuids_;
   UuidSet pending_connects_;
   ConnectionsMap connections_;
-  mutable std::mutex connections_mutex_;
+
+  // Guards the sets and maps above since handlers of different connections
+  // may run concurrently if the context runs on multiple threads
+  mutable std::recursive_mutex connections_mutex_;
 
   std::atomic<OperationTag> last_op_tag_;
+  std::atomic<std::size_t> next_shard_;
 
   BranchEventHandler event_handler_;
   api::BranchEvents observed_events_;
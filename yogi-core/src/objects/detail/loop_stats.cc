@@ -0,0 +1,178 @@
+/*
+ * This file is part of the Yogi distribution https://github.com/yohummus/yogi.
+ * Copyright (c) 2018 Johannes Bergmann.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "loop_stats.h"
+
+#include <algorithm>
+
+namespace objects {
+namespace detail {
+namespace {
+
+double ToSeconds(std::chrono::nanoseconds dur) {
+  return std::chrono::duration<double>(dur).count();
+}
+
+}  // anonymous namespace
+
+LoopStats::LoopStats(std::size_t num_threads)
+    : num_threads_(num_threads),
+      enabled_(false),
+      slow_handler_threshold_(Clock::duration::max().count()),
+      queued_handlers_(0),
+      max_queued_handlers_(0) {
+  Reset();
+}
+
+void LoopStats::Configure(bool enable,
+                          std::chrono::nanoseconds slow_handler_threshold) {
+  if (slow_handler_threshold == slow_handler_threshold.max()) {
+    slow_handler_threshold_ = Clock::duration::max().count();
+  } else {
+    slow_handler_threshold_ =
+        std::chrono::duration_cast<Clock::duration>(slow_handler_threshold)
+            .count();
+  }
+
+  if (enable && !Enabled()) {
+    Reset();
+  }
+
+  enabled_ = enable;
+}
+
+void LoopStats::Reset() {
+  period_start_ = Clock::now().time_since_epoch().count();
+  busy_time_ = 0;
+  handlers_ = 0;
+  slow_handlers_ = 0;
+  max_queued_handlers_ = queued_handlers_.load();
+  execution_times_.Reset();
+  queue_delays_.Reset();
+}
+
+LoopStats::Clock::time_point LoopStats::HandlerQueued() {
+  if (!Enabled()) return {};
+
+  auto n = ++queued_handlers_;
+  auto max = max_queued_handlers_.load();
+  while (n > max && !max_queued_handlers_.compare_exchange_weak(max, n)) {
+  }
+
+  return Clock::now();
+}
+
+LoopStats::Clock::time_point LoopStats::HandlerStarted(
+    Clock::time_point queued_at, bool nested) {
+  // Handlers queued while enabled always need to be taken off the count
+  if (queued_at != Clock::time_point{}) {
+    --queued_handlers_;
+  }
+
+  if (!Enabled()) return {};
+
+  auto now = Clock::now();
+  if (queued_at != Clock::time_point{}) {
+    queue_delays_.Add(now - queued_at);
+  }
+
+  return nested ? Clock::time_point{} : now;
+}
+
+void LoopStats::HandlerFinished(Clock::time_point started_at) {
+  auto dur = Clock::now() - started_at;
+  busy_time_ += dur.count();
+  ++handlers_;
+  execution_times_.Add(dur);
+
+  if (dur > Clock::duration(slow_handler_threshold_.load())) {
+    ++slow_handlers_;
+    YOGI_LOG_WARNING(logger_, "Slow handler detected: Execution took "
+                                  << ToSeconds(dur) * 1000.0 << " ms");
+  }
+}
+
+nlohmann::json LoopStats::ToJson() const {
+  auto now = Clock::now().time_since_epoch();
+  auto period = now - Clock::duration(period_start_.load());
+  auto busy_time = Clock::duration(busy_time_.load());
+
+  double utilization = 0.0;
+  if (period > period.zero()) {
+    utilization = ToSeconds(busy_time) /
+                  (ToSeconds(period) * static_cast<double>(num_threads_));
+  }
+
+  auto threshold = Clock::duration(slow_handler_threshold_.load());
+  auto threshold_json = threshold == threshold.max()
+                            ? nlohmann::json(-1)
+                            : nlohmann::json(ToSeconds(threshold));
+
+  return {
+      {"enabled", Enabled()},
+      {"period", ToSeconds(period)},
+      {"threads", num_threads_},
+      {"handlers", handlers_.load()},
+      {"queued_handlers", std::max<std::int64_t>(queued_handlers_, 0)},
+      {"max_queued_handlers", max_queued_handlers_.load()},
+      {"busy_time", ToSeconds(busy_time)},
+      {"utilization", utilization},
+      {"slow_handler_threshold", threshold_json},
+      {"slow_handlers", slow_handlers_.load()},
+      {"execution_times", execution_times_.ToJson()},
+      {"queue_delays", queue_delays_.ToJson()},
+  };
+}
+
+void LoopStats::Histogram::Reset() {
+  for (auto& count : counts_) {
+    count = 0;
+  }
+}
+
+void LoopStats::Histogram::Add(std::chrono::nanoseconds dur) {
+  auto us = std::chrono::duration_cast<std::chrono::microseconds>(dur).count();
+  std::size_t idx = 0;
+  while (idx < kNumBuckets && (1ll << idx) < us) {
+    ++idx;
+  }
+
+  counts_[idx].fetch_add(1, std::memory_order_relaxed);
+}
+
+nlohmann::json LoopStats::Histogram::ToJson() const {
+  auto bounds = nlohmann::json::array();
+  auto counts = nlohmann::json::array();
+  for (std::size_t i = 0; i < counts_.size(); ++i) {
+    if (i < kNumBuckets) {
+      bounds.push_back(static_cast<double>(1ll << i) / 1e6);
+    }
+
+    counts.push_back(counts_[i].load(std::memory_order_relaxed));
+  }
+
+  return {{"upper_bounds", bounds}, {"counts", counts}};
+}
+
+thread_local int LoopStats::HandlerScope::depth_ = 0;
+
+const LoggerPtr LoopStats::logger_ =
+    Logger::CreateStaticInternalLogger("Context.LoopStats");
+
+}  // namespace detail
+}  // namespace objects
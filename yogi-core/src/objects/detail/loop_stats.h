@@ -0,0 +1,145 @@
+/*
+ * This file is part of the Yogi distribution https://github.com/yohummus/yogi.
+ * Copyright (c) 2018 Johannes Bergmann.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "../../config.h"
+#include "../logger.h"
+
+#include <nlohmann/json.hpp>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <utility>
+
+namespace objects {
+namespace detail {
+
+// Optional instrumentation of the handlers executed by a context. Tracks how
+// long handlers take to execute, how long posted handlers wait in the queue
+// and how busy the context's threads are. All counters are lock-free so
+// handlers running concurrently on different threads do not contend.
+class LoopStats {
+ public:
+  typedef std::chrono::steady_clock Clock;
+
+  explicit LoopStats(std::size_t num_threads);
+
+  // A threshold of nanoseconds::max() disables slow handler warnings;
+  // enabling resets all statistics
+  void Configure(bool enable, std::chrono::nanoseconds slow_handler_threshold);
+  bool Enabled() const { return enabled_.load(std::memory_order_relaxed); }
+  void Reset();
+
+  // Returns the time the handler got queued at or a default constructed
+  // time point if the instrumentation is disabled
+  Clock::time_point HandlerQueued();
+
+  // Returns the start time of the handler or a default constructed time point
+  // if the instrumentation is disabled or if the handler is nested
+  Clock::time_point HandlerStarted(Clock::time_point queued_at, bool nested);
+
+  // Logs a warning if the handler took longer than the slow handler threshold
+  void HandlerFinished(Clock::time_point started_at);
+
+  nlohmann::json ToJson() const;
+
+  // Records the execution of a handler from construction to destruction.
+  // Handlers running inside another instrumented handler on the same thread
+  // (e.g. dispatched inline through a strand) are part of the enclosing
+  // handler's execution and therefore do not get counted again.
+  class HandlerScope {
+   public:
+    HandlerScope(LoopStats* stats, Clock::time_point queued_at)
+        : stats_(stats),
+          started_at_(stats->HandlerStarted(queued_at, depth_ > 0)) {
+      ++depth_;
+    }
+
+    ~HandlerScope() {
+      --depth_;
+      if (started_at_ != Clock::time_point{}) {
+        stats_->HandlerFinished(started_at_);
+      }
+    }
+
+   private:
+    static thread_local int depth_;
+
+    LoopStats* const stats_;
+    const Clock::time_point started_at_;
+  };
+
+ private:
+  static const LoggerPtr logger_;
+
+  // Bucket i counts durations up to 2^i microseconds; the last bucket counts
+  // everything longer than that
+  class Histogram {
+   public:
+    static constexpr std::size_t kNumBuckets = 22;
+
+    Histogram() { Reset(); }
+    void Reset();
+    void Add(std::chrono::nanoseconds dur);
+    nlohmann::json ToJson() const;
+
+   private:
+    std::array<std::atomic<std::uint64_t>, kNumBuckets + 1> counts_;
+  };
+
+  const std::size_t num_threads_;
+  std::atomic<bool> enabled_;
+  std::atomic<Clock::rep> slow_handler_threshold_;
+  std::atomic<Clock::rep> period_start_;
+  std::atomic<Clock::rep> busy_time_;
+  std::atomic<std::uint64_t> handlers_;
+  std::atomic<std::uint64_t> slow_handlers_;
+  std::atomic<std::int64_t> queued_handlers_;
+  std::atomic<std::int64_t> max_queued_handlers_;
+  Histogram execution_times_;
+  Histogram queue_delays_;
+};
+
+// Wraps a handler so that its execution gets recorded in the loop statistics.
+// Queued handlers are those sitting in the context's queue (i.e. posted ones)
+// as opposed to completion handlers of pending I/O operations.
+template <typename Handler>
+class InstrumentedHandler {
+ public:
+  InstrumentedHandler(LoopStats* stats, Handler handler, bool queued)
+      : stats_(stats),
+        handler_(std::move(handler)),
+        queued_at_(queued ? stats->HandlerQueued()
+                          : LoopStats::Clock::time_point{}) {}
+
+  template <typename... Args>
+  void operator()(Args&&... args) {
+    LoopStats::HandlerScope scope(stats_, queued_at_);
+    handler_(std::forward<Args>(args)...);
+  }
+
+ private:
+  LoopStats* stats_;
+  Handler handler_;
+  LoopStats::Clock::time_point queued_at_;
+};
+
+}  // namespace detail
+}  // namespace objects
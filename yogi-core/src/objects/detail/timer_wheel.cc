@@ -0,0 +1,196 @@
+/*
+ * This file is part of the Yogi distribution https://github.com/yohummus/yogi.
+ * Copyright (c) 2018 Johannes Bergmann.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "timer_wheel.h"
+
+#include <algorithm>
+
+namespace objects {
+namespace detail {
+
+TimerWheel::TimerWheel(boost::asio::io_context& ioc, LoopStats* stats,
+                       std::chrono::nanoseconds resolution,
+                       std::size_t num_slots)
+    : start_time_(Clock::now()),
+      resolution_(resolution),
+      stats_(stats),
+      timer_(ioc),
+      timer_armed_(false),
+      armed_tick_(0),
+      processed_tick_(0),
+      last_id_(0),
+      slots_(num_slots) {
+  YOGI_ASSERT(resolution.count() > 0);
+  YOGI_ASSERT(num_slots > 0);
+}
+
+TimerWheel::TimerId TimerWheel::Schedule(Clock::time_point deadline,
+                                         Handler handler) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  // Slots up to processed_tick_ have already been run, so anything that is
+  // due already gets run with the next tick
+  auto tick = std::max(DeadlineToTick(deadline), processed_tick_ + 1);
+  auto idx = SlotIndex(tick);
+  auto& slot = slots_[idx];
+
+  auto id = ++last_id_;
+  if (pool_.empty()) {
+    slot.push_front(Entry{id, tick, std::move(handler)});
+  } else {
+    slot.splice(slot.begin(), pool_, pool_.begin());
+    slot.front() = Entry{id, tick, std::move(handler)};
+  }
+
+  entries_.emplace(id, std::make_pair(idx, slot.begin()));
+
+  if (!timer_armed_ || tick < armed_tick_) {
+    ArmTimer(tick);
+  }
+
+  return id;
+}
+
+TimerWheel::TimerId TimerWheel::ScheduleAfter(std::chrono::nanoseconds delay,
+                                              Handler handler) {
+  auto now = Clock::now();
+  auto deadline = Clock::time_point::max();
+  if (delay < deadline - now) {
+    deadline = now + delay;
+  }
+
+  return Schedule(deadline, std::move(handler));
+}
+
+bool TimerWheel::Cancel(TimerId id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto it = entries_.find(id);
+  if (it == entries_.end()) return false;
+
+  RemoveEntry(&slots_[it->second.first], it->second.second);
+  entries_.erase(it);
+
+  // The asio timer is left alone; if it expires with nothing to do it simply
+  // gets armed for the next entry
+  return true;
+}
+
+std::size_t TimerWheel::Size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+std::uint64_t TimerWheel::DeadlineToTick(Clock::time_point deadline) const {
+  if (deadline <= start_time_) return 0;
+
+  // Round up so that handlers never get called before their deadline
+  auto dur = deadline - start_time_;
+  auto tick = static_cast<std::uint64_t>(dur / resolution_);
+  if (dur % resolution_ != dur.zero()) ++tick;
+  return tick;
+}
+
+TimerWheel::Clock::time_point TimerWheel::TickToTime(
+    std::uint64_t tick) const {
+  auto max_tick = static_cast<std::uint64_t>(
+      (Clock::time_point::max() - start_time_) / resolution_);
+  if (tick >= max_tick) return Clock::time_point::max();
+
+  return start_time_ + resolution_ * static_cast<std::int64_t>(tick);
+}
+
+std::uint64_t TimerWheel::CurrentTick() const {
+  return static_cast<std::uint64_t>((Clock::now() - start_time_) /
+                                    resolution_);
+}
+
+std::size_t TimerWheel::SlotIndex(std::uint64_t tick) const {
+  return static_cast<std::size_t>(tick % slots_.size());
+}
+
+void TimerWheel::RemoveEntry(EntryList* slot, EntryList::iterator it) {
+  it->handler = {};
+  pool_.splice(pool_.begin(), *slot, it);
+}
+
+void TimerWheel::ArmTimer(std::uint64_t tick) {
+  timer_armed_ = true;
+  armed_tick_ = tick;
+
+  timer_.expires_at(TickToTime(tick));
+  auto handler = [this](auto& ec) {
+    if (ec == boost::asio::error::operation_aborted) return;
+    this->OnTimerExpired();
+  };
+
+  timer_.async_wait(
+      InstrumentedHandler<decltype(handler)>(stats_, handler, false));
+}
+
+void TimerWheel::ArmTimerForNextEntry() {
+  if (entries_.empty()) return;
+
+  // Entries in the first non-empty slot may belong to a later revolution; in
+  // that case the timer simply expires without calling anything
+  for (std::size_t i = 1; i <= slots_.size(); ++i) {
+    auto tick = processed_tick_ + i;
+    if (!slots_[SlotIndex(tick)].empty()) {
+      ArmTimer(tick);
+      return;
+    }
+  }
+}
+
+void TimerWheel::OnTimerExpired() {
+  HandlerVector handlers;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    timer_armed_ = false;
+    CollectExpiredEntries(CurrentTick(), &handlers);
+    ArmTimerForNextEntry();
+  }
+
+  for (auto& handler : handlers) {
+    handler();
+  }
+}
+
+void TimerWheel::CollectExpiredEntries(std::uint64_t now_tick,
+                                       HandlerVector* handlers) {
+  if (now_tick <= processed_tick_) return;
+
+  auto n = std::min<std::uint64_t>(now_tick - processed_tick_, slots_.size());
+  for (std::uint64_t i = 1; i <= n; ++i) {
+    auto& slot = slots_[SlotIndex(processed_tick_ + i)];
+    for (auto it = slot.begin(); it != slot.end();) {
+      auto cur = it++;
+      if (cur->tick <= now_tick) {
+        handlers->push_back(std::move(cur->handler));
+        entries_.erase(cur->id);
+        RemoveEntry(&slot, cur);
+      }
+    }
+  }
+
+  processed_tick_ = now_tick;
+}
+
+}  // namespace detail
+}  // namespace objects
@@ -0,0 +1,93 @@
+/*
+ * This file is part of the Yogi distribution https://github.com/yohummus/yogi.
+ * Copyright (c) 2018 Johannes Bergmann.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "../../config.h"
+#include "../../utils/small_function.h"
+#include "loop_stats.h"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <list>
+#include <vector>
+#include <unordered_map>
+
+namespace objects {
+namespace detail {
+
+// Hashed timer wheel for large numbers of coarse deadlines (e.g. transport
+// timeouts and heartbeats). Scheduling and canceling are O(1) and all
+// deadlines are serviced by a single asio timer which only gets re-armed if a
+// deadline earlier than the currently armed one is scheduled. Handlers get
+// called from the io_context and may fire up to one resolution late; their
+// execution gets recorded in the given loop statistics.
+class TimerWheel {
+ public:
+  typedef std::chrono::steady_clock Clock;
+  typedef std::uint64_t TimerId;  // 0 => invalid
+  typedef utils::SmallFunction<void()> Handler;
+
+  TimerWheel(boost::asio::io_context& ioc, LoopStats* stats,
+             std::chrono::nanoseconds resolution, std::size_t num_slots);
+
+  TimerId Schedule(Clock::time_point deadline, Handler handler);
+  TimerId ScheduleAfter(std::chrono::nanoseconds delay, Handler handler);
+  bool Cancel(TimerId id);
+  std::size_t Size() const;
+
+ private:
+  struct Entry {
+    TimerId id;
+    std::uint64_t tick;
+    Handler handler;
+  };
+
+  typedef std::list<Entry> EntryList;
+  typedef std::vector<Handler> HandlerVector;
+
+  std::uint64_t DeadlineToTick(Clock::time_point deadline) const;
+  Clock::time_point TickToTime(std::uint64_t tick) const;
+  std::uint64_t CurrentTick() const;
+  std::size_t SlotIndex(std::uint64_t tick) const;
+  void RemoveEntry(EntryList* slot, EntryList::iterator it);
+  void ArmTimer(std::uint64_t tick);
+  void ArmTimerForNextEntry();
+  void OnTimerExpired();
+  void CollectExpiredEntries(std::uint64_t now_tick, HandlerVector* handlers);
+
+  const Clock::time_point start_time_;
+  const std::chrono::nanoseconds resolution_;
+  LoopStats* const stats_;
+  mutable std::mutex mutex_;
+  boost::asio::steady_timer timer_;
+  bool timer_armed_;
+  std::uint64_t armed_tick_;
+  std::uint64_t processed_tick_;  // All slots up to this tick have been run
+  TimerId last_id_;
+  std::vector<EntryList> slots_;
+  EntryList pool_;  // Recycled nodes for slots_
+  std::unordered_map<TimerId, std::pair<std::size_t, EntryList::iterator>>
+      entries_;
+};
+
+}  // namespace detail
+}  // namespace objects
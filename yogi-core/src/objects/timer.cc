@@ -25,10 +25,10 @@ Timer::Timer(ContextPtr context)
 
 void Timer::StartAsync(std::chrono::nanoseconds timeout, HandlerFn fn) {
   timer_.expires_after(timeout);
-  timer_.async_wait([=](const auto& ec) {
+  timer_.async_wait(context_->WrapHandler([=](const auto& ec) {
     YOGI_ASSERT(!ec || ec == boost::asio::error::operation_aborted);
     fn(ec ? api::Error(YOGI_ERR_CANCELED) : api::kSuccess);
-  });
+  }));
 }
 
 bool Timer::Cancel() {
@@ -0,0 +1,98 @@
+/*
+ * This file is part of the Yogi distribution https://github.com/yohummus/yogi.
+ * Copyright (c) 2018 Johannes Bergmann.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "handler_memory.h"
+
+#include <atomic>
+#include <new>
+
+namespace utils {
+
+constexpr std::size_t HandlerMemoryPool::kMinBlockSize;
+constexpr std::size_t HandlerMemoryPool::kNumSizeClasses;
+constexpr std::size_t HandlerMemoryPool::kMaxCachedBlocks;
+constexpr std::size_t HandlerMemoryPool::kNumSharedPools;
+
+HandlerMemoryPool::HandlerMemoryPool() {
+  free_lists_.fill(nullptr);
+  num_cached_.fill(0);
+}
+
+HandlerMemoryPool::~HandlerMemoryPool() {
+  for (auto block : free_lists_) {
+    while (block) {
+      auto next = block->next;
+      ::operator delete(block);
+      block = next;
+    }
+  }
+}
+
+HandlerMemoryPool& HandlerMemoryPool::Shared() {
+  // Intentionally leaked since callables may get destroyed during static
+  // destruction
+  static auto pools = new std::array<HandlerMemoryPool, kNumSharedPools>();
+  static std::atomic<std::size_t> num_threads{0};
+  thread_local auto idx = num_threads++ % kNumSharedPools;
+  return (*pools)[idx];
+}
+
+void* HandlerMemoryPool::Allocate(std::size_t size) {
+  auto idx = SizeClassIndex(size);
+  if (idx == kNumSizeClasses) {
+    return ::operator new(size);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (auto block = free_lists_[idx]) {
+      free_lists_[idx] = block->next;
+      --num_cached_[idx];
+      return block;
+    }
+  }
+
+  return ::operator new(kMinBlockSize << idx);
+}
+
+void HandlerMemoryPool::Deallocate(void* p, std::size_t size) {
+  auto idx = SizeClassIndex(size);
+  if (idx < kNumSizeClasses) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (num_cached_[idx] < kMaxCachedBlocks) {
+      auto block = static_cast<Block*>(p);
+      block->next = free_lists_[idx];
+      free_lists_[idx] = block;
+      ++num_cached_[idx];
+      return;
+    }
+  }
+
+  ::operator delete(p);
+}
+
+std::size_t HandlerMemoryPool::SizeClassIndex(std::size_t size) {
+  std::size_t idx = 0;
+  while (idx < kNumSizeClasses && (kMinBlockSize << idx) < size) {
+    ++idx;
+  }
+
+  return idx;
+}
+
+}  // namespace utils
@@ -0,0 +1,134 @@
+/*
+ * This file is part of the Yogi distribution https://github.com/yohummus/yogi.
+ * Copyright (c) 2018 Johannes Bergmann.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "../config.h"
+
+#include <array>
+#include <cstddef>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+
+namespace utils {
+
+// Thread-safe pool that recycles the memory of short-lived objects such as
+// asio operations and callables. Blocks are grouped into power-of-two size
+// classes; each class caches a limited number of freed blocks so the steady
+// state does not require any heap allocations. Larger blocks bypass the pool.
+class HandlerMemoryPool {
+ public:
+  HandlerMemoryPool();
+  HandlerMemoryPool(const HandlerMemoryPool&) = delete;
+  HandlerMemoryPool& operator=(const HandlerMemoryPool&) = delete;
+  ~HandlerMemoryPool();
+
+  // Process-wide pool for users that are not tied to a context. Threads get
+  // spread over a number of such pools so they rarely contend for the same
+  // mutex; blocks may be returned to any of them.
+  static HandlerMemoryPool& Shared();
+
+  void* Allocate(std::size_t size);
+  void Deallocate(void* p, std::size_t size);
+
+ private:
+  struct Block {
+    Block* next;
+  };
+
+  static constexpr std::size_t kMinBlockSize = 64;
+  static constexpr std::size_t kNumSizeClasses = 6;  // 64 bytes to 2 KiB
+  static constexpr std::size_t kMaxCachedBlocks = 256;
+  static constexpr std::size_t kNumSharedPools = 16;
+
+  static std::size_t SizeClassIndex(std::size_t size);
+
+  std::mutex mutex_;
+  std::array<Block*, kNumSizeClasses> free_lists_;
+  std::array<std::size_t, kNumSizeClasses> num_cached_;
+};
+
+// Standard allocator on top of a HandlerMemoryPool
+template <typename T>
+class HandlerAllocator {
+ public:
+  typedef T value_type;
+
+  explicit HandlerAllocator(HandlerMemoryPool* pool) noexcept : pool_(pool) {}
+
+  template <typename U>
+  HandlerAllocator(const HandlerAllocator<U>& other) noexcept
+      : pool_(other.pool_) {}
+
+  T* allocate(std::size_t n) {
+    return static_cast<T*>(pool_->Allocate(sizeof(T) * n));
+  }
+
+  void deallocate(T* p, std::size_t n) {
+    pool_->Deallocate(p, sizeof(T) * n);
+  }
+
+  template <typename U>
+  bool operator==(const HandlerAllocator<U>& other) const noexcept {
+    return pool_ == other.pool_;
+  }
+
+  template <typename U>
+  bool operator!=(const HandlerAllocator<U>& other) const noexcept {
+    return pool_ != other.pool_;
+  }
+
+ private:
+  template <typename>
+  friend class HandlerAllocator;
+
+  HandlerMemoryPool* pool_;
+};
+
+// Wraps a completion handler so that asio allocates the memory for the
+// associated operation from the given pool (via associated_allocator)
+template <typename Handler>
+class RecyclingHandler {
+ public:
+  typedef HandlerAllocator<Handler> allocator_type;
+
+  RecyclingHandler(HandlerMemoryPool* pool, Handler handler)
+      : pool_(pool), handler_(std::move(handler)) {}
+
+  allocator_type get_allocator() const noexcept {
+    return allocator_type(pool_);
+  }
+
+  template <typename... Args>
+  void operator()(Args&&... args) {
+    handler_(std::forward<Args>(args)...);
+  }
+
+ private:
+  HandlerMemoryPool* pool_;
+  Handler handler_;
+};
+
+template <typename Handler>
+RecyclingHandler<typename std::decay<Handler>::type> MakeRecyclingHandler(
+    HandlerMemoryPool* pool, Handler&& handler) {
+  return {pool, std::forward<Handler>(handler)};
+}
+
+}  // namespace utils
@@ -0,0 +1,137 @@
+/*
+ * This file is part of the Yogi distribution https://github.com/yohummus/yogi.
+ * Copyright (c) 2018 Johannes Bergmann.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "../config.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace utils {
+
+// Unbounded multi-producer/single-consumer queue. Pushing never blocks and
+// the consumer always takes all queued elements at once, in FIFO order.
+//
+// Nodes come from a fixed pool of PoolSize slots that producers claim with a
+// single atomic exchange, so pushing only allocates memory if more than
+// PoolSize elements are queued at the same time.
+template <typename T, std::size_t PoolSize = 32>
+class LockFreeMpscQueue {
+ public:
+  LockFreeMpscQueue() : head_(nullptr), next_slot_(0) {
+    for (auto& node : pool_) {
+      node.pooled = true;
+    }
+
+    for (auto& used : pool_used_) {
+      used.store(false, std::memory_order_relaxed);
+    }
+  }
+
+  LockFreeMpscQueue(const LockFreeMpscQueue&) = delete;
+  LockFreeMpscQueue& operator=(const LockFreeMpscQueue&) = delete;
+
+  ~LockFreeMpscQueue() {
+    ConsumeAll([](T&&) {});
+  }
+
+  bool Empty() const {
+    return head_.load(std::memory_order_acquire) == nullptr;
+  }
+
+  void Push(T val) {
+    auto node = AcquireNode();
+    new (&node->storage) T(std::move(val));
+
+    node->next = head_.load(std::memory_order_relaxed);
+    while (!head_.compare_exchange_weak(node->next, node,
+                                        std::memory_order_release,
+                                        std::memory_order_relaxed)) {
+    }
+  }
+
+  template <typename Fn>
+  std::size_t ConsumeAll(Fn fn) {
+    // The elements are stored in LIFO order, so reverse them first
+    Node* node = head_.exchange(nullptr, std::memory_order_acquire);
+    Node* first = nullptr;
+    while (node) {
+      auto next = node->next;
+      node->next = first;
+      first = node;
+      node = next;
+    }
+
+    std::size_t n = 0;
+    while (first) {
+      auto current = first;
+      first = first->next;
+
+      auto& value = *reinterpret_cast<T*>(&current->storage);
+      fn(std::move(value));
+      value.~T();
+      ReleaseNode(current);
+      ++n;
+    }
+
+    return n;
+  }
+
+ private:
+  struct Node {
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+    Node* next = nullptr;
+    bool pooled = false;
+  };
+
+  Node* AcquireNode() {
+    // Start at a different slot for each push so that concurrent producers
+    // do not fight over the same slots
+    auto start = next_slot_.fetch_add(1, std::memory_order_relaxed);
+    for (std::size_t i = 0; i < PoolSize; ++i) {
+      auto idx = (start + i) % PoolSize;
+      auto& used = pool_used_[idx];
+      if (!used.load(std::memory_order_relaxed) &&
+          !used.exchange(true, std::memory_order_acquire)) {
+        return &pool_[idx];
+      }
+    }
+
+    return new Node;
+  }
+
+  void ReleaseNode(Node* node) {
+    if (node->pooled) {
+      auto idx = static_cast<std::size_t>(node - pool_.data());
+      pool_used_[idx].store(false, std::memory_order_release);
+    } else {
+      delete node;
+    }
+  }
+
+  std::atomic<Node*> head_;
+  std::atomic<std::size_t> next_slot_;
+  std::array<Node, PoolSize> pool_;
+  std::array<std::atomic<bool>, PoolSize> pool_used_;
+};
+
+}  // namespace utils
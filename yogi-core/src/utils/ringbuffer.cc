@@ -143,6 +143,32 @@ boost::asio::const_buffers_1 LockFreeRingBuffer::FirstReadArray() const {
   }
 }
 
+void LockFreeRingBuffer::CommitReadArrays(std::size_t n) {
+  YOGI_ASSERT(n <= AvailableForRead());
+
+  auto ri = read_idx_.load(std::memory_order_relaxed);
+
+  ri += n;
+  if (ri >= data_.size()) {
+    ri -= data_.size();
+  }
+
+  read_idx_.store(ri, std::memory_order_release);
+}
+
+LockFreeRingBuffer::ConstBuffers LockFreeRingBuffer::ReadArrays() const {
+  auto wi = write_idx_.load(std::memory_order_acquire);
+  auto ri = read_idx_.load(std::memory_order_relaxed);
+
+  if (wi < ri) {
+    return {{boost::asio::buffer(data_.data() + ri, data_.size() - ri),
+             boost::asio::buffer(data_.data(), wi)}};
+  } else {
+    return {{boost::asio::buffer(data_.data() + ri, wi - ri),
+             boost::asio::const_buffer{}}};
+  }
+}
+
 std::size_t LockFreeRingBuffer::AvailableForWrite() const {
   auto wi = write_idx_.load(std::memory_order_relaxed);
   auto ri = read_idx_.load(std::memory_order_acquire);
@@ -211,6 +237,51 @@ boost::asio::mutable_buffers_1 LockFreeRingBuffer::FirstWriteArray() {
                              data_.size() - wi - (ri == 0 ? 1 : 0));
 }
 
+void LockFreeRingBuffer::CommitWriteArrays(std::size_t n) {
+  YOGI_ASSERT(n <= AvailableForWrite());
+
+  auto wi = write_idx_.load(std::memory_order_relaxed);
+
+  wi += n;
+  if (wi >= data_.size()) {
+    wi -= data_.size();
+  }
+
+  write_idx_.store(wi, std::memory_order_release);
+}
+
+LockFreeRingBuffer::MutableBuffers LockFreeRingBuffer::WriteArrays() {
+  auto wi = write_idx_.load(std::memory_order_relaxed);
+  auto ri = read_idx_.load(std::memory_order_acquire);
+
+  if (wi < ri) {
+    return {{boost::asio::buffer(data_.data() + wi, ri - wi - 1),
+             boost::asio::mutable_buffer{}}};
+  }
+
+  if (ri == 0) {
+    return {{boost::asio::buffer(data_.data() + wi, data_.size() - wi - 1),
+             boost::asio::mutable_buffer{}}};
+  }
+
+  return {{boost::asio::buffer(data_.data() + wi, data_.size() - wi),
+           boost::asio::buffer(data_.data(), ri - 1)}};
+}
+
+LockFreeRingBuffer::MutableBuffers LockFreeRingBuffer::Reserve(std::size_t n) {
+  YOGI_ASSERT(n <= AvailableForWrite());
+
+  auto bufs = WriteArrays();
+  if (bufs[0].size() >= n) {
+    bufs[0] = boost::asio::buffer(bufs[0], n);
+    bufs[1] = boost::asio::mutable_buffer{};
+  } else {
+    bufs[1] = boost::asio::buffer(bufs[1], n - bufs[0].size());
+  }
+
+  return bufs;
+}
+
 std::size_t LockFreeRingBuffer::AvailableForRead(std::size_t write_idx,
                                                  std::size_t read_idx) const {
   if (write_idx >= read_idx) {
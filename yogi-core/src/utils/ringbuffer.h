@@ -24,6 +24,7 @@
 #include <atomic>
 #include <vector>
 #include <memory>
+#include <array>
 
 namespace utils {
 
@@ -31,6 +32,11 @@ namespace utils {
 // ringbuffer implementation in boost by Tim Blechmann (spsc_queue).
 class LockFreeRingBuffer {
  public:
+  // Both halves of the readable/writable region; the second one is empty
+  // unless the region wraps around the end of the internal buffer
+  typedef std::array<boost::asio::const_buffer, 2> ConstBuffers;
+  typedef std::array<boost::asio::mutable_buffer, 2> MutableBuffers;
+
   explicit LockFreeRingBuffer(std::size_t capacity);
 
   std::size_t Capacity() const { return capacity_; };
@@ -43,10 +49,15 @@ class LockFreeRingBuffer {
   std::size_t Discard(std::size_t max_size);
   void CommitFirstReadArray(std::size_t n);
   boost::asio::const_buffers_1 FirstReadArray() const;
+  void CommitReadArrays(std::size_t n);
+  ConstBuffers ReadArrays() const;
   std::size_t AvailableForWrite() const;
   std::size_t Write(const Byte* data, std::size_t size);
   void CommitFirstWriteArray(std::size_t n);
   boost::asio::mutable_buffers_1 FirstWriteArray();
+  void CommitWriteArrays(std::size_t n);
+  MutableBuffers WriteArrays();
+  MutableBuffers Reserve(std::size_t n);
 
   template <typename Fn>
   void PopUntil(Fn fn) {
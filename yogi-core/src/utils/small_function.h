@@ -0,0 +1,232 @@
+/*
+ * This file is part of the Yogi distribution https://github.com/yohummus/yogi.
+ * Copyright (c) 2018 Johannes Bergmann.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "../config.h"
+#include "handler_memory.h"
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace utils {
+
+template <typename Signature, std::size_t InlineSize = 6 * sizeof(void*)>
+class SmallFunction;
+
+// Copyable replacement for std::function on internal paths. Callables that
+// fit into InlineSize bytes are stored in place; larger ones (typically
+// lambdas capturing another SmallFunction) are stored in memory recycled
+// through HandlerMemoryPool::Shared() instead of being heap-allocated.
+template <typename R, typename... Args, std::size_t InlineSize>
+class SmallFunction<R(Args...), InlineSize> {
+  template <typename Fn>
+  using EnableIfCallable = typename std::enable_if<
+      !std::is_same<typename std::decay<Fn>::type, SmallFunction>::value &&
+      !std::is_same<typename std::decay<Fn>::type, std::nullptr_t>::value>::
+      type;
+
+ public:
+  SmallFunction() noexcept : ops_(nullptr) {}
+  SmallFunction(std::nullptr_t) noexcept : ops_(nullptr) {}
+
+  template <typename Fn, typename = EnableIfCallable<Fn>>
+  SmallFunction(Fn&& fn) : ops_(nullptr) {
+    Emplace<typename std::decay<Fn>::type>(std::forward<Fn>(fn));
+  }
+
+  SmallFunction(const SmallFunction& other) : ops_(nullptr) {
+    if (other.ops_) {
+      other.ops_->copy(&other.storage_, &storage_);
+      ops_ = other.ops_;
+    }
+  }
+
+  SmallFunction(SmallFunction&& other) noexcept : ops_(nullptr) {
+    MoveFrom(&other);
+  }
+
+  ~SmallFunction() { Reset(); }
+
+  SmallFunction& operator=(const SmallFunction& other) {
+    if (this != &other) {
+      SmallFunction tmp(other);
+      Reset();
+      MoveFrom(&tmp);
+    }
+
+    return *this;
+  }
+
+  SmallFunction& operator=(SmallFunction&& other) noexcept {
+    if (this != &other) {
+      Reset();
+      MoveFrom(&other);
+    }
+
+    return *this;
+  }
+
+  SmallFunction& operator=(std::nullptr_t) noexcept {
+    Reset();
+    return *this;
+  }
+
+  template <typename Fn, typename = EnableIfCallable<Fn>>
+  SmallFunction& operator=(Fn&& fn) {
+    return *this = SmallFunction(std::forward<Fn>(fn));
+  }
+
+  explicit operator bool() const noexcept { return ops_ != nullptr; }
+
+  R operator()(Args... args) const {
+    YOGI_ASSERT(ops_ != nullptr);
+    return ops_->invoke(const_cast<Storage*>(&storage_),
+                        std::forward<Args>(args)...);
+  }
+
+ private:
+  typedef typename std::aligned_storage<InlineSize, alignof(void*)>::type
+      Storage;
+
+  struct Ops {
+    R (*invoke)(Storage*, Args&&...);
+    void (*copy)(const Storage*, Storage*);
+    void (*move)(Storage*, Storage*);
+    void (*destroy)(Storage*);
+  };
+
+  template <typename Fn>
+  struct IsStoredInline
+      : std::integral_constant<
+            bool, sizeof(Fn) <= InlineSize &&
+                      alignof(Fn) <= alignof(Storage) &&
+                      std::is_nothrow_move_constructible<Fn>::value> {};
+
+  template <typename Fn>
+  struct InlineOps {
+    static Fn* Get(Storage* s) { return reinterpret_cast<Fn*>(s); }
+    static const Fn* Get(const Storage* s) {
+      return reinterpret_cast<const Fn*>(s);
+    }
+
+    static R Invoke(Storage* s, Args&&... args) {
+      return (*Get(s))(std::forward<Args>(args)...);
+    }
+
+    static void Copy(const Storage* src, Storage* dst) {
+      new (dst) Fn(*Get(src));
+    }
+
+    static void Move(Storage* src, Storage* dst) noexcept {
+      new (dst) Fn(std::move(*Get(src)));
+      Get(src)->~Fn();
+    }
+
+    static void Destroy(Storage* s) noexcept { Get(s)->~Fn(); }
+
+    static const Ops ops;
+  };
+
+  template <typename Fn>
+  struct PooledOps {
+    static Fn*& Get(Storage* s) { return *reinterpret_cast<Fn**>(s); }
+    static Fn* Get(const Storage* s) {
+      return *reinterpret_cast<Fn* const*>(s);
+    }
+
+    template <typename... FnArgs>
+    static void Create(Storage* s, FnArgs&&... fn_args) {
+      auto& pool = HandlerMemoryPool::Shared();
+      auto p = pool.Allocate(sizeof(Fn));
+      try {
+        Get(s) = new (p) Fn(std::forward<FnArgs>(fn_args)...);
+      } catch (...) {
+        pool.Deallocate(p, sizeof(Fn));
+        throw;
+      }
+    }
+
+    static R Invoke(Storage* s, Args&&... args) {
+      return (*Get(s))(std::forward<Args>(args)...);
+    }
+
+    static void Copy(const Storage* src, Storage* dst) {
+      Create(dst, *Get(src));
+    }
+
+    static void Move(Storage* src, Storage* dst) noexcept {
+      Get(dst) = Get(src);
+    }
+
+    static void Destroy(Storage* s) noexcept {
+      Get(s)->~Fn();
+      HandlerMemoryPool::Shared().Deallocate(Get(s), sizeof(Fn));
+    }
+
+    static const Ops ops;
+  };
+
+  template <typename Fn, typename... FnArgs>
+  typename std::enable_if<IsStoredInline<Fn>::value>::type Emplace(
+      FnArgs&&... fn_args) {
+    new (&storage_) Fn(std::forward<FnArgs>(fn_args)...);
+    ops_ = &InlineOps<Fn>::ops;
+  }
+
+  template <typename Fn, typename... FnArgs>
+  typename std::enable_if<!IsStoredInline<Fn>::value>::type Emplace(
+      FnArgs&&... fn_args) {
+    PooledOps<Fn>::Create(&storage_, std::forward<FnArgs>(fn_args)...);
+    ops_ = &PooledOps<Fn>::ops;
+  }
+
+  void MoveFrom(SmallFunction* other) noexcept {
+    if (other->ops_) {
+      other->ops_->move(&other->storage_, &storage_);
+      ops_ = other->ops_;
+      other->ops_ = nullptr;
+    }
+  }
+
+  void Reset() noexcept {
+    if (ops_) {
+      ops_->destroy(&storage_);
+      ops_ = nullptr;
+    }
+  }
+
+  Storage storage_;
+  const Ops* ops_;
+};
+
+template <typename R, typename... Args, std::size_t InlineSize>
+template <typename Fn>
+const typename SmallFunction<R(Args...), InlineSize>::Ops
+    SmallFunction<R(Args...), InlineSize>::InlineOps<Fn>::ops = {
+        &Invoke, &Copy, &Move, &Destroy};
+
+template <typename R, typename... Args, std::size_t InlineSize>
+template <typename Fn>
+const typename SmallFunction<R(Args...), InlineSize>::Ops
+    SmallFunction<R(Args...), InlineSize>::PooledOps<Fn>::ops = {
+        &Invoke, &Copy, &Move, &Destroy};
+
+}  // namespace utils
@@ -47,6 +47,8 @@
 
 #ifdef __linux__
 #include <linux/if_packet.h>
+#include <pthread.h>
+#include <sched.h>
 #endif
 
 namespace utils {
@@ -128,6 +130,22 @@ int GetCurrentThreadId() {
   return static_cast<int>(id);
 }
 
+bool PinCurrentThreadToCpu(std::size_t cpu) {
+#if defined(_WIN32)
+  auto mask = static_cast<DWORD_PTR>(1) << cpu;
+  return SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#elif defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+  // macOS only supports affinity hints via thread_policy_set()
+  YOGI_UNUSED(cpu);
+  return false;
+#endif
+}
+
 std::vector<NetworkInterfaceInfo> GetNetworkInterfaces() {
   std::vector<NetworkInterfaceInfo> ifs;
 
@@ -37,6 +37,7 @@ struct NetworkInterfaceInfo {
 std::string GetHostname();
 int GetProcessId();
 int GetCurrentThreadId();
+bool PinCurrentThreadToCpu(std::size_t cpu);
 std::vector<NetworkInterfaceInfo> GetNetworkInterfaces();
 std::vector<NetworkInterfaceInfo> GetFilteredNetworkInterfaces(
     const std::vector<std::string>& adv_if_strings,
@@ -22,6 +22,7 @@
 #include "../utils/system.h"
 
 #include <nlohmann/json.hpp>
+#include <limits>
 #include <string>
 using namespace std::string_literals;
 
@@ -50,6 +51,22 @@ boost::asio::ip::udp::endpoint ExtractAdvEndpoint(
   return adv_ep;
 }
 
+network::SlowConsumerPolicy ExtractSlowConsumerPolicy(
+    const nlohmann::json& properties) {
+  auto policy =
+      properties.value<std::string>("tx_slow_consumer_policy", "block");
+
+  if (policy == "block") return network::SlowConsumerPolicy::kBlock;
+  if (policy == "drop") return network::SlowConsumerPolicy::kDrop;
+  if (policy == "conflate") return network::SlowConsumerPolicy::kConflate;
+  if (policy == "disconnect") return network::SlowConsumerPolicy::kDisconnect;
+
+  throw api::DescriptiveError(YOGI_ERR_INVALID_PARAM)
+      << "Invalid value \"" << policy
+      << "\" for property \"tx_slow_consumer_policy\". Allowed values are "
+         "\"block\", \"drop\", \"conflate\" and \"disconnect\".";
+}
+
 }  // anonymous namespace
 
 YOGI_API int YOGI_BranchCreate(void** branch, void* context, const char* props,
@@ -83,11 +100,34 @@ YOGI_API int YOGI_BranchCreate(void** branch, void* context, const char* props,
         api::kMinRxQueueSize, api::kMaxRxQueueSize);
     auto transceive_byte_limit =
         ExtractSizeWithInfSupport(properties, "_transceive_byte_limit", -1, 0);
-
-    auto brn = objects::Branch::Create(ctx, name, description, network,
-                                       password, path, adv_if_strings, adv_ep,
-                                       adv_int, timeout, ghost, tx_queue_size,
-                                       rx_queue_size, transceive_byte_limit);
+    auto tx_coalescing_delay =
+        ExtractDuration(properties, "tx_coalescing_delay", 0);
+    auto tx_coalescing_bytes =
+        ExtractSizeWithInfSupport(properties, "tx_coalescing_bytes", -1, 1);
+    auto tx_zerocopy_threshold =
+        ExtractSizeWithInfSupport(properties, "tx_zerocopy_threshold", -1, 1);
+    auto tx_fanout_partitions = ExtractLimitedNumber<std::size_t>(
+        properties, "tx_fanout_partitions", 1, 0,
+        std::numeric_limits<int>::max());
+    auto rx_broadcast_queue_depth = ExtractLimitedNumber<std::size_t>(
+        properties, "rx_broadcast_queue_depth", 0, 0,
+        std::numeric_limits<int>::max());
+    auto tx_slow_consumer_policy = ExtractSlowConsumerPolicy(properties);
+    auto tx_slow_consumer_threshold = ExtractLimitedNumber<std::size_t>(
+        properties, "tx_slow_consumer_threshold",
+        static_cast<int>(tx_queue_size / 2), 0, api::kMaxTxQueueSize);
+    auto tx_slow_consumer_timeout =
+        ExtractDuration(properties, "tx_slow_consumer_timeout", 1'000'000'000);
+    auto tx_overflow_budget =
+        ExtractSizeWithInfSupport(properties, "tx_overflow_budget", -1, 0);
+
+    auto brn = objects::Branch::Create(
+        ctx, name, description, network, password, path, adv_if_strings,
+        adv_ep, adv_int, timeout, ghost, tx_queue_size, rx_queue_size,
+        transceive_byte_limit, tx_coalescing_delay, tx_coalescing_bytes,
+        tx_zerocopy_threshold, tx_fanout_partitions, rx_broadcast_queue_depth,
+        tx_slow_consumer_policy, tx_slow_consumer_threshold,
+        tx_slow_consumer_timeout, tx_overflow_budget);
     brn->Start();
 
     *branch = api::ObjectRegister::Register(brn);
@@ -264,6 +304,63 @@ YOGI_API int YOGI_BranchReceiveBroadcastAsync(
   CATCH_AND_RETURN;
 }
 
+YOGI_API int YOGI_BranchReceiveBroadcastLeaseAsync(
+    void* branch,
+    void (*fn)(int res, const void* uuid, const void* data, int size,
+               void* lease, void* userarg),
+    void* userarg) {
+  CHECK_PARAM(branch != nullptr);
+  CHECK_PARAM(fn != nullptr);
+
+  try {
+    auto brn = api::ObjectRegister::Get<objects::Branch>(branch);
+    brn->ReceiveBroadcastLease([=](auto& res, auto& src_uuid, auto data,
+                                   auto lease) {
+      if (res.IsError()) {
+        fn(res.GetValue(), nullptr, nullptr, 0, nullptr, userarg);
+        return;
+      }
+
+      // Ownership of the heap-allocated lease is passed to the user who
+      // returns it via YOGI_BranchReleaseBroadcastLease()
+      auto lease_handle = new objects::Branch::ReceiveLease(lease);
+      fn(res.GetValue(), src_uuid.data, data.data(),
+         static_cast<int>(data.size()), lease_handle, userarg);
+    });
+  }
+  CATCH_AND_RETURN;
+}
+
+YOGI_API int YOGI_BranchReceiveBroadcastsAsync(
+    void* branch, int enc, void* data, int datasize,
+    void (*fn)(int res, int count, int size, void* userarg), void* userarg) {
+  CHECK_PARAM(branch != nullptr);
+  CHECK_PARAM(enc == api::Encoding::kJson || enc == api::Encoding::kMsgPack);
+  CHECK_PARAM(data != nullptr || datasize == 0);
+  CHECK_PARAM(fn != nullptr);
+
+  try {
+    auto brn = api::ObjectRegister::Get<objects::Branch>(branch);
+    brn->ReceiveBroadcasts(
+        static_cast<api::Encoding>(enc),
+        boost::asio::buffer(data, static_cast<std::size_t>(datasize)),
+        [=](auto& res, auto count, auto size) {
+          fn(res.GetValue(), static_cast<int>(count), static_cast<int>(size),
+             userarg);
+        });
+  }
+  CATCH_AND_RETURN;
+}
+
+YOGI_API int YOGI_BranchReleaseBroadcastLease(void* lease) {
+  CHECK_PARAM(lease != nullptr);
+
+  try {
+    delete static_cast<objects::Branch::ReceiveLease*>(lease);
+  }
+  CATCH_AND_RETURN;
+}
+
 YOGI_API int YOGI_BranchCancelReceiveBroadcast(void* branch) {
   CHECK_PARAM(branch != nullptr);
 
@@ -18,12 +18,22 @@
 #include "macros.h"
 #include "helpers.h"
 #include "../objects/context.h"
+#include "../objects/context_group.h"
+
+#include <algorithm>
+#include <thread>
 
 YOGI_API int YOGI_ContextCreate(void** context) {
+  return YOGI_ContextCreateWithThreads(context, 1);
+}
+
+YOGI_API int YOGI_ContextCreateWithThreads(void** context, int num_threads) {
   CHECK_PARAM(context != nullptr);
+  CHECK_PARAM(num_threads >= 1);
 
   try {
-    auto ctx = objects::Context::Create();
+    auto ctx =
+        objects::Context::Create(static_cast<std::size_t>(num_threads));
     *context = api::ObjectRegister::Register(ctx);
   }
   CATCH_AND_RETURN;
@@ -87,6 +97,22 @@ YOGI_API int YOGI_ContextRunOne(void* context, int* count, long long duration) {
   CATCH_AND_RETURN;
 }
 
+YOGI_API int YOGI_ContextRunBusyPoll(void* context, int* count,
+                                    long long duration) {
+  CHECK_PARAM(context != nullptr);
+  CHECK_PARAM(duration >= -1);
+
+  try {
+    auto ctx = api::ObjectRegister::Get<objects::Context>(context);
+
+    int n = ctx->RunBusyPoll(ConvertDuration(duration));
+    if (count) {
+      *count = n;
+    }
+  }
+  CATCH_AND_RETURN;
+}
+
 YOGI_API int YOGI_ContextRunInBackground(void* context) {
   CHECK_PARAM(context != nullptr);
 
@@ -97,6 +123,17 @@ YOGI_API int YOGI_ContextRunInBackground(void* context) {
   CATCH_AND_RETURN;
 }
 
+YOGI_API int YOGI_ContextRunInBackgroundBusyPoll(void* context, int cpu) {
+  CHECK_PARAM(context != nullptr);
+  CHECK_PARAM(cpu >= -1);
+
+  try {
+    auto ctx = api::ObjectRegister::Get<objects::Context>(context);
+    ctx->RunInBackground(cpu, true);
+  }
+  CATCH_AND_RETURN;
+}
+
 YOGI_API int YOGI_ContextStop(void* context) {
   CHECK_PARAM(context != nullptr);
 
@@ -143,3 +180,130 @@ YOGI_API int YOGI_ContextPost(void* context, void (*fn)(void*), void* userarg) {
   }
   CATCH_AND_RETURN;
 }
+
+YOGI_API int YOGI_ContextPostBatch(void* context, void (*fns[])(void*),
+                                   void* userargs[], int n) {
+  CHECK_PARAM(context != nullptr);
+  CHECK_PARAM(fns != nullptr || n == 0);
+  CHECK_PARAM(n >= 0);
+
+  for (int i = 0; i < n; ++i) {
+    CHECK_PARAM(fns[i] != nullptr);
+  }
+
+  try {
+    auto ctx = api::ObjectRegister::Get<objects::Context>(context);
+
+    std::vector<std::pair<void (*)(void*), void*>> batch;
+    batch.reserve(static_cast<std::size_t>(n));
+    for (int i = 0; i < n; ++i) {
+      batch.emplace_back(fns[i], userargs ? userargs[i] : nullptr);
+    }
+
+    ctx->PostBatch(std::move(batch));
+  }
+  CATCH_AND_RETURN;
+}
+
+YOGI_API int YOGI_ContextConfigureStats(void* context, int enable,
+                                       long long slow_threshold) {
+  CHECK_PARAM(context != nullptr);
+  CHECK_PARAM(enable == YOGI_TRUE || enable == YOGI_FALSE);
+  CHECK_PARAM(slow_threshold >= -1);
+
+  try {
+    auto ctx = api::ObjectRegister::Get<objects::Context>(context);
+    ctx->ConfigureLoopStats(enable == YOGI_TRUE,
+                            ConvertDuration(slow_threshold));
+  }
+  CATCH_AND_RETURN;
+}
+
+YOGI_API int YOGI_ContextGetStats(void* context, char* json, int jsonsize,
+                                  int reset) {
+  CHECK_PARAM(context != nullptr);
+  CHECK_PARAM(json == nullptr || jsonsize > 0);
+  CHECK_PARAM(reset == YOGI_TRUE || reset == YOGI_FALSE);
+
+  try {
+    auto ctx = api::ObjectRegister::Get<objects::Context>(context);
+    if (!CopyStringToUserBuffer(ctx->MakeLoopStatsString(reset == YOGI_TRUE),
+                                json, jsonsize)) {
+      return YOGI_ERR_BUFFER_TOO_SMALL;
+    }
+  }
+  CATCH_AND_RETURN;
+}
+
+YOGI_API int YOGI_ContextGroupCreate(void** group, int num_contexts) {
+  CHECK_PARAM(group != nullptr);
+  CHECK_PARAM(num_contexts >= 0);
+
+  try {
+    auto n = static_cast<std::size_t>(num_contexts);
+    if (n == 0) {
+      n = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    auto grp = objects::ContextGroup::Create(n);
+    for (auto& ctx : grp->GetContexts()) {
+      api::ObjectRegister::Register(ctx);
+    }
+
+    *group = api::ObjectRegister::Register(grp);
+  }
+  CATCH_AND_RETURN;
+}
+
+YOGI_API int YOGI_ContextGroupGetContext(void* group, int index,
+                                         void** context) {
+  CHECK_PARAM(group != nullptr);
+  CHECK_PARAM(index >= 0);
+  CHECK_PARAM(context != nullptr);
+
+  try {
+    auto grp = api::ObjectRegister::Get<objects::ContextGroup>(group);
+
+    auto& contexts = grp->GetContexts();
+    if (static_cast<std::size_t>(index) >= contexts.size()) {
+      return YOGI_ERR_INVALID_PARAM;
+    }
+
+    *context = contexts[static_cast<std::size_t>(index)]->Handle();
+  }
+  CATCH_AND_RETURN;
+}
+
+YOGI_API int YOGI_ContextGroupRunInBackground(void* group, int pin) {
+  CHECK_PARAM(group != nullptr);
+  CHECK_PARAM(pin == YOGI_TRUE || pin == YOGI_FALSE);
+
+  try {
+    auto grp = api::ObjectRegister::Get<objects::ContextGroup>(group);
+    grp->RunInBackground(pin == YOGI_TRUE);
+  }
+  CATCH_AND_RETURN;
+}
+
+YOGI_API int YOGI_ContextGroupStop(void* group) {
+  CHECK_PARAM(group != nullptr);
+
+  try {
+    auto grp = api::ObjectRegister::Get<objects::ContextGroup>(group);
+    grp->Stop();
+  }
+  CATCH_AND_RETURN;
+}
+
+YOGI_API int YOGI_ContextGroupWaitForStopped(void* group, long long duration) {
+  CHECK_PARAM(group != nullptr);
+  CHECK_PARAM(duration >= -1);
+
+  try {
+    auto grp = api::ObjectRegister::Get<objects::ContextGroup>(group);
+    if (!grp->WaitForStopped(ConvertDuration(duration))) {
+      return YOGI_ERR_TIMEOUT;
+    }
+  }
+  CATCH_AND_RETURN;
+}
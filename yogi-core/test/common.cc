@@ -23,10 +23,30 @@
 
 #include <boost/uuid/uuid_io.hpp>
 #include <boost/asio.hpp>
+#include <cstdlib>
+#include <new>
 using namespace std::string_literals;
 
 namespace fs = boost::filesystem;
 
+namespace {
+
+thread_local std::size_t heap_allocation_count = 0;
+
+}  // anonymous namespace
+
+void* operator new(std::size_t size) {
+  ++heap_allocation_count;
+  if (auto p = std::malloc(size ? size : 1)) return p;
+  throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) { return operator new(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
 TestFixture::TestFixture() {
   // SetupLogging(YOGI_VB_TRACE);
 }
@@ -185,7 +205,12 @@ FakeBranch::FakeBranch()
   info_ = std::make_shared<objects::detail::LocalBranchInfo>(
       "Fake Branch", "", utils::GetHostname(), "/Fake Branch", ifs, adv_ep_,
       acceptor_.local_endpoint(), 1s, 1s, false, api::kMinTxQueueSize,
-      api::kMinRxQueueSize, std::numeric_limits<std::size_t>::max());
+      api::kMinRxQueueSize, std::numeric_limits<std::size_t>::max(),
+      std::chrono::nanoseconds::zero(), std::numeric_limits<std::size_t>::max(),
+      std::numeric_limits<std::size_t>::max(), 1, 0,
+      network::SlowConsumerPolicy::kBlock,
+      std::numeric_limits<std::size_t>::max(), 1s,
+      std::numeric_limits<std::size_t>::max());
 }
 
 void FakeBranch::Connect(void* branch,
@@ -436,6 +461,8 @@ std::string ReadFile(const std::string& filename) {
   return content;
 }
 
+std::size_t GetHeapAllocationCount() { return heap_allocation_count; }
+
 std::ostream& operator<<(std::ostream& os,
                          const std::chrono::nanoseconds& dur) {
   os << dur.count() << "ns";
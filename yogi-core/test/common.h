@@ -156,6 +156,7 @@ class FakeBranch final {
   void Advertise(std::function<void(utils::ByteVector*)> msg_changer = {});
 
   bool IsConnectedTo(void* branch) const;
+  boost::uuids::uuid GetUuid() const { return info_->GetUuid(); }
 
  private:
   void Authenticate(std::function<void(utils::ByteVector*)> info_changer);
@@ -217,6 +218,10 @@ T GetBranchProperty(void* branch, const char* property) {
 
 std::string ReadFile(const std::string& filename);
 
+// Number of heap allocations done by the calling thread so far (counted by
+// the test binary's replacement of the global operator new)
+std::size_t GetHeapAllocationCount();
+
 std::ostream& operator<<(std::ostream& os, const std::chrono::nanoseconds& dur);
 std::ostream& operator<<(std::ostream& os,
                          const std::chrono::microseconds& dur);
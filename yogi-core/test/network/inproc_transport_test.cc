@@ -0,0 +1,191 @@
+/*
+ * This file is part of the Yogi distribution https://github.com/yohummus/yogi.
+ * Copyright (c) 2018 Johannes Bergmann.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "../common.h"
+#include "../../src/network/inproc_transport.h"
+
+using namespace std::chrono_literals;
+
+class InProcTransportTest : public TestFixture {
+ protected:
+  virtual void SetUp() override {
+    listener_ = network::InProcTransport::Listen(
+        context_, "server", 10s, std::numeric_limits<std::size_t>::max(),
+        [&](auto& res, auto transport) {
+          EXPECT_EQ(res, api::kSuccess);
+          server_ = transport;
+        });
+  }
+
+  void Connect() {
+    network::InProcTransport::ConnectAsync(
+        context_, "server", 10s, std::numeric_limits<std::size_t>::max(),
+        [&](auto& res, auto transport) {
+          ASSERT_EQ(res, api::kSuccess);
+          client_ = transport;
+        });
+
+    while (!server_ || !client_) {
+      context_->RunOne(100us);
+    }
+  }
+
+  void Transfer(network::TransportPtr from, network::TransportPtr to,
+                std::size_t size) {
+    utils::ByteVector data(size);
+    for (std::size_t i = 0; i < size; ++i) {
+      data[i] = static_cast<utils::Byte>(i * 7);
+    }
+
+    bool sent = false;
+    from->SendAllAsync(boost::asio::buffer(data), [&](auto& res) {
+      EXPECT_EQ(res, api::kSuccess);
+      sent = true;
+    });
+
+    bool received = false;
+    utils::ByteVector buffer(size);
+    to->ReceiveAllAsync(boost::asio::buffer(buffer), [&](auto& res) {
+      EXPECT_EQ(res, api::kSuccess);
+      received = true;
+    });
+
+    while (!sent || !received) {
+      context_->RunOne(100us);
+    }
+
+    EXPECT_EQ(data, buffer);
+  }
+
+  objects::ContextPtr context_ = objects::Context::Create();
+  network::InProcTransport::ListenerPtr listener_;
+  network::TransportPtr server_;
+  network::TransportPtr client_;
+};
+
+TEST_F(InProcTransportTest, Listen) {
+  EXPECT_TRUE(network::InProcTransport::IsListening("server"));
+  EXPECT_FALSE(network::InProcTransport::IsListening("foo"));
+
+  EXPECT_THROW(network::InProcTransport::Listen(
+                   context_, "server", 10s,
+                   std::numeric_limits<std::size_t>::max(), {}),
+               api::Error);
+
+  listener_.reset();
+  EXPECT_FALSE(network::InProcTransport::IsListening("server"));
+}
+
+TEST_F(InProcTransportTest, Connect) {
+  Connect();
+
+  EXPECT_TRUE(server_->CreatedFromIncomingConnectionRequest());
+  EXPECT_EQ(server_->GetPeerDescription(), "inproc:server (client)");
+  EXPECT_FALSE(client_->CreatedFromIncomingConnectionRequest());
+  EXPECT_EQ(client_->GetPeerDescription(), "inproc:server");
+}
+
+TEST_F(InProcTransportTest, ConnectToUnknownName) {
+  bool called = false;
+  network::InProcTransport::ConnectAsync(
+      context_, "foo", 10s, std::numeric_limits<std::size_t>::max(),
+      [&](auto& res, auto transport) {
+        EXPECT_EQ(res, api::Error(YOGI_ERR_CONNECT_SOCKET_FAILED));
+        EXPECT_FALSE(!!transport);
+        called = true;
+      });
+
+  while (!called) {
+    context_->RunOne(100us);
+  }
+}
+
+TEST_F(InProcTransportTest, SendAndReceive) {
+  Connect();
+  Transfer(client_, server_, 100);
+  Transfer(server_, client_, 100);
+}
+
+TEST_F(InProcTransportTest, LargeTransfers) {
+  // Larger than the ring buffers, so both sides have to wait for each other
+  Connect();
+  Transfer(client_, server_, 1024 * 1024 + 13);
+  Transfer(server_, client_, 1024 * 1024 + 13);
+}
+
+TEST_F(InProcTransportTest, ReceiveDataSentBeforeClose) {
+  Connect();
+
+  utils::ByteVector data = {1, 2, 3};
+  bool sent = false;
+  client_->SendAllAsync(boost::asio::buffer(data), [&](auto& res) {
+    EXPECT_EQ(res, api::kSuccess);
+    sent = true;
+  });
+
+  while (!sent) {
+    context_->RunOne(100us);
+  }
+
+  client_.reset();
+
+  utils::ByteVector buffer(data.size() + 1);
+  api::Result result;
+  std::size_t bytes_read = 0;
+  server_->ReceiveSomeAsync(boost::asio::buffer(buffer), [&](auto& res,
+                                                             auto n) {
+    result = res;
+    bytes_read = n;
+  });
+
+  while (bytes_read == 0) {
+    context_->RunOne(100us);
+  }
+
+  EXPECT_EQ(result, api::kSuccess);
+  EXPECT_EQ(bytes_read, data.size());
+
+  bool called = false;
+  server_->ReceiveSomeAsync(boost::asio::buffer(buffer), [&](auto& res,
+                                                             auto) {
+    EXPECT_EQ(res, api::Error(YOGI_ERR_RW_SOCKET_FAILED));
+    called = true;
+  });
+
+  while (!called) {
+    context_->RunOne(100us);
+  }
+}
+
+TEST_F(InProcTransportTest, CancelReceive) {
+  Connect();
+
+  utils::ByteVector buffer(10);
+  bool called = false;
+  client_->ReceiveSomeAsync(boost::asio::buffer(buffer), [&](auto& res,
+                                                             auto) {
+    EXPECT_EQ(res, api::Error(YOGI_ERR_CANCELED));
+    called = true;
+  });
+
+  client_->Close();
+
+  while (!called) {
+    context_->RunOne(100us);
+  }
+}
@@ -157,6 +157,39 @@ TEST(MessagesTest, SerializeShared) {
   EXPECT_EQ(*bytes, (utils::SmallByteVector{1, 2, 3}));
 }
 
+TEST(MessagesTest, SerializedBuffersBorrowPayload) {
+  auto data = utils::SmallByteVector{0x93, 0x1, 0x2, 0x3};
+  auto payload = Payload(boost::asio::buffer(data.data(), data.size()),
+                         api::Encoding::kMsgPack);
+  messages::BroadcastOutgoing msg(payload);
+
+  auto bufs = msg.GetSerializedBuffers();
+  EXPECT_EQ(bufs[0].size(), 1);
+  EXPECT_EQ(bufs[1].data(), data.data());
+  EXPECT_EQ(bufs[1].size(), data.size());
+  EXPECT_EQ(msg.GetSize(), data.size() + 1);
+
+  auto expected = FakeOutgoingMessage::MakeMsgBytes(payload);
+  EXPECT_EQ(msg.Serialize(), expected);
+
+  auto bytes = msg.SerializeShared();
+  data[1] = 0x7;
+  EXPECT_EQ(*bytes, expected);
+  bufs = msg.GetSerializedBuffers();
+  EXPECT_EQ(bufs[0].size(), expected.size());
+  EXPECT_EQ(bufs[1].size(), 0);
+}
+
+TEST(MessagesTest, SerializedBuffersConvertJsonPayload) {
+  auto payload =
+      Payload(boost::asio::buffer("[1,2,3]"), api::Encoding::kJson);
+  messages::BroadcastOutgoing msg(payload);
+
+  auto bufs = msg.GetSerializedBuffers();
+  EXPECT_EQ(bufs[1].size(), 0);
+  EXPECT_EQ(msg.Serialize(), FakeOutgoingMessage::MakeMsgBytes(payload));
+}
+
 TEST(MessagesTest, Deserialize) {
   utils::ByteVector bytes = {MessageType::kBroadcast, 0x93, 0x01, 0x02, 0x03};
 
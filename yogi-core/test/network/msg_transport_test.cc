@@ -22,6 +22,7 @@ using namespace network;
 #include <random>
 #include <atomic>
 #include <algorithm>
+#include <tuple>
 
 class FakeOutgoingMessage : public OutgoingMessage,
                             public MessageT<MessageType::kBroadcast> {
@@ -45,28 +46,47 @@ class FakeTransport : public Transport {
   std::size_t tx_send_limit = std::numeric_limits<std::size_t>::max();
   bool dead = false;
 
+  // Writes only get executed once they are released
+  void HoldWrites() { hold_writes_ = true; }
+
+  void ReleaseWrites() {
+    hold_writes_ = false;
+    for (auto& write : held_writes_) {
+      WriteSomeAsync(write.first, write.second);
+    }
+
+    held_writes_.clear();
+  }
+
  protected:
-  virtual void WriteSomeAsync(boost::asio::const_buffer data,
+  virtual void WriteSomeAsync(const ConstBufferSequence& data,
                               TransferSomeHandler handler) override {
+    if (hold_writes_) {
+      held_writes_.push_back(std::make_pair(data, handler));
+      return;
+    }
+
     static std::default_random_engine gen;
-    std::uniform_int_distribution<std::size_t> dist(1, data.size());
+    std::uniform_int_distribution<std::size_t> dist(
+        1, boost::asio::buffer_size(data));
     auto n = std::min(dist(gen), tx_send_limit);
-    auto p = static_cast<const char*>(data.data());
 
-    tx_data.insert(tx_data.end(), p, p + n);
+    auto old_size = tx_data.size();
+    tx_data.resize(old_size + n);
+    boost::asio::buffer_copy(boost::asio::buffer(tx_data) + old_size, data);
 
     PostHandler(handler, n);
   }
 
-  virtual void ReadSomeAsync(boost::asio::mutable_buffer data,
+  virtual void ReadSomeAsync(const MutableBufferSequence& data,
                              TransferSomeHandler handler) override {
     if (rx_data.empty()) return;
 
     static std::default_random_engine gen;
     std::uniform_int_distribution<std::size_t> dist(
-        1, std::min(data.size(), rx_data.size()));
+        1, std::min(boost::asio::buffer_size(data), rx_data.size()));
     auto n = dist(gen);
-    std::copy_n(rx_data.begin(), n, static_cast<char*>(data.data()));
+    boost::asio::buffer_copy(data, boost::asio::buffer(rx_data, n));
     rx_data.erase(
         rx_data.begin(),
         rx_data.begin() + static_cast<utils::ByteVector::difference_type>(n));
@@ -77,6 +97,10 @@ class FakeTransport : public Transport {
   virtual void Shutdown() override { dead = true; }
 
  private:
+  bool hold_writes_ = false;
+  std::vector<std::pair<ConstBufferSequence, TransferSomeHandler>>
+      held_writes_;
+
   void PostHandler(TransferSomeHandler handler, std::size_t bytes_transferred) {
     if (dead) {
       GetContext()->Post([=] {
@@ -206,6 +230,18 @@ TEST_F(MessageTransportTest, TrySend) {
   EXPECT_EQ(transport_->tx_data, MakeTransportBytes(5, msg, 5, msg));
 }
 
+TEST_F(MessageTransportTest, LastSendTime) {
+  auto time_before = uut_->GetLastSendTime();
+  EXPECT_LE(time_before, std::chrono::steady_clock::now());
+
+  uut_->Start();
+  EXPECT_TRUE(uut_->TrySend(MakeMessage(5)));
+  EXPECT_EQ(uut_->GetLastSendTime(), time_before);
+
+  context_->Poll();
+  EXPECT_GT(uut_->GetLastSendTime(), time_before);
+}
+
 TEST_F(MessageTransportTest, TrySendTransportFailure) {
   uut_->Start();
 
@@ -279,6 +315,138 @@ TEST_F(MessageTransportTest, CancelSend) {
   EXPECT_TRUE(called);
 }
 
+TEST_F(MessageTransportTest, CancelSendPreservesOrder) {
+  uut_->Start();
+
+  auto msg = MakeMessage(6);
+  EXPECT_TRUE(uut_->TrySend(msg));
+
+  std::vector<int> results;
+  for (int tag = 1; tag <= 4; ++tag) {
+    uut_->SendAsync(&msg, tag, [&, tag](auto& res) {
+      results.push_back(res == api::kSuccess ? tag : -tag);
+    });
+  }
+
+  EXPECT_TRUE(uut_->CancelSend(2));
+  EXPECT_TRUE(uut_->CancelSend(4));
+
+  // Canceled operation tags are free to be used again
+  uut_->SendAsync(&msg, 2, [&](auto& res) {
+    results.push_back(res == api::kSuccess ? 5 : -5);
+  });
+
+  while (results.size() < 5) {
+    context_->Poll();
+  }
+
+  EXPECT_EQ(results, (std::vector<int>{-2, -4, 1, 3, 5}));
+}
+
+TEST_F(MessageTransportTest, PendingSendsScale) {
+  auto uut = std::make_shared<MessageTransport>(transport_, 8, 8);
+  auto msg = MakeMessage(6);
+
+  // Enqueues and cancels n sends in the worst order for a linear search and
+  // returns the number of heap allocations that took
+  auto fn = [&](std::size_t n) {
+    EXPECT_TRUE(uut->TrySend(msg));
+
+    auto allocs_before = GetHeapAllocationCount();
+    for (int tag = 1; tag <= static_cast<int>(n); ++tag) {
+      uut->SendAsync(&msg, tag, [](auto&) {});
+    }
+
+    for (int tag = static_cast<int>(n); tag > 0; --tag) {
+      EXPECT_TRUE(uut->CancelSend(tag));
+    }
+
+    auto allocs = GetHeapAllocationCount() - allocs_before;
+    context_->Poll();
+    return allocs;
+  };
+
+  // The first round at each size populates the node pool and sizes the tag
+  // index. Afterwards, list nodes get reused and the allocations per
+  // operation must not depend on how many operations are pending.
+  const std::size_t n = 10000;
+  auto first = fn(n);
+  auto small = fn(n);
+  EXPECT_LT(small, first);
+  EXPECT_LE(small, 3 * n);
+
+  fn(10 * n);
+  auto big = fn(10 * n);
+  EXPECT_LE(big, 10 * small + n);
+}
+
+TEST_F(MessageTransportTest, CoalescingDelay) {
+  uut_ = std::make_shared<MessageTransport>(transport_, 100, 8);
+  uut_->EnableCoalescing(std::chrono::milliseconds(20),
+                         std::numeric_limits<std::size_t>::max());
+  uut_->Start();
+
+  auto msg = MakeMessage(5);
+  EXPECT_TRUE(uut_->TrySend(msg));
+  EXPECT_TRUE(uut_->TrySend(msg));
+  context_->Poll();
+  EXPECT_TRUE(transport_->tx_data.empty());
+
+  auto start = std::chrono::steady_clock::now();
+  while (transport_->tx_data.size() < 12) {
+    context_->RunOne(std::chrono::milliseconds(1));
+  }
+
+  EXPECT_GE(std::chrono::steady_clock::now() - start,
+            std::chrono::milliseconds(15));
+  EXPECT_EQ(transport_->tx_data, MakeTransportBytes(5, msg, 5, msg));
+}
+
+TEST_F(MessageTransportTest, CoalescingBytes) {
+  uut_ = std::make_shared<MessageTransport>(transport_, 100, 8);
+  uut_->EnableCoalescing(std::chrono::hours(1), 10);
+  uut_->Start();
+
+  auto msg = MakeMessage(5);
+  EXPECT_TRUE(uut_->TrySend(msg));
+  context_->Poll();
+  EXPECT_TRUE(transport_->tx_data.empty());
+
+  EXPECT_TRUE(uut_->TrySend(msg));
+  context_->Poll();
+  EXPECT_EQ(transport_->tx_data, MakeTransportBytes(5, msg, 5, msg));
+}
+
+TEST_F(MessageTransportTest, DeferredRelease) {
+  auto log = std::make_shared<BroadcastLog>(6);
+  uut_->DeferReleaseOfSentBytes();
+  uut_->Start();
+  uut_->AttachBroadcastLog(log);
+
+  // Written data occupies the TX queue and the log until it gets released
+  auto msg = MakeMessage(5);
+  EXPECT_TRUE(uut_->TrySend(msg));
+  EXPECT_TRUE(log->TryAppend(msg));
+  context_->Poll();
+  EXPECT_EQ(transport_->tx_data, MakeTransportBytes(5, msg, 5, msg));
+  EXPECT_FALSE(uut_->TrySend(msg));
+  EXPECT_FALSE(log->TryAppend(msg));
+
+  uut_->ReleaseSentBytes(6);
+  EXPECT_TRUE(uut_->TrySend(msg));
+  EXPECT_FALSE(log->TryAppend(msg));
+  uut_->ReleaseSentBytes(6);
+  EXPECT_TRUE(log->TryAppend(msg));
+
+  // Releases may overtake the completion of the writes
+  uut_->ReleaseSentBytes(12);
+  context_->Poll();
+  EXPECT_EQ(transport_->tx_data,
+            MakeTransportBytes(5, msg, 5, msg, 5, msg, 5, msg));
+  EXPECT_TRUE(uut_->TrySend(msg));
+  EXPECT_TRUE(log->TryAppend(msg));
+}
+
 TEST_F(MessageTransportTest, ReceiveAsync) {
   transport_->rx_data = utils::ByteVector{5, 1, 2, 3, 4, 5, 4, 1, 2, 3, 4};
   uut_->Start();
@@ -325,6 +493,61 @@ TEST_F(MessageTransportTest, ReceiveAsyncTransportFailure) {
   EXPECT_TRUE(called);
 }
 
+TEST_F(MessageTransportTest, ReceiveLeaseAsync) {
+  transport_->rx_data = utils::ByteVector{5, 1, 2, 3, 4, 5, 4, 1, 2, 3, 4};
+  uut_->Start();
+  context_->Poll();
+
+  utils::ByteVector data;
+  bool called = false;
+  auto handler = [&](auto& res, auto msg) {
+    EXPECT_EQ(res, api::kSuccess);
+    auto begin = static_cast<const utils::Byte*>(msg.data());
+    data.assign(begin, begin + msg.size());
+    called = true;
+  };
+
+  uut_->ReceiveLeaseAsync(handler);
+  context_->Poll();
+  EXPECT_TRUE(called);
+  EXPECT_EQ(data, (utils::ByteVector{1, 2, 3, 4, 5}));
+
+  // The second message wraps around the end of the RX queue
+  uut_->ReleaseLeasedReceive();
+  context_->Poll();
+  called = false;
+  uut_->ReceiveLeaseAsync(handler);
+  context_->Poll();
+  EXPECT_TRUE(called);
+  EXPECT_EQ(data, (utils::ByteVector{1, 2, 3, 4}));
+  uut_->ReleaseLeasedReceive();
+}
+
+TEST_F(MessageTransportTest, TryReceiveLease) {
+  transport_->rx_data = utils::ByteVector{2, 1, 2, 1, 3, 0, 3, 4, 5, 6};
+
+  boost::asio::const_buffer msg;
+  EXPECT_FALSE(uut_->TryReceiveLease(&msg));
+
+  uut_->Start();
+  context_->Poll();
+
+  std::vector<utils::ByteVector> msgs;
+  while (uut_->TryReceiveLease(&msg)) {
+    auto begin = static_cast<const utils::Byte*>(msg.data());
+    msgs.push_back(utils::ByteVector(begin, begin + msg.size()));
+    uut_->ReleaseLeasedReceive();
+  }
+
+  // Only the first three messages fit into the RX queue in one go
+  EXPECT_EQ(msgs, (std::vector<utils::ByteVector>{{1, 2}, {3}, {}}));
+
+  context_->Poll();
+  EXPECT_TRUE(uut_->TryReceiveLease(&msg));
+  EXPECT_EQ(msg.size(), 3);
+  uut_->ReleaseLeasedReceive();
+}
+
 TEST_F(MessageTransportTest, CancelReceive) {
   uut_->Start();
 
@@ -479,3 +702,357 @@ TEST_F(MessageTransportTest, Stress) {
   EXPECT_EQ(received_msgs_bytes.size(), sent_msgs_bytes.size());
   EXPECT_EQ(received_msgs_bytes, sent_msgs_bytes);
 }
+
+TEST_F(MessageTransportTest, ConcurrentProducers) {
+  const int kMsgsPerThread = 1000;
+
+  for (int num_threads : {1, 2, 4, 8, 16}) {
+    transport_->tx_data.clear();
+    uut_ = std::make_shared<MessageTransport>(transport_, 64, 8);
+    context_->RunInBackground();
+
+    std::atomic<int> num_sent{0};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+      threads.emplace_back([&, i] {
+        for (int seq = 0; seq < kMsgsPerThread; ++seq) {
+          auto msg = FakeOutgoingMessage(
+              {FakeOutgoingMessage::kMessageType, static_cast<utils::Byte>(i),
+               static_cast<utils::Byte>(seq >> 8),
+               static_cast<utils::Byte>(seq & 0xFF)});
+
+          if (seq % 2 && uut_->TrySend(msg)) {
+            ++num_sent;
+          } else {
+            uut_->SendAsync(&msg, [&](auto& res) {
+              EXPECT_EQ(res, api::kSuccess);
+              ++num_sent;
+            });
+          }
+        }
+      });
+    }
+
+    for (auto& thread : threads) thread.join();
+    while (num_sent < num_threads * kMsgsPerThread) {
+      std::this_thread::yield();
+    }
+
+    context_->Stop();
+    context_->WaitForStopped(std::chrono::seconds(1));
+
+    // Send handlers get called once a message has been queued, so the last
+    // messages may not have been written to the transport yet
+    auto& data = transport_->tx_data;
+    auto expected_size =
+        static_cast<std::size_t>(num_threads * kMsgsPerThread * 5);
+    auto timeout = std::chrono::steady_clock::now() + 5s;
+    while (data.size() < expected_size &&
+           std::chrono::steady_clock::now() < timeout) {
+      context_->Poll();
+    }
+
+    // Every message must have been sent and the order of the messages from
+    // each individual thread must be preserved
+    ASSERT_EQ(data.size(), expected_size);
+
+    std::vector<int> next_seqs(static_cast<std::size_t>(num_threads));
+    for (std::size_t i = 0; i < data.size(); i += 5) {
+      ASSERT_EQ(data[i], 4);
+      auto& next_seq = next_seqs[data[i + 2]];
+      EXPECT_EQ((data[i + 3] << 8) | data[i + 4], next_seq);
+      ++next_seq;
+    }
+  }
+}
+
+TEST_F(MessageTransportTest, BroadcastLog) {
+  auto transport2 = std::make_shared<FakeTransport>(context_);
+  auto uut2 = std::make_shared<MessageTransport>(transport2, 8, 8);
+
+  auto log = std::make_shared<BroadcastLog>(8);
+  uut_->Start();
+  uut_->AttachBroadcastLog(log);
+  uut2->Start();
+  uut2->AttachBroadcastLog(log);
+
+  // The second connection is stalled but does not hold back the first one;
+  // it only misses what does not fit into its own share of the log
+  transport2->HoldWrites();
+
+  auto msg = MakeMessage(5);
+  EXPECT_TRUE(log->TryAppend(msg));
+  context_->Poll();
+  EXPECT_FALSE(log->TryAppend(msg));
+  context_->Poll();
+  EXPECT_EQ(transport_->tx_data, MakeTransportBytes(5, msg, 5, msg));
+
+  bool called = false;
+  EXPECT_FALSE(log->AppendOrQueue(msg, 1, [&](auto& res) {
+    EXPECT_EQ(res, api::kSuccess);
+    called = true;
+  }));
+  context_->Poll();
+  EXPECT_EQ(transport_->tx_data, MakeTransportBytes(5, msg, 5, msg, 5, msg));
+  EXPECT_FALSE(called);
+
+  // Messages must not overtake queued ones
+  transport2->ReleaseWrites();
+  EXPECT_FALSE(log->TryAppend(msg));
+  context_->Poll();
+  EXPECT_TRUE(called);
+
+  EXPECT_EQ(transport_->tx_data,
+            MakeTransportBytes(5, msg, 5, msg, 5, msg, 5, msg));
+  EXPECT_EQ(transport2->tx_data, MakeTransportBytes(5, msg, 5, msg));
+
+  // Closing a connection completes the messages queued for it
+  transport2->HoldWrites();
+  EXPECT_TRUE(log->TryAppend(msg));
+  context_->Poll();
+  called = false;
+  EXPECT_FALSE(log->AppendOrQueue(msg, 2, [&](auto& res) {
+    EXPECT_EQ(res, api::kSuccess);
+    called = true;
+  }));
+  context_->Poll();
+  EXPECT_FALSE(called);
+  uut2.reset();
+  context_->Poll();
+  EXPECT_TRUE(called);
+  EXPECT_TRUE(log->TryAppend(msg));
+}
+
+TEST_F(MessageTransportTest, BroadcastLogOverflowBudget) {
+  auto transport2 = std::make_shared<FakeTransport>(context_);
+  auto uut2 = std::make_shared<MessageTransport>(transport2, 8, 8);
+  auto transport3 = std::make_shared<FakeTransport>(context_);
+  auto uut3 = std::make_shared<MessageTransport>(transport3, 8, 8);
+
+  // The budget only covers a single private queue
+  auto log = std::make_shared<BroadcastLog>(8, 1, SlowConsumerPolicy::kBlock,
+                                            0, 15);
+  uut_->Start();
+  uut_->AttachBroadcastLog(log);
+
+  int overruns2 = 0;
+  uut2->Start();
+  uut2->AttachBroadcastLog(log, {}, [&] { ++overruns2; });
+
+  int overruns3 = 0;
+  uut3->Start();
+  uut3->AttachBroadcastLog(log, {}, [&] { ++overruns3; });
+
+  // Both stalled connections fall behind but only the first one gets a queue
+  transport2->HoldWrites();
+  transport3->HoldWrites();
+
+  auto msg = MakeMessage(5);
+  EXPECT_TRUE(log->TryAppend(msg));
+  context_->Poll();
+  EXPECT_FALSE(log->TryAppend(msg));
+  context_->Poll();
+  EXPECT_EQ(transport_->tx_data, MakeTransportBytes(5, msg, 5, msg));
+  EXPECT_EQ(overruns2, 0);
+  EXPECT_EQ(overruns3, 1);
+
+  // The overrun connection completes its write but gets nothing after that,
+  // nor does it hold back any appends
+  transport2->ReleaseWrites();
+  transport3->ReleaseWrites();
+  context_->Poll();
+  EXPECT_TRUE(log->TryAppend(msg));
+  context_->Poll();
+
+  EXPECT_EQ(transport_->tx_data, MakeTransportBytes(5, msg, 5, msg, 5, msg));
+  EXPECT_EQ(transport2->tx_data, MakeTransportBytes(5, msg, 5, msg));
+  EXPECT_EQ(transport3->tx_data, MakeTransportBytes(5, msg));
+  EXPECT_EQ(overruns3, 1);
+
+  // The queue of the first connection can be reused once it caught up
+  transport2->HoldWrites();
+  EXPECT_TRUE(log->TryAppend(msg));
+  context_->Poll();
+  EXPECT_FALSE(log->TryAppend(msg));
+  context_->Poll();
+  EXPECT_EQ(overruns2, 0);
+}
+
+TEST_F(MessageTransportTest, BroadcastLogCursorsDoNotAllocate) {
+  auto log = std::make_shared<BroadcastLog>(100);
+  auto cursor1 = log->MakeCursor(context_, [] {});
+  auto cursor2 = log->MakeCursor(context_, [] {});
+
+  auto msg = MakeMessage(5);
+  for (int i = 0; i < 10; ++i) {
+    ASSERT_TRUE(log->TryAppend(msg));
+
+    auto allocs = GetHeapAllocationCount();
+    for (auto cursor : {cursor1.get(), cursor2.get()}) {
+      auto n = boost::asio::buffer_size(cursor->ReadArrays());
+      cursor->Advance(n);
+    }
+
+    if (i > 0) {
+      EXPECT_EQ(GetHeapAllocationCount(), allocs);
+    }
+  }
+}
+
+TEST_F(MessageTransportTest, BroadcastLogPartitions) {
+  auto context2 = std::make_shared<objects::Context>(3);
+
+  // Connections get spread evenly over the partitions of their context
+  std::vector<std::tuple<std::size_t, std::vector<std::size_t>,
+                         std::vector<std::size_t>>>
+      entries = {
+          {0, {5}, {2, 2, 1}},
+          {1, {5}, {5}},
+          {2, {3, 2}, {3, 2}},
+          {5, {1, 1, 1, 1, 1}, {1, 1, 1, 1, 1}},
+      };
+
+  for (auto& entry : entries) {
+    auto partitions = std::get<0>(entry);
+    auto log = std::make_shared<BroadcastLog>(100, partitions);
+
+    std::vector<std::shared_ptr<FakeTransport>> transports;
+    std::vector<MessageTransportPtr> uuts;
+    for (int i = 0; i < 10; ++i) {
+      auto& ctx = i % 2 ? context_ : context2;
+      transports.push_back(std::make_shared<FakeTransport>(ctx));
+      uuts.push_back(
+          std::make_shared<MessageTransport>(transports.back(), 100, 100));
+      uuts.back()->Start();
+      uuts.back()->AttachBroadcastLog(log);
+    }
+
+    EXPECT_EQ(log->GetPartitionSizes(context_), std::get<1>(entry))
+        << "partitions: " << partitions;
+    EXPECT_EQ(log->GetPartitionSizes(context2), std::get<2>(entry))
+        << "partitions: " << partitions;
+
+    auto msg = MakeMessage(5);
+    EXPECT_TRUE(log->TryAppend(msg));
+    context_->Poll();
+    context2->Poll();
+
+    // Every connection must get woken up, no matter which partition it is in
+    for (auto& transport : transports) {
+      EXPECT_EQ(transport->tx_data, MakeTransportBytes(5, msg));
+    }
+  }
+}
+
+TEST_F(MessageTransportTest, BroadcastLogSlowConsumerPolicies) {
+  for (auto policy :
+       {SlowConsumerPolicy::kDrop, SlowConsumerPolicy::kConflate}) {
+    auto transport2 = std::make_shared<FakeTransport>(context_);
+    auto uut2 = std::make_shared<MessageTransport>(transport2, 18, 18);
+
+    auto log = std::make_shared<BroadcastLog>(18, 1, policy, 6);
+    uut_ = std::make_shared<MessageTransport>(transport_, 18, 18);
+    transport_->tx_data.clear();
+    uut_->Start();
+    uut_->AttachBroadcastLog(log);
+
+    std::vector<std::size_t> backlogs;
+    uut2->Start();
+    uut2->AttachBroadcastLog(log, [&](auto backlog) {
+      backlogs.push_back(backlog);
+    });
+
+    // The second connection gets stuck while writing the first message
+    transport2->HoldWrites();
+    auto msg_a = MakeMessage(5);
+    EXPECT_TRUE(log->TryAppend(msg_a));
+    context_->Poll();
+
+    auto msg_b = MakeMessage(5);
+    auto msg_c = MakeMessage(5);
+    EXPECT_TRUE(log->TryAppend(msg_b));
+    context_->Poll();
+    EXPECT_TRUE(log->TryAppend(msg_c));
+    context_->Poll();
+    EXPECT_EQ(backlogs, std::vector<std::size_t>{12});
+
+    EXPECT_EQ(transport_->tx_data,
+              MakeTransportBytes(5, msg_a, 5, msg_b, 5, msg_c));
+
+    // Data being written cannot be skipped
+    transport2->ReleaseWrites();
+    context_->Poll();
+    auto msg_d = MakeMessage(5);
+    EXPECT_TRUE(log->TryAppend(msg_d));
+    context_->Poll();
+
+    EXPECT_EQ(transport_->tx_data,
+              MakeTransportBytes(5, msg_a, 5, msg_b, 5, msg_c, 5, msg_d));
+    if (policy == SlowConsumerPolicy::kDrop) {
+      EXPECT_EQ(transport2->tx_data, MakeTransportBytes(5, msg_a, 5, msg_d));
+    } else {
+      EXPECT_EQ(transport2->tx_data,
+                MakeTransportBytes(5, msg_a, 5, msg_c, 5, msg_d));
+    }
+  }
+}
+
+TEST_F(MessageTransportTest, CancelBroadcastLogAppend) {
+  auto log = std::make_shared<BroadcastLog>(8);
+  transport_->HoldWrites();
+  uut_->Start();
+  uut_->AttachBroadcastLog(log);
+
+  auto msg = MakeMessage(5);
+  EXPECT_TRUE(log->TryAppend(msg));
+
+  bool called = false;
+  EXPECT_FALSE(log->AppendOrQueue(msg, 123, [&](auto& res) {
+    EXPECT_EQ(res, api::Error(YOGI_ERR_CANCELED));
+    called = true;
+  }));
+  EXPECT_TRUE(log->CancelQueued(123));
+  EXPECT_TRUE(called);
+  EXPECT_FALSE(log->CancelQueued(123));
+}
+
+TEST_F(MessageTransportTest, BroadcastLogInterleaving) {
+  const std::size_t kQueueSize = 300;
+  uut_ = std::make_shared<MessageTransport>(transport_, kQueueSize, kQueueSize);
+  auto log = std::make_shared<BroadcastLog>(kQueueSize);
+  uut_->Start();
+  uut_->AttachBroadcastLog(log);
+
+  // Messages from the TX queue and the log must never get mixed up, even
+  // though the transport only writes parts of the data at a time
+  std::vector<FakeOutgoingMessage> msgs;
+  for (std::size_t i = 1; i < 100; ++i) {
+    msgs.push_back(MakeMessage(i));
+  }
+
+  std::size_t expected_size = 0;
+  for (std::size_t i = 0; i < msgs.size(); ++i) {
+    auto& msg = msgs[i];
+    bool sent;
+    do {
+      sent = i % 2 ? log->TryAppend(msg) : uut_->TrySend(msg);
+      context_->PollOne();
+    } while (!sent);
+
+    expected_size += 1 + msg.Serialize().size();
+  }
+
+  auto& data = transport_->tx_data;
+  while (data.size() < expected_size) {
+    context_->Poll();
+  }
+
+  ASSERT_EQ(data.size(), expected_size);
+  for (std::size_t i = 0; i < data.size(); i += 1u + data[i]) {
+    auto size = static_cast<std::size_t>(data[i]);
+    ASSERT_GT(size, 0u);
+    auto& msg = msgs[size - 1].Serialize();
+    EXPECT_TRUE(std::equal(msg.begin(), msg.end(), data.begin() +
+                           static_cast<std::ptrdiff_t>(i + 1)));
+  }
+}
@@ -0,0 +1,171 @@
+/*
+ * This file is part of the Yogi distribution https://github.com/yohummus/yogi.
+ * Copyright (c) 2018 Johannes Bergmann.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "../common.h"
+#include "../../src/network/shm_transport.h"
+
+#ifdef YOGI_HAS_SHM_TRANSPORT
+
+#include <boost/uuid/uuid_io.hpp>
+#include <boost/uuid/uuid_generators.hpp>
+
+using namespace std::chrono_literals;
+
+class ShmTransportTest : public TestFixture {
+ protected:
+  virtual void SetUp() override {
+    name_ = "yogi-test-" +
+            boost::uuids::to_string(boost::uuids::random_generator()());
+    auto ep = network::UnixTransport::MakeAbstractEndpoint(name_);
+    acceptor_.open(ep.protocol());
+    acceptor_.bind(ep);
+    acceptor_.listen();
+
+    auto accept_guard = network::UnixTransport::AcceptAsync(
+        context_, &acceptor_, 10s, std::numeric_limits<std::size_t>::max(),
+        [&](auto& res, auto transport, auto) {
+          ASSERT_EQ(res, api::kSuccess);
+          server_ = transport;
+        });
+
+    auto connect_guard = network::UnixTransport::ConnectAsync(
+        context_, name_, 10s, std::numeric_limits<std::size_t>::max(), true,
+        [&](auto& res, auto transport, auto) {
+          ASSERT_EQ(res, api::kSuccess);
+          client_ = transport;
+        });
+
+    while (!server_ || !client_) {
+      context_->RunOne(100us);
+    }
+  }
+
+  void Transfer(network::TransportPtr from, network::TransportPtr to,
+                std::size_t size) {
+    utils::ByteVector data(size);
+    for (std::size_t i = 0; i < size; ++i) {
+      data[i] = static_cast<utils::Byte>(i * 7);
+    }
+
+    bool sent = false;
+    from->SendAllAsync(boost::asio::buffer(data), [&](auto& res) {
+      EXPECT_EQ(res, api::kSuccess);
+      sent = true;
+    });
+
+    bool received = false;
+    utils::ByteVector buffer(size);
+    to->ReceiveAllAsync(boost::asio::buffer(buffer), [&](auto& res) {
+      EXPECT_EQ(res, api::kSuccess);
+      received = true;
+    });
+
+    while (!sent || !received) {
+      context_->RunOne(100us);
+    }
+
+    EXPECT_EQ(data, buffer);
+  }
+
+  objects::ContextPtr context_ = objects::Context::Create();
+  std::string name_;
+  network::UnixTransport::Acceptor acceptor_{context_->IoContext()};
+  network::TransportPtr server_;
+  network::TransportPtr client_;
+};
+
+TEST_F(ShmTransportTest, Handshake) {
+  EXPECT_TRUE(!!std::dynamic_pointer_cast<network::ShmTransport>(server_));
+  EXPECT_TRUE(server_->CreatedFromIncomingConnectionRequest());
+  EXPECT_TRUE(!!std::dynamic_pointer_cast<network::ShmTransport>(client_));
+  EXPECT_FALSE(client_->CreatedFromIncomingConnectionRequest());
+  EXPECT_EQ(client_->GetPeerDescription(), '@' + name_);
+}
+
+TEST_F(ShmTransportTest, SendAndReceive) {
+  Transfer(client_, server_, 100);
+  Transfer(server_, client_, 100);
+}
+
+TEST_F(ShmTransportTest, LargeTransfers) {
+  // Larger than the ring buffers, so both sides have to wait for each other
+  Transfer(client_, server_, 1024 * 1024 + 13);
+  Transfer(server_, client_, 1024 * 1024 + 13);
+}
+
+TEST_F(ShmTransportTest, ReceiveFailure) {
+  utils::ByteVector buffer(10);
+  bool called = false;
+  server_->ReceiveSomeAsync(boost::asio::buffer(buffer), [&](auto& res,
+                                                             auto) {
+    EXPECT_EQ(res, api::Error(YOGI_ERR_RW_SOCKET_FAILED));
+    called = true;
+  });
+
+  client_->Close();
+
+  while (!called) {
+    context_->RunOne(100us);
+  }
+}
+
+TEST_F(ShmTransportTest, ReceiveDataSentBeforeClose) {
+  utils::ByteVector data = {1, 2, 3};
+  bool sent = false;
+  client_->SendAllAsync(boost::asio::buffer(data), [&](auto& res) {
+    EXPECT_EQ(res, api::kSuccess);
+    sent = true;
+  });
+
+  while (!sent) {
+    context_->RunOne(100us);
+  }
+
+  client_->Close();
+
+  utils::ByteVector buffer(data.size());
+  bool received = false;
+  server_->ReceiveAllAsync(boost::asio::buffer(buffer), [&](auto& res) {
+    EXPECT_EQ(res, api::kSuccess);
+    received = true;
+  });
+
+  while (!received) {
+    context_->RunOne(100us);
+  }
+
+  EXPECT_EQ(data, buffer);
+}
+
+TEST_F(ShmTransportTest, CancelReceive) {
+  utils::ByteVector buffer(10);
+  bool called = false;
+  server_->ReceiveSomeAsync(boost::asio::buffer(buffer), [&](auto& res,
+                                                             auto) {
+    EXPECT_EQ(res, api::Error(YOGI_ERR_CANCELED));
+    called = true;
+  });
+
+  server_->Close();
+
+  while (!called) {
+    context_->RunOne(100us);
+  }
+}
+
+#endif  // YOGI_HAS_SHM_TRANSPORT
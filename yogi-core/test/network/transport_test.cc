@@ -24,20 +24,29 @@ using namespace std::chrono_literals;
 
 MATCHER_P(BufferEq, other, std::string(negation ? "isn't" : "is")) {
   *result_listener << "";
-  return arg.data() == other.data() && arg.size() == other.size();
+  return arg[0].data() == other.data() && arg[0].size() == other.size() &&
+         arg[1].size() == 0;
+}
+
+MATCHER_P2(BuffersEq, first, second,
+           std::string(negation ? "aren't" : "are")) {
+  *result_listener << "";
+  return arg[0].data() == first.data() && arg[0].size() == first.size() &&
+         arg[1].data() == second.data() && arg[1].size() == second.size();
 }
 
 class MockTransport : public network::Transport {
  public:
   MockTransport(objects::ContextPtr context, std::chrono::nanoseconds timeout,
-                bool created_from_incoming_conn_req)
+                bool created_from_incoming_conn_req,
+                std::size_t transceive_byte_limit =
+                    std::numeric_limits<std::size_t>::max())
       : network::Transport(context, timeout, created_from_incoming_conn_req,
-                           "Broccoli",
-                           std::numeric_limits<std::size_t>::max()) {}
+                           "Broccoli", transceive_byte_limit) {}
 
-  MOCK_METHOD2(WriteSomeAsync, void(boost::asio::const_buffer data,
+  MOCK_METHOD2(WriteSomeAsync, void(const ConstBufferSequence& data,
                                     TransferSomeHandler handler));
-  MOCK_METHOD2(ReadSomeAsync, void(boost::asio::mutable_buffer data,
+  MOCK_METHOD2(ReadSomeAsync, void(const MutableBufferSequence& data,
                                    TransferSomeHandler handler));
   MOCK_METHOD0(Shutdown, void());
 };
@@ -137,6 +146,45 @@ TEST_F(TransportTest, SendSomeTimeout) {
   EXPECT_LT(std::chrono::steady_clock::now(), start_time + 1ms + kTimingMargin);
 }
 
+TEST_F(TransportTest, SendSomeVectored) {
+  auto first = boost::asio::buffer(data_.data(), 4);
+  auto second = boost::asio::buffer(data_.data() + 4, 2);
+
+  // clang-format off
+  EXPECT_CALL(*transport_, WriteSomeAsync(BuffersEq(first, second), _))
+      .WillOnce(InvokeArgument<1>(api::kSuccess, 5));
+  // clang-format on
+
+  bool called = false;
+  transport_->SendSomeAsync(
+      network::Transport::ConstBufferSequence{{first, second}},
+      [&](auto& res, auto bytes_sent) {
+        EXPECT_EQ(res, api::kSuccess);
+        EXPECT_EQ(bytes_sent, 5);
+        called = true;
+      });
+
+  context_->Poll();
+  EXPECT_TRUE(called);
+}
+
+TEST_F(TransportTest, SendSomeVectoredTransceiveByteLimit) {
+  transport_ = std::make_shared<MockTransport>(context_, 10s, false, 5);
+  auto first = boost::asio::buffer(data_.data(), 4);
+  auto second = boost::asio::buffer(data_.data() + 4, 2);
+
+  // clang-format off
+  EXPECT_CALL(*transport_, WriteSomeAsync(
+      BuffersEq(first, boost::asio::buffer(data_.data() + 4, 1)), _))
+      .WillOnce(InvokeArgument<1>(api::kSuccess, 5));
+  // clang-format on
+
+  transport_->SendSomeAsync(
+      network::Transport::ConstBufferSequence{{first, second}},
+      [&](auto&, auto) {});
+  context_->Poll();
+}
+
 TEST_F(TransportTest, SendAllSuccess) {
   // clang-format off
   EXPECT_CALL(*transport_, Shutdown())
@@ -319,6 +367,28 @@ TEST_F(TransportTest, ReceiveSomeTimeout) {
   EXPECT_LT(std::chrono::steady_clock::now(), start_time + 1ms + kTimingMargin);
 }
 
+TEST_F(TransportTest, ReceiveSomeVectored) {
+  auto first = boost::asio::buffer(data_.data(), 4);
+  auto second = boost::asio::buffer(data_.data() + 4, 2);
+
+  // clang-format off
+  EXPECT_CALL(*transport_, ReadSomeAsync(BuffersEq(first, second), _))
+      .WillOnce(InvokeArgument<1>(api::kSuccess, 6));
+  // clang-format on
+
+  bool called = false;
+  transport_->ReceiveSomeAsync(
+      network::Transport::MutableBufferSequence{{first, second}},
+      [&](auto& res, auto bytes_received) {
+        EXPECT_EQ(res, api::kSuccess);
+        EXPECT_EQ(bytes_received, 6);
+        called = true;
+      });
+
+  context_->Poll();
+  EXPECT_TRUE(called);
+}
+
 TEST_F(TransportTest, ReceiveAllSuccess) {
   // clang-format off
   EXPECT_CALL(*transport_, Shutdown())
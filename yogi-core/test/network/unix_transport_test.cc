@@ -0,0 +1,260 @@
+/*
+ * This file is part of the Yogi distribution https://github.com/yohummus/yogi.
+ * Copyright (c) 2018 Johannes Bergmann.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "../common.h"
+#include "../../src/network/unix_transport.h"
+
+#ifdef YOGI_HAS_UNIX_TRANSPORT
+
+#include <boost/uuid/uuid_io.hpp>
+#include <boost/uuid/uuid_generators.hpp>
+
+using namespace std::chrono_literals;
+
+class UnixTransportTest : public TestFixture {
+ protected:
+  virtual void SetUp() override {
+    name_ = "yogi-test-" +
+            boost::uuids::to_string(boost::uuids::random_generator()());
+    auto ep = network::UnixTransport::MakeAbstractEndpoint(name_);
+    acceptor_.open(ep.protocol());
+    acceptor_.bind(ep);
+    acceptor_.listen();
+  }
+
+  network::TransportPtr Connect() {
+    network::TransportPtr transport;
+    auto guard = network::UnixTransport::ConnectAsync(
+        context_, name_, 10s, std::numeric_limits<std::size_t>::max(), false,
+        [&](auto& res, auto tp, auto) {
+          ASSERT_EQ(res, api::kSuccess);
+          transport = tp;
+        });
+
+    bool accepted = false;
+    acceptor_.async_accept(socket_, [&](auto& ec) {
+      EXPECT_TRUE(!ec) << ec.message();
+      accepted = true;
+    });
+
+    while (!transport || !accepted) {
+      context_->RunOne(100us);
+    }
+
+    char handshake = 0;
+    boost::asio::read(socket_, boost::asio::buffer(&handshake, 1));
+    EXPECT_EQ(handshake, network::UnixTransport::kPlainHandshake);
+
+    return transport;
+  };
+
+  objects::ContextPtr context_ = objects::Context::Create();
+  std::string name_;
+  network::UnixTransport::Acceptor acceptor_{context_->IoContext()};
+  network::UnixTransport::Socket socket_{context_->IoContext()};
+  std::vector<char> data_ = {1, 2, 3, 4, 5, 6};
+};
+
+TEST_F(UnixTransportTest, Accept) {
+  bool called = false;
+  auto guard = network::UnixTransport::AcceptAsync(
+      context_, &acceptor_, 10s, std::numeric_limits<std::size_t>::max(),
+      [&](auto& res, auto transport, auto) {
+        EXPECT_EQ(res, api::kSuccess);
+        ASSERT_TRUE(!!transport);
+        EXPECT_TRUE(!!std::dynamic_pointer_cast<network::UnixTransport>(
+            transport));
+        EXPECT_TRUE(transport->CreatedFromIncomingConnectionRequest());
+        called = true;
+      });
+
+  char handshake = network::UnixTransport::kPlainHandshake;
+  socket_.async_connect(acceptor_.local_endpoint(), [&](auto& ec) {
+    EXPECT_TRUE(!ec) << ec.message();
+    boost::asio::write(socket_, boost::asio::buffer(&handshake, 1));
+  });
+
+  while (!called) {
+    context_->RunOne(100us);
+  }
+}
+
+TEST_F(UnixTransportTest, AcceptedBeforeHandshake) {
+  bool accepted = false;
+  bool called = false;
+  auto guard = network::UnixTransport::AcceptAsync(
+      context_, &acceptor_, 10s, std::numeric_limits<std::size_t>::max(),
+      [&](auto& res, auto, auto) {
+        EXPECT_EQ(res, api::kSuccess);
+        EXPECT_TRUE(accepted);
+        called = true;
+      },
+      [&] {
+        EXPECT_FALSE(called);
+        accepted = true;
+      });
+
+  // Connect without sending the handshake yet
+  socket_.connect(acceptor_.local_endpoint());
+  while (!accepted) {
+    context_->RunOne(100us);
+  }
+
+  EXPECT_FALSE(called);
+
+  char handshake = network::UnixTransport::kPlainHandshake;
+  boost::asio::write(socket_, boost::asio::buffer(&handshake, 1));
+  while (!called) {
+    context_->RunOne(100us);
+  }
+}
+
+TEST_F(UnixTransportTest, InvalidHandshake) {
+  bool called = false;
+  auto guard = network::UnixTransport::AcceptAsync(
+      context_, &acceptor_, 10s, std::numeric_limits<std::size_t>::max(),
+      [&](auto& res, auto transport, auto) {
+        EXPECT_EQ(res, api::Error(YOGI_ERR_DESERIALIZE_MSG_FAILED));
+        EXPECT_FALSE(!!transport);
+        called = true;
+      });
+
+  socket_.async_connect(acceptor_.local_endpoint(), [&](auto& ec) {
+    EXPECT_TRUE(!ec) << ec.message();
+    boost::asio::write(socket_, boost::asio::buffer("X", 1));
+  });
+
+  while (!called) {
+    context_->RunOne(100us);
+  }
+}
+
+TEST_F(UnixTransportTest, HandshakeTimeout) {
+  bool called = false;
+  auto guard = network::UnixTransport::AcceptAsync(
+      context_, &acceptor_, 1ms, std::numeric_limits<std::size_t>::max(),
+      [&](auto& res, auto transport, auto) {
+        EXPECT_EQ(res, api::Error(YOGI_ERR_TIMEOUT));
+        EXPECT_FALSE(!!transport);
+        called = true;
+      });
+
+  socket_.connect(acceptor_.local_endpoint());
+
+  while (!called) {
+    context_->RunOne(100us);
+  }
+}
+
+TEST_F(UnixTransportTest, CancelAccept) {
+  bool called = false;
+  auto guard = network::UnixTransport::AcceptAsync(
+      context_, &acceptor_, 10s, std::numeric_limits<std::size_t>::max(),
+      [&](auto& res, auto transport, auto guard) {
+        EXPECT_EQ(res, api::Error(YOGI_ERR_CANCELED));
+        ASSERT_FALSE(!!transport);
+        ASSERT_FALSE(!!guard);
+        called = true;
+      });
+
+  guard.reset();
+
+  while (!called) {
+    context_->RunOne(100us);
+  }
+}
+
+TEST_F(UnixTransportTest, Connect) {
+  auto transport = Connect();
+  EXPECT_FALSE(transport->CreatedFromIncomingConnectionRequest());
+  EXPECT_EQ(transport->GetPeerDescription(), '@' + name_);
+}
+
+TEST_F(UnixTransportTest, ConnectToUnknownName) {
+  bool called = false;
+  auto guard = network::UnixTransport::ConnectAsync(
+      context_, name_ + "-unknown", 10s,
+      std::numeric_limits<std::size_t>::max(), false,
+      [&](auto& res, auto transport, auto) {
+        EXPECT_EQ(res, api::Error(YOGI_ERR_CONNECT_SOCKET_FAILED));
+        EXPECT_FALSE(!!transport);
+        called = true;
+      });
+
+  while (!called) {
+    context_->RunOne(100us);
+  }
+}
+
+TEST_F(UnixTransportTest, SendAndReceive) {
+  auto transport = Connect();
+
+  bool received = false;
+  std::vector<char> buffer(data_.size());
+  boost::asio::async_read(socket_, boost::asio::buffer(buffer),
+                          [&](auto& ec, auto bytes_read) {
+                            EXPECT_TRUE(!ec) << ec.message();
+                            EXPECT_EQ(bytes_read, buffer.size());
+                            received = true;
+                          });
+
+  bool sent = false;
+  transport->SendAllAsync(boost::asio::buffer(data_), [&](auto& res) {
+    EXPECT_EQ(res, api::kSuccess);
+    sent = true;
+  });
+
+  while (!sent || !received) {
+    context_->RunOne(100us);
+  }
+
+  EXPECT_EQ(data_, buffer);
+
+  received = false;
+  std::fill(buffer.begin(), buffer.end(), 0);
+  transport->ReceiveAllAsync(boost::asio::buffer(buffer), [&](auto& res) {
+    EXPECT_EQ(res, api::kSuccess);
+    received = true;
+  });
+
+  boost::asio::write(socket_, boost::asio::buffer(data_));
+
+  while (!received) {
+    context_->RunOne(100us);
+  }
+
+  EXPECT_EQ(data_, buffer);
+}
+
+TEST_F(UnixTransportTest, ReceiveFailure) {
+  auto transport = Connect();
+
+  bool called = false;
+  transport->ReceiveSomeAsync(boost::asio::buffer(data_), [&](auto& res, auto) {
+    EXPECT_TRUE(res.IsError());
+    called = true;
+  });
+
+  socket_.close();
+
+  while (!called) {
+    context_->RunOne(100us);
+  }
+}
+
+#endif  // YOGI_HAS_UNIX_TRANSPORT
@@ -107,6 +107,46 @@ TEST_F(BranchTest, InvalidQueueSizes) {
   }
 }
 
+TEST_F(BranchTest, TxProperties) {
+  auto slow = [](const char* policy) {
+    return nlohmann::json{{"tx_slow_consumer_policy", policy},
+                          {"tx_slow_consumer_threshold", 1000},
+                          {"tx_slow_consumer_timeout", 0.5}};
+  };
+
+  std::vector<std::pair<nlohmann::json, int>> entries = {
+      {{{"tx_coalescing_delay", 0.001}, {"tx_coalescing_bytes", 1000}},
+       YOGI_OK},
+      {{{"tx_coalescing_delay", -1}, {"tx_coalescing_bytes", 1000}},
+       YOGI_ERR_INVALID_PARAM},
+      {{{"tx_coalescing_delay", 0.001}, {"tx_coalescing_bytes", 0}},
+       YOGI_ERR_INVALID_PARAM},
+      {{{"tx_zerocopy_threshold", 10000}}, YOGI_OK},
+      {{{"tx_zerocopy_threshold", 0}}, YOGI_ERR_INVALID_PARAM},
+      {{{"tx_fanout_partitions", 0}}, YOGI_OK},
+      {{{"tx_fanout_partitions", -1}}, YOGI_ERR_INVALID_PARAM},
+      {slow("block"), YOGI_OK},
+      {slow("drop"), YOGI_OK},
+      {slow("conflate"), YOGI_OK},
+      {slow("disconnect"), YOGI_OK},
+      {slow("ignore"), YOGI_ERR_INVALID_PARAM},
+      {{{"tx_slow_consumer_policy", "disconnect"},
+        {"tx_slow_consumer_timeout", -1}},
+       YOGI_ERR_INVALID_PARAM},
+      {{{"tx_overflow_budget", 3000000}}, YOGI_OK},
+      {{{"tx_overflow_budget", -2}}, YOGI_ERR_INVALID_PARAM},
+  };
+
+  for (auto& entry : entries) {
+    char err[100];
+
+    void* branch;
+    int res = YOGI_BranchCreate(&branch, context_, entry.first.dump().c_str(),
+                                nullptr, err, sizeof(err));
+    EXPECT_EQ(res, entry.second) << entry.first.dump() << ": " << err;
+  }
+}
+
 TEST_F(BranchTest, GetInfoBufferTooSmall) {
   char json[3];
   int res = YOGI_BranchGetInfo(branch_, nullptr, json, sizeof(json));
@@ -148,6 +188,10 @@ TEST_F(BranchTest, GetInfoJson) {
   EXPECT_EQ(json.value("advertising_interval", -1.0f),
             static_cast<float>(kBranchProps["advertising_interval"]));
   EXPECT_EQ(json.value("ghost_mode", true), false);
+#ifdef __linux__
+  EXPECT_EQ(json.value("unix_socket_name", "NOT FOUND"),
+            "yogi-" + boost::uuids::to_string(uuid));
+#endif
   EXPECT_EQ(json.value("tx_queue_size", -1), api::kDefaultTxQueueSize);
   EXPECT_EQ(json.value("rx_queue_size", -1), api::kDefaultRxQueueSize);
 
@@ -16,9 +16,12 @@
  */
 
 #include "../common.h"
+#include "../../src/api/constants.h"
 
 #include <chrono>
 #include <atomic>
+#include <cstdint>
+#include <cstring>
 #include <thread>
 
 class BroadcastReceiver {
@@ -352,3 +355,379 @@ TEST_F(BroadcastManagerTest, CancelReceive) {
   EXPECT_TRUE(rcv_a_.BroadcastReceived());
   EXPECT_EQ(rcv_a_.GetHandlerResult(), YOGI_ERR_CANCELED);
 }
+
+TEST_F(BroadcastManagerTest, ReceiveLease) {
+  struct Lease {
+    std::atomic<bool> called{false};
+    int res;
+    boost::uuids::uuid uuid;
+    std::vector<char> data;
+    void* handle;
+  };
+
+  auto receive = [&](Lease* lease) {
+    int res = YOGI_BranchReceiveBroadcastLeaseAsync(
+        branch_c_,
+        [](int res, const void* uuid, const void* data, int size, void* lease,
+           void* userarg) {
+          auto l = static_cast<Lease*>(userarg);
+          l->res = res;
+          if (uuid) std::memcpy(&l->uuid, uuid, sizeof(l->uuid));
+          auto begin = static_cast<const char*>(data);
+          l->data.assign(begin, begin + size);
+          l->handle = lease;
+          l->called = true;
+        },
+        lease);
+    EXPECT_OK(res);
+  };
+
+  auto send = [&] {
+    int res = YOGI_BranchSendBroadcast(branch_b_, YOGI_ENC_JSON, json_data_,
+                                       sizeof(json_data_), YOGI_TRUE);
+    EXPECT_OK(res);
+  };
+
+  Lease first;
+  receive(&first);
+  PollContext(context_);
+  EXPECT_EQ(rcv_c_.GetHandlerResult(), YOGI_ERR_CANCELED);
+
+  RunContextInBackground(context_);
+  send();
+  while (!first.called) std::this_thread::yield();
+
+  EXPECT_OK(first.res);
+  EXPECT_EQ(first.uuid, GetBranchUuid(branch_b_));
+  EXPECT_EQ(first.data, std::vector<char>(std::begin(msgpack_data_),
+                                          std::end(msgpack_data_)));
+  ASSERT_NE(first.handle, nullptr);
+
+  // No further messages from branch b until the lease has been released
+  Lease second;
+  receive(&second);
+  send();
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(second.called);
+
+  EXPECT_OK(YOGI_BranchReleaseBroadcastLease(first.handle));
+  while (!second.called) std::this_thread::yield();
+  EXPECT_OK(second.res);
+  EXPECT_OK(YOGI_BranchReleaseBroadcastLease(second.handle));
+}
+
+TEST_F(BroadcastManagerTest, StalledConnection) {
+  struct SlowConsumerAwaiter {
+    void* branch;
+    boost::uuids::uuid fake_uuid;
+    boost::uuids::uuid uuid;
+    char json[1000];
+    std::atomic<bool> fake_penalized{false};
+
+    void Start() {
+      int res = YOGI_BranchAwaitEventAsync(
+          branch, YOGI_BEV_SLOW_CONSUMER, &uuid, json, sizeof(json),
+          [](int res, int, int, void* userarg) {
+            if (res != YOGI_OK) return;
+
+            // Branch c may get penalized as well since it reads so slowly
+            auto self = static_cast<SlowConsumerAwaiter*>(userarg);
+            if (self->uuid == self->fake_uuid) {
+              auto json = nlohmann::json::parse(self->json);
+              EXPECT_EQ(json["policy"], "drop");
+              self->fake_penalized = true;
+            } else {
+              self->Start();
+            }
+          },
+          this);
+      EXPECT_OK(res);
+    }
+  };
+
+  auto props = kBranchProps;
+  props["name"] = "sender";
+  props["tx_slow_consumer_policy"] = "drop";
+
+  void* sender;
+  int res = YOGI_BranchCreate(&sender, context_, props.dump().c_str(),
+                              nullptr, nullptr, 0);
+  ASSERT_OK(res);
+  RunContextUntilBranchesAreConnected(context_, {sender, branch_b_});
+
+  RunContextInBackground(context_);
+  FakeBranch fake;
+  fake.Connect(sender);
+  while (!fake.IsConnectedTo(sender))
+    ;
+
+  SlowConsumerAwaiter awaiter;
+  awaiter.branch = sender;
+  awaiter.fake_uuid = fake.GetUuid();
+  awaiter.Start();
+
+  // The fake branch never reads anything, so its connection stalls as soon
+  // as the socket buffers are full
+  auto data = MakeBigJsonData();
+  auto start = std::chrono::steady_clock::now();
+  while (!awaiter.fake_penalized &&
+         std::chrono::steady_clock::now() < start + std::chrono::seconds(1)) {
+    YOGI_BranchSendBroadcast(sender, YOGI_ENC_JSON, data.data(),
+                             static_cast<int>(data.size()), YOGI_FALSE);
+  }
+
+  YOGI_BranchCancelAwaitEvent(sender);
+  ASSERT_TRUE(awaiter.fake_penalized);
+
+  // Give branch b some time to work through the big messages; after that, it
+  // must keep receiving broadcasts even though the fake branch is stalled
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  BroadcastReceiver rcv(branch_b_);
+  res = YOGI_BranchSendBroadcast(sender, YOGI_ENC_JSON, json_data_,
+                                 sizeof(json_data_), YOGI_TRUE);
+  EXPECT_OK(res);
+
+  rcv.WaitForBroadcast();
+  EXPECT_OK(rcv.GetHandlerResult());
+  rcv.CheckReceivedDataEquals(json_data_);
+  EXPECT_TRUE(fake.IsConnectedTo(sender));
+}
+
+class BroadcastManagerQueueTest : public TestFixture {
+ protected:
+  struct BatchReceiver {
+    std::atomic<bool> called{false};
+    int res;
+    int count;
+    std::vector<char> data;
+  };
+
+  BroadcastManagerQueueTest()
+      : context_(CreateContext()), sender_(CreateBranch(context_, "sender")) {
+    auto props = kBranchProps;
+    props["name"] = "receiver";
+    props["rx_broadcast_queue_depth"] = 3;
+    int res = YOGI_BranchCreate(&receiver_, context_, props.dump().c_str(),
+                                nullptr, nullptr, 0);
+    EXPECT_OK(res);
+
+    RunContextUntilBranchesAreConnected(context_, {sender_, receiver_});
+
+    // The receiver logs every broadcast that it queues or discards
+    YOGI_LoggerSetComponentsVerbosity(kComponent, YOGI_VB_TRACE, nullptr);
+    YOGI_ConfigureHookLogging(YOGI_VB_TRACE, &CountQueueEntries,
+                              &queue_entries_);
+
+    RunContextInBackground(context_);
+  }
+
+  virtual void TearDown() {
+    EXPECT_EQ(YOGI_DestroyAll(), YOGI_OK);
+    YOGI_ConfigureHookLogging(YOGI_VB_NONE, nullptr, nullptr);
+    YOGI_LoggerSetComponentsVerbosity(kComponent, api::kDefaultLoggerVerbosity,
+                                      nullptr);
+  }
+
+  static void CountQueueEntries(int severity, long long, int, const char*,
+                                int, const char* component, const char*,
+                                void* userarg) {
+    if (severity == YOGI_VB_TRACE &&
+        std::string(component) == "Yogi.Branch.BroadcastManager") {
+      ++*static_cast<std::atomic<std::size_t>*>(userarg);
+    }
+  }
+
+  void Send(const std::string& json) {
+    int res = YOGI_BranchSendBroadcast(sender_, YOGI_ENC_JSON, json.c_str(),
+                                       static_cast<int>(json.size() + 1),
+                                       YOGI_TRUE);
+    EXPECT_OK(res);
+  }
+
+  // Waits until the receiver has either queued or discarded every message
+  void SendAndWaitUntilQueued(std::initializer_list<std::string> jsons) {
+    using namespace std::chrono_literals;
+    using clock = std::chrono::steady_clock;
+
+    auto expected_entries = queue_entries_ + jsons.size();
+    for (auto& json : jsons) Send(json);
+
+    auto start = clock::now();
+    while (queue_entries_ < expected_entries) {
+      if (clock::now() > start + 1s) {
+        throw std::runtime_error("Broadcasts not queued within one second.");
+      }
+
+      std::this_thread::yield();
+    }
+  }
+
+  void ReceiveBatch(BatchReceiver* rcv, std::size_t size) {
+    rcv->data.resize(size);
+    int res = YOGI_BranchReceiveBroadcastsAsync(
+        receiver_, YOGI_ENC_JSON, rcv->data.data(), static_cast<int>(size),
+        [](int res, int count, int size, void* userarg) {
+          auto rcv = static_cast<BatchReceiver*>(userarg);
+          rcv->res = res;
+          rcv->count = count;
+          rcv->data.resize(static_cast<std::size_t>(size));
+          rcv->called = true;
+        },
+        rcv);
+    EXPECT_OK(res);
+  }
+
+  // Returns the JSON strings of all messages in the batch
+  std::vector<std::string> ParseBatch(const std::vector<char>& data) {
+    std::vector<std::string> msgs;
+    for (std::size_t i = 0; i < data.size();) {
+      boost::uuids::uuid uuid;
+      std::memcpy(&uuid, data.data() + i, sizeof(uuid));
+      EXPECT_EQ(uuid, GetBranchUuid(sender_));
+
+      std::uint32_t size;
+      std::memcpy(&size, data.data() + i + 16, sizeof(size));
+      msgs.push_back(data.data() + i + 20);
+      EXPECT_EQ(msgs.back().size() + 1, size);
+
+      i += 20 + size;
+    }
+
+    return msgs;
+  }
+
+  static constexpr const char* kComponent =
+      "Yogi\\.Branch\\.BroadcastManager";
+
+  void* context_;
+  void* sender_;
+  void* receiver_;
+  std::atomic<std::size_t> queue_entries_{0};
+};
+
+TEST_F(BroadcastManagerQueueTest, ReceiveQueued) {
+  SendAndWaitUntilQueued({"[1]", "[2]"});
+
+  BroadcastReceiver rcv_1(receiver_);
+  rcv_1.WaitForBroadcast();
+  rcv_1.CheckReceivedDataEquals("[1]");
+  EXPECT_EQ(rcv_1.GetSourceUuid(), GetBranchUuid(sender_));
+
+  BroadcastReceiver rcv_2(receiver_);
+  rcv_2.WaitForBroadcast();
+  rcv_2.CheckReceivedDataEquals("[2]");
+}
+
+TEST_F(BroadcastManagerQueueTest, ReceiveBatch) {
+  // The fourth message does not fit into the queue any more
+  SendAndWaitUntilQueued({"[1]", "[2]", "[3]", "[4]"});
+
+  // Only two messages fit into the buffer; the third one stays queued
+  BatchReceiver first;
+  ReceiveBatch(&first, 50);
+  while (!first.called) std::this_thread::yield();
+  EXPECT_OK(first.res);
+  EXPECT_EQ(first.count, 2);
+  EXPECT_EQ(ParseBatch(first.data), (std::vector<std::string>{"[1]", "[2]"}));
+
+  BatchReceiver second;
+  ReceiveBatch(&second, 1000);
+  while (!second.called) std::this_thread::yield();
+  EXPECT_OK(second.res);
+  EXPECT_EQ(ParseBatch(second.data), std::vector<std::string>{"[3]"});
+
+  // With an empty queue, the next message gets delivered right away
+  BatchReceiver third;
+  ReceiveBatch(&third, 1000);
+  Send("[5]");
+  while (!third.called) std::this_thread::yield();
+  EXPECT_OK(third.res);
+  EXPECT_EQ(ParseBatch(third.data), std::vector<std::string>{"[5]"});
+
+  BatchReceiver fourth;
+  ReceiveBatch(&fourth, 10);
+  Send("[6]");
+  while (!fourth.called) std::this_thread::yield();
+  EXPECT_ERR(fourth.res, YOGI_ERR_BUFFER_TOO_SMALL);
+  EXPECT_EQ(fourth.count, 0);
+}
+
+TEST_F(BroadcastManagerQueueTest, LeasedEntriesDoNotGetReused) {
+  struct Lease {
+    std::atomic<bool> called{false};
+    const char* data;
+    int size;
+    void* handle;
+  };
+
+  SendAndWaitUntilQueued({"[1]"});
+
+  Lease lease;
+  int res = YOGI_BranchReceiveBroadcastLeaseAsync(
+      receiver_,
+      [](int res, const void*, const void* data, int size, void* handle,
+         void* userarg) {
+        EXPECT_OK(res);
+        auto l = static_cast<Lease*>(userarg);
+        l->data = static_cast<const char*>(data);
+        l->size = size;
+        l->handle = handle;
+        l->called = true;
+      },
+      &lease);
+  EXPECT_OK(res);
+  while (!lease.called) std::this_thread::yield();
+  std::vector<char> leased_data(lease.data, lease.data + lease.size);
+
+  // More messages get queued than there are free entries to reuse
+  SendAndWaitUntilQueued({"[2]", "[3]", "[4]"});
+  EXPECT_EQ(std::vector<char>(lease.data, lease.data + lease.size),
+            leased_data);
+  EXPECT_OK(YOGI_BranchReleaseBroadcastLease(lease.handle));
+
+  BatchReceiver batch;
+  ReceiveBatch(&batch, 1000);
+  while (!batch.called) std::this_thread::yield();
+  EXPECT_OK(batch.res);
+  EXPECT_EQ(ParseBatch(batch.data),
+            (std::vector<std::string>{"[2]", "[3]", "[4]"}));
+
+  SendAndWaitUntilQueued({"[5]", "[6]"});
+  BatchReceiver batch2;
+  ReceiveBatch(&batch2, 1000);
+  while (!batch2.called) std::this_thread::yield();
+  EXPECT_EQ(ParseBatch(batch2.data),
+            (std::vector<std::string>{"[5]", "[6]"}));
+}
+
+class BroadcastManagerMultiThreadedTest : public TestFixture {
+ protected:
+  virtual void TearDown() { EXPECT_EQ(YOGI_DestroyAll(), YOGI_OK); }
+};
+
+TEST_F(BroadcastManagerMultiThreadedTest, SendAndReceive) {
+  void* context;
+  int res = YOGI_ContextCreateWithThreads(&context, 4);
+  ASSERT_OK(res);
+
+  auto branch_a = CreateBranch(context, "a");
+  auto branch_b = CreateBranch(context, "b");
+  auto branch_c = CreateBranch(context, "c");
+  RunContextUntilBranchesAreConnected(context, {branch_a, branch_b, branch_c});
+  RunContextInBackground(context);
+
+  const char json_data[8] = "[1,2,3]";
+  for (int i = 0; i < 10; ++i) {
+    BroadcastReceiver rcv_b(branch_b);
+    BroadcastReceiver rcv_c(branch_c);
+
+    res = YOGI_BranchSendBroadcast(branch_a, YOGI_ENC_JSON, json_data,
+                                   sizeof(json_data), YOGI_TRUE);
+    ASSERT_OK(res);
+
+    rcv_b.WaitForBroadcast();
+    rcv_b.CheckReceivedDataEquals(json_data);
+    rcv_c.WaitForBroadcast();
+    rcv_c.CheckReceivedDataEquals(json_data);
+  }
+}
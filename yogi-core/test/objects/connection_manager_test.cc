@@ -17,8 +17,11 @@
 
 #include "../common.h"
 #include "../../src/api/constants.h"
+#include "../../src/network/serialize.h"
 
 #include <boost/asio.hpp>
+#include <atomic>
+#include <thread>
 
 class ConnectionManagerTest : public TestFixture {
  protected:
@@ -165,6 +168,36 @@ TEST_F(ConnectionManagerTest, Reconnect) {
     ;
 }
 
+TEST_F(ConnectionManagerTest, IterateSessionsWhileConnectionsChange) {
+  RunContextInBackground(context_);
+
+  // Sessions get iterated over without a lock while they start and terminate
+  std::atomic<bool> done{false};
+  std::atomic<int> iterations{0};
+  std::thread reader([&] {
+    while (!done) {
+      auto branches = GetConnectedBranches(branch_);
+      EXPECT_LE(branches.size(), 1u);
+      ++iterations;
+    }
+  });
+
+  FakeBranch fake;
+  for (int i = 0; i < 5; ++i) {
+    fake.Connect(branch_);
+    while (!fake.IsConnectedTo(branch_))
+      ;
+
+    fake.Disconnect();
+    while (fake.IsConnectedTo(branch_))
+      ;
+  }
+
+  done = true;
+  reader.join();
+  EXPECT_GT(iterations, 0);
+}
+
 TEST_F(ConnectionManagerTest, InvalidMagicPrefix) {
   RunContextInBackground(context_);
   FakeBranch fake;
@@ -223,6 +256,31 @@ TEST_F(ConnectionManagerTest, BrokenInfoMessage) {
   EXPECT_THROW(fake.Accept(fn), boost::system::system_error);
 }
 
+TEST_F(ConnectionManagerTest, InfoMessageWithoutUnixSocketName) {
+  RunContextInBackground(context_);
+  FakeBranch fake;
+
+  // Older branches do not append the Unix domain socket name
+  auto fn = [](auto msg) {
+    using objects::detail::BranchInfo;
+
+    boost::uuids::uuid uuid;
+    std::copy_n(msg->begin() + 7, uuid.size(), uuid.begin());
+    auto n = BranchInfo::MakeUnixSocketName(uuid).size() + 1;
+    msg->resize(msg->size() - n);
+
+    utils::ByteVector size_field;
+    network::Serialize<std::size_t>(
+        &size_field, msg->size() - BranchInfo::kInfoMessageHeaderSize);
+    std::copy(size_field.begin(), size_field.end(),
+              msg->begin() + BranchInfo::kAdvertisingMessageSize);
+  };
+
+  fake.Connect(branch_, fn);
+  while (!fake.IsConnectedTo(branch_))
+    ;
+}
+
 TEST_F(ConnectionManagerTest, BranchEvents) {
   void* branch_a = CreateBranch(context_, "a");
   auto uuid = GetBranchUuid(branch_a);
@@ -0,0 +1,176 @@
+/*
+ * This file is part of the Yogi distribution https://github.com/yohummus/yogi.
+ * Copyright (c) 2018 Johannes Bergmann.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "../common.h"
+#include "../../src/objects/context_group.h"
+
+#include <atomic>
+#include <set>
+
+class ContextGroupTest : public TestFixture {
+ protected:
+  virtual void SetUp() override {
+    int res = YOGI_ContextGroupCreate(&group_, 3);
+    ASSERT_OK(res);
+    ASSERT_NE(group_, nullptr);
+  }
+
+  virtual void TearDown() override { EXPECT_EQ(YOGI_DestroyAll(), YOGI_OK); }
+
+  void* GetContext(int index) {
+    void* context = nullptr;
+    int res = YOGI_ContextGroupGetContext(group_, index, &context);
+    EXPECT_OK(res);
+    return context;
+  }
+
+  void* group_;
+};
+
+TEST_F(ContextGroupTest, CreateAndDestroy) {
+  std::set<void*> contexts;
+  for (int i = 0; i < 3; ++i) {
+    contexts.insert(GetContext(i));
+  }
+
+  EXPECT_EQ(contexts.size(), 3u);
+  EXPECT_EQ(contexts.count(nullptr), 0u);
+
+  void* context;
+  int res = YOGI_ContextGroupGetContext(group_, 3, &context);
+  EXPECT_ERR(res, YOGI_ERR_INVALID_PARAM);
+
+  res = YOGI_Destroy(*contexts.begin());
+  EXPECT_ERR(res, YOGI_ERR_OBJECT_STILL_USED);
+
+  res = YOGI_Destroy(group_);
+  EXPECT_OK(res);
+
+  for (auto context : contexts) {
+    res = YOGI_Destroy(context);
+    EXPECT_OK(res);
+  }
+}
+
+TEST_F(ContextGroupTest, CreateOnePerCpu) {
+  void* group;
+  int res = YOGI_ContextGroupCreate(&group, 0);
+  ASSERT_OK(res);
+
+  void* context;
+  auto n = static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u));
+  res = YOGI_ContextGroupGetContext(group, n - 1, &context);
+  EXPECT_OK(res);
+  res = YOGI_ContextGroupGetContext(group, n, &context);
+  EXPECT_ERR(res, YOGI_ERR_INVALID_PARAM);
+
+  res = YOGI_ContextGroupCreate(&group, -1);
+  EXPECT_ERR(res, YOGI_ERR_INVALID_PARAM);
+}
+
+TEST_F(ContextGroupTest, Shards) {
+  auto group = objects::ContextGroup::Create(3);
+  auto& contexts = group->GetContexts();
+  ASSERT_EQ(contexts.size(), 3u);
+
+  for (auto& context : contexts) {
+    for (std::size_t i = 0; i < 6; ++i) {
+      EXPECT_EQ(context->GetShard(i), contexts[i % 3]);
+    }
+  }
+
+  // Contexts outside of a group are their own shard
+  auto context = objects::Context::Create();
+  EXPECT_EQ(context->GetShard(123), context);
+}
+
+TEST_F(ContextGroupTest, RunInBackground) {
+  std::atomic<int> n(0);
+  for (int i = 0; i < 3; ++i) {
+    YOGI_ContextPost(GetContext(i),
+                     [](void* n_) { ++*static_cast<std::atomic<int>*>(n_); },
+                     &n);
+  }
+
+  int res = YOGI_ContextGroupRunInBackground(group_, YOGI_TRUE);
+  EXPECT_OK(res);
+
+  res = YOGI_ContextGroupRunInBackground(group_, YOGI_FALSE);
+  EXPECT_ERR(res, YOGI_ERR_BUSY);
+
+  while (n != 3)
+    ;
+
+  res = YOGI_ContextGroupWaitForStopped(group_, 0);
+  EXPECT_ERR(res, YOGI_ERR_TIMEOUT);
+
+  res = YOGI_ContextGroupStop(group_);
+  EXPECT_OK(res);
+
+  res = YOGI_ContextGroupWaitForStopped(group_, -1);
+  EXPECT_OK(res);
+
+  for (int i = 0; i < 3; ++i) {
+    res = YOGI_ContextWaitForStopped(GetContext(i), 0);
+    EXPECT_OK(res);
+  }
+}
+
+TEST_F(ContextGroupTest, ConnectBranches) {
+  void* branch_a = CreateBranch(GetContext(0), "a");
+  void* branch_b = CreateBranch(GetContext(1), "b");
+  void* branch_c = CreateBranch(GetContext(1), "c");
+
+  int res = YOGI_ContextGroupRunInBackground(group_, YOGI_FALSE);
+  ASSERT_OK(res);
+
+  auto start = std::chrono::steady_clock::now();
+  for (auto branch : {branch_a, branch_b, branch_c}) {
+    while (GetConnectedBranches(branch).size() < 2) {
+      ASSERT_LT(std::chrono::steady_clock::now() - start, 3s);
+      std::this_thread::sleep_for(1ms);
+    }
+  }
+
+  static const char data[] = "[1,2,3]";
+  struct Received {
+    std::atomic<bool> done{false};
+    char buffer[sizeof(data)];
+  } received;
+
+  res = YOGI_BranchReceiveBroadcastAsync(
+      branch_c, nullptr, YOGI_ENC_JSON, received.buffer,
+      sizeof(received.buffer),
+      [](int res, int, void* userarg) {
+        EXPECT_OK(res);
+        static_cast<Received*>(userarg)->done = true;
+      },
+      &received);
+  ASSERT_OK(res);
+
+  res = YOGI_BranchSendBroadcast(branch_a, YOGI_ENC_JSON, data, sizeof(data),
+                                 YOGI_TRUE);
+  ASSERT_OK(res);
+
+  while (!received.done) {
+    ASSERT_LT(std::chrono::steady_clock::now() - start, 3s);
+    std::this_thread::sleep_for(1ms);
+  }
+
+  EXPECT_STREQ(received.buffer, data);
+}
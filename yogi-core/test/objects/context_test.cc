@@ -16,7 +16,11 @@
  */
 
 #include "../common.h"
+#include "../../src/objects/context.h"
 
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/io_context_strand.hpp>
+#include <nlohmann/json.hpp>
 #include <atomic>
 #include <thread>
 
@@ -33,6 +37,13 @@ TEST_F(ContextTest, CreateAndDestroy) {
   EXPECT_OK(res);
 }
 
+TEST_F(ContextTest, CreateWithInvalidThreadCount) {
+  void* context = nullptr;
+  int res = YOGI_ContextCreateWithThreads(&context, 0);
+  EXPECT_ERR(res, YOGI_ERR_INVALID_PARAM);
+  EXPECT_EQ(context, nullptr);
+}
+
 TEST_F(ContextTest, Poll) {
   int res = YOGI_ContextPoll(context_, nullptr);
   EXPECT_OK(res);
@@ -171,6 +182,23 @@ TEST_F(ContextTest, RunOneFor) {
   EXPECT_EQ(n, 1);
 }
 
+TEST_F(ContextTest, RunBusyPollFor) {
+  int n = 0;
+  YOGI_ContextPost(context_, [](void* n_) { ++*static_cast<int*>(n_); }, &n);
+  YOGI_ContextPost(context_, [](void* n_) { ++*static_cast<int*>(n_); }, &n);
+
+  int count = -1;
+  auto start_time = std::chrono::steady_clock::now();
+  int res = YOGI_ContextRunBusyPoll(context_, &count, 5000000);
+  auto dur = std::chrono::steady_clock::now() - start_time;
+
+  EXPECT_OK(res);
+  EXPECT_GE(dur, 5ms);
+  EXPECT_LT(dur, 5ms + kTimingMargin);
+  EXPECT_EQ(count, 2);
+  EXPECT_EQ(n, 2);
+}
+
 TEST_F(ContextTest, RunInBackground) {
   std::atomic<int> n(0);
   YOGI_ContextPost(context_, [](void* n_) { ++*static_cast<int*>(n_); }, &n);
@@ -184,6 +212,86 @@ TEST_F(ContextTest, RunInBackground) {
     ;
 }
 
+TEST_F(ContextTest, RunInBackgroundBusyPoll) {
+  int res = YOGI_ContextRunInBackgroundBusyPoll(context_, -2);
+  EXPECT_ERR(res, YOGI_ERR_INVALID_PARAM);
+
+  res = YOGI_ContextRunInBackgroundBusyPoll(context_, 0);
+  EXPECT_OK(res);
+
+  std::atomic<int> n(0);
+  YOGI_ContextPost(context_, [](void* n_) { ++*static_cast<int*>(n_); }, &n);
+
+  while (n != 1)
+    ;
+
+  YOGI_ContextStop(context_);
+  res = YOGI_ContextWaitForStopped(context_, -1);
+  EXPECT_OK(res);
+}
+
+TEST_F(ContextTest, RunInBackgroundOnMultipleThreads) {
+  void* context;
+  int res = YOGI_ContextCreateWithThreads(&context, 3);
+  ASSERT_OK(res);
+
+  // Each handler blocks until all of them are running at the same time
+  std::atomic<int> n(0);
+  auto fn = [](void* n_) {
+    auto& n = *static_cast<std::atomic<int>*>(n_);
+    ++n;
+    while (n < 3)
+      ;
+  };
+
+  for (int i = 0; i < 3; ++i) {
+    YOGI_ContextPost(context, fn, &n);
+  }
+
+  res = YOGI_ContextRunInBackground(context);
+  EXPECT_OK(res);
+
+  res = YOGI_ContextRunInBackground(context);
+  EXPECT_ERR(res, YOGI_ERR_BUSY);
+
+  while (n != 3)
+    ;
+
+  YOGI_ContextStop(context);
+  res = YOGI_ContextWaitForStopped(context, -1);
+  EXPECT_OK(res);
+
+  res = YOGI_Destroy(context);
+  EXPECT_OK(res);
+}
+
+TEST_F(ContextTest, RunOnMultipleThreads) {
+  void* context;
+  int res = YOGI_ContextCreateWithThreads(&context, 2);
+  ASSERT_OK(res);
+
+  std::atomic<int> n(0);
+  auto fn = [](void* n_) {
+    auto& n = *static_cast<std::atomic<int>*>(n_);
+    ++n;
+    while (n < 2)
+      ;
+  };
+
+  YOGI_ContextPost(context, fn, &n);
+  YOGI_ContextPost(context, fn, &n);
+
+  // The calling thread is one of the two threads running the handlers
+  int count = -1;
+  res = YOGI_ContextRun(context, &count, 100000000);
+  EXPECT_OK(res);
+  EXPECT_EQ(count, 2);
+  EXPECT_EQ(n, 2);
+
+  res = YOGI_Destroy(context);
+  EXPECT_OK(res);
+}
+
 TEST_F(ContextTest, WaitForStopped) {
   YOGI_ContextRunInBackground(context_);
 
@@ -206,3 +314,102 @@ TEST_F(ContextTest, Post) {
   int res = YOGI_ContextPost(context_, [](void*) {}, nullptr);
   EXPECT_OK(res);
 }
+
+TEST_F(ContextTest, Stats) {
+  char json[4096];
+  int res = YOGI_ContextGetStats(context_, json, sizeof(json), YOGI_FALSE);
+  ASSERT_OK(res);
+  EXPECT_FALSE(nlohmann::json::parse(json)["enabled"].get<bool>());
+
+  res = YOGI_ContextConfigureStats(context_, YOGI_TRUE, -2);
+  EXPECT_ERR(res, YOGI_ERR_INVALID_PARAM);
+  res = YOGI_ContextConfigureStats(context_, YOGI_TRUE, 1000000);
+  EXPECT_OK(res);
+
+  YOGI_ContextPost(context_, [](void*) {}, nullptr);
+  YOGI_ContextPost(
+      context_, [](void*) { std::this_thread::sleep_for(2ms); }, nullptr);
+
+  res = YOGI_ContextGetStats(context_, json, sizeof(json), YOGI_FALSE);
+  ASSERT_OK(res);
+  auto stats = nlohmann::json::parse(json);
+  EXPECT_TRUE(stats["enabled"].get<bool>());
+  EXPECT_EQ(stats["queued_handlers"], 2);
+  EXPECT_EQ(stats["handlers"], 0);
+
+  res = YOGI_ContextPoll(context_, nullptr);
+  ASSERT_OK(res);
+
+  res = YOGI_ContextGetStats(context_, json, sizeof(json), YOGI_TRUE);
+  ASSERT_OK(res);
+  stats = nlohmann::json::parse(json);
+  EXPECT_EQ(stats["queued_handlers"], 0);
+  EXPECT_EQ(stats["max_queued_handlers"], 2);
+  EXPECT_EQ(stats["handlers"], 2);
+  EXPECT_EQ(stats["slow_handlers"], 1);
+  EXPECT_DOUBLE_EQ(stats["slow_handler_threshold"].get<double>(), 0.001);
+  EXPECT_GT(stats["busy_time"].get<double>(), 0.002);
+
+  auto& counts = stats["execution_times"]["counts"];
+  EXPECT_EQ(counts.size(), stats["execution_times"]["upper_bounds"].size() + 1);
+  int total = 0;
+  for (auto& count : counts) total += count.get<int>();
+  EXPECT_EQ(total, 2);
+
+  // Got reset
+  res = YOGI_ContextGetStats(context_, json, sizeof(json), YOGI_FALSE);
+  ASSERT_OK(res);
+  EXPECT_EQ(nlohmann::json::parse(json)["handlers"], 0);
+
+  res = YOGI_ContextGetStats(context_, json, 10, YOGI_FALSE);
+  EXPECT_ERR(res, YOGI_ERR_BUFFER_TOO_SMALL);
+}
+
+TEST_F(ContextTest, StatsCountNestedHandlersOnce) {
+  auto context = objects::Context::Create();
+  context->ConfigureLoopStats(true, std::chrono::nanoseconds::max());
+  boost::asio::io_context::strand strand(context->IoContext());
+
+  bool nested_called = false;
+  context->Post([&] {
+    boost::asio::dispatch(strand, context->WrapHandler([&] {
+                            std::this_thread::sleep_for(2ms);
+                            nested_called = true;
+                          }));
+  });
+
+  bool timer_called = false;
+  context->GetTimerWheel().ScheduleAfter(1ms, [&] { timer_called = true; });
+
+  while (!nested_called || !timer_called) {
+    context->RunOne(1s);
+  }
+
+  auto stats = nlohmann::json::parse(context->MakeLoopStatsString(false));
+  EXPECT_EQ(stats["handlers"], 2);
+  EXPECT_GT(stats["busy_time"].get<double>(), 0.002);
+}
+
+TEST_F(ContextTest, PostBatch) {
+  std::vector<int> calls;
+  auto fn = [](void* v) { static_cast<std::vector<int>*>(v)->push_back(1); };
+  auto fn2 = [](void* v) { static_cast<std::vector<int>*>(v)->push_back(2); };
+
+  void (*fns[])(void*) = {fn, fn2, fn};
+  void* userargs[] = {&calls, &calls, &calls};
+  int res = YOGI_ContextPostBatch(context_, fns, userargs, 3);
+  EXPECT_OK(res);
+
+  res = YOGI_ContextPostBatch(context_, fns, nullptr, 0);
+  EXPECT_OK(res);
+
+  void (*bad_fns[])(void*) = {fn, nullptr};
+  res = YOGI_ContextPostBatch(context_, bad_fns, userargs, 2);
+  EXPECT_ERR(res, YOGI_ERR_INVALID_PARAM);
+
+  int count = -1;
+  res = YOGI_ContextPoll(context_, &count);
+  EXPECT_OK(res);
+  EXPECT_EQ(count, 1);
+  EXPECT_EQ(calls, (std::vector<int>{1, 2, 1}));
+}
@@ -0,0 +1,120 @@
+/*
+ * This file is part of the Yogi distribution https://github.com/yohummus/yogi.
+ * Copyright (c) 2018 Johannes Bergmann.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "../common.h"
+#include "../../src/objects/detail/timer_wheel.h"
+using objects::detail::TimerWheel;
+
+#include <vector>
+
+class TimerWheelTest : public TestFixture {
+ protected:
+  void RunUntil(std::function<bool()> done) {
+    auto timeout = std::chrono::steady_clock::now() + 1s;
+    while (!done() && std::chrono::steady_clock::now() < timeout) {
+      ioc_.restart();
+      ioc_.run_one_for(10ms);
+    }
+  }
+
+  boost::asio::io_context ioc_;
+  objects::detail::LoopStats stats_{1};
+  TimerWheel uut_{ioc_, &stats_, 1ms, 16};
+};
+
+TEST_F(TimerWheelTest, Schedule) {
+  auto start_time = TimerWheel::Clock::now();
+
+  std::vector<int> fired;
+  uut_.ScheduleAfter(5ms, [&] { fired.push_back(2); });
+  uut_.ScheduleAfter(2ms, [&] { fired.push_back(1); });
+  uut_.ScheduleAfter(40ms, [&] { fired.push_back(3); });  // > 1 revolution
+  EXPECT_EQ(uut_.Size(), 3);
+
+  RunUntil([&] { return fired.size() == 3; });
+  EXPECT_EQ(fired, (std::vector<int>{1, 2, 3}));
+  EXPECT_GE(TimerWheel::Clock::now(), start_time + 40ms);
+  EXPECT_LT(TimerWheel::Clock::now(), start_time + 40ms + kTimingMargin);
+  EXPECT_EQ(uut_.Size(), 0);
+}
+
+TEST_F(TimerWheelTest, ScheduleInThePast) {
+  bool called = false;
+  uut_.Schedule(TimerWheel::Clock::now() - 1s, [&] { called = true; });
+
+  RunUntil([&] { return called; });
+  EXPECT_TRUE(called);
+}
+
+TEST_F(TimerWheelTest, NeverEarly) {
+  std::vector<bool> early;
+  for (int i = 0; i < 50; ++i) {
+    auto deadline = TimerWheel::Clock::now() + i * 70us;
+    uut_.Schedule(deadline, [&, deadline] {
+      early.push_back(TimerWheel::Clock::now() < deadline);
+    });
+  }
+
+  RunUntil([&] { return early.size() == 50; });
+  EXPECT_EQ(early, std::vector<bool>(50, false));
+}
+
+TEST_F(TimerWheelTest, Cancel) {
+  bool called_a = false;
+  bool called_b = false;
+  auto id = uut_.ScheduleAfter(2ms, [&] { called_a = true; });
+  uut_.ScheduleAfter(5ms, [&] { called_b = true; });
+
+  EXPECT_TRUE(uut_.Cancel(id));
+  EXPECT_FALSE(uut_.Cancel(id));
+  EXPECT_EQ(uut_.Size(), 1);
+
+  RunUntil([&] { return called_b; });
+  EXPECT_FALSE(called_a);
+  EXPECT_TRUE(called_b);
+  EXPECT_FALSE(uut_.Cancel(id));
+}
+
+TEST_F(TimerWheelTest, RescheduleFromHandler) {
+  int calls = 0;
+  std::function<void()> fn = [&] {
+    if (++calls < 5) {
+      uut_.ScheduleAfter(1ms, fn);
+    }
+  };
+
+  uut_.ScheduleAfter(1ms, fn);
+  RunUntil([&] { return calls == 5; });
+  EXPECT_EQ(calls, 5);
+  EXPECT_EQ(uut_.Size(), 0);
+}
+
+TEST_F(TimerWheelTest, ManyTimers) {
+  // Typical transport pattern: every operation cancels its previous timeout
+  // and schedules a new one
+  const int kNumTimers = 1000;
+  std::vector<TimerWheel::TimerId> ids(kNumTimers);
+  for (int round = 0; round < 100; ++round) {
+    for (auto& id : ids) {
+      uut_.Cancel(id);
+      id = uut_.ScheduleAfter(10s, [] {});
+    }
+  }
+
+  EXPECT_EQ(uut_.Size(), kNumTimers);
+}
@@ -0,0 +1,139 @@
+/*
+ * This file is part of the Yogi distribution https://github.com/yohummus/yogi.
+ * Copyright (c) 2018 Johannes Bergmann.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "../common.h"
+#include "../../src/utils/handler_memory.h"
+#include "../../src/utils/small_function.h"
+
+#include <boost/asio/post.hpp>
+#include <array>
+#include <memory>
+#include <thread>
+
+class HandlerMemoryTest : public TestFixture {
+ protected:
+  utils::HandlerMemoryPool pool_;
+};
+
+TEST_F(HandlerMemoryTest, RecyclesBlocks) {
+  void* p = pool_.Allocate(100);
+  ASSERT_NE(p, nullptr);
+  pool_.Deallocate(p, 100);
+
+  // Same size class
+  EXPECT_EQ(pool_.Allocate(128), p);
+  pool_.Deallocate(p, 128);
+}
+
+TEST_F(HandlerMemoryTest, LargeBlocks) {
+  void* p = pool_.Allocate(1024 * 1024);
+  ASSERT_NE(p, nullptr);
+  pool_.Deallocate(p, 1024 * 1024);
+}
+
+TEST_F(HandlerMemoryTest, AsioUsesPool) {
+  boost::asio::io_context ioc;
+
+  int calls = 0;
+  auto fn = [&] { ++calls; };
+  auto handler = utils::MakeRecyclingHandler(&pool_, fn);
+  EXPECT_EQ(boost::asio::get_associated_allocator(handler),
+            utils::HandlerAllocator<void>(&pool_));
+
+  boost::asio::post(ioc, handler);
+  ioc.run();
+  EXPECT_EQ(calls, 1);
+
+  // Once the pool holds enough blocks, posting does not allocate any more
+  for (int round = 0; round < 2; ++round) {
+    ioc.restart();
+    auto allocs = GetHeapAllocationCount();
+    for (int i = 0; i < 10; ++i) {
+      boost::asio::post(ioc, handler);
+    }
+
+    ioc.run();
+    if (round == 1) {
+      EXPECT_EQ(GetHeapAllocationCount(), allocs);
+    }
+  }
+
+  EXPECT_EQ(calls, 21);
+}
+
+TEST_F(HandlerMemoryTest, SharedPoolPerThread) {
+  auto pool = &utils::HandlerMemoryPool::Shared();
+  EXPECT_EQ(&utils::HandlerMemoryPool::Shared(), pool);
+
+  utils::HandlerMemoryPool* other_pool = nullptr;
+  std::thread([&] { other_pool = &utils::HandlerMemoryPool::Shared(); })
+      .join();
+  EXPECT_NE(other_pool, pool);
+
+  // Blocks can be returned to a different pool
+  void* p = pool->Allocate(100);
+  other_pool->Deallocate(p, 100);
+  EXPECT_EQ(other_pool->Allocate(100), p);
+  pool->Deallocate(p, 100);
+}
+
+TEST_F(HandlerMemoryTest, SmallFunction) {
+  utils::SmallFunction<int(int)> fn;
+  EXPECT_FALSE(fn);
+
+  fn = [](int x) { return x * 2; };
+  ASSERT_TRUE(fn);
+  EXPECT_EQ(fn(21), 42);
+
+  auto fn2 = fn;
+  EXPECT_EQ(fn2(1), 2);
+
+  auto fn3 = std::move(fn2);
+  EXPECT_EQ(fn3(2), 4);
+
+  fn = nullptr;
+  EXPECT_FALSE(fn);
+}
+
+TEST_F(HandlerMemoryTest, SmallFunctionWithLargeCapture) {
+  std::array<char, 512> big;
+  big.fill('x');
+  auto counter = std::make_shared<int>(0);
+
+  utils::SmallFunction<char()> fn = [big, counter] {
+    ++*counter;
+    return big[511];
+  };
+  EXPECT_EQ(counter.use_count(), 2);
+
+  auto fn2 = fn;
+  EXPECT_EQ(counter.use_count(), 3);
+  EXPECT_EQ(fn2(), 'x');
+  EXPECT_EQ(*counter, 1);
+
+  fn = nullptr;
+  fn2 = nullptr;
+  EXPECT_EQ(counter.use_count(), 1);
+
+  // The memory for the capture gets recycled
+  auto allocs = GetHeapAllocationCount();
+  fn = [big, counter] { return big[0]; };
+  EXPECT_EQ(fn(), 'x');
+  fn = nullptr;
+  EXPECT_EQ(GetHeapAllocationCount(), allocs);
+}
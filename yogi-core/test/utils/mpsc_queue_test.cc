@@ -0,0 +1,102 @@
+/*
+ * This file is part of the Yogi distribution https://github.com/yohummus/yogi.
+ * Copyright (c) 2018 Johannes Bergmann.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../common.h"
+#include "../../src/utils/mpsc_queue.h"
+using namespace utils;
+
+#include <thread>
+
+TEST(MpscQueueTest, ConsumeAll) {
+  LockFreeMpscQueue<int> uut;
+  EXPECT_TRUE(uut.Empty());
+
+  uut.Push(1);
+  uut.Push(2);
+  uut.Push(3);
+  EXPECT_FALSE(uut.Empty());
+
+  std::vector<int> values;
+  EXPECT_EQ(uut.ConsumeAll([&](int&& val) { values.push_back(val); }), 3);
+  EXPECT_EQ(values, (std::vector<int>{1, 2, 3}));
+  EXPECT_TRUE(uut.Empty());
+  EXPECT_EQ(uut.ConsumeAll([](int&&) {}), 0);
+}
+
+TEST(MpscQueueTest, DestroyNonEmpty) {
+  auto counter = std::make_shared<int>();
+  {
+    LockFreeMpscQueue<std::shared_ptr<int>> uut;
+    uut.Push(counter);
+    EXPECT_EQ(counter.use_count(), 2);
+  }
+
+  EXPECT_EQ(counter.use_count(), 1);
+}
+
+TEST(MpscQueueTest, MultipleProducers) {
+  const int kNumThreads = 8;
+  const int kValuesPerThread = 10000;
+
+  LockFreeMpscQueue<std::pair<int, int>> uut;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([&, i] {
+      for (int j = 0; j < kValuesPerThread; ++j) {
+        uut.Push(std::make_pair(i, j));
+      }
+    });
+  }
+
+  std::vector<int> next_values(kNumThreads);
+  int n = 0;
+  auto fn = [&](std::pair<int, int>&& val) {
+    EXPECT_EQ(val.second, next_values[static_cast<std::size_t>(val.first)]++);
+    ++n;
+  };
+
+  while (n < kNumThreads * kValuesPerThread) {
+    uut.ConsumeAll(fn);
+  }
+
+  for (auto& thread : threads) thread.join();
+  EXPECT_TRUE(uut.Empty());
+}
+
+TEST(MpscQueueTest, PooledNodes) {
+  LockFreeMpscQueue<int, 4> uut;
+
+  // More elements than the pool can hold get pushed into heap nodes
+  for (int i = 0; i < 10; ++i) {
+    uut.Push(i);
+  }
+
+  int next = 0;
+  EXPECT_EQ(uut.ConsumeAll([&](int&& val) { EXPECT_EQ(val, next++); }), 10);
+
+  // Up to the pool size, pushing does not allocate any memory
+  auto allocs_before = GetHeapAllocationCount();
+  for (int round = 0; round < 100; ++round) {
+    for (int i = 0; i < 4; ++i) {
+      uut.Push(i);
+    }
+
+    EXPECT_EQ(uut.ConsumeAll([](int&&) {}), 4);
+  }
+
+  EXPECT_EQ(GetHeapAllocationCount(), allocs_before);
+}
@@ -90,6 +90,78 @@ TEST_F(RingBufferTest, FirstWriteArray) {
   EXPECT_EQ(0, FirstWriteArraySize());
 }
 
+TEST_F(RingBufferTest, ReadArrays) {
+  auto arrays = uut.ReadArrays();
+  EXPECT_EQ(0, boost::asio::buffer_size(arrays));
+
+  ByteVector data(uut.Capacity());
+  for (std::size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<Byte>(i);
+  }
+
+  uut.Write(data.data(), data.size());
+  uut.Discard(6);
+  uut.Write(data.data(), 4);
+
+  arrays = uut.ReadArrays();
+  EXPECT_EQ(5, boost::asio::buffer_size(arrays[0]));
+  EXPECT_EQ(3, boost::asio::buffer_size(arrays[1]));
+
+  ByteVector buffer(boost::asio::buffer_size(arrays));
+  boost::asio::buffer_copy(boost::asio::buffer(buffer), arrays);
+  EXPECT_EQ(buffer, (ByteVector{6, 7, 8, 9, 0, 1, 2, 3}));
+
+  uut.CommitReadArrays(7);
+  EXPECT_EQ(1, uut.AvailableForRead());
+  EXPECT_EQ(3, uut.Front());
+}
+
+TEST_F(RingBufferTest, WriteArrays) {
+  auto arrays = uut.WriteArrays();
+  EXPECT_EQ(uut.Capacity(), boost::asio::buffer_size(arrays[0]));
+  EXPECT_EQ(0, boost::asio::buffer_size(arrays[1]));
+
+  ByteVector data(7, 'x');
+  uut.Write(data.data(), data.size());
+  uut.Discard(data.size());
+
+  arrays = uut.WriteArrays();
+  EXPECT_EQ(uut.Capacity(), boost::asio::buffer_size(arrays));
+  EXPECT_EQ(4, boost::asio::buffer_size(arrays[0]));
+  EXPECT_EQ(6, boost::asio::buffer_size(arrays[1]));
+
+  ByteVector input{1, 2, 3, 4, 5, 6};
+  boost::asio::buffer_copy(arrays, boost::asio::buffer(input));
+  uut.CommitWriteArrays(input.size());
+
+  ByteVector output(input.size());
+  EXPECT_EQ(input.size(), uut.Read(output.data(), output.size()));
+  EXPECT_EQ(input, output);
+}
+
+TEST_F(RingBufferTest, Reserve) {
+  auto arrays = uut.Reserve(3);
+  EXPECT_EQ(3, boost::asio::buffer_size(arrays[0]));
+  EXPECT_EQ(0, boost::asio::buffer_size(arrays[1]));
+
+  ByteVector data(7, 'x');
+  uut.Write(data.data(), data.size());
+  uut.Discard(data.size());
+
+  arrays = uut.Reserve(6);
+  EXPECT_EQ(4, boost::asio::buffer_size(arrays[0]));
+  EXPECT_EQ(2, boost::asio::buffer_size(arrays[1]));
+
+  ByteVector input{1, 2, 3, 4, 5, 6};
+  boost::asio::buffer_copy(arrays, boost::asio::buffer(input));
+  EXPECT_EQ(0, uut.AvailableForRead());
+  uut.CommitWriteArrays(input.size());
+
+  ByteVector output(input.size());
+  EXPECT_EQ(input.size(), uut.Read(output.data(), output.size()));
+  EXPECT_EQ(input, output);
+}
+
 TEST_F(RingBufferTest, Empty) {
   EXPECT_TRUE(uut.Empty());
   ByteVector buffer{'x'};
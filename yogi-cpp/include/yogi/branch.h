@@ -38,7 +38,10 @@
 #include "internal/flags.h"
 #include "internal/query_string.h"
 
+#include <cstdint>
+#include <cstring>
 #include <unordered_map>
+#include <vector>
 
 namespace yogi {
 
@@ -78,6 +81,19 @@ _YOGI_DEFINE_API_FN(int, YOGI_BranchReceiveBroadcastAsync,
                      int datasize, void (*fn)(int res, int size, void* userarg),
                      void* userarg))
 
+_YOGI_DEFINE_API_FN(int, YOGI_BranchReceiveBroadcastLeaseAsync,
+                    (void* branch,
+                     void (*fn)(int res, const void* uuid, const void* data,
+                                int size, void* lease, void* userarg),
+                     void* userarg))
+
+_YOGI_DEFINE_API_FN(int, YOGI_BranchReceiveBroadcastsAsync,
+                    (void* branch, int enc, void* data, int datasize,
+                     void (*fn)(int res, int count, int size, void* userarg),
+                     void* userarg))
+
+_YOGI_DEFINE_API_FN(int, YOGI_BranchReleaseBroadcastLease, (void* lease))
+
 _YOGI_DEFINE_API_FN(int, YOGI_BranchCancelReceiveBroadcast, (void* branch))
 
 /// \addtogroup enums
@@ -104,9 +120,12 @@ enum class BranchEvents {
   /// The connection to a branch was lost.
   kConnectionLost = (1 << 3),
 
+  /// A branch has been penalized for falling behind on broadcasts.
+  kSlowConsumer = (1 << 4),
+
   /// Combination of all flags.
-  kAll =
-      kBranchDiscovered | kBranchQueried | kConnectFinished | kConnectionLost,
+  kAll = kBranchDiscovered | kBranchQueried | kConnectFinished |
+         kConnectionLost | kSlowConsumer,
 };
 
 _YOGI_DEFINE_FLAG_OPERATORS(BranchEvents)
@@ -119,6 +138,7 @@ inline std::string ToString<BranchEvents>(const BranchEvents& events) {
     _YOGI_TO_STRING_ENUM_CASE(BranchEvents, kBranchQueried)
     _YOGI_TO_STRING_ENUM_CASE(BranchEvents, kConnectFinished)
     _YOGI_TO_STRING_ENUM_CASE(BranchEvents, kConnectionLost)
+    _YOGI_TO_STRING_ENUM_CASE(BranchEvents, kSlowConsumer)
     _YOGI_TO_STRING_ENUM_CASE(BranchEvents, kAll)
   }
 
@@ -127,6 +147,7 @@ inline std::string ToString<BranchEvents>(const BranchEvents& events) {
   _YOGI_TO_STRING_FLAG_APPENDER(events, BranchEvents, kBranchQueried)
   _YOGI_TO_STRING_FLAG_APPENDER(events, BranchEvents, kConnectFinished)
   _YOGI_TO_STRING_FLAG_APPENDER(events, BranchEvents, kConnectionLost)
+  _YOGI_TO_STRING_FLAG_APPENDER(events, BranchEvents, kSlowConsumer)
   return s.substr(3);
 }
 
@@ -215,6 +236,11 @@ class BranchInfo {
   /// \return True if the branch is in ghost mode.
   bool GetGhostMode() const { return json_["ghost_mode"]; }
 
+  /// Returns the name of the Unix domain socket for same-host connections.
+  ///
+  /// \returns The name of the Unix domain socket for same-host connections.
+  std::string GetUnixSocketName() const { return json_["unix_socket_name"]; }
+
   /// Returns the branch information as JSON-encoded string.
   ///
   /// \returns Branch information as JSON-encoded string.
@@ -423,6 +449,13 @@ class BranchQueriedEventInfo : public BranchEventInfo {
   /// \return True if the branch is in ghost mode.
   bool GetGhostMode() const { return ToJson()["ghost_mode"]; }
 
+  /// Returns the name of the Unix domain socket for same-host connections.
+  ///
+  /// \returns The name of the Unix domain socket for same-host connections.
+  std::string GetUnixSocketName() const {
+    return ToJson()["unix_socket_name"];
+  }
+
   /// Converts the event information to a RemoteBranchInfo object.
   ///
   /// \returns The converted RemoteBranchInfo object.
@@ -455,11 +488,105 @@ class ConnectionLostEventInfo : public BranchEventInfo {
   using BranchEventInfo::BranchEventInfo;
 };
 
+////////////////////////////////////////////////////////////////////////////////
+/// Information associated with the kSlowConsumer event.
+////////////////////////////////////////////////////////////////////////////////
+class SlowConsumerEventInfo : public BranchEventInfo {
+  friend class Branch;
+
+ public:
+  /// Returns the slow consumer policy that has been applied.
+  ///
+  /// \returns The slow consumer policy ("drop", "conflate" or "disconnect").
+  std::string GetPolicy() const { return ToJson()["policy"]; }
+
+  /// Returns the number of unsent broadcast bytes for the branch.
+  ///
+  /// \returns The number of unsent broadcast bytes for the branch.
+  int GetBacklog() const { return ToJson()["backlog"]; }
+
+ protected:
+  using BranchEventInfo::BranchEventInfo;
+};
+
 class Branch;
 
 /// Shared pointer to a branch.
 using BranchPtr = std::shared_ptr<Branch>;
 
+////////////////////////////////////////////////////////////////////////////////
+/// Broadcast message received via Branch::ReceiveBroadcastsAsync().
+////////////////////////////////////////////////////////////////////////////////
+struct ReceivedBroadcast {
+  /// UUID of the sending branch.
+  Uuid source;
+
+  /// View on the received payload in the receive buffer.
+  PayloadView payload;
+};
+
+class BroadcastLease;
+
+/// Unique pointer to a broadcast lease.
+using BroadcastLeasePtr = std::unique_ptr<BroadcastLease>;
+
+////////////////////////////////////////////////////////////////////////////////
+/// Lease on a broadcast message received via
+/// Branch::ReceiveBroadcastLeaseAsync().
+///
+/// The payload of the message stays in the receive queue of the connection
+/// that it arrived on until the lease gets released, either explicitly via
+/// Release() or by destroying the lease. No further messages will be received
+/// from the sending branch until then.
+////////////////////////////////////////////////////////////////////////////////
+class BroadcastLease {
+  friend class Branch;
+
+ public:
+  ~BroadcastLease() {
+    if (handle_) {
+      internal::YOGI_BranchReleaseBroadcastLease(handle_);
+    }
+  }
+
+  /// Returns the received payload.
+  ///
+  /// The payload is always encoded as MessagePack and the view is only valid
+  /// until the lease has been released.
+  ///
+  /// \returns View on the received payload.
+  const PayloadView& GetPayload() const { return payload_; }
+
+  /// Returns true if the lease has been released.
+  ///
+  /// \returns True if the lease has been released.
+  bool IsReleased() const { return handle_ == nullptr; }
+
+  /// Releases the lease.
+  ///
+  /// After this function returns, the payload must not be accessed anymore.
+  /// Calling this function on a lease that has already been released has no
+  /// effect.
+  void Release() {
+    if (!handle_) return;
+
+    int res = internal::YOGI_BranchReleaseBroadcastLease(handle_);
+    handle_ = nullptr;
+    payload_ = PayloadView();
+    internal::CheckErrorCode(res);
+  }
+
+ private:
+  BroadcastLease(void* handle, const PayloadView& payload)
+      : handle_(handle), payload_(payload) {}
+
+  BroadcastLease(const BroadcastLease&) = delete;
+  BroadcastLease& operator=(const BroadcastLease&) = delete;
+
+  void* handle_;
+  PayloadView payload_;
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 /// Entry point into a Yogi network.
 ///
@@ -517,6 +644,27 @@ class Branch : public ObjectT<Branch> {
   using ReceiveBroadcastSimpleFn = std::function<void(
       const Result& res, const Uuid& source, const PayloadView& payload)>;
 
+  /// Callback function used in ReceiveBroadcastsAsync().
+  ///
+  /// \param res       %Result of the receive operation.
+  /// \param broadcasts The received messages.
+  /// \param buffer    Buffer holding the messages.
+  using ReceiveBroadcastsFn =
+      std::function<void(const Result& res,
+                         const std::vector<ReceivedBroadcast>& broadcasts,
+                         BufferPtr&& buffer)>;
+
+  /// Callback function used in ReceiveBroadcastLeaseAsync().
+  ///
+  /// \param res     %Result of the receive operation.
+  /// \param source  UUID of the sending branch.
+  /// \param payload View on the received MessagePack payload.
+  /// \param lease   Lease on the payload (nullptr on failure).
+  using ReceiveBroadcastLeaseFn =
+      std::function<void(const Result& res, const Uuid& source,
+                         const PayloadView& payload,
+                         BroadcastLeasePtr&& lease)>;
+
   /// Creates a branch.
   ///
   /// The branch is configured via the \p props parameter. The supplied JSON
@@ -672,6 +820,11 @@ class Branch : public ObjectT<Branch> {
   /// \return True if the branch is in ghost mode.
   bool GetGhostMode() const { return info_.GetGhostMode(); }
 
+  /// Returns the name of the Unix domain socket for same-host connections.
+  ///
+  /// \returns The name of the Unix domain socket for same-host connections.
+  std::string GetUnixSocketName() const { return info_.GetUnixSocketName(); }
+
   /// Advertising IP address.
   ///
   /// \returns The advertising IP address.
@@ -788,6 +941,10 @@ class Branch : public ObjectT<Branch> {
                                                           data);
                 break;
 
+              case BranchEvents::kSlowConsumer:
+                CallAwaitEventFn<SlowConsumerEventInfo>(res, be, ev_res, data);
+                break;
+
               default: {
                 bool should_never_get_here = false;
                 assert(should_never_get_here);
@@ -1257,10 +1414,148 @@ class Branch : public ObjectT<Branch> {
                           });
   }
 
+  /// Receives multiple broadcast messages at once.
+  ///
+  /// This function works like ReceiveBroadcastAsync(), however, all broadcast
+  /// messages queued by the branch (see the _rx_broadcast_queue_depth_ branch
+  /// property) get written to \p buffer in one go, as long as they fit. If no
+  /// messages are queued, the operation completes as soon as the next one has
+  /// been received.
+  ///
+  /// Messages that do not fit into \p buffer any more remain queued for the
+  /// next receive operation. If not even the first message fits, then \p fn
+  /// will be called with the #kBufferTooSmall error and the message will be
+  /// discarded.
+  ///
+  /// This function shares its receive operation with ReceiveBroadcastAsync(),
+  /// i.e. calling either of them while a previous receive operation is still
+  /// active will cancel the previous operation with the #kCanceled error.
+  ///
+  /// \param enc    Encoding to use for the received payloads.
+  /// \param buffer Buffer to use for receiving the messages.
+  /// \param fn     Handler to call for the received messages.
+  void ReceiveBroadcastsAsync(EncodingType enc, BufferPtr&& buffer,
+                              ReceiveBroadcastsFn fn) {
+    struct CallbackData {
+      ReceiveBroadcastsFn fn;
+      BufferPtr buffer;
+      EncodingType enc;
+    };
+
+    auto data = std::make_unique<CallbackData>();
+    data->fn = fn;
+    data->buffer = std::move(buffer);
+    data->enc = enc;
+
+    int res = internal::YOGI_BranchReceiveBroadcastsAsync(
+        GetHandle(), static_cast<int>(enc), data->buffer->data(),
+        static_cast<int>(data->buffer->size()),
+        [](int res, int count, int size, void* userarg) {
+          auto data = std::unique_ptr<CallbackData>(
+              static_cast<CallbackData*>(userarg));
+          if (!data->fn) return;
+
+          // Each message is stored as the sender's UUID, the payload size as
+          // a 32 bit integer in host byte order and the payload itself
+          std::vector<ReceivedBroadcast> broadcasts;
+          if (Result(res)) {
+            broadcasts.reserve(static_cast<std::size_t>(count));
+            const char* p = data->buffer->data();
+            const char* end = p + size;
+            while (p < end) {
+              ReceivedBroadcast brd;
+              std::memcpy(brd.source.data(), p, brd.source.size());
+              p += brd.source.size();
+
+              std::uint32_t payload_size;
+              std::memcpy(&payload_size, p, sizeof(payload_size));
+              p += sizeof(payload_size);
+
+              brd.payload = PayloadView(
+                  p, static_cast<std::size_t>(payload_size), data->enc);
+              p += payload_size;
+
+              broadcasts.push_back(brd);
+            }
+          }
+
+          internal::WithErrorCodeToResult(res, data->fn, broadcasts,
+                                          std::move(data->buffer));
+        },
+        data.get());
+
+    internal::CheckErrorCode(res);
+    data.release();
+  }
+
+  /// Receives multiple broadcast messages at once.
+  ///
+  /// This function works like ReceiveBroadcastsAsync() above with the
+  /// payloads being encoded as MessagePack.
+  ///
+  /// \param buffer Buffer to use for receiving the messages.
+  /// \param fn     Handler to call for the received messages.
+  void ReceiveBroadcastsAsync(BufferPtr&& buffer, ReceiveBroadcastsFn fn) {
+    ReceiveBroadcastsAsync(EncodingType::kMsgpack, std::move(buffer), fn);
+  }
+
+  /// Receives a broadcast message without copying its payload.
+  ///
+  /// Instead of copying the received payload into a buffer, \p fn gets a view
+  /// directly into the receive queue of the connection that the message
+  /// arrived on. The payload is always encoded as MessagePack.
+  ///
+  /// The payload stays valid until the lease passed to \p fn has been
+  /// released or destroyed. No further messages will be received from the
+  /// sending branch until then; hence, leases should be released as soon as
+  /// possible. If \p fn does not take ownership of the lease, it gets
+  /// released once \p fn returns.
+  ///
+  /// This function shares its receive operation with ReceiveBroadcastAsync(),
+  /// i.e. calling either of them while a previous receive operation is still
+  /// active will cancel the previous operation with the #kCanceled error.
+  ///
+  /// \param fn Handler to call for the received broadcast message.
+  void ReceiveBroadcastLeaseAsync(ReceiveBroadcastLeaseFn fn) {
+    struct CallbackData {
+      ReceiveBroadcastLeaseFn fn;
+    };
+
+    auto data = std::make_unique<CallbackData>();
+    data->fn = fn;
+
+    int res = internal::YOGI_BranchReceiveBroadcastLeaseAsync(
+        GetHandle(),
+        [](int res, const void* uuid, const void* payload_data, int size,
+           void* lease_handle, void* userarg) {
+          auto data = std::unique_ptr<CallbackData>(
+              static_cast<CallbackData*>(userarg));
+
+          Uuid source = {};
+          PayloadView payload;
+          BroadcastLeasePtr lease;
+          if (Result(res)) {
+            std::memcpy(source.data(), uuid, source.size());
+            payload = PayloadView(static_cast<const char*>(payload_data), size,
+                                  EncodingType::kMsgpack);
+            lease.reset(new BroadcastLease(lease_handle, payload));
+          }
+
+          if (!data->fn) return;
+          internal::WithErrorCodeToResult(res, data->fn, source, payload,
+                                          std::move(lease));
+        },
+        data.get());
+
+    internal::CheckErrorCode(res);
+    data.release();
+  }
+
   /// Cancels receiving a broadcast message.
   ///
   /// Calling this function will cause the handler registered via
-  /// ReceiveBroadcastAsync() to be called with the kCanceled error.
+  /// ReceiveBroadcastAsync(), ReceiveBroadcastsAsync() or
+  /// ReceiveBroadcastLeaseAsync() to be called with the kCanceled error.
   ///
   /// \note
   ///   If the receive handler has already been scheduled for execution,
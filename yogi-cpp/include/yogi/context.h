@@ -24,16 +24,22 @@
 
 #include "object.h"
 #include "duration.h"
+#include "json.h"
 #include "internal/duration_conversion.h"
+#include "internal/query_string.h"
 
 #include <chrono>
 #include <functional>
 #include <memory>
+#include <vector>
 
 namespace yogi {
 
 _YOGI_DEFINE_API_FN(int, YOGI_ContextCreate, (void** context))
 
+_YOGI_DEFINE_API_FN(int, YOGI_ContextCreateWithThreads,
+                    (void** context, int num_threads))
+
 _YOGI_DEFINE_API_FN(int, YOGI_ContextPoll, (void* context, int* count))
 
 _YOGI_DEFINE_API_FN(int, YOGI_ContextPollOne, (void* context, int* count))
@@ -44,8 +50,14 @@ _YOGI_DEFINE_API_FN(int, YOGI_ContextRun,
 _YOGI_DEFINE_API_FN(int, YOGI_ContextRunOne,
                     (void* context, int* count, long long duration))
 
+_YOGI_DEFINE_API_FN(int, YOGI_ContextRunBusyPoll,
+                    (void* context, int* count, long long duration))
+
 _YOGI_DEFINE_API_FN(int, YOGI_ContextRunInBackground, (void* context))
 
+_YOGI_DEFINE_API_FN(int, YOGI_ContextRunInBackgroundBusyPoll,
+                    (void* context, int cpu))
+
 _YOGI_DEFINE_API_FN(int, YOGI_ContextStop, (void* context))
 
 _YOGI_DEFINE_API_FN(int, YOGI_ContextWaitForRunning,
@@ -57,6 +69,30 @@ _YOGI_DEFINE_API_FN(int, YOGI_ContextWaitForStopped,
 _YOGI_DEFINE_API_FN(int, YOGI_ContextPost,
                     (void* context, void (*fn)(void* userarg), void* userarg))
 
+_YOGI_DEFINE_API_FN(int, YOGI_ContextPostBatch,
+                    (void* context, void (*fns[])(void* userarg),
+                     void* userargs[], int n))
+
+_YOGI_DEFINE_API_FN(int, YOGI_ContextConfigureStats,
+                    (void* context, int enable, long long slow_threshold))
+
+_YOGI_DEFINE_API_FN(int, YOGI_ContextGetStats,
+                    (void* context, char* json, int jsonsize, int reset))
+
+_YOGI_DEFINE_API_FN(int, YOGI_ContextGroupCreate,
+                    (void** group, int num_contexts))
+
+_YOGI_DEFINE_API_FN(int, YOGI_ContextGroupGetContext,
+                    (void* group, int index, void** context))
+
+_YOGI_DEFINE_API_FN(int, YOGI_ContextGroupRunInBackground,
+                    (void* group, int pin))
+
+_YOGI_DEFINE_API_FN(int, YOGI_ContextGroupStop, (void* group))
+
+_YOGI_DEFINE_API_FN(int, YOGI_ContextGroupWaitForStopped,
+                    (void* group, long long duration))
+
 class Context;
 
 /// Shared pointer to a context.
@@ -70,13 +106,19 @@ using ContextPtr = std::shared_ptr<Context>;
 /// Poll... or Run... functions.
 ////////////////////////////////////////////////////////////////////////////////
 class Context : public ObjectT<Context> {
+  friend class ContextGroup;
+
  public:
   using HandlerFn = std::function<void()>;
 
   /// Creates the context
   ///
+  /// \param num_threads Number of threads running the context's handlers.
+  ///
   /// \returns The created context.
-  static ContextPtr Create() { return ContextPtr(new Context()); }
+  static ContextPtr Create(int num_threads = 1) {
+    return ContextPtr(new Context(num_threads));
+  }
 
   /// Runs the context's event processing loop to execute ready handlers.
   ///
@@ -182,6 +224,39 @@ class Context : public ObjectT<Context> {
   /// \returns Number of executed handlers.
   int RunOne() { return RunOne(Duration::kInfinity); }
 
+  /// Runs the context's event processing loop for the specified duration
+  /// without ever blocking.
+  ///
+  /// This function behaves like Run() but instead of sleeping while waiting for
+  /// events, it continuously polls for ready handlers. This keeps the calling
+  /// thread busy at 100% CPU load but avoids the latency of being woken up by
+  /// the operating system.
+  ///
+  /// This function must be called from outside any handler functions that are
+  /// being executed through the context.
+  ///
+  /// \param duration Duration.
+  ///
+  /// \returns Number of executed handlers.
+  int RunBusyPoll(const Duration& duration) {
+    int count;
+    int res = internal::YOGI_ContextRunBusyPoll(
+        GetHandle(), &count, internal::ToCoreDuration(duration));
+    internal::CheckErrorCode(res);
+    return count;
+  }
+
+  /// Runs the context's event processing loop without ever blocking.
+  ///
+  /// This function behaves like Run() but instead of sleeping while waiting for
+  /// events, it continuously polls for ready handlers until Stop() is called.
+  ///
+  /// This function must be called from outside any handler functions that are
+  /// being executed through the context.
+  ///
+  /// \returns Number of executed handlers.
+  int RunBusyPoll() { return RunBusyPoll(Duration::kInfinity); }
+
   /// Starts an internal thread for running the context's event processing loop.
   ///
   /// This function starts a threads that runs the context's event processing
@@ -196,6 +271,24 @@ class Context : public ObjectT<Context> {
     internal::CheckErrorCode(res);
   }
 
+  /// Starts internal threads for running the context's event processing loop
+  /// in busy-poll mode.
+  ///
+  /// This function works like RunInBackground() except that the threads never
+  /// block (see RunBusyPoll()). Optionally, the threads can be pinned to CPUs:
+  /// the first thread gets pinned to \p cpu, the second one to \p cpu + 1 and
+  /// so on.
+  ///
+  /// This function must be called from outside any handler functions that are
+  /// being executed through the context.
+  ///
+  /// \param cpu Index of the CPU to pin the first thread to (-1 to not pin the
+  ///            threads).
+  void RunInBackgroundBusyPoll(int cpu = -1) {
+    int res = internal::YOGI_ContextRunInBackgroundBusyPoll(GetHandle(), cpu);
+    internal::CheckErrorCode(res);
+  }
+
   /// Stops the context's event processing loop.
   ///
   /// This function signals the context to stop running its event processing
@@ -272,9 +365,210 @@ class Context : public ObjectT<Context> {
     internal::CheckErrorCode(res);
   }
 
+  /// Adds the given functions to the context's event processing queue as a
+  /// single handler and returns immediately.
+  ///
+  /// The functions will be called one after another in the given order from
+  /// the same thread. Unlike posting each function individually, the batch
+  /// counts as one handler for RunOne() and PollOne() and its functions never
+  /// run concurrently.
+  ///
+  /// \param fns Functions to call from within the context.
+  void PostBatch(const std::vector<HandlerFn>& fns) {
+    if (fns.empty()) return;
+
+    static auto wrapper = [](void* userarg) {
+      std::unique_ptr<HandlerFn> fn_ptr(static_cast<HandlerFn*>(userarg));
+      (*fn_ptr)();
+    };
+
+    std::vector<void (*)(void*)> wrappers(fns.size(), wrapper);
+    std::vector<void*> fn_ptrs;
+    for (auto& fn : fns) {
+      fn_ptrs.push_back(new HandlerFn(fn));
+    }
+
+    int res = internal::YOGI_ContextPostBatch(GetHandle(), wrappers.data(),
+                                              fn_ptrs.data(),
+                                              static_cast<int>(fns.size()));
+    if (res < 0) {
+      for (auto fn_ptr : fn_ptrs) {
+        delete static_cast<HandlerFn*>(fn_ptr);
+      }
+    }
+
+    internal::CheckErrorCode(res);
+  }
+
+  /// Enables or disables recording statistics about the context's event
+  /// processing loop.
+  ///
+  /// When enabled, the context measures the execution time of handlers, the
+  /// time that posted handlers spend waiting in the queue as well as the number
+  /// of queued handlers. Enabling the statistics resets them.
+  ///
+  /// Handlers taking longer than \p slow_threshold to execute get reported via
+  /// a warning log entry.
+  ///
+  /// \param enable         True to enable and false to disable the statistics.
+  /// \param slow_threshold Execution time above which handlers are considered
+  ///                       slow (infinity to never report slow handlers).
+  void ConfigureStats(bool enable,
+                      const Duration& slow_threshold = Duration::kInfinity) {
+    int res = internal::YOGI_ContextConfigureStats(
+        GetHandle(), enable ? 1 : 0, internal::ToCoreDuration(slow_threshold));
+    internal::CheckErrorCode(res);
+  }
+
+  /// Retrieves the statistics about the context's event processing loop.
+  ///
+  /// See YOGI_ContextGetStats() in yogi_core.h for the structure of the
+  /// returned JSON object. All times are in seconds.
+  ///
+  /// \param reset Reset the statistics after reading them.
+  ///
+  /// \returns The statistics.
+  Json GetStats(bool reset = false) {
+    auto json = internal::QueryString([&](auto str, auto size) {
+      return internal::YOGI_ContextGetStats(this->GetHandle(), str, size, 0);
+    });
+
+    if (reset) {
+      // The statistics get reset even if they do not fit into the buffer, so
+      // retrying with a larger buffer would lose them; the JSON only grows
+      // slightly between the two calls though
+      std::vector<char> v(json.size() * 2 + 1024);
+      int res = internal::YOGI_ContextGetStats(
+          GetHandle(), v.data(), static_cast<int>(v.size()), 1);
+      internal::CheckErrorCode(res);
+      json = v.data();
+    }
+
+    return Json::parse(json);
+  }
+
  private:
-  Context()
-      : ObjectT(internal::CallApiCreate(internal::YOGI_ContextCreate), {}) {}
+  Context(int num_threads)
+      : ObjectT(internal::CallApiCreate(
+                internal::YOGI_ContextCreateWithThreads, num_threads),
+                {}) {}
+
+  Context(void* handle) : ObjectT(handle, {}) {}
+};
+
+class ContextGroup;
+
+/// Shared pointer to a context group.
+using ContextGroupPtr = std::shared_ptr<ContextGroup>;
+
+////////////////////////////////////////////////////////////////////////////////
+/// Group of contexts, each running its event processing loop in a thread of
+/// its own.
+///
+/// A branch created on one of the group's contexts distributes its
+/// connections over all contexts of the group. Handlers for operations on
+/// such a branch get called from the thread of whichever context handles the
+/// connection that caused them to be called.
+///
+/// The contexts of the group are regular contexts; they get destroyed after
+/// the group.
+////////////////////////////////////////////////////////////////////////////////
+class ContextGroup : public ObjectT<ContextGroup> {
+ public:
+  /// Creates the context group.
+  ///
+  /// \param num_contexts Number of contexts to create; 0 creates one context
+  ///                     per CPU core.
+  ///
+  /// \returns The created context group.
+  static ContextGroupPtr Create(int num_contexts = 0) {
+    return ContextGroupPtr(new ContextGroup(
+        internal::CallApiCreate(internal::YOGI_ContextGroupCreate,
+                                num_contexts)));
+  }
+
+  /// Returns the number of contexts in the group.
+  ///
+  /// \returns Number of contexts in the group.
+  int GetSize() const { return static_cast<int>(contexts_.size()); }
+
+  /// Returns a context of the group.
+  ///
+  /// \param index Index of the context (starting at 0).
+  ///
+  /// \returns The context.
+  const ContextPtr& GetContext(int index) const {
+    return contexts_.at(static_cast<std::size_t>(index));
+  }
+
+  /// Returns all contexts of the group.
+  ///
+  /// \returns The contexts of the group.
+  const std::vector<ContextPtr>& GetContexts() const { return contexts_; }
+
+  /// Runs the event processing loops of all contexts in the group, each in
+  /// its own background thread.
+  ///
+  /// If \p pin is true, the thread of the context with index i gets pinned to
+  /// CPU core i (modulo the number of cores). On platforms that do not
+  /// support this, a warning is logged and the threads run unpinned.
+  ///
+  /// \param pin Pin the threads to CPU cores.
+  void RunInBackground(bool pin = false) {
+    int res = internal::YOGI_ContextGroupRunInBackground(GetHandle(),
+                                                         pin ? 1 : 0);
+    internal::CheckErrorCode(res);
+  }
+
+  /// Stops the event processing loops of all contexts in the group.
+  void Stop() {
+    int res = internal::YOGI_ContextGroupStop(GetHandle());
+    internal::CheckErrorCode(res);
+  }
+
+  /// Blocks until no context in the group is running its event processing
+  /// loop any more or until the specified timeout is reached.
+  ///
+  /// \param duration Maximum time to wait.
+  ///
+  /// \returns True if no context is running its event processing loop within
+  ///          the specified duration and false otherwise.
+  bool WaitForStopped(const Duration& duration) {
+    int res = internal::YOGI_ContextGroupWaitForStopped(
+        GetHandle(), internal::ToCoreDuration(duration));
+    if (res == static_cast<int>(ErrorCode::kTimeout)) return false;
+    internal::CheckErrorCode(res);
+    return true;
+  }
+
+  /// Blocks until no context in the group is running its event processing
+  /// loop any more.
+  void WaitForStopped() { WaitForStopped(Duration::kInfinity); }
+
+ private:
+  ContextGroup(void* handle) : ContextGroup(handle, QueryContexts(handle)) {}
+
+  // The contexts are dependencies so that they get destroyed after the group
+  ContextGroup(void* handle, std::vector<ContextPtr> contexts)
+      : ObjectT(handle, std::vector<ObjectPtr>(contexts.begin(),
+                                               contexts.end())),
+        contexts_(std::move(contexts)) {}
+
+  static std::vector<ContextPtr> QueryContexts(void* handle) {
+    std::vector<ContextPtr> contexts;
+    while (true) {
+      void* context;
+      int res = internal::YOGI_ContextGroupGetContext(
+          handle, static_cast<int>(contexts.size()), &context);
+      if (res == static_cast<int>(ErrorCode::kInvalidParam)) break;
+      internal::CheckErrorCode(res);
+      contexts.push_back(ContextPtr(new Context(context)));
+    }
+
+    return contexts;
+  }
+
+  const std::vector<ContextPtr> contexts_;
 };
 
 }  // namespace yogi
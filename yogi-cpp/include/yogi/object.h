@@ -33,6 +33,8 @@
 #include <memory>
 #include <type_traits>
 #include <initializer_list>
+#include <utility>
+#include <vector>
 
 namespace yogi {
 namespace internal {
@@ -118,6 +120,9 @@ class Object : public std::enable_shared_from_this<Object> {
   Object(void* handle, std::initializer_list<ObjectPtr> dependencies)
       : handle_(handle), dependencies_(dependencies) {}
 
+  Object(void* handle, std::vector<ObjectPtr> dependencies)
+      : handle_(handle), dependencies_(std::move(dependencies)) {}
+
   void* GetHandle() const { return handle_; }
 
   static void* GetForeignHandle(const ObjectPtr& other) {
@@ -129,7 +134,7 @@ class Object : public std::enable_shared_from_this<Object> {
   Object& operator=(const Object&) = delete;
 
   void* handle_;
-  const std::initializer_list<ObjectPtr> dependencies_;
+  const std::vector<ObjectPtr> dependencies_;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -56,6 +56,7 @@ TEST_F(BranchTest, BranchEventsEnum) {
   CHECK_ENUM_ELEMENT(BranchEvents, kBranchQueried,    YOGI_BEV_BRANCH_QUERIED);
   CHECK_ENUM_ELEMENT(BranchEvents, kConnectFinished,  YOGI_BEV_CONNECT_FINISHED);
   CHECK_ENUM_ELEMENT(BranchEvents, kConnectionLost,   YOGI_BEV_CONNECTION_LOST);
+  CHECK_ENUM_ELEMENT(BranchEvents, kSlowConsumer,     YOGI_BEV_SLOW_CONSUMER);
   CHECK_ENUM_ELEMENT(BranchEvents, kAll,              YOGI_BEV_ALL);
   // clang-format on
 
@@ -100,6 +101,7 @@ TEST_F(BranchTest, Info) {
   EXPECT_LT(info.GetStartTime(), yogi::GetCurrentTime());
   EXPECT_EQ(info.GetTimeout(), yogi::Duration::kInfinity);
   EXPECT_FALSE(info.GetGhostMode());
+  EXPECT_EQ(info.GetUnixSocketName(), "yogi-" + info.GetUuid().ToString());
   EXPECT_GT(info.GetTxQueueSize(), 1000);
   EXPECT_GT(info.GetRxQueueSize(), 1000);
 
@@ -118,6 +120,7 @@ TEST_F(BranchTest, Info) {
   EXPECT_EQ(branch->GetStartTime(), info.GetStartTime());
   EXPECT_EQ(branch->GetTimeout(), info.GetTimeout());
   EXPECT_EQ(branch->GetGhostMode(), info.GetGhostMode());
+  EXPECT_EQ(branch->GetUnixSocketName(), info.GetUnixSocketName());
   EXPECT_EQ(branch->GetTxQueueSize(), info.GetTxQueueSize());
   EXPECT_EQ(branch->GetRxQueueSize(), info.GetRxQueueSize());
 }
@@ -407,6 +410,116 @@ TEST_F(BranchTest, ReceiveBroadcast) {
   while (!called) context_->RunOne();
 }
 
+TEST_F(BranchTest, ReceiveBroadcasts) {
+  auto branch_a = yogi::Branch::Create(
+      context_, "{\"name\":\"a\", \"rx_broadcast_queue_depth\":8}");
+  auto branch_b = yogi::Branch::Create(context_, "{\"name\":\"b\"}");
+  RunContextUntilBranchesAreConnected(context_, {branch_a, branch_b});
+
+  // Messages received while not receiving get queued
+  int sent = 0;
+  for (int i = 0; i < 3; ++i) {
+    branch_b->SendBroadcastAsync(msgpack_view_,
+                                 [&](auto& res, auto) {
+                                   EXPECT_EQ(res, yogi::Success());
+                                   ++sent;
+                                 });
+  }
+  while (sent < 3) context_->RunOne();
+  context_->Poll();
+
+  // With encoding
+  auto uuid_b = branch_b->GetUuid();
+  std::size_t received = 0;
+  while (received < 3) {
+    bool called = false;
+    auto buffer = std::make_unique<yogi::Buffer>(1000);
+    branch_a->ReceiveBroadcastsAsync(
+        yogi::EncodingType::kJson, std::move(buffer),
+        [&](auto& res, auto& broadcasts, auto&& buffer) {
+          EXPECT_EQ(res, yogi::Success());
+          EXPECT_FALSE(broadcasts.empty());
+          EXPECT_EQ(buffer->size(), 1000u);
+          for (auto& brd : broadcasts) {
+            EXPECT_EQ(brd.source, uuid_b);
+            EXPECT_EQ(brd.payload, json_view_);
+          }
+          received += broadcasts.size();
+          called = true;
+        });
+
+    while (!called) context_->RunOne();
+  }
+
+  EXPECT_EQ(received, 3u);
+
+  // Buffer too small for the first message
+  bool called = false;
+  auto buffer = std::make_unique<yogi::Buffer>(10);
+  branch_a->ReceiveBroadcastsAsync(
+      std::move(buffer), [&](auto& res, auto& broadcasts, auto&&) {
+        EXPECT_EQ(res, yogi::Failure(yogi::ErrorCode::kBufferTooSmall));
+        EXPECT_TRUE(broadcasts.empty());
+        called = true;
+      });
+
+  branch_b->SendBroadcastAsync(msgpack_view_, {});
+  while (!called) context_->RunOne();
+}
+
+TEST_F(BranchTest, ReceiveBroadcastLease) {
+  auto branch_a = yogi::Branch::Create(context_, "{\"name\":\"a\"}");
+  auto branch_b = yogi::Branch::Create(context_, "{\"name\":\"b\"}");
+  RunContextUntilBranchesAreConnected(context_, {branch_a, branch_b});
+
+  // Keep the lease beyond the handler function
+  auto uuid_b = branch_b->GetUuid();
+  yogi::BroadcastLeasePtr lease;
+  branch_a->ReceiveBroadcastLeaseAsync(
+      [&](auto& res, auto& source, auto& payload, auto&& lse) {
+        EXPECT_EQ(res, yogi::Success());
+        EXPECT_EQ(source, uuid_b);
+        EXPECT_EQ(payload, msgpack_view_);
+        ASSERT_TRUE(lse);
+        lease = std::move(lse);
+      });
+
+  branch_b->SendBroadcastAsync(msgpack_view_, {});
+  while (!lease) context_->RunOne();
+
+  EXPECT_FALSE(lease->IsReleased());
+  EXPECT_EQ(lease->GetPayload(), msgpack_view_);
+
+  // Release the lease by letting it go out of scope in the handler function
+  bool called = false;
+  branch_a->ReceiveBroadcastLeaseAsync(
+      [&](auto& res, auto&, auto& payload, auto&&) {
+        EXPECT_EQ(res, yogi::Success());
+        EXPECT_EQ(payload, msgpack_view_);
+        called = true;
+      });
+
+  branch_b->SendBroadcastAsync(msgpack_view_, {});
+  lease->Release();
+  EXPECT_TRUE(lease->IsReleased());
+  EXPECT_NO_THROW(lease->Release());
+
+  while (!called) context_->RunOne();
+
+  // Canceled
+  called = false;
+  branch_a->ReceiveBroadcastLeaseAsync(
+      [&](auto& res, auto&, auto&, auto&& lse) {
+        EXPECT_EQ(res, yogi::Failure(yogi::ErrorCode::kCanceled));
+        EXPECT_FALSE(lse);
+        called = true;
+      });
+
+  EXPECT_TRUE(branch_a->CancelReceiveBroadcast());
+  context_->Poll();
+  EXPECT_TRUE(called);
+}
+
 TEST_F(BranchTest, CancelReceiveBroadcast) {
   auto branch_a = yogi::Branch::Create(context_, "{\"name\":\"a\"}");
 
@@ -20,6 +20,9 @@
 #include <regex>
 #include <thread>
 #include <chrono>
+#include <vector>
+#include <atomic>
+#include <stdexcept>
 using namespace std::chrono_literals;
 
 class ContextTest : public testing::Test {
@@ -55,6 +58,47 @@ TEST_F(ContextTest, RunOne) {
   EXPECT_EQ(context_->RunOne(1ms), 1);
 }
 
+TEST_F(ContextTest, RunBusyPoll) {
+  EXPECT_EQ(context_->RunBusyPoll(1ms), 0);
+  context_->Post([] {});
+  context_->Post([] {});
+  EXPECT_EQ(context_->RunBusyPoll(1ms), 2);
+}
+
+TEST_F(ContextTest, PostBatch) {
+  std::vector<int> order;
+  context_->PostBatch({[&] { order.push_back(1); }, [&] { order.push_back(2); },
+                       [&] { order.push_back(3); }});
+  EXPECT_EQ(context_->RunOne(1ms), 1);
+  EXPECT_EQ(order, (std::vector<int>{1, 2, 3}));
+
+  context_->PostBatch({});
+  EXPECT_EQ(context_->Poll(), 0);
+}
+
+TEST_F(ContextTest, Stats) {
+  auto stats = context_->GetStats();
+  EXPECT_FALSE(stats["enabled"].get<bool>());
+
+  context_->ConfigureStats(true, 10ms);
+  context_->Post([] {});
+  context_->Post([] {});
+  context_->Poll();
+
+  stats = context_->GetStats(true);
+  EXPECT_TRUE(stats["enabled"].get<bool>());
+  EXPECT_EQ(stats["handlers"].get<int>(), 2);
+  EXPECT_NEAR(stats["slow_handler_threshold"].get<double>(), 0.01, 1e-9);
+  EXPECT_TRUE(stats["execution_times"].count("upper_bounds"));
+  EXPECT_TRUE(stats["queue_delays"].count("counts"));
+
+  stats = context_->GetStats();
+  EXPECT_EQ(stats["handlers"].get<int>(), 0);
+
+  context_->ConfigureStats(false);
+  EXPECT_FALSE(context_->GetStats()["enabled"].get<bool>());
+}
+
 TEST_F(ContextTest, RunInBackground) {
   context_->RunInBackground();
 
@@ -65,6 +109,20 @@ TEST_F(ContextTest, RunInBackground) {
     ;
 }
 
+TEST_F(ContextTest, RunInBackgroundBusyPoll) {
+  context_->RunInBackgroundBusyPoll();
+
+  std::atomic<bool> called{false};
+  context_->Post([&] { called = true; });
+
+  while (!called)
+    ;
+
+  context_->Stop();
+  context_->WaitForStopped();
+  EXPECT_THROW(context_->RunInBackgroundBusyPoll(-2), yogi::FailureException);
+}
+
 TEST_F(ContextTest, Stop) {
   auto th = std::thread([&] {
     context_->WaitForRunning();
@@ -89,3 +147,48 @@ TEST_F(ContextTest, WaitForRunningAndStopped) {
   context_->Stop();
   context_->WaitForStopped();
 }
+
+TEST(ContextGroupTest, Create) {
+  auto group = yogi::ContextGroup::Create(3);
+  EXPECT_EQ(group->GetSize(), 3);
+  EXPECT_EQ(group->GetContexts().size(), 3u);
+  EXPECT_NE(group->GetContext(0), group->GetContext(1));
+  EXPECT_EQ(group->GetContext(2), group->GetContexts()[2]);
+  EXPECT_THROW(group->GetContext(3), std::out_of_range);
+
+  group = yogi::ContextGroup::Create();
+  EXPECT_GE(group->GetSize(), 1);
+}
+
+TEST(ContextGroupTest, RunInBackgroundAndStop) {
+  auto group = yogi::ContextGroup::Create(2);
+  EXPECT_TRUE(group->WaitForStopped(1ms));
+
+  group->RunInBackground();
+
+  std::atomic<int> calls{0};
+  for (auto& context : group->GetContexts()) {
+    context->WaitForRunning();
+    context->Post([&] { ++calls; });
+  }
+
+  while (calls != 2)
+    ;
+
+  EXPECT_FALSE(group->WaitForStopped(1ms));
+  group->Stop();
+  group->WaitForStopped();
+
+  for (auto& context : group->GetContexts()) {
+    EXPECT_TRUE(context->WaitForStopped(1ms));
+  }
+}
+
+TEST(ContextGroupTest, ContextOutlivesGroup) {
+  auto group = yogi::ContextGroup::Create(2);
+  auto context = group->GetContext(1);
+  group.reset();
+
+  context->Post([] {});
+  EXPECT_EQ(context->Poll(), 1);
+}
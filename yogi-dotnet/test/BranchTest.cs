@@ -94,6 +94,7 @@ namespace test
             Assert.True(info.StartTime < Yogi.CurrentTime);
             Assert.Equal(Yogi.Duration.Infinity, info.Timeout);
             Assert.False(info.GhostMode);
+            Assert.Equal("yogi-" + info.Uuid, info.UnixSocketName);
             Assert.True(info.TxQueueSize > 1000);
             Assert.True(info.RxQueueSize > 1000);
 
@@ -112,6 +113,7 @@ namespace test
             Assert.Equal(info.StartTime, branch.StartTime);
             Assert.Equal(info.Timeout, branch.Timeout);
             Assert.Equal(info.GhostMode, branch.GhostMode);
+            Assert.Equal(info.UnixSocketName, branch.UnixSocketName);
             Assert.Equal(info.TxQueueSize, branch.TxQueueSize);
             Assert.Equal(info.RxQueueSize, branch.RxQueueSize);
         }
@@ -451,6 +453,144 @@ namespace test
             GC.KeepAlive(branchB);
         }
 
+        [Fact]
+        public void ReceiveBroadcastsAsync()
+        {
+            var branchA = new Yogi.Branch(context,
+                "{\"name\":\"a\", \"rx_broadcast_queue_depth\":8}");
+            var branchB = new Yogi.Branch(context, "{\"name\":\"b\"}");
+            RunContextUntilBranchesAreConnected(context, branchA, branchB);
+
+            // Messages received while not receiving get queued
+            int sent = 0;
+            for (int i = 0; i < 3; ++i)
+            {
+                branchB.SendBroadcastAsync(msgpackView, (res, _) =>
+                {
+                    Assert.Equal(Yogi.ErrorCode.Ok, res.ErrorCode);
+                    ++sent;
+                });
+            }
+
+            GC.Collect();
+            while (sent < 3) context.RunOne();
+            context.Poll();
+
+            // With encoding and buffer in handler function
+            var uuidB = branchB.Uuid;
+            var buffer = new byte[1000];
+            int received = 0;
+            while (received < 3)
+            {
+                bool called = false;
+                branchA.ReceiveBroadcastsAsync(Yogi.EncodingType.Json, buffer,
+                    (res, broadcasts, buf) =>
+                {
+                    Assert.Equal(Yogi.ErrorCode.Ok, res.ErrorCode);
+                    Assert.NotEmpty(broadcasts);
+                    foreach (var brd in broadcasts)
+                    {
+                        Assert.Equal(uuidB, brd.Source);
+                        Assert.Equal(jsonView, brd.Payload);
+                    }
+
+                    Assert.Same(buffer, buf);
+                    received += broadcasts.Count;
+                    called = true;
+                });
+
+                GC.Collect();
+                while (!called) context.RunOne();
+            }
+
+            Assert.Equal(3, received);
+
+            // Buffer too small for the first message
+            bool tooSmall = false;
+            branchA.ReceiveBroadcastsAsync(new byte[10], (res, broadcasts, _) =>
+            {
+                Assert.Equal(Yogi.ErrorCode.BufferTooSmall, res.ErrorCode);
+                Assert.Empty(broadcasts);
+                tooSmall = true;
+            });
+
+            branchB.SendBroadcastAsync(msgpackView, (_1, _2) => { });
+            GC.Collect();
+            while (!tooSmall) context.RunOne();
+
+            GC.KeepAlive(branchA);
+            GC.KeepAlive(branchB);
+        }
+
+        [Fact]
+        public void ReceiveBroadcastLeaseAsync()
+        {
+            var branchA = new Yogi.Branch(context, "{\"name\":\"a\"}");
+            var branchB = new Yogi.Branch(context, "{\"name\":\"b\"}");
+            RunContextUntilBranchesAreConnected(context, branchA, branchB);
+
+            // Keep the lease beyond the handler function
+            var uuidB = branchB.Uuid;
+            Yogi.BroadcastLease lease = null;
+            branchA.ReceiveBroadcastLeaseAsync((res, source, lse) =>
+            {
+                Assert.Equal(Yogi.ErrorCode.Ok, res.ErrorCode);
+                Assert.Equal(uuidB, source);
+                Assert.NotNull(lse);
+                lease = lse;
+            });
+
+            branchB.SendBroadcastAsync(msgpackView, (_1, _2) => { });
+            GC.Collect();
+            while (lease == null) context.RunOne();
+
+            Assert.False(lease.Released);
+            Assert.NotEqual(IntPtr.Zero, lease.Data);
+            Assert.Equal(msgpackView.Size, lease.Size);
+            Assert.Equal(msgpackView, lease.Payload);
+
+            // Release the lease in the handler function
+            bool called = false;
+            branchA.ReceiveBroadcastLeaseAsync((res, _, lse) =>
+            {
+                using (lse)
+                {
+                    Assert.Equal(Yogi.ErrorCode.Ok, res.ErrorCode);
+                    Assert.Equal(msgpackView, lse.Payload);
+                }
+
+                Assert.True(lse.Released);
+                called = true;
+            });
+
+            branchB.SendBroadcastAsync(msgpackView, (_1, _2) => { });
+            lease.Release();
+            Assert.True(lease.Released);
+            Assert.Equal(msgpackView, lease.Payload);
+            lease.Dispose();
+
+            GC.Collect();
+            while (!called) context.RunOne();
+
+            // Canceled
+            called = false;
+            branchA.ReceiveBroadcastLeaseAsync((res, _, lse) =>
+            {
+                Assert.Equal(Yogi.ErrorCode.Canceled, res.ErrorCode);
+                Assert.Null(lse);
+                called = true;
+            });
+
+            GC.Collect();
+
+            Assert.True(branchA.CancelReceiveBroadcast());
+            context.Poll();
+            Assert.True(called);
+
+            GC.KeepAlive(branchA);
+            GC.KeepAlive(branchB);
+        }
+
         [Fact]
         public void CancelReceiveBroadcast()
         {
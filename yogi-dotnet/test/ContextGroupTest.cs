@@ -0,0 +1,81 @@
+/*
+ * This file is part of the Yogi distribution https://github.com/yohummus/yogi.
+ * Copyright (c) 2018 Johannes Bergmann.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+using System;
+using System.Threading;
+using Xunit;
+
+namespace test
+{
+    public class ContextGroupTest : TestCase
+    {
+        [Fact]
+        public void Create()
+        {
+            var group = new Yogi.ContextGroup(3);
+            Assert.Equal(3, group.Count);
+            Assert.Equal(3, group.Contexts.Count);
+            Assert.NotSame(group[0], group[1]);
+            Assert.Same(group[2], group.Contexts[2]);
+
+            group = new Yogi.ContextGroup();
+            Assert.True(group.Count >= 1);
+        }
+
+        [Fact]
+        public void RunInBackgroundAndStop()
+        {
+            var group = new Yogi.ContextGroup(2);
+            Assert.True(group.WaitForStopped(TimeSpan.FromMilliseconds(1)));
+
+            group.RunInBackground();
+
+            int calls = 0;
+            foreach (var context in group.Contexts)
+            {
+                Assert.True(context.WaitForRunning());
+                context.Post(() => Interlocked.Increment(ref calls));
+            }
+
+            while (Volatile.Read(ref calls) != 2) ;
+
+            Assert.False(group.WaitForStopped(TimeSpan.FromMilliseconds(1)));
+            group.Stop();
+            Assert.True(group.WaitForStopped());
+
+            foreach (var context in group.Contexts)
+            {
+                Assert.True(context.WaitForStopped(TimeSpan.FromMilliseconds(1)));
+            }
+
+            group.Dispose();
+        }
+
+        [Fact]
+        public void ContextOutlivesGroup()
+        {
+            var group = new Yogi.ContextGroup(2);
+            var context = group[1];
+            group.Dispose();
+
+            context.Post(() => { });
+            Assert.Equal(1, context.Poll());
+
+            context.Dispose();
+        }
+    }
+}
@@ -16,6 +16,7 @@
  */
 
 using System;
+using System.Collections.Generic;
 using System.Threading;
 using Xunit;
 
@@ -71,6 +72,46 @@ namespace test
             Assert.Equal(1, context.RunOne(TimeSpan.FromMilliseconds(1)));
         }
 
+        [Fact]
+        public void PostBatch()
+        {
+            var order = new List<int>();
+            context.PostBatch(new Action[] {
+                () => order.Add(1),
+                () => order.Add(2),
+                () => order.Add(3)
+            });
+            Assert.Equal(1, context.RunOne(TimeSpan.FromMilliseconds(1)));
+            Assert.Equal(new List<int> { 1, 2, 3 }, order);
+
+            context.PostBatch(new Action[] { });
+            Assert.Equal(0, context.Poll());
+        }
+
+        [Fact]
+        public void Stats()
+        {
+            var stats = context.GetStats();
+            Assert.False((bool)stats["enabled"]);
+
+            context.ConfigureStats(true, TimeSpan.FromMilliseconds(10));
+            context.Post(() => { });
+            context.Post(() => { });
+            context.Poll();
+
+            stats = context.GetStats(true);
+            Assert.True((bool)stats["enabled"]);
+            Assert.Equal(2, (int)stats["handlers"]);
+            Assert.Equal(0.01, (double)stats["slow_handler_threshold"], 9);
+            Assert.NotNull(stats["execution_times"]["upper_bounds"]);
+            Assert.NotNull(stats["queue_delays"]["counts"]);
+
+            Assert.Equal(0, (int)context.GetStats()["handlers"]);
+
+            context.ConfigureStats(false);
+            Assert.False((bool)context.GetStats()["enabled"]);
+        }
+
         [Fact]
         public void RunInBackground()
         {
@@ -83,6 +124,34 @@ namespace test
             ev.WaitOne();
         }
 
+        [Fact]
+        public void RunBusyPoll()
+        {
+            Assert.Equal(0, context.RunBusyPoll(TimeSpan.FromMilliseconds(1)));
+            context.Post(() => { });
+            context.Post(() => { });
+            Assert.Equal(2, context.RunBusyPoll(TimeSpan.FromMilliseconds(1)));
+        }
+
+        [Fact]
+        public void RunInBackgroundBusyPoll()
+        {
+            var ev = new AutoResetEvent(false);
+            context.RunInBackgroundBusyPoll();
+            context.Post(() =>
+            {
+                ev.Set();
+            });
+            ev.WaitOne();
+
+            context.Stop();
+            Assert.True(context.WaitForStopped());
+
+            var ex = Assert.Throws<Yogi.FailureException>(
+                () => context.RunInBackgroundBusyPoll(-2));
+            Assert.Equal(Yogi.ErrorCode.InvalidParam, ex.Failure.ErrorCode);
+        }
+
         [Fact]
         public void Stop()
         {
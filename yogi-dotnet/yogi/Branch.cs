@@ -127,6 +127,41 @@ public static partial class Yogi
             = Library.GetDelegateForFunction<BranchReceiveBroadcastAsyncDelegate>(
                 "YOGI_BranchReceiveBroadcastAsync");
 
+        // === YOGI_BranchReceiveBroadcastsAsync ===
+        [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+        public delegate void BranchReceiveBroadcastsAsyncFnDelegate(int res, int count,
+                                                                    int size, IntPtr userarg);
+
+        [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+        public delegate int BranchReceiveBroadcastsAsyncDelegate(SafeObjectHandle branch,
+            int enc, byte[] data, int datasize, BranchReceiveBroadcastsAsyncFnDelegate fn,
+            IntPtr userarg);
+
+        public static BranchReceiveBroadcastsAsyncDelegate YOGI_BranchReceiveBroadcastsAsync
+            = Library.GetDelegateForFunction<BranchReceiveBroadcastsAsyncDelegate>(
+                "YOGI_BranchReceiveBroadcastsAsync");
+
+        // === YOGI_BranchReceiveBroadcastLeaseAsync ===
+        [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+        public delegate void BranchReceiveBroadcastLeaseAsyncFnDelegate(int res, IntPtr uuid,
+            IntPtr data, int size, IntPtr lease, IntPtr userarg);
+
+        [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+        public delegate int BranchReceiveBroadcastLeaseAsyncDelegate(SafeObjectHandle branch,
+            BranchReceiveBroadcastLeaseAsyncFnDelegate fn, IntPtr userarg);
+
+        public static BranchReceiveBroadcastLeaseAsyncDelegate YOGI_BranchReceiveBroadcastLeaseAsync
+            = Library.GetDelegateForFunction<BranchReceiveBroadcastLeaseAsyncDelegate>(
+                "YOGI_BranchReceiveBroadcastLeaseAsync");
+
+        // === YOGI_BranchReleaseBroadcastLease ===
+        [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+        public delegate int BranchReleaseBroadcastLeaseDelegate(IntPtr lease);
+
+        public static BranchReleaseBroadcastLeaseDelegate YOGI_BranchReleaseBroadcastLease
+            = Library.GetDelegateForFunction<BranchReleaseBroadcastLeaseDelegate>(
+                "YOGI_BranchReleaseBroadcastLease");
+
         // === YOGI_BranchCancelReceiveBroadcast ===
         [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
         public delegate int BranchCancelReceiveBroadcastDelegate(SafeObjectHandle branch);
@@ -157,8 +192,11 @@ public static partial class Yogi
         /// <summary>The connection to a branch was lost.</summary>
         ConnectionLost = (1 << 3),
 
+        /// <summary>A branch has been penalized for falling behind on broadcasts.</summary>
+        SlowConsumer = (1 << 4),
+
         /// <summary>Combination of all flags.</summary>
-        All = BranchDiscovered | BranchQueried | ConnectFinished | ConnectionLost
+        All = BranchDiscovered | BranchQueried | ConnectFinished | ConnectionLost | SlowConsumer
     }
 
     /// <summary>
@@ -191,6 +229,7 @@ public static partial class Yogi
             StartTime = Timestamp.Parse((string)Data["start_time"]);
             Timeout = Duration.FromJson(Data["timeout"]);
             GhostMode = (bool)Data["ghost_mode"];
+            UnixSocketName = (string)Data["unix_socket_name"];
         }
 
         public override string ToString()
@@ -240,6 +279,9 @@ public static partial class Yogi
 
         /// <summary>True if the branch is in ghost mode.</summary>
         public bool GhostMode { get; }
+
+        /// <summary>Name of the Unix domain socket for same-host connections.</summary>
+        public string UnixSocketName { get; }
     }
 
     /// <summary>
@@ -392,6 +434,9 @@ public static partial class Yogi
         /// <summary>True if the branch is in ghost mode.</summary>
         public bool GhostMode { get { return info.GhostMode; } }
 
+        /// <summary>Name of the Unix domain socket for same-host connections.</summary>
+        public string UnixSocketName { get { return info.UnixSocketName; } }
+
         /// <summary>
         /// Converts the event information to a RemoteBranchInfo object.
         /// </summary>
@@ -434,6 +479,148 @@ public static partial class Yogi
         }
     }
 
+    /// <summary>
+    /// Information associated with the SlowConsumer branch event.
+    /// </summary>
+    public class SlowConsumerEventInfo : BranchEventInfo
+    {
+        /// <summary>
+        /// Constructor.
+        /// </summary>
+        /// <param name="json">JSON string to parse.</param>
+        internal SlowConsumerEventInfo(string json)
+        : base(json)
+        {
+            Policy = (string)Data["policy"];
+            Backlog = (int)Data["backlog"];
+        }
+
+        /// <summary>Applied slow consumer policy ("drop", "conflate" or "disconnect").</summary>
+        public string Policy { get; }
+
+        /// <summary>Number of unsent broadcast bytes for the branch.</summary>
+        public int Backlog { get; }
+    }
+
+    /// <summary>
+    /// Lease on a broadcast message received via Branch.ReceiveBroadcastLeaseAsync().
+    ///
+    /// The payload of the message stays in the receive queue of the connection
+    /// that it arrived on until the lease gets released, either explicitly via
+    /// Release() or Dispose() or once the lease gets finalized. No further messages
+    /// will be received from the sending branch until then.
+    /// </summary>
+    public class BroadcastLease : IDisposable
+    {
+        /// <summary>
+        /// Constructor.
+        /// </summary>
+        /// <param name="handle">Native handle of the lease.</param>
+        /// <param name="data">Pointer to the received payload.</param>
+        /// <param name="size">Size of the received payload in bytes.</param>
+        internal BroadcastLease(IntPtr handle, IntPtr data, int size)
+        {
+            this.handle = handle;
+            Data = data;
+            Size = size;
+        }
+
+        ~BroadcastLease()
+        {
+            if (handle != IntPtr.Zero)
+            {
+                Api.YOGI_BranchReleaseBroadcastLease(handle);
+            }
+        }
+
+        /// <summary>
+        /// Pointer to the received MessagePack payload.
+        ///
+        /// The memory must not be accessed after the lease has been released.
+        /// </summary>
+        public IntPtr Data { get; private set; }
+
+        /// <summary>Size of the received payload in bytes.</summary>
+        public int Size { get; }
+
+        /// <summary>True if the lease has been released.</summary>
+        public bool Released { get { return handle == IntPtr.Zero; } }
+
+        /// <summary>
+        /// Copy of the received payload.
+        ///
+        /// The payload gets copied the first time this property is accessed; the
+        /// returned view stays valid after the lease has been released.
+        /// </summary>
+        public PayloadView Payload
+        {
+            get
+            {
+                if (payload == null)
+                {
+                    if (Released) throw new InvalidOperationException("Lease has been released");
+
+                    var bytes = new byte[Size];
+                    Marshal.Copy(Data, bytes, 0, Size);
+                    payload = new PayloadView(bytes, EncodingType.Msgpack);
+                }
+
+                return payload;
+            }
+        }
+
+        /// <summary>
+        /// Releases the lease.
+        ///
+        /// Calling this function on a lease that has already been released has no
+        /// effect.
+        /// </summary>
+        public void Release()
+        {
+            if (handle == IntPtr.Zero) return;
+
+            int res = Api.YOGI_BranchReleaseBroadcastLease(handle);
+            handle = IntPtr.Zero;
+            Data = IntPtr.Zero;
+            GC.SuppressFinalize(this);
+            CheckErrorCode(res);
+        }
+
+        /// <summary>
+        /// Releases the lease.
+        /// </summary>
+        public void Dispose()
+        {
+            Release();
+        }
+
+        IntPtr handle;
+        PayloadView payload;
+    }
+
+    /// <summary>
+    /// Broadcast message received via Branch.ReceiveBroadcastsAsync().
+    /// </summary>
+    public class ReceivedBroadcast
+    {
+        /// <summary>
+        /// Constructor.
+        /// </summary>
+        /// <param name="source">UUID of the sending branch.</param>
+        /// <param name="payload">Received payload.</param>
+        internal ReceivedBroadcast(Guid source, PayloadView payload)
+        {
+            Source = source;
+            Payload = payload;
+        }
+
+        /// <summary>UUID of the sending branch.</summary>
+        public Guid Source { get; }
+
+        /// <summary>Received payload.</summary>
+        public PayloadView Payload { get; }
+    }
+
     /// <summary>
     /// Entry point into a Yogi network.
     ///
@@ -568,6 +755,9 @@ public static partial class Yogi
         /// <summary>True if the branch is in ghost mode.</summary>
         public bool GhostMode { get { return Info.GhostMode; } }
 
+        /// <summary>Name of the Unix domain socket for same-host connections.</summary>
+        public string UnixSocketName { get { return Info.UnixSocketName; } }
+
         /// <summary>Advertising IP address.</summary>
         public IPAddress AdvertisingAddress { get { return Info.AdvertisingAddress; } }
 
@@ -674,6 +864,10 @@ public static partial class Yogi
                         case BranchEvents.ConnectionLost:
                             info = new ConnectionLostEventInfo(jsonStr);
                             break;
+
+                        case BranchEvents.SlowConsumer:
+                            info = new SlowConsumerEventInfo(jsonStr);
+                            break;
                     }
                 }
 
@@ -1152,11 +1346,180 @@ public static partial class Yogi
                                                 byte[] _) => fn(res, source, payload));
         }
 
+        /// <summary>
+        /// Delegate for the receive broadcasts handler function.
+        /// </summary>
+        /// <param name="res">Result of the receive operation.</param>
+        /// <param name="broadcasts">Received broadcast messages.</param>
+        /// <param name="buffer">The buffer passed to ReceiveBroadcastsAsync().</param>
+        public delegate void ReceiveBroadcastsFnDelegate(Result res,
+                                                         IList<ReceivedBroadcast> broadcasts,
+                                                         byte[] buffer);
+
+        /// <summary>
+        /// Receives multiple broadcast messages at once.
+        ///
+        /// This function works like ReceiveBroadcastAsync(), however, all broadcast
+        /// messages queued by the branch (see the rx_broadcast_queue_depth branch
+        /// property) get written to buffer in one go, as long as they fit. If no
+        /// messages are queued, the operation completes as soon as the next one has
+        /// been received. The payloads will be encoded as MessagePack.
+        ///
+        /// Messages that do not fit into buffer any more remain queued for the next
+        /// receive operation. If not even the first message fits, then fn will be
+        /// called with the BufferTooSmall error and the message will be discarded.
+        ///
+        /// This function shares its receive operation with ReceiveBroadcastAsync(),
+        /// i.e. calling either of them while a previous receive operation is still
+        /// active will cancel the previous operation with the Canceled error.
+        /// </summary>
+        /// <param name="buffer">Buffer to use for receiving the messages.</param>
+        /// <param name="fn">Handler to call for the received broadcast messages.</param>
+        public void ReceiveBroadcastsAsync(byte[] buffer, ReceiveBroadcastsFnDelegate fn)
+        {
+            ReceiveBroadcastsAsync(EncodingType.Msgpack, buffer, fn);
+        }
+
+        /// <summary>
+        /// Receives multiple broadcast messages at once.
+        ///
+        /// This function works like ReceiveBroadcastAsync(), however, all broadcast
+        /// messages queued by the branch (see the rx_broadcast_queue_depth branch
+        /// property) get written to buffer in one go, as long as they fit. If no
+        /// messages are queued, the operation completes as soon as the next one has
+        /// been received. The payloads will be encoded as per enc.
+        ///
+        /// Messages that do not fit into buffer any more remain queued for the next
+        /// receive operation. If not even the first message fits, then fn will be
+        /// called with the BufferTooSmall error and the message will be discarded.
+        ///
+        /// This function shares its receive operation with ReceiveBroadcastAsync(),
+        /// i.e. calling either of them while a previous receive operation is still
+        /// active will cancel the previous operation with the Canceled error.
+        /// </summary>
+        /// <param name="enc">Encoding to use for the received payloads.</param>
+        /// <param name="buffer">Buffer to use for receiving the messages.</param>
+        /// <param name="fn">Handler to call for the received broadcast messages.</param>
+        public void ReceiveBroadcastsAsync(EncodingType enc, byte[] buffer,
+                                           ReceiveBroadcastsFnDelegate fn)
+        {
+            var bufferHandle = GCHandle.Alloc(buffer, GCHandleType.Pinned);
+
+            Api.BranchReceiveBroadcastsAsyncFnDelegate wrapper = (res, count, size, userarg) =>
+            {
+                try
+                {
+                    // Each message is stored as the sender's UUID, the payload size as a
+                    // 32 bit integer in host byte order and the payload itself
+                    var broadcasts = new List<ReceivedBroadcast>(Math.Max(count, 0));
+                    var pos = 0;
+                    while (res >= 0 && pos < size)
+                    {
+                        var source = MakeGuidFromBytes(buffer, pos);
+                        var payloadSize = (int)BitConverter.ToUInt32(buffer, pos + 16);
+                        pos += 20;
+                        var data = new byte[payloadSize];
+                        Array.Copy(buffer, pos, data, 0, payloadSize);
+                        pos += payloadSize;
+                        broadcasts.Add(new ReceivedBroadcast(source,
+                            new PayloadView(data, payloadSize, enc)));
+                    }
+
+                    fn(ErrorCodeToResult(res), broadcasts, buffer);
+                }
+                finally
+                {
+                    bufferHandle.Free();
+                    GCHandle.FromIntPtr(userarg).Free();
+                }
+            };
+            var wrapperHandle = GCHandle.Alloc(wrapper);
+
+            try
+            {
+                var wrapperPtr = GCHandle.ToIntPtr(wrapperHandle);
+                int res = Api.YOGI_BranchReceiveBroadcastsAsync(Handle, (int)enc, buffer,
+                                                                buffer.Length, wrapper,
+                                                                wrapperPtr);
+                CheckErrorCode(res);
+            }
+            catch
+            {
+                wrapperHandle.Free();
+                bufferHandle.Free();
+                throw;
+            }
+        }
+
+        /// <summary>
+        /// Delegate for the receive broadcast lease handler function.
+        /// </summary>
+        /// <param name="res">Result of the receive operation.</param>
+        /// <param name="source">UUID of the sending branch.</param>
+        /// <param name="lease">Lease on the received payload (null on failure).</param>
+        public delegate void ReceiveBroadcastLeaseFnDelegate(Result res, Guid source,
+                                                             BroadcastLease lease);
+
+        /// <summary>
+        /// Receives a broadcast message without copying its payload.
+        ///
+        /// Instead of copying the received payload into a buffer, fn gets a lease
+        /// on the payload which points directly into the receive queue of the
+        /// connection that the message arrived on. The payload is always encoded
+        /// as MessagePack.
+        ///
+        /// The payload stays valid until the lease has been released. No further
+        /// messages will be received from the sending branch until then; hence,
+        /// leases should be released as soon as possible, ideally from within fn.
+        ///
+        /// This function shares its receive operation with ReceiveBroadcastAsync(),
+        /// i.e. calling either of them while a previous receive operation is still
+        /// active will cancel the previous operation with the Canceled error.
+        /// </summary>
+        /// <param name="fn">Handler to call for the received broadcast message.</param>
+        public void ReceiveBroadcastLeaseAsync(ReceiveBroadcastLeaseFnDelegate fn)
+        {
+            Api.BranchReceiveBroadcastLeaseAsyncFnDelegate wrapper =
+                (res, uuid, data, size, lease, userarg) =>
+            {
+                try
+                {
+                    var source = new Guid();
+                    BroadcastLease brdLease = null;
+                    if (res >= 0)
+                    {
+                        source = MakeGuidFromVoidPtr(uuid);
+                        brdLease = new BroadcastLease(lease, data, size);
+                    }
+
+                    fn(ErrorCodeToResult(res), source, brdLease);
+                }
+                finally
+                {
+                    GCHandle.FromIntPtr(userarg).Free();
+                }
+            };
+            var wrapperHandle = GCHandle.Alloc(wrapper);
+
+            try
+            {
+                var wrapperPtr = GCHandle.ToIntPtr(wrapperHandle);
+                int res = Api.YOGI_BranchReceiveBroadcastLeaseAsync(Handle, wrapper, wrapperPtr);
+                CheckErrorCode(res);
+            }
+            catch
+            {
+                wrapperHandle.Free();
+                throw;
+            }
+        }
+
         /// <summary>
         /// Cancels a receive broadcast operation.
         ///
         /// Calling this function will cause the handler registered via
-        /// ReceiveBroadcastAsync() to be called with the Canceled error.
+        /// ReceiveBroadcastAsync(), ReceiveBroadcastsAsync() or
+        /// ReceiveBroadcastLeaseAsync() to be called with the Canceled error.
         ///
         /// Note: If the receive handler has already been scheduled for execution
         ///       this function will return false.
@@ -1201,6 +1564,13 @@ public static partial class Yogi
         {
             var bytes = new byte[16];
             Marshal.Copy(uuid, bytes, 0, 16);
+            return MakeGuidFromBytes(bytes, 0);
+        }
+
+        Guid MakeGuidFromBytes(byte[] uuid, int offset)
+        {
+            var bytes = new byte[16];
+            Array.Copy(uuid, offset, bytes, 0, 16);
             Array.Reverse(bytes, 0, 4);
             Array.Reverse(bytes, 4, 2);
             Array.Reverse(bytes, 6, 2);
@@ -16,7 +16,10 @@
  */
 
 using System;
+using System.Collections.Generic;
 using System.Runtime.InteropServices;
+using System.Text;
+using Newtonsoft.Json.Linq;
 
 public static partial class Yogi
 {
@@ -30,6 +33,15 @@ public static partial class Yogi
             = Library.GetDelegateForFunction<ContextCreateDelegate>(
                 "YOGI_ContextCreate");
 
+        // === YOGI_ContextCreateWithThreads ===
+        [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+        public delegate int ContextCreateWithThreadsDelegate(ref IntPtr context,
+            int numThreads);
+
+        public static ContextCreateWithThreadsDelegate YOGI_ContextCreateWithThreads
+            = Library.GetDelegateForFunction<ContextCreateWithThreadsDelegate>(
+                "YOGI_ContextCreateWithThreads");
+
         // === YOGI_ContextPoll ===
         [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
         public delegate int ContextPollDelegate(SafeObjectHandle context, ref int count);
@@ -72,6 +84,24 @@ public static partial class Yogi
             = Library.GetDelegateForFunction<ContextRunInBackgroundDelegate>(
                 "YOGI_ContextRunInBackground");
 
+        // === YOGI_ContextRunBusyPoll ===
+        [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+        public delegate int ContextRunBusyPollDelegate(SafeObjectHandle context, ref int count,
+            long duration);
+
+        public static ContextRunBusyPollDelegate YOGI_ContextRunBusyPoll
+            = Library.GetDelegateForFunction<ContextRunBusyPollDelegate>(
+                "YOGI_ContextRunBusyPoll");
+
+        // === YOGI_ContextRunInBackgroundBusyPoll ===
+        [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+        public delegate int ContextRunInBackgroundBusyPollDelegate(SafeObjectHandle context,
+            int cpu);
+
+        public static ContextRunInBackgroundBusyPollDelegate YOGI_ContextRunInBackgroundBusyPoll
+            = Library.GetDelegateForFunction<ContextRunInBackgroundBusyPollDelegate>(
+                "YOGI_ContextRunInBackgroundBusyPoll");
+
         // === YOGI_ContextStop ===
         [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
         public delegate int ContextStopDelegate(SafeObjectHandle context);
@@ -107,6 +137,75 @@ public static partial class Yogi
         public static ContextPostDelegate YOGI_ContextPost
             = Library.GetDelegateForFunction<ContextPostDelegate>(
                 "YOGI_ContextPost");
+
+        // === YOGI_ContextPostBatch ===
+        [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+        public delegate int ContextPostBatchDelegate(SafeObjectHandle context,
+            IntPtr[] fns, IntPtr[] userargs, int n);
+
+        public static ContextPostBatchDelegate YOGI_ContextPostBatch
+            = Library.GetDelegateForFunction<ContextPostBatchDelegate>(
+                "YOGI_ContextPostBatch");
+
+        // === YOGI_ContextConfigureStats ===
+        [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+        public delegate int ContextConfigureStatsDelegate(SafeObjectHandle context, int enable,
+            long slowThreshold);
+
+        public static ContextConfigureStatsDelegate YOGI_ContextConfigureStats
+            = Library.GetDelegateForFunction<ContextConfigureStatsDelegate>(
+                "YOGI_ContextConfigureStats");
+
+        // === YOGI_ContextGetStats ===
+        [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+        public delegate int ContextGetStatsDelegate(SafeObjectHandle context,
+            [MarshalAs(UnmanagedType.LPStr)] StringBuilder json, int jsonsize, int reset);
+
+        public static ContextGetStatsDelegate YOGI_ContextGetStats
+            = Library.GetDelegateForFunction<ContextGetStatsDelegate>(
+                "YOGI_ContextGetStats");
+
+        // === YOGI_ContextGroupCreate ===
+        [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+        public delegate int ContextGroupCreateDelegate(ref IntPtr group, int numContexts);
+
+        public static ContextGroupCreateDelegate YOGI_ContextGroupCreate
+            = Library.GetDelegateForFunction<ContextGroupCreateDelegate>(
+                "YOGI_ContextGroupCreate");
+
+        // === YOGI_ContextGroupGetContext ===
+        [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+        public delegate int ContextGroupGetContextDelegate(IntPtr group, int index,
+            ref IntPtr context);
+
+        public static ContextGroupGetContextDelegate YOGI_ContextGroupGetContext
+            = Library.GetDelegateForFunction<ContextGroupGetContextDelegate>(
+                "YOGI_ContextGroupGetContext");
+
+        // === YOGI_ContextGroupRunInBackground ===
+        [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+        public delegate int ContextGroupRunInBackgroundDelegate(SafeObjectHandle group, int pin);
+
+        public static ContextGroupRunInBackgroundDelegate YOGI_ContextGroupRunInBackground
+            = Library.GetDelegateForFunction<ContextGroupRunInBackgroundDelegate>(
+                "YOGI_ContextGroupRunInBackground");
+
+        // === YOGI_ContextGroupStop ===
+        [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+        public delegate int ContextGroupStopDelegate(SafeObjectHandle group);
+
+        public static ContextGroupStopDelegate YOGI_ContextGroupStop
+            = Library.GetDelegateForFunction<ContextGroupStopDelegate>(
+                "YOGI_ContextGroupStop");
+
+        // === YOGI_ContextGroupWaitForStopped ===
+        [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+        public delegate int ContextGroupWaitForStoppedDelegate(SafeObjectHandle group,
+            long duration);
+
+        public static ContextGroupWaitForStoppedDelegate YOGI_ContextGroupWaitForStopped
+            = Library.GetDelegateForFunction<ContextGroupWaitForStoppedDelegate>(
+                "YOGI_ContextGroupWaitForStopped");
     }
 
     /// <summary>
@@ -121,8 +220,18 @@ public static partial class Yogi
         /// <summary>
         /// Constructor.
         /// </summary>
-        public Context()
-        : base(Create())
+        /// <param name="numThreads">Number of threads running the context's handlers.</param>
+        public Context(int numThreads = 1)
+        : base(Create(numThreads))
+        {
+        }
+
+        /// <summary>
+        /// Constructs a context from the handle of a context owned by a context group.
+        /// </summary>
+        /// <param name="handle">Native handle of the context.</param>
+        internal Context(IntPtr handle)
+        : base(handle)
         {
         }
 
@@ -247,6 +356,49 @@ public static partial class Yogi
             return RunOne(new Duration(duration));
         }
 
+        /// <summary>
+        /// Runs the context's event processing loop for the specified duration without
+        /// ever blocking.
+        ///
+        /// This function behaves like Run() but instead of sleeping while waiting for
+        /// events, it continuously polls for ready handlers. This keeps the calling thread
+        /// busy at 100% CPU load but avoids the latency of being woken up by the operating
+        /// system.
+        ///
+        /// This function must be called from outside any handler functions that are being
+        /// executed through the context.
+        /// </summary>
+        /// <param name="duration">Duration (infinity by default).</param>
+        /// <returns>Number of executed handlers.</returns>
+        public int RunBusyPoll([Optional] Duration duration)
+        {
+            long dur = duration == null ? -1 : DurationToApiDuration(duration);
+
+            int count = -1;
+            int res = Api.YOGI_ContextRunBusyPoll(Handle, ref count, dur);
+            CheckErrorCode(res);
+            return count;
+        }
+
+        /// <summary>
+        /// Runs the context's event processing loop for the specified duration without
+        /// ever blocking.
+        ///
+        /// This function behaves like Run() but instead of sleeping while waiting for
+        /// events, it continuously polls for ready handlers. This keeps the calling thread
+        /// busy at 100% CPU load but avoids the latency of being woken up by the operating
+        /// system.
+        ///
+        /// This function must be called from outside any handler functions that are being
+        /// executed through the context.
+        /// </summary>
+        /// <param name="duration">Duration.</param>
+        /// <returns>Number of executed handlers.</returns>
+        public int RunBusyPoll(TimeSpan duration)
+        {
+            return RunBusyPoll(new Duration(duration));
+        }
+
         /// <summary>
         /// Starts an internal thread for running the context's event processing loop.
         ///
@@ -264,6 +416,25 @@ public static partial class Yogi
             CheckErrorCode(res);
         }
 
+        /// <summary>
+        /// Starts internal threads for running the context's event processing loop in
+        /// busy-poll mode.
+        ///
+        /// This function works like RunInBackground() except that the threads never
+        /// block (see RunBusyPoll()). Optionally, the threads can be pinned to CPUs: the
+        /// first thread gets pinned to cpu, the second one to cpu + 1 and so on.
+        ///
+        /// This function must be called from outside any handler functions that are being
+        /// executed through the context.
+        /// </summary>
+        /// <param name="cpu">Index of the CPU to pin the first thread to (-1 to not pin
+        /// the threads).</param>
+        public void RunInBackgroundBusyPoll(int cpu = -1)
+        {
+            int res = Api.YOGI_ContextRunInBackgroundBusyPoll(Handle, cpu);
+            CheckErrorCode(res);
+        }
+
         /// <summary>
         /// Stops the context's event processing loop.
         ///
@@ -383,12 +554,276 @@ public static partial class Yogi
 
         }
 
-        static IntPtr Create()
+        /// <summary>
+        /// Adds the given functions to the context's event processing queue as
+        /// a single handler and returns immediately.
+        ///
+        /// The functions will be called one after another in the given order
+        /// from the same thread. Unlike posting each function individually, the
+        /// batch counts as one handler for RunOne() and PollOne() and its
+        /// functions never run concurrently.
+        /// </summary>
+        /// <param name="fns">The functions to call from within the context.</param>
+        public void PostBatch(IEnumerable<Action> fns)
+        {
+            var fnList = new List<Action>(fns);
+            if (fnList.Count == 0)
+            {
+                return;
+            }
+
+            var wrapperHandle = new GCHandle();
+            Api.ContextPostFnDelegate wrapper = (userarg) => {
+                var index = userarg.ToInt32() - 1;
+                try
+                {
+                    fnList[index]();
+                }
+                finally
+                {
+                    if (index == fnList.Count - 1)
+                    {
+                        wrapperHandle.Free();
+                    }
+                }
+            };
+            wrapperHandle = GCHandle.Alloc(wrapper);
+
+            try
+            {
+                var wrapperPtr = Marshal.GetFunctionPointerForDelegate(wrapper);
+                var wrapperPtrs = new IntPtr[fnList.Count];
+                var userargs = new IntPtr[fnList.Count];
+                for (int i = 0; i < fnList.Count; ++i)
+                {
+                    wrapperPtrs[i] = wrapperPtr;
+                    userargs[i] = new IntPtr(i + 1);
+                }
+
+                int res = Api.YOGI_ContextPostBatch(Handle, wrapperPtrs, userargs,
+                    fnList.Count);
+                CheckErrorCode(res);
+            }
+            catch
+            {
+                wrapperHandle.Free();
+                throw;
+            }
+        }
+
+        /// <summary>
+        /// Enables or disables recording statistics about the context's event
+        /// processing loop.
+        ///
+        /// When enabled, the context measures the execution time of handlers, the time
+        /// that posted handlers spend waiting in the queue as well as the number of
+        /// queued handlers. Enabling the statistics resets them.
+        ///
+        /// Handlers taking longer than slowThreshold to execute get reported via a
+        /// warning log entry.
+        /// </summary>
+        /// <param name="enable">True to enable and false to disable the statistics.</param>
+        /// <param name="slowThreshold">Execution time above which handlers are considered
+        /// slow (infinity by default, i.e. slow handlers never get reported).</param>
+        public void ConfigureStats(bool enable, [Optional] Duration slowThreshold)
+        {
+            long thresh = slowThreshold == null ? -1 : DurationToApiDuration(slowThreshold);
+
+            int res = Api.YOGI_ContextConfigureStats(Handle, enable ? 1 : 0, thresh);
+            CheckErrorCode(res);
+        }
+
+        /// <summary>
+        /// Enables or disables recording statistics about the context's event
+        /// processing loop.
+        ///
+        /// When enabled, the context measures the execution time of handlers, the time
+        /// that posted handlers spend waiting in the queue as well as the number of
+        /// queued handlers. Enabling the statistics resets them.
+        ///
+        /// Handlers taking longer than slowThreshold to execute get reported via a
+        /// warning log entry.
+        /// </summary>
+        /// <param name="enable">True to enable and false to disable the statistics.</param>
+        /// <param name="slowThreshold">Execution time above which handlers are considered
+        /// slow.</param>
+        public void ConfigureStats(bool enable, TimeSpan slowThreshold)
+        {
+            ConfigureStats(enable, new Duration(slowThreshold));
+        }
+
+        /// <summary>
+        /// Retrieves the statistics about the context's event processing loop.
+        ///
+        /// See YOGI_ContextGetStats() in yogi_core.h for the structure of the returned
+        /// JSON object. All times are in seconds.
+        /// </summary>
+        /// <param name="reset">Reset the statistics after reading them.</param>
+        /// <returns>The statistics.</returns>
+        public JObject GetStats(bool reset = false)
+        {
+            StringBuilder json;
+            var size = 512;
+            int res;
+            do
+            {
+                json = new StringBuilder(size);
+                size *= 2;
+                res = Api.YOGI_ContextGetStats(Handle, json, json.Capacity, 0);
+            }
+            while (res == (int)ErrorCode.BufferTooSmall);
+            CheckErrorCode(res);
+
+            if (reset)
+            {
+                // The statistics get reset even if they do not fit into the buffer, so
+                // retrying with a larger buffer would lose them; the JSON only grows
+                // slightly between the two calls though
+                json = new StringBuilder(size + 1024);
+                res = Api.YOGI_ContextGetStats(Handle, json, json.Capacity, 1);
+                CheckErrorCode(res);
+            }
+
+            return JObject.Parse(json.ToString());
+        }
+
+        static IntPtr Create(int numThreads)
+        {
+            var handle = new IntPtr();
+            int res = Api.YOGI_ContextCreateWithThreads(ref handle, numThreads);
+            CheckErrorCode(res);
+            return handle;
+        }
+    }
+
+    /// <summary>
+    /// Group of contexts, each running its event processing loop in a thread of
+    /// its own.
+    ///
+    /// A branch created on one of the group's contexts distributes its
+    /// connections over all contexts of the group. Handlers for operations on
+    /// such a branch get called from the thread of whichever context handles the
+    /// connection that caused them to be called.
+    ///
+    /// The contexts of the group are regular contexts; they get destroyed after
+    /// the group.
+    /// </summary>
+    public class ContextGroup : Object
+    {
+        /// <summary>
+        /// Constructor.
+        /// </summary>
+        /// <param name="numContexts">Number of contexts to create; 0 creates one
+        /// context per CPU core.</param>
+        public ContextGroup(int numContexts = 0)
+        : this(Create(numContexts))
+        {
+        }
+
+        /// <summary>
+        /// The contexts of the group.
+        /// </summary>
+        public IReadOnlyList<Context> Contexts { get { return contexts; } }
+
+        /// <summary>
+        /// Number of contexts in the group.
+        /// </summary>
+        public int Count { get { return contexts.Length; } }
+
+        /// <summary>
+        /// Returns a context of the group.
+        /// </summary>
+        /// <param name="index">Index of the context (starting at 0).</param>
+        public Context this[int index] { get { return contexts[index]; } }
+
+        /// <summary>
+        /// Runs the event processing loops of all contexts in the group, each in
+        /// its own background thread.
+        ///
+        /// If pin is true, the thread of the context with index i gets pinned to
+        /// CPU core i (modulo the number of cores). On platforms that do not
+        /// support this, a warning is logged and the threads run unpinned.
+        /// </summary>
+        /// <param name="pin">Pin the threads to CPU cores.</param>
+        public void RunInBackground(bool pin = false)
+        {
+            int res = Api.YOGI_ContextGroupRunInBackground(Handle, pin ? 1 : 0);
+            CheckErrorCode(res);
+        }
+
+        /// <summary>
+        /// Stops the event processing loops of all contexts in the group.
+        /// </summary>
+        public void Stop()
+        {
+            int res = Api.YOGI_ContextGroupStop(Handle);
+            CheckErrorCode(res);
+        }
+
+        /// <summary>
+        /// Blocks until no context in the group is running its event processing
+        /// loop any more or until the specified timeout is reached.
+        /// </summary>
+        /// <param name="duration">Maximum time to wait (infinity by default).</param>
+        /// <returns>True if no context is running its event processing loop within
+        /// the specified duration and false otherwise.</returns>
+        public bool WaitForStopped([Optional] Duration duration)
+        {
+            long dur = duration == null ? -1 : DurationToApiDuration(duration);
+
+            int res = Api.YOGI_ContextGroupWaitForStopped(Handle, dur);
+            if ((ErrorCode)res == ErrorCode.Timeout) return false;
+            CheckErrorCode(res);
+            return true;
+        }
+
+        /// <summary>
+        /// Blocks until no context in the group is running its event processing
+        /// loop any more or until the specified timeout is reached.
+        /// </summary>
+        /// <param name="duration">Maximum time to wait.</param>
+        /// <returns>True if no context is running its event processing loop within
+        /// the specified duration and false otherwise.</returns>
+        public bool WaitForStopped(TimeSpan duration)
+        {
+            return WaitForStopped(new Duration(duration));
+        }
+
+        ContextGroup(IntPtr handle)
+        : this(handle, QueryContexts(handle))
+        {
+        }
+
+        // The contexts are dependencies so that they get destroyed after the group
+        ContextGroup(IntPtr handle, Context[] contexts)
+        : base(handle, contexts)
+        {
+            this.contexts = contexts;
+        }
+
+        static IntPtr Create(int numContexts)
         {
             var handle = new IntPtr();
-            int res = Api.YOGI_ContextCreate(ref handle);
+            int res = Api.YOGI_ContextGroupCreate(ref handle, numContexts);
             CheckErrorCode(res);
             return handle;
         }
+
+        static Context[] QueryContexts(IntPtr handle)
+        {
+            var contexts = new List<Context>();
+            while (true)
+            {
+                var context = new IntPtr();
+                int res = Api.YOGI_ContextGroupGetContext(handle, contexts.Count, ref context);
+                if ((ErrorCode)res == ErrorCode.InvalidParam) break;
+                CheckErrorCode(res);
+                contexts.Add(new Context(context));
+            }
+
+            return contexts.ToArray();
+        }
+
+        Context[] contexts;
     }
 }
@@ -76,6 +76,7 @@ class TestBranches(TestCase):
         self.assertLessEqual(info.start_time, yogi.get_current_time())
         self.assertEqual(info.timeout, float("inf"))
         self.assertEqual(info.ghost_mode, False)
+        self.assertEqual(info.unix_socket_name, "yogi-" + str(info.uuid))
         self.assertGreater(info.tx_queue_size, 1000)
         self.assertGreater(info.rx_queue_size, 1000)
 
@@ -349,6 +350,130 @@ class TestBranches(TestCase):
         while not called:
             self.context.run_one()
 
+    def test_receive_broadcasts(self):
+        branch_a = yogi.Branch(self.context, '{"name": "a",'
+                               ' "rx_broadcast_queue_depth": 8}')
+        branch_b = yogi.Branch(self.context, '{"name": "b"}')
+        self.run_context_until_branches_are_connected(
+            self.context, [branch_a, branch_b])
+
+        # Messages received while not receiving get queued
+        sent = 0
+
+        def send_handler(res, oid):
+            self.assertEqual(res.error_code, yogi.ErrorCode.OK)
+            nonlocal sent
+            sent += 1
+
+        for _ in range(3):
+            branch_b.send_broadcast_async(self.msgpack_view, send_handler)
+        while sent < 3:
+            self.context.run_one()
+        self.context.poll()
+
+        # With encoding
+        uuid_b = branch_b.uuid
+        received = 0
+        while received < 3:
+            called = False
+
+            def handler_1(res, broadcasts):
+                self.assertEqual(res.error_code, yogi.ErrorCode.OK)
+                self.assertNotEqual(len(broadcasts), 0)
+                for source, payload in broadcasts:
+                    self.assertEqual(source, uuid_b)
+                    self.assertEqual(payload, self.json_view)
+                nonlocal called, received
+                received += len(broadcasts)
+                called = True
+
+            branch_a.receive_broadcasts_async(
+                bytearray(1000), handler_1, encoding=yogi.EncodingType.JSON)
+            while not called:
+                self.context.run_one()
+
+        self.assertEqual(received, 3)
+
+        # Buffer too small for the first message
+        called = False
+
+        def handler_2(res, broadcasts):
+            self.assertEqual(res.error_code, yogi.ErrorCode.BUFFER_TOO_SMALL)
+            self.assertEqual(broadcasts, [])
+            nonlocal called
+            called = True
+
+        branch_a.receive_broadcasts_async(bytearray(10), handler_2)
+
+        branch_b.send_broadcast_async(self.msgpack_view, lambda x, y: None)
+        while not called:
+            self.context.run_one()
+
+    def test_receive_broadcast_lease(self):
+        branch_a = yogi.Branch(self.context, '{"name": "a"}')
+        branch_b = yogi.Branch(self.context, '{"name": "b"}')
+        self.run_context_until_branches_are_connected(
+            self.context, [branch_a, branch_b])
+
+        # Keep the lease beyond the handler function
+        uuid_b = branch_b.uuid
+        lease = None
+
+        def handler_1(res, source, payload, lse):
+            self.assertEqual(res.error_code, yogi.ErrorCode.OK)
+            self.assertEqual(source, uuid_b)
+            self.assertEqual(payload, self.msgpack_view)
+            self.assertIsInstance(lse, yogi.BroadcastLease)
+            nonlocal lease
+            lease = lse
+
+        branch_a.receive_broadcast_lease_async(handler_1)
+
+        branch_b.send_broadcast_async(self.msgpack_view, lambda x, y: None)
+        while lease is None:
+            self.context.run_one()
+
+        self.assertFalse(lease.released)
+        self.assertEqual(lease.payload, self.msgpack_view)
+
+        # Release the lease via the context manager in the handler function
+        called = False
+
+        def handler_2(res, source, payload, lse):
+            with lse:
+                self.assertEqual(res.error_code, yogi.ErrorCode.OK)
+                self.assertEqual(payload, self.msgpack_view)
+            self.assertTrue(lse.released)
+            nonlocal called
+            called = True
+
+        branch_a.receive_broadcast_lease_async(handler_2)
+
+        branch_b.send_broadcast_async(self.msgpack_view, lambda x, y: None)
+        lease.release()
+        self.assertTrue(lease.released)
+        lease.release()
+
+        while not called:
+            self.context.run_one()
+
+        # Canceled
+        called = False
+
+        def handler_3(res, source, payload, lse):
+            self.assertEqual(res.error_code, yogi.ErrorCode.CANCELED)
+            self.assertIsNone(source)
+            self.assertIsNone(payload)
+            self.assertIsNone(lse)
+            nonlocal called
+            called = True
+
+        branch_a.receive_broadcast_lease_async(handler_3)
+
+        self.assertTrue(branch_a.cancel_receive_broadcast())
+        self.context.poll()
+        self.assertTrue(called)
+
     def test_cancel_receive_broadcast(self):
         branch = yogi.Branch(self.context, '{"name": "a"}')
 
@@ -52,6 +52,45 @@ class TestContext(TestCase):
         self.context.post(lambda: None)
         self.assertEqual(self.context.run_one(one_ms), 1)
 
+    def test_run_busy_poll(self):
+        self.assertEqual(self.context.run_busy_poll(one_ms), 0)
+        self.context.post(lambda: None)
+        self.context.post(lambda: None)
+        self.assertEqual(self.context.run_busy_poll(one_ms), 2)
+
+    def test_post_batch(self):
+        order = []
+        self.context.post_batch([lambda: order.append(1),
+                                 lambda: order.append(2),
+                                 lambda: order.append(3)])
+        self.assertEqual(self.context.run_one(one_ms), 1)
+        self.assertEqual(order, [1, 2, 3])
+
+        self.context.post_batch([])
+        self.assertEqual(self.context.poll(), 0)
+
+    def test_stats(self):
+        stats = self.context.get_stats()
+        self.assertFalse(stats["enabled"])
+
+        self.context.configure_stats(True,
+                                     yogi.Duration.from_milliseconds(10))
+        self.context.post(lambda: None)
+        self.context.post(lambda: None)
+        self.context.poll()
+
+        stats = self.context.get_stats(True)
+        self.assertTrue(stats["enabled"])
+        self.assertEqual(stats["handlers"], 2)
+        self.assertAlmostEqual(stats["slow_handler_threshold"], 0.01)
+        self.assertIn("upper_bounds", stats["execution_times"])
+        self.assertIn("counts", stats["queue_delays"])
+
+        self.assertEqual(self.context.get_stats()["handlers"], 0)
+
+        self.context.configure_stats(False)
+        self.assertFalse(self.context.get_stats()["enabled"])
+
     def test_run_in_background(self):
         called = False
 
@@ -64,6 +103,23 @@ class TestContext(TestCase):
         while not called:
             pass
 
+    def test_run_in_background_busy_poll(self):
+        called = False
+
+        def fn():
+            nonlocal called
+            called = True
+
+        self.context.run_in_background_busy_poll()
+        self.context.post(fn)
+        while not called:
+            pass
+
+        self.context.stop()
+        self.assertTrue(self.context.wait_for_stopped())
+        self.assertRaises(yogi.FailureException,
+                          lambda: self.context.run_in_background_busy_poll(-2))
+
     def test_stop(self):
         def thread_fn():
             self.context.wait_for_running()
@@ -90,5 +146,47 @@ class TestContext(TestCase):
         self.assertTrue(self.context.wait_for_stopped())
 
 
+class TestContextGroup(TestCase):
+    def test_create(self):
+        group = yogi.ContextGroup(3)
+        self.assertEqual(len(group), 3)
+        self.assertEqual(len(group.contexts), 3)
+        self.assertIsInstance(group[0], yogi.Context)
+        self.assertIsNot(group[0], group[1])
+        self.assertIs(group[2], group.contexts[2])
+
+        group = yogi.ContextGroup()
+        self.assertGreaterEqual(len(group), 1)
+
+    def test_run_in_background_and_stop(self):
+        group = yogi.ContextGroup(2)
+        self.assertTrue(group.wait_for_stopped(one_ms))
+
+        group.run_in_background()
+
+        calls = []
+        for context in group.contexts:
+            self.assertTrue(context.wait_for_running())
+            context.post(lambda: calls.append(1))
+
+        while len(calls) != 2:
+            pass
+
+        self.assertFalse(group.wait_for_stopped(one_ms))
+        group.stop()
+        self.assertTrue(group.wait_for_stopped())
+
+        for context in group.contexts:
+            self.assertTrue(context.wait_for_stopped(one_ms))
+
+    def test_context_outlives_group(self):
+        group = yogi.ContextGroup(2)
+        context = group[1]
+        del group
+
+        context.post(lambda: None)
+        self.assertEqual(context.poll(), 1)
+
+
 if __name__ == '__main__':
     unittest.main()
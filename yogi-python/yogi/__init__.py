@@ -16,8 +16,9 @@
 from .private.branch import BranchEvents, Branch, BranchInfo, \
     LocalBranchInfo, RemoteBranchInfo, BranchEventInfo, \
     BranchDiscoveredEventInfo, BranchQueriedEventInfo, \
-    ConnectFinishedEventInfo, ConnectionLostEventInfo
-from .private.context import Context
+    ConnectFinishedEventInfo, ConnectionLostEventInfo, SlowConsumerEventInfo, \
+    BroadcastLease
+from .private.context import Context, ContextGroup
 from .private.duration import Duration
 from .private.configuration import ConfigurationFlags, CommandLineOptions, \
     Configuration
@@ -28,12 +28,13 @@ from .operation_id import OperationId
 from .constants import Constants
 
 import json
+import struct
 import inspect
 from enum import IntEnum
 from uuid import UUID
-from typing import Callable, Any, Optional, Dict, Union
-from ctypes import c_char, c_int, c_longlong, c_void_p, c_char_p, CFUNCTYPE, \
-    POINTER, byref, create_string_buffer, sizeof
+from typing import Callable, Any, Optional, Dict, Union, List, Tuple
+from ctypes import c_char, c_ubyte, c_int, c_longlong, c_void_p, c_char_p, \
+    CFUNCTYPE, POINTER, byref, create_string_buffer, sizeof, string_at
 
 
 class BranchEvents(IntEnum):
@@ -45,6 +46,8 @@ class BranchEvents(IntEnum):
         BRANCH_QUERIED    Querying a new branch for information finished.
         CONNECT_FINISHED  Connecting to a branch finished.
         CONNECTION_LOST   The connection to a branch was lost.
+        SLOW_CONSUMER     A branch has been penalized for falling behind on
+                          broadcasts.
         ALL               Combination of all flags.
     """
     NONE = 0
@@ -52,8 +55,9 @@ class BranchEvents(IntEnum):
     BRANCH_QUERIED = (1 << 1)
     CONNECT_FINISHED = (1 << 2)
     CONNECTION_LOST = (1 << 3)
+    SLOW_CONSUMER = (1 << 4)
     ALL = BRANCH_DISCOVERED | BRANCH_QUERIED | CONNECT_FINISHED \
-        | CONNECTION_LOST
+        | CONNECTION_LOST | SLOW_CONSUMER
 
 
 def convert_info_fields(info):
@@ -142,6 +146,11 @@ class BranchInfo:
         """True if the branch is in ghost mode."""
         return self._info["ghost_mode"]
 
+    @property
+    def unix_socket_name(self) -> str:
+        """Name of the Unix domain socket for same-host connections."""
+        return self._info["unix_socket_name"]
+
     @property
     def tx_queue_size(self) -> int:
         """Size of the send queue for remote branches."""
@@ -232,6 +241,23 @@ class ConnectionLostEventInfo(BranchEventInfo):
         BranchEventInfo.__init__(self, info_string)
 
 
+class SlowConsumerEventInfo(BranchEventInfo):
+    """Information associated with the SLOW_CONSUMER event."""
+
+    def __init__(self, info_string: str):
+        BranchEventInfo.__init__(self, info_string)
+
+    @property
+    def policy(self) -> str:
+        """Applied policy ("drop", "conflate" or "disconnect")."""
+        return self._info["policy"]
+
+    @property
+    def backlog(self) -> int:
+        """Number of unsent broadcast bytes for the branch."""
+        return self._info["backlog"]
+
+
 yogi.YOGI_BranchCreate.restype = int
 yogi.YOGI_BranchCreate.argtypes = [
     POINTER(c_void_p), c_void_p, c_char_p, c_char_p, c_char_p, c_int]
@@ -269,10 +295,80 @@ yogi.YOGI_BranchReceiveBroadcastAsync.argtypes = [
     c_void_p, c_void_p, c_int, c_void_p, c_int,
     CFUNCTYPE(None, c_int, c_int, c_void_p), c_void_p]
 
+yogi.YOGI_BranchReceiveBroadcastLeaseAsync.restype = api_result_handler
+yogi.YOGI_BranchReceiveBroadcastLeaseAsync.argtypes = [
+    c_void_p,
+    CFUNCTYPE(None, c_int, c_void_p, c_void_p, c_int, c_void_p, c_void_p),
+    c_void_p]
+
+yogi.YOGI_BranchReceiveBroadcastsAsync.restype = api_result_handler
+yogi.YOGI_BranchReceiveBroadcastsAsync.argtypes = [
+    c_void_p, c_int, c_void_p, c_int,
+    CFUNCTYPE(None, c_int, c_int, c_int, c_void_p), c_void_p]
+
+yogi.YOGI_BranchReleaseBroadcastLease.restype = api_result_handler
+yogi.YOGI_BranchReleaseBroadcastLease.argtypes = [c_void_p]
+
 yogi.YOGI_BranchCancelReceiveBroadcast.restype = int
 yogi.YOGI_BranchCancelReceiveBroadcast.argtypes = [c_void_p]
 
 
+class BroadcastLease:
+    """Lease on a broadcast message received via
+    Branch.receive_broadcast_lease_async().
+
+    The payload of the message stays in the receive queue of the connection
+    that it arrived on until the lease gets released. No further messages will
+    be received from the sending branch until then.
+
+    The lease can be used as a context manager which releases the lease on
+    exit. Leases that have not been released explicitly get released once
+    they get garbage collected.
+    """
+
+    def __init__(self, handle: int, payload: PayloadView):
+        self._handle = handle
+        self._payload = payload
+
+    def __del__(self):
+        if self._handle is not None:
+            yogi.YOGI_BranchReleaseBroadcastLease(self._handle)
+
+    def __enter__(self) -> 'BroadcastLease':
+        return self
+
+    def __exit__(self, exc_type, exc_val, exc_tb):
+        self.release()
+
+    @property
+    def payload(self) -> PayloadView:
+        """View on the received MessagePack payload.
+
+        The view refers directly to the receive queue and must not be accessed
+        after the lease has been released.
+        """
+        return self._payload
+
+    @property
+    def released(self) -> bool:
+        """True if the lease has been released."""
+        return self._handle is None
+
+    def release(self) -> None:
+        """Releases the lease.
+
+        Calling this function on a lease that has already been released has no
+        effect.
+        """
+        if self._handle is None:
+            return
+
+        handle = self._handle
+        self._handle = None
+        self._payload = None
+        yogi.YOGI_BranchReleaseBroadcastLease(handle)
+
+
 class Branch(Object):
     """Entry point into a Yogi network.
 
@@ -468,6 +564,11 @@ class Branch(Object):
         """True if the branch is in ghost mode."""
         return self._info.ghost_mode
 
+    @property
+    def unix_socket_name(self) -> str:
+        """Name of the Unix domain socket for same-host connections."""
+        return self._info.unix_socket_name
+
     @property
     def tx_queue_size(self) -> int:
         """Size of the send queue for remote branches."""
@@ -558,6 +659,8 @@ class Branch(Object):
                     info = ConnectFinishedEventInfo(string)
                 elif event == BranchEvents.CONNECTION_LOST:
                     info = ConnectionLostEventInfo(string)
+                elif event == BranchEvents.SLOW_CONSUMER:
+                    info = SlowConsumerEventInfo(string)
                 else:
                     info = BranchEventInfo(string)
 
@@ -747,11 +850,109 @@ class Branch(Object):
                                                   encoding, buffer_ptr,
                                                   len(buffer), handler, None)
 
+    def receive_broadcasts_async(
+            self, buffer: bytearray,
+            fn: Callable[[Result, List[Tuple[UUID, PayloadView]]], Any], *,
+            encoding: EncodingType = EncodingType.MSGPACK) -> None:
+        """Receives multiple broadcast messages at once.
+
+        This function works like receive_broadcast_async(), however, all
+        broadcast messages queued by the branch (see the
+        rx_broadcast_queue_depth branch property) get written to buffer in one
+        go, as long as they fit. If no messages are queued, the operation
+        completes as soon as the next one has been received.
+
+        The handler fn gets called with a list of (source UUID, payload)
+        tuples; the payload views refer to buffer.
+
+        Messages that do not fit into buffer any more remain queued for the
+        next receive operation. If not even the first message fits, then fn
+        will be called with the BUFFER_TOO_SMALL error and the message will be
+        discarded.
+
+        This function shares its receive operation with
+        receive_broadcast_async(), i.e. calling either of them while a
+        previous receive operation is still active will cancel the previous
+        operation with the CANCELED error.
+
+        Args:
+            buffer:   Buffer to use for receiving the messages.
+            fn:       Handler to call for the received messages.
+            encoding: Encoding to use for the received payloads.
+        """
+        buffer_ptr = (c_char * len(buffer)).from_buffer(buffer)
+
+        def wrapped_fn(res, count, size):
+            # Each message is stored as the sender's UUID, the payload size as
+            # a 32 bit integer in host byte order and the payload itself
+            broadcasts = []
+            view = memoryview(buffer)
+            pos = 0
+            while res and pos < size:
+                uuid = UUID(bytes=bytes(view[pos:pos + 16]))
+                payload_size, = struct.unpack_from("=I", buffer, pos + 16)
+                pos += 20
+                payload = PayloadView(view[pos:pos + payload_size],
+                                      payload_size, encoding)
+                pos += payload_size
+                broadcasts.append((uuid, payload))
+
+            fn(res, broadcasts)
+
+        with Handler(yogi.YOGI_BranchReceiveBroadcastsAsync.argtypes[4],
+                     wrapped_fn) as handler:
+            yogi.YOGI_BranchReceiveBroadcastsAsync(self._handle, encoding,
+                                                   buffer_ptr, len(buffer),
+                                                   handler, None)
+
+    def receive_broadcast_lease_async(
+            self, fn: Callable[[Result, Optional[UUID], Optional[PayloadView],
+                                Optional[BroadcastLease]], Any]) -> None:
+        """Receives a broadcast message without copying its payload.
+
+        Instead of copying the received payload into a buffer, fn gets a view
+        directly into the receive queue of the connection that the message
+        arrived on. The payload is always encoded as MessagePack.
+
+        The payload stays valid until the lease passed to fn has been
+        released. No further messages will be received from the sending
+        branch until then; hence, leases should be released as soon as
+        possible, ideally from within fn.
+
+        This function shares its receive operation with
+        receive_broadcast_async(), i.e. calling either of them while a
+        previous receive operation is still active will cancel the previous
+        operation with the CANCELED error.
+
+        Args:
+            fn: Handler to call for the received broadcast message. On
+                failure, the UUID, the payload and the lease are None.
+        """
+        def wrapped_fn(res, uuid_ptr, data_ptr, size, lease_handle):
+            if not res:
+                fn(res, None, None, None)
+                return
+
+            uuid = UUID(bytes=string_at(uuid_ptr, 16))
+            if size:
+                data = memoryview((c_ubyte * size).from_address(data_ptr))
+                data = data.cast('B')
+            else:
+                data = memoryview(bytearray())
+            payload = PayloadView(data, size, EncodingType.MSGPACK)
+            fn(res, uuid, payload, BroadcastLease(lease_handle, payload))
+
+        with Handler(yogi.YOGI_BranchReceiveBroadcastLeaseAsync.argtypes[1],
+                     wrapped_fn) as handler:
+            yogi.YOGI_BranchReceiveBroadcastLeaseAsync(self._handle, handler,
+                                                       None)
+
     def cancel_receive_broadcast(self) -> bool:
         """Cancels a receive broadcast operation.
 
         Calling this function will cause the handler registered via
-        receive_broadcast_async() to be called with the CANCELED error.
+        receive_broadcast_async(), receive_broadcasts_async() or
+        receive_broadcast_lease_async() to be called with the CANCELED error.
 
         Note: If the receive handler has already been scheduled for execution
               this function will return False.
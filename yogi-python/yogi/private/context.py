@@ -19,14 +19,18 @@ from .library import yogi
 from .handler import inc_ref_cnt, dec_ref_cnt
 from .duration import Duration, duration_to_api_duration
 
-from typing import Callable, Any
-from ctypes import c_int, c_longlong, c_void_p, CFUNCTYPE, POINTER, byref, \
-    py_object
+import json
+from typing import Callable, Any, List, Dict
+from ctypes import c_int, c_longlong, c_void_p, c_char_p, CFUNCTYPE, POINTER, \
+    byref, py_object, create_string_buffer, sizeof
 
 
 yogi.YOGI_ContextCreate.restype = api_result_handler
 yogi.YOGI_ContextCreate.argtypes = [POINTER(c_void_p)]
 
+yogi.YOGI_ContextCreateWithThreads.restype = api_result_handler
+yogi.YOGI_ContextCreateWithThreads.argtypes = [POINTER(c_void_p), c_int]
+
 yogi.YOGI_ContextPoll.restype = api_result_handler
 yogi.YOGI_ContextPoll.argtypes = [c_void_p, POINTER(c_int)]
 
@@ -39,9 +43,15 @@ yogi.YOGI_ContextRun.argtypes = [c_void_p, POINTER(c_int), c_longlong]
 yogi.YOGI_ContextRunOne.restype = api_result_handler
 yogi.YOGI_ContextRunOne.argtypes = [c_void_p, POINTER(c_int), c_longlong]
 
+yogi.YOGI_ContextRunBusyPoll.restype = api_result_handler
+yogi.YOGI_ContextRunBusyPoll.argtypes = [c_void_p, POINTER(c_int), c_longlong]
+
 yogi.YOGI_ContextRunInBackground.restype = api_result_handler
 yogi.YOGI_ContextRunInBackground.argtypes = [c_void_p]
 
+yogi.YOGI_ContextRunInBackgroundBusyPoll.restype = api_result_handler
+yogi.YOGI_ContextRunInBackgroundBusyPoll.argtypes = [c_void_p, c_int]
+
 yogi.YOGI_ContextStop.restype = api_result_handler
 yogi.YOGI_ContextStop.argtypes = [c_void_p]
 
@@ -55,14 +65,43 @@ yogi.YOGI_ContextPost.restype = api_result_handler
 yogi.YOGI_ContextPost.argtypes = [c_void_p, CFUNCTYPE(None, c_void_p),
                                   c_void_p]
 
+yogi.YOGI_ContextPostBatch.restype = api_result_handler
+yogi.YOGI_ContextPostBatch.argtypes = [c_void_p, c_void_p, c_void_p, c_int]
+
+yogi.YOGI_ContextConfigureStats.restype = api_result_handler
+yogi.YOGI_ContextConfigureStats.argtypes = [c_void_p, c_int, c_longlong]
+
+yogi.YOGI_ContextGetStats.restype = api_result_handler
+yogi.YOGI_ContextGetStats.argtypes = [c_void_p, c_char_p, c_int, c_int]
+
+yogi.YOGI_ContextGroupCreate.restype = api_result_handler
+yogi.YOGI_ContextGroupCreate.argtypes = [POINTER(c_void_p), c_int]
+
+yogi.YOGI_ContextGroupGetContext.restype = int
+yogi.YOGI_ContextGroupGetContext.argtypes = [c_void_p, c_int,
+                                             POINTER(c_void_p)]
+
+yogi.YOGI_ContextGroupRunInBackground.restype = api_result_handler
+yogi.YOGI_ContextGroupRunInBackground.argtypes = [c_void_p, c_int]
+
+yogi.YOGI_ContextGroupStop.restype = api_result_handler
+yogi.YOGI_ContextGroupStop.argtypes = [c_void_p]
+
+yogi.YOGI_ContextGroupWaitForStopped.restype = api_result_handler
+yogi.YOGI_ContextGroupWaitForStopped.argtypes = [c_void_p, c_longlong]
+
 
 class Context(Object):
     """Scheduler for the execution of asynchronous operations."""
 
-    def __init__(self):
-        """Creates the context."""
+    def __init__(self, num_threads: int = 1):
+        """Creates the context.
+
+        Args:
+            num_threads: Number of threads running the context's handlers.
+        """
         handle = c_void_p()
-        yogi.YOGI_ContextCreate(byref(handle))
+        yogi.YOGI_ContextCreateWithThreads(byref(handle), num_threads)
         Object.__init__(self, handle)
 
     def poll(self) -> int:
@@ -148,6 +187,29 @@ class Context(Object):
         yogi.YOGI_ContextRunOne(self._handle, byref(n), dur)
         return n.value
 
+    def run_busy_poll(self, duration: Duration = None) -> int:
+        """Runs the context's event processing loop for the specified
+        duration without ever blocking.
+
+        This function behaves like run() but instead of sleeping while waiting
+        for events, it continuously polls for ready handlers. This keeps the
+        calling thread busy at 100% CPU load but avoids the latency of being
+        woken up by the operating system.
+
+        This function must be called from outside any handler functions that
+        are being executed through the context.
+
+        Args:
+            duration: Maximum amount of time to run.
+
+        Returns:
+            Number of executed handlers.
+        """
+        n = c_int()
+        dur = duration_to_api_duration(duration, Duration.infinity)
+        yogi.YOGI_ContextRunBusyPoll(self._handle, byref(n), dur)
+        return n.value
+
     def run_in_background(self) -> None:
         """Starts an internal thread for running the context's event
         processing loop.
@@ -163,6 +225,24 @@ class Context(Object):
         """
         yogi.YOGI_ContextRunInBackground(self._handle)
 
+    def run_in_background_busy_poll(self, cpu: int = -1) -> None:
+        """Starts internal threads for running the context's event processing
+        loop in busy-poll mode.
+
+        This function works like run_in_background() except that the threads
+        never block (see run_busy_poll()). Optionally, the threads can be
+        pinned to CPUs: the first thread gets pinned to cpu, the second one to
+        cpu + 1 and so on.
+
+        This function must be called from outside any handler functions that
+        are being executed through the context.
+
+        Args:
+            cpu: Index of the CPU to pin the first thread to (-1 to not pin
+                 the threads).
+        """
+        yogi.YOGI_ContextRunInBackgroundBusyPoll(self._handle, cpu)
+
     def stop(self) -> None:
         """Stops the context's event processing loop.
 
@@ -249,3 +329,191 @@ class Context(Object):
         except Exception:
             dec_ref_cnt(fn_obj)
             raise
+
+    def post_batch(self, fns: List[Callable[[], Any]]) -> None:
+        """Adds the given functions to the context's event processing queue as
+        a single handler and returns immediately.
+
+        The functions will be called one after another in the given order from
+        the same thread. Unlike posting each function individually, the batch
+        counts as one handler for run_one() and poll_one() and its functions
+        never run concurrently.
+
+        Args:
+            fns: The functions to call from within the context.
+        """
+        fns = list(fns)
+        n = len(fns)
+        if n == 0:
+            return
+
+        fn_obj = None
+
+        # userarg holds the 1-based index of the function since ctypes maps a
+        # null pointer to None
+        def clb(userarg):
+            if userarg == n:
+                dec_ref_cnt(fn_obj)
+            fns[userarg - 1]()
+
+        wrapped_fn = yogi.YOGI_ContextPost.argtypes[1](clb)
+        fn_obj = py_object(wrapped_fn)
+        inc_ref_cnt(fn_obj)
+
+        wrapped_fns = (type(wrapped_fn) * n)(*([wrapped_fn] * n))
+        userargs = (c_void_p * n)(*range(1, n + 1))
+
+        try:
+            yogi.YOGI_ContextPostBatch(self._handle, wrapped_fns, userargs, n)
+        except Exception:
+            dec_ref_cnt(fn_obj)
+            raise
+
+
+    def configure_stats(self, enable: bool,
+                        slow_threshold: Duration = None) -> None:
+        """Enables or disables recording statistics about the context's event
+        processing loop.
+
+        When enabled, the context measures the execution time of handlers, the
+        time that posted handlers spend waiting in the queue as well as the
+        number of queued handlers. Enabling the statistics resets them.
+
+        Handlers taking longer than slow_threshold to execute get reported via
+        a warning log entry.
+
+        Args:
+            enable:         True to enable and False to disable the
+                            statistics.
+            slow_threshold: Execution time above which handlers are considered
+                            slow (None or infinity to never report slow
+                            handlers).
+        """
+        thresh = duration_to_api_duration(slow_threshold, Duration.infinity)
+        yogi.YOGI_ContextConfigureStats(self._handle, 1 if enable else 0,
+                                        thresh)
+
+    def get_stats(self, reset: bool = False) -> Dict[str, Any]:
+        """Retrieves the statistics about the context's event processing
+        loop.
+
+        See YOGI_ContextGetStats() in yogi_core.h for the structure of the
+        returned JSON object. All times are in seconds.
+
+        Args:
+            reset: Reset the statistics after reading them.
+
+        Returns:
+            The statistics.
+        """
+        s = create_string_buffer(256)
+        while True:
+            try:
+                yogi.YOGI_ContextGetStats(self._handle, s, sizeof(s), 0)
+                break
+            except FailureException as e:
+                if e.failure.error_code is ErrorCode.BUFFER_TOO_SMALL:
+                    s = create_string_buffer(sizeof(s) * 2)
+                else:
+                    raise
+
+        if reset:
+            # The statistics get reset even if they do not fit into the
+            # buffer, so retrying with a larger buffer would lose them; the
+            # JSON only grows slightly between the two calls though
+            s = create_string_buffer(sizeof(s) * 2 + 1024)
+            yogi.YOGI_ContextGetStats(self._handle, s, sizeof(s), 1)
+
+        return json.loads(s.value.decode("utf-8"))
+
+class ContextGroup(Object):
+    """Group of contexts, each running its event processing loop in a thread
+    of its own.
+
+    A branch created on one of the group's contexts distributes its
+    connections over all contexts of the group. Handlers for operations on
+    such a branch get called from the thread of whichever context handles the
+    connection that caused them to be called.
+
+    The contexts of the group are regular contexts; they get destroyed after
+    the group.
+    """
+
+    def __init__(self, num_contexts: int = 0):
+        """Creates the context group.
+
+        Args:
+            num_contexts: Number of contexts to create; 0 creates one context
+                          per CPU core.
+        """
+        handle = c_void_p()
+        yogi.YOGI_ContextGroupCreate(byref(handle), num_contexts)
+
+        contexts = []
+        while True:
+            ctx_handle = c_void_p()
+            res = yogi.YOGI_ContextGroupGetContext(handle, len(contexts),
+                                                   byref(ctx_handle))
+            if res == ErrorCode.INVALID_PARAM:
+                break
+            api_result_handler(res)
+
+            context = Context.__new__(Context)
+            Object.__init__(context, ctx_handle)
+            contexts.append(context)
+
+        # The contexts are dependencies so that they get destroyed after the
+        # group
+        Object.__init__(self, handle, contexts)
+        self._contexts = contexts
+
+    @property
+    def contexts(self) -> List[Context]:
+        """The contexts of the group."""
+        return list(self._contexts)
+
+    def __len__(self) -> int:
+        return len(self._contexts)
+
+    def __getitem__(self, index: int) -> Context:
+        return self._contexts[index]
+
+    def run_in_background(self, pin: bool = False) -> None:
+        """Runs the event processing loops of all contexts in the group, each
+        in its own background thread.
+
+        If pin is True, the thread of the context with index i gets pinned to
+        CPU core i (modulo the number of cores). On platforms that do not
+        support this, a warning is logged and the threads run unpinned.
+
+        Args:
+            pin: Pin the threads to CPU cores.
+        """
+        yogi.YOGI_ContextGroupRunInBackground(self._handle, 1 if pin else 0)
+
+    def stop(self) -> None:
+        """Stops the event processing loops of all contexts in the group."""
+        yogi.YOGI_ContextGroupStop(self._handle)
+
+    def wait_for_stopped(self, duration: Duration = None) -> bool:
+        """Blocks until no context in the group is running its event
+        processing loop any more or until the specified timeout is reached.
+
+        Args:
+            duration: Maximum time to wait.
+
+        Returns:
+            True if no context is running its event processing loop within
+            the specified duration and False otherwise.
+        """
+        dur = duration_to_api_duration(duration, Duration.infinity)
+
+        try:
+            yogi.YOGI_ContextGroupWaitForStopped(self._handle, dur)
+        except FailureException as e:
+            if e.failure.error_code is ErrorCode.TIMEOUT:
+                return False
+            else:
+                raise
+
+        return True
@@ -35,13 +35,14 @@ class PayloadView:
     """Helper class for passing and converting different types of user payload.
     """
 
-    def __init__(self, buf_or_view: Union[bytearray, JsonView, MsgpackView],
+    def __init__(self, buf_or_view: Union[bytearray, memoryview, JsonView,
+                                          MsgpackView],
                  size: Optional[int] = None,
                  encoding: Optional[EncodingType] = None):
         """Constructs a view from a buffer, a JsonView or a MsgpackView.
 
         Args:
-            buf_or_view: Byte array, JsonView or MsgpackView.
+            buf_or_view: Byte array, memory view, JsonView or MsgpackView.
             size:        Data size in the bytes array.
             encoding:    Encoding of the data in the bytes array.
         """
@@ -57,7 +58,7 @@ class PayloadView:
             self._memview = buf_or_view.data
             self._size = buf_or_view.size
             self._encoding = EncodingType.MSGPACK
-        elif isinstance(buf_or_view, bytearray):
+        elif isinstance(buf_or_view, (bytearray, memoryview)):
             assert size is not None
             assert encoding is not None
             self._memview = memoryview(buf_or_view)[:size]